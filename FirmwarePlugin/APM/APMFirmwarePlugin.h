@@ -87,6 +87,8 @@ public:
     void                adjustOutgoingMavlinkMessage    (Vehicle* vehicle, LinkInterface* outgoingLink, mavlink_message_t* message) final;
     void                initializeVehicle               (Vehicle* vehicle) final;
     bool                sendHomePositionToVehicle       (void) final;
+    bool                supportsMissionWritePartialList (void) final { return true; }
+    bool                supportsMissionReadWindow       (void) final { return true; }
     void                addMetaDataToFact               (QObject* parameterMetaData, Fact* fact, MAV_TYPE vehicleType) final;
     QString             getDefaultComponentIdParam      (void) const final { return QString("SYSID_SW_TYPE"); }
     QString             missionCommandOverrides         (MAV_TYPE vehicleType) const;
@@ -134,6 +134,16 @@ void FirmwarePlugin::initializeVehicle(Vehicle* vehicle)
     // Generic Flight Stack is by definition "generic", so no extra work
 }
 
+bool FirmwarePlugin::supportsMissionWritePartialList(void)
+{
+    return false;
+}
+
+bool FirmwarePlugin::supportsMissionReadWindow(void)
+{
+    return false;
+}
+
 bool FirmwarePlugin::sendHomePositionToVehicle(void)
 {
     // Generic stack does not want home position sent in the first position.
@@ -189,6 +189,14 @@ public:
     ///     false: Do not send first item to vehicle, sequence numbers must be adjusted
     virtual bool sendHomePositionToVehicle(void);
 
+    /// @return true: Firmware accepts MISSION_WRITE_PARTIAL_LIST, so changed mission items can be written
+    ///                 without sending the whole mission again
+    virtual bool supportsMissionWritePartialList(void);
+
+    /// @return true: Firmware answers MISSION_REQUESTs for any item in any order, so several can be kept in
+    ///                 flight while reading a mission. false: only the next item or a repeat of the last one.
+    virtual bool supportsMissionReadWindow(void);
+
     /// Returns the parameter that is used to identify the default component
     virtual QString getDefaultComponentIdParam(void) const { return QString(); }
 
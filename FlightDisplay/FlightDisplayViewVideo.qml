@@ -142,6 +142,10 @@ Item {
             //console.log("Target : " + rotation + " " + tl_x + " " + tl_y + " " + rb_x + " " + rb_y
             //            + " " + Math.abs(rb_x - tl_x) + " " + Math.abs(rb_y - tl_y))
         }
+        onTx1StatusTrackedTargetCleared:{
+            trackedZoom.visible = false
+            trackedZoom1.visible = false
+        }
         onTx1StatusFeaturePointChanged:{
 
 //            m = root.width*x/1280
@@ -124,6 +124,9 @@ Item {
 
 
 
+        }
+        onTx1StatusTrackedTargetCleared:{
+            trackingActivePoints=0
         }
     }
     function setCurrentItem(sequenceNumber) {
@@ -442,6 +442,7 @@ void VideoManager::setSaveImage(bool saveImage){
 }
 void VideoManager::setCarInfo(bool carInfo){
     _carInfo = carInfo;
+    _videoReceiver->setPlateRecognition(carInfo);
    _videoReceiver->setRoi(_location);
     car->setSaveImg(false);
     if(car&&_trackFlag)car->start();
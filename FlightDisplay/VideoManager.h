@@ -62,6 +62,7 @@ public:
     bool        hasVideo            ();
     bool        isGStreamer         ();
     bool        videoRunning        () { return _videoRunning; }
+    VideoReceiver* videoReceiver    () { return _videoReceiver; }
     QString     videoSourceID       () { return _videoSourceID; }
     QString     inf                 () { return _inf;}
     QString     updateInf           () {return _updateInf;}
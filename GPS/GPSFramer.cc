@@ -0,0 +1,253 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "GPSFramer.h"
+
+const uint8_t GPSFramer::ubxSync1;
+const uint8_t GPSFramer::ubxSync2;
+const uint8_t GPSFramer::rtcm3Preamble;
+
+GPSFramer::GPSFramer(Client* client)
+    : _client(client)
+    , _bytesReceived(0)
+    , _ubxFrames(0)
+    , _rtcmFrames(0)
+    , _checksumErrors(0)
+    , _parseErrors(0)
+    , _droppedBytes(0)
+{
+
+}
+
+const uint8_t* GPSFramer::_byteTable(void)
+{
+    struct Table {
+        uint8_t flags[256];
+
+        Table(void) {
+            // UBX message classes sent by u-blox receivers: NAV, RXM, INF, ACK, CFG, UPD, MON, AID, TIM, ESF, MGA, LOG, SEC, HNR
+            static const uint8_t rgClasses[] = { 0x01, 0x02, 0x04, 0x05, 0x06, 0x09, 0x0A, 0x0B, 0x0D, 0x10, 0x13, 0x21, 0x27, 0x28 };
+
+            for (int i=0; i<256; i++) {
+                flags[i] = 0;
+            }
+            flags[ubxSync1] |= ByteUBXSync;
+            flags[rtcm3Preamble] |= ByteRTCM3Sync;
+            for (size_t i=0; i<sizeof(rgClasses); i++) {
+                flags[rgClasses[i]] |= ByteUBXClass;
+            }
+        }
+    };
+    static const Table table;
+
+    return table.flags;
+}
+
+const uint32_t* GPSFramer::_crc24qTable(void)
+{
+    struct Table {
+        uint32_t crc[256];
+
+        Table(void) {
+            const uint32_t polynomial = 0x1864CFB;
+
+            for (uint32_t i=0; i<256; i++) {
+                uint32_t crc = i << 16;
+                for (int bit=0; bit<8; bit++) {
+                    crc <<= 1;
+                    if (crc & 0x1000000) {
+                        crc ^= polynomial;
+                    }
+                }
+                this->crc[i] = crc & 0xFFFFFF;
+            }
+        }
+    };
+    static const Table table;
+
+    return table.crc;
+}
+
+uint32_t GPSFramer::crc24q(const uint8_t* data, int length)
+{
+    const uint32_t* table = _crc24qTable();
+
+    uint32_t crc = 0;
+    for (int i=0; i<length; i++) {
+        crc = ((crc << 8) & 0xFFFFFF) ^ table[((crc >> 16) ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+void GPSFramer::ubxChecksum(const uint8_t* data, int length, uint8_t& ckA, uint8_t& ckB)
+{
+    // Sums kept in full ints and truncated once at the end
+    unsigned int a = 0;
+    unsigned int b = 0;
+    for (int i=0; i<length; i++) {
+        a += data[i];
+        b += a;
+    }
+    ckA = (uint8_t)a;
+    ckB = (uint8_t)b;
+}
+
+void GPSFramer::reset(void)
+{
+    _drop(_pending.count());
+    _pending.clear();
+}
+
+GPSFramer::Stats_t GPSFramer::stats(void) const
+{
+    Stats_t stats;
+
+    stats.bytesReceived     = _bytesReceived.load(std::memory_order_relaxed);
+    stats.ubxFrames         = _ubxFrames.load(std::memory_order_relaxed);
+    stats.rtcmFrames        = _rtcmFrames.load(std::memory_order_relaxed);
+    stats.checksumErrors    = _checksumErrors.load(std::memory_order_relaxed);
+    stats.parseErrors       = _parseErrors.load(std::memory_order_relaxed);
+    stats.droppedBytes      = _droppedBytes.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+void GPSFramer::addBytes(const uint8_t* data, int length)
+{
+    _bytesReceived.fetch_add(length, std::memory_order_relaxed);
+
+    if (_pending.isEmpty()) {
+        // Frame straight out of the caller's buffer, only a trailing partial frame is copied
+        int used = _process(data, length);
+        if (used < length) {
+            _pending.append((const char*)data + used, length - used);
+        }
+    } else {
+        _pending.append((const char*)data, length);
+        int used = _process((const uint8_t*)_pending.constData(), _pending.count());
+        _pending.remove(0, used);
+    }
+}
+
+int GPSFramer::_process(const uint8_t* data, int length)
+{
+    const uint8_t* byteTable = _byteTable();
+
+    int pos = 0;
+    while (pos < length) {
+        // Skip to the next sync byte
+        int start = pos;
+        while (pos < length && !(byteTable[data[pos]] & (ByteUBXSync | ByteRTCM3Sync))) {
+            pos++;
+        }
+        if (pos > start) {
+            _drop(pos - start);
+        }
+        if (pos == length) {
+            break;
+        }
+
+        bool ubx = byteTable[data[pos]] & ByteUBXSync;
+        int frameLength = ubx ? _frameUBX(data + pos, length - pos) : _frameRTCM3(data + pos, length - pos);
+
+        if (frameLength == 0) {
+            // Wait for the rest of the frame
+            break;
+        } else if (frameLength < 0) {
+            // False sync, look again from the next byte
+            _drop(1);
+            pos++;
+        } else {
+            if (ubx) {
+                _ubxFrames.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                _rtcmFrames.fetch_add(1, std::memory_order_relaxed);
+            }
+            _client->frameReceived(ubx ? FrameType::UBX : FrameType::RTCM3, data + pos, frameLength);
+            pos += frameLength;
+        }
+    }
+
+    return pos;
+}
+
+int GPSFramer::_frameUBX(const uint8_t* data, int length)
+{
+    // Header is checked as it arrives so a false sync doesn't hold up the stream waiting for a bogus length
+    if (length < 3) {
+        return 0;
+    }
+    if (data[1] != ubxSync2 || !(_byteTable()[data[2]] & ByteUBXClass)) {
+        _parseErrors.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    if (length < ubxHeaderLength) {
+        return 0;
+    }
+
+    int payloadLength = data[4] | (data[5] << 8);
+    if (payloadLength > ubxMaxPayload) {
+        _parseErrors.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+
+    int frameLength = ubxHeaderLength + payloadLength + 2;
+    if (length < frameLength) {
+        return 0;
+    }
+
+    // Checksum covers class, id, length and payload
+    uint8_t ckA, ckB;
+    ubxChecksum(data + 2, frameLength - 4, ckA, ckB);
+    if (ckA != data[frameLength - 2] || ckB != data[frameLength - 1]) {
+        _checksumErrors.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+
+    return frameLength;
+}
+
+int GPSFramer::_frameRTCM3(const uint8_t* data, int length)
+{
+    if (length < 2) {
+        return 0;
+    }
+    if (data[1] & 0xFC) {
+        // Reserved bits must be zero
+        _parseErrors.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    if (length < rtcm3HeaderLength + 2) {
+        return 0;
+    }
+
+    // Every message starts with a 12 bit message number: 1001-1300 standard, 4001-4095 proprietary
+    int payloadLength = ((data[1] & 0x03) << 8) | data[2];
+    int messageNumber = (data[3] << 4) | (data[4] >> 4);
+    if (payloadLength < 2 || !((messageNumber >= 1001 && messageNumber <= 1300) || messageNumber >= 4001)) {
+        _parseErrors.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+
+    int frameLength = rtcm3HeaderLength + payloadLength + rtcm3CrcLength;
+    if (length < frameLength) {
+        return 0;
+    }
+
+    // CRC covers everything before it
+    const uint8_t* crcBytes = data + frameLength - rtcm3CrcLength;
+    uint32_t crc = (crcBytes[0] << 16) | (crcBytes[1] << 8) | crcBytes[2];
+    if (crc24q(data, frameLength - rtcm3CrcLength) != crc) {
+        _checksumErrors.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+
+    return frameLength;
+}
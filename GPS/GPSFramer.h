@@ -0,0 +1,107 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#pragma once
+
+#include <QByteArray>
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ ** class GPSFramer
+ * Splits the raw byte stream from a u-blox receiver into UBX and RTCM3 frames.
+ *
+ * Bytes are handed over in blocks as they come off the port. Sync bytes and UBX classes are checked with
+ * a lookup table, each frame's checksum (UBX Fletcher-8, RTCM3 CRC-24Q) is checked over the whole frame at
+ * once and only complete, valid frames reach the client. Anything else, NMEA or line noise, is counted and
+ * dropped. After a bad frame the search restarts one byte later, so a good frame hidden behind a false sync
+ * is not lost.
+ */
+class GPSFramer
+{
+public:
+    enum class FrameType {
+        UBX,
+        RTCM3
+    };
+
+    class Client
+    {
+    public:
+        virtual ~Client() {}
+
+        /// Called from addBytes for each complete frame, sync bytes and checksum included. The frame is
+        /// only valid for the duration of the call.
+        virtual void frameReceived(FrameType type, const uint8_t* frame, int length) = 0;
+    };
+
+    typedef struct {
+        quint64 bytesReceived;
+        quint64 ubxFrames;
+        quint64 rtcmFrames;
+        quint64 checksumErrors;     ///< Frames with a good header and a bad checksum
+        quint64 parseErrors;        ///< Sync bytes followed by an impossible header
+        quint64 droppedBytes;       ///< Bytes which were not part of a valid frame
+    } Stats_t;
+
+    GPSFramer(Client* client);
+
+    /// Adds bytes read from the receiver. Partial frames are kept until the rest arrives.
+    void addBytes(const uint8_t* data, int length);
+
+    /// Drops any partial frame, for example after a baud rate change
+    void reset(void);
+
+    /// @return Counters since construction. Thread safe.
+    Stats_t stats(void) const;
+
+    static uint32_t crc24q(const uint8_t* data, int length);
+    static void ubxChecksum(const uint8_t* data, int length, uint8_t& ckA, uint8_t& ckB);
+
+    static const uint8_t ubxSync1 = 0xB5;
+    static const uint8_t ubxSync2 = 0x62;
+    static const uint8_t rtcm3Preamble = 0xD3;
+
+    static const int ubxHeaderLength = 6;       ///< Sync, class, id, length
+    static const int ubxMaxPayload = 8192;
+    static const int rtcm3HeaderLength = 3;     ///< Preamble, 6 reserved bits, 10 bit length
+    static const int rtcm3CrcLength = 3;
+
+private:
+    /// Flags in the byte table
+    enum {
+        ByteUBXSync     = 1,
+        ByteRTCM3Sync   = 2,
+        ByteUBXClass    = 4,    ///< Message class the receiver sends
+    };
+
+    /// @return Number of bytes used from the start of data, the rest is an incomplete frame
+    int _process(const uint8_t* data, int length);
+
+    /// @return Frame length, 0 if more bytes are needed, -1 if there is no valid frame at the start of data
+    int _frameUBX   (const uint8_t* data, int length);
+    int _frameRTCM3 (const uint8_t* data, int length);
+
+    void _drop(int count) { _droppedBytes.fetch_add(count, std::memory_order_relaxed); }
+
+    Client*     _client;
+    QByteArray  _pending;               ///< Bytes of a frame which is not complete yet
+
+    std::atomic<quint64> _bytesReceived;
+    std::atomic<quint64> _ubxFrames;
+    std::atomic<quint64> _rtcmFrames;
+    std::atomic<quint64> _checksumErrors;
+    std::atomic<quint64> _parseErrors;
+    std::atomic<quint64> _droppedBytes;
+
+    static const uint8_t*   _byteTable(void);
+    static const uint32_t*  _crc24qTable(void);
+};
@@ -0,0 +1,205 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "GPSFramerTest.h"
+#include "GPSFramer.h"
+
+#include <QFile>
+
+/// Keeps every frame the framer hands out
+class GPSFrameRecorder : public GPSFramer::Client
+{
+public:
+    void frameReceived(GPSFramer::FrameType type, const uint8_t* frame, int length) final
+    {
+        types.append(type);
+        frames.append(QByteArray((const char*)frame, length));
+    }
+
+    QList<GPSFramer::FrameType> types;
+    QList<QByteArray>           frames;
+};
+
+GPSFramerTest::GPSFramerTest(void)
+{
+
+}
+
+QByteArray GPSFramerTest::_ubxFrame(uint8_t msgClass, uint8_t msgId, int payloadLength)
+{
+    QByteArray frame;
+    frame.append((char)GPSFramer::ubxSync1);
+    frame.append((char)GPSFramer::ubxSync2);
+    frame.append((char)msgClass);
+    frame.append((char)msgId);
+    frame.append((char)(payloadLength & 0xFF));
+    frame.append((char)(payloadLength >> 8));
+    for (int i=0; i<payloadLength; i++) {
+        frame.append((char)((i * 7) & 0x7F));
+    }
+
+    uint8_t ckA, ckB;
+    GPSFramer::ubxChecksum((const uint8_t*)frame.constData() + 2, frame.count() - 2, ckA, ckB);
+    frame.append((char)ckA);
+    frame.append((char)ckB);
+
+    return frame;
+}
+
+QByteArray GPSFramerTest::_rtcm3Frame(int messageNumber, int payloadLength)
+{
+    QByteArray frame;
+    frame.append((char)GPSFramer::rtcm3Preamble);
+    frame.append((char)(payloadLength >> 8));
+    frame.append((char)(payloadLength & 0xFF));
+    frame.append((char)(messageNumber >> 4));
+    frame.append((char)((messageNumber & 0x0F) << 4));
+    for (int i=2; i<payloadLength; i++) {
+        frame.append((char)((i * 13) & 0x7F));
+    }
+
+    uint32_t crc = GPSFramer::crc24q((const uint8_t*)frame.constData(), frame.count());
+    frame.append((char)(crc >> 16));
+    frame.append((char)(crc >> 8));
+    frame.append((char)crc);
+
+    return frame;
+}
+
+void GPSFramerTest::_testChecksums(void)
+{
+    // CRC-24Q check value
+    QCOMPARE(GPSFramer::crc24q((const uint8_t*)"123456789", 9), (uint32_t)0xCDE703);
+
+    // MON-VER poll: B5 62 0A 04 00 00 0E 34
+    const uint8_t monVerPoll[] = { 0x0A, 0x04, 0x00, 0x00 };
+    uint8_t ckA, ckB;
+    GPSFramer::ubxChecksum(monVerPoll, sizeof(monVerPoll), ckA, ckB);
+    QCOMPARE(ckA, (uint8_t)0x0E);
+    QCOMPARE(ckB, (uint8_t)0x34);
+}
+
+void GPSFramerTest::_testFraming(void)
+{
+    QList<QByteArray> expectedFrames;
+    expectedFrames << _ubxFrame(0x01, 0x3B, 40)     // NAV-SVIN
+                   << _rtcm3Frame(1005, 19)
+                   << _rtcm3Frame(1077, 400)
+                   << _ubxFrame(0x05, 0x01, 2)      // ACK-ACK
+                   << _rtcm3Frame(1230, 6)
+                   << _rtcm3Frame(4072, 200);       // u-blox proprietary
+
+    // NMEA sentence and a frame with a bad CRC mixed in, neither contains a sync byte after its start
+    QByteArray nmea("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n");
+    QByteArray badFrame = _rtcm3Frame(1087, 120);
+    badFrame[badFrame.count() - 3] = 0;
+    badFrame[badFrame.count() - 2] = 0;
+    badFrame[badFrame.count() - 1] = 0;
+
+    QByteArray stream;
+    stream.append(expectedFrames[0]);
+    stream.append(nmea);
+    stream.append(expectedFrames[1]);
+    stream.append(expectedFrames[2]);
+    stream.append(badFrame);
+    stream.append(expectedFrames[3]);
+    stream.append(expectedFrames[4]);
+    stream.append(nmea);
+    stream.append(expectedFrames[5]);
+
+    // Chunk sizes which split headers, payloads and checksums in every possible place
+    for (int chunkSize=1; chunkSize<=97; chunkSize+=12) {
+        GPSFrameRecorder recorder;
+        GPSFramer framer(&recorder);
+
+        for (int i=0; i<stream.count(); i+=chunkSize) {
+            framer.addBytes((const uint8_t*)stream.constData() + i, qMin(chunkSize, stream.count() - i));
+        }
+
+        QCOMPARE(recorder.frames, expectedFrames);
+        QCOMPARE(recorder.types[0], GPSFramer::FrameType::UBX);
+        QCOMPARE(recorder.types[1], GPSFramer::FrameType::RTCM3);
+        QCOMPARE(recorder.types[3], GPSFramer::FrameType::UBX);
+
+        GPSFramer::Stats_t stats = framer.stats();
+        QCOMPARE(stats.bytesReceived, (quint64)stream.count());
+        QCOMPARE(stats.ubxFrames, (quint64)2);
+        QCOMPARE(stats.rtcmFrames, (quint64)4);
+        QCOMPARE(stats.checksumErrors, (quint64)1);
+        QCOMPARE(stats.droppedBytes, (quint64)(nmea.count() * 2 + badFrame.count()));
+    }
+
+    // A partial frame is dropped on reset and the next frame still comes through
+    GPSFrameRecorder recorder;
+    GPSFramer framer(&recorder);
+    QByteArray frame = _rtcm3Frame(1005, 19);
+    framer.addBytes((const uint8_t*)frame.constData(), 10);
+    framer.reset();
+    framer.addBytes((const uint8_t*)frame.constData(), frame.count());
+    QCOMPARE(recorder.frames.count(), 1);
+    QCOMPARE(recorder.frames[0], frame);
+    QCOMPARE(framer.stats().droppedBytes, (quint64)10);
+}
+
+QByteArray GPSFramerTest::_loadCapture(void)
+{
+    QByteArray capture;
+
+    QByteArray capturePath = qgetenv("QGC_GPS_BENCHMARK_FILE");
+    if (!capturePath.isEmpty()) {
+        QFile file(QString::fromLocal8Bit(capturePath));
+        if (file.open(QIODevice::ReadOnly)) {
+            capture = file.readAll();
+        }
+    }
+
+    if (capture.isEmpty()) {
+        // One second of RTK base output: MSM7 GPS and GLONASS, station position, GLONASS biases and survey-in status
+        QByteArray second;
+        second.append(_rtcm3Frame(1005, 19));
+        second.append(_rtcm3Frame(1077, 436));
+        second.append(_rtcm3Frame(1087, 352));
+        second.append(_rtcm3Frame(1230, 6));
+        second.append(_ubxFrame(0x01, 0x3B, 40));
+        while (capture.count() < 8 * 1024 * 1024) {
+            capture.append(second);
+        }
+    }
+
+    return capture;
+}
+
+void GPSFramerTest::_benchmarkFraming(void)
+{
+    QByteArray capture = _loadCapture();
+    const uint8_t* data = (const uint8_t*)capture.constData();
+
+    // Block reads as the GPS thread does them now, and a byte at a time as the driver parser used to see them
+    int rgBlockSizes[] = { 16384, 1 };
+    for (size_t i=0; i<sizeof(rgBlockSizes) / sizeof(rgBlockSizes[0]); i++) {
+        GPSFrameRecorder recorder;
+        GPSFramer framer(&recorder);
+
+        for (int j=0; j<capture.count(); j+=rgBlockSizes[i]) {
+            framer.addBytes(data + j, qMin(rgBlockSizes[i], capture.count() - j));
+            if (recorder.frames.count() > 1024) {
+                recorder.frames.clear();
+                recorder.types.clear();
+            }
+        }
+
+        GPSFramer::Stats_t stats = framer.stats();
+        QVERIFY(stats.ubxFrames + stats.rtcmFrames > 0);
+        QCOMPARE(stats.bytesReceived, (quint64)capture.count());
+        if (qgetenv("QGC_GPS_BENCHMARK_FILE").isEmpty()) {
+            QCOMPARE(stats.checksumErrors + stats.parseErrors + stats.droppedBytes, (quint64)0);
+        }
+    }
+}
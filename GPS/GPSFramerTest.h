@@ -0,0 +1,38 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef GPSFramerTest_H
+#define GPSFramerTest_H
+
+#include "UnitTest.h"
+
+/// Unit test and benchmark for GPSFramer
+///
+/// The benchmark runs over the captured receiver output named by the QGC_GPS_BENCHMARK_FILE environment
+/// variable if it is set, otherwise over a generated RTK base station stream.
+class GPSFramerTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    GPSFramerTest(void);
+
+private slots:
+    void _testChecksums(void);
+    void _testFraming(void);
+    void _benchmarkFraming(void);
+
+private:
+    QByteArray _ubxFrame    (uint8_t msgClass, uint8_t msgId, int payloadLength);
+    QByteArray _rtcm3Frame  (int messageNumber, int payloadLength);
+    QByteArray _loadCapture (void);
+};
+
+#endif
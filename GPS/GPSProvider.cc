@@ -13,6 +13,7 @@
 #define GPS_RECEIVE_TIMEOUT 1200
 
 #include <QDebug>
+#include <QElapsedTimer>
 
 #include "Drivers/src/ubx.h"
 #include "Drivers/src/gps_helper.h"
@@ -96,11 +97,14 @@ void GPSProvider::run()
             }
         }
     }
+    GPSFramer::Stats_t stats = _framer.stats();
+    qDebug() << "GPS framing: bytes" << stats.bytesReceived << "ubx" << stats.ubxFrames << "rtcm" << stats.rtcmFrames
+             << "checksum errors" << stats.checksumErrors << "parse errors" << stats.parseErrors << "dropped bytes" << stats.droppedBytes;
     qDebug() << "Exiting GPS thread";
 }
 
 GPSProvider::GPSProvider(const QString& device, bool enableSatInfo, const std::atomic_bool& requestStop)
-    : _device(device), _requestStop(requestStop)
+    : _device(device), _requestStop(requestStop), _framer(this)
 {
     if (enableSatInfo) _pReportSatInfo = new satellite_info_s();
 }
@@ -131,6 +135,42 @@ void GPSProvider::gotRTCMData(uint8_t* data, size_t len)
     emit RTCMDataUpdate(message);
 }
 
+void GPSProvider::frameReceived(GPSFramer::FrameType type, const uint8_t* frame, int length)
+{
+    if (type == GPSFramer::FrameType::RTCM3) {
+        // Checked by the framer already, the driver's own RTCM path is never reached
+        gotRTCMData((uint8_t*) frame, length);
+    } else {
+        _ubxBytes.append((const char*) frame, length);
+    }
+}
+
+int GPSProvider::_readDeviceData(uint8_t *buf, int bufLength, int timeout)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // RTCM3 and noise never reach the driver, keep reading until there is something for it
+    while (_ubxBytes.isEmpty()) {
+        if (_serial->bytesAvailable() == 0) {
+            int remaining = timeout - (int)timer.elapsed();
+            if (remaining <= 0 || !_serial->waitForReadyRead(remaining)) {
+                return 0; //timeout
+            }
+        }
+        qint64 count = _serial->read((char*) _readBuffer, _readBufferSize);
+        if (count < 0) {
+            return -1;
+        }
+        _framer.addBytes(_readBuffer, (int)count);
+    }
+
+    int count = qMin(bufLength, _ubxBytes.count());
+    memcpy(buf, _ubxBytes.constData(), count);
+    _ubxBytes.remove(0, count);
+    return count;
+}
+
 int GPSProvider::callbackEntry(GPSCallbackType type, void *data1, int data2, void *user)
 {
     GPSProvider *gps = (GPSProvider *)user;
@@ -141,12 +181,8 @@ int GPSProvider::callback(GPSCallbackType type, void *data1, int data2)
 {
     switch (type) {
         case GPSCallbackType::readDeviceData: {
-            if (_serial->bytesAvailable() == 0) {
-                int timeout = *((int *) data1);
-                if (!_serial->waitForReadyRead(timeout))
-                    return 0; //timeout
-            }
-            return (int)_serial->read((char*) data1, data2);
+            int timeout = *((int *) data1);
+            return _readDeviceData((uint8_t*) data1, data2, timeout);
         }
         case GPSCallbackType::writeDeviceData:
             if (_serial->write((char*) data1, data2) >= 0) {
@@ -156,6 +192,9 @@ int GPSProvider::callback(GPSCallbackType type, void *data1, int data2)
             return -1;
 
         case GPSCallbackType::setBaudrate:
+            // Anything buffered was received at the old rate
+            _framer.reset();
+            _ubxBytes.clear();
             return _serial->setBaudRate(data2) ? 0 : -1;
 
         case GPSCallbackType::gotRTCMMessage:
@@ -18,14 +18,18 @@
 #include <atomic>
 
 #include "GPSPositionMessage.h"
+#include "GPSFramer.h"
 #include "Drivers/src/gps_helper.h"
 
 
 /**
  ** class GPSProvider
  * opens a GPS device and handles the protocol
+ *
+ * The port is read in large blocks and split into frames by GPSFramer before the driver sees anything.
+ * RTCM3 frames go straight out through RTCMDataUpdate, only UBX frames are passed on to the driver.
  */
-class GPSProvider : public QThread
+class GPSProvider : public QThread, public GPSFramer::Client
 {
     Q_OBJECT
 public:
@@ -36,6 +40,10 @@ public:
      * this is called by the callback method
      */
     void gotRTCMData(uint8_t *data, size_t len);
+
+    /// @return Framing counters for the port. Thread safe.
+    GPSFramer::Stats_t framerStats(void) const { return _framer.stats(); }
+
 signals:
     void positionUpdate(GPSPositionMessage message);
     void satelliteInfoUpdate(GPSSatelliteMessage message);
@@ -45,6 +53,9 @@ protected:
     void run();
 
 private:
+    // Overrides from GPSFramer::Client
+    void frameReceived(GPSFramer::FrameType type, const uint8_t* frame, int length) final;
+
     void publishGPSPosition();
     void publishGPSSatellite();
 
@@ -55,6 +66,11 @@ private:
 
 	int callback(GPSCallbackType type, void *data1, int data2);
 
+    /// Hands framed UBX bytes to the driver, reading blocks from the port until there are some
+    ///     @param timeout Msecs to wait for data
+    /// @return Bytes copied to buf, 0 on timeout, -1 on a port error
+    int _readDeviceData(uint8_t *buf, int bufLength, int timeout);
+
     QString _device;
     const std::atomic_bool& _requestStop;
 
@@ -62,4 +78,10 @@ private:
 	struct satellite_info_s		*_pReportSatInfo = nullptr;
 
 	QSerialPort *_serial = nullptr;
+
+    static const int _readBufferSize = 16384;
+
+    GPSFramer   _framer;
+    QByteArray  _ubxBytes;          ///< Framed UBX bytes not yet read by the driver
+    uint8_t     _readBuffer[_readBufferSize];
 };
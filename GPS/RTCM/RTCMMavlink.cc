@@ -13,6 +13,8 @@
 #include "MultiVehicleManager.h"
 #include "Vehicle.h"
 
+#include <QDebug>
+
 #include <cstdio>
 
 RTCMMavlink::RTCMMavlink(QGCToolbox& toolbox)
@@ -33,39 +35,69 @@ void RTCMMavlink::RTCMDataUpdate(QByteArray message)
     }
 
     const int maxMessageLength = MAVLINK_MSG_GPS_RTCM_DATA_FIELD_DATA_LEN;
-    mavlink_gps_rtcm_data_t mavlinkRtcmData;
-    memset(&mavlinkRtcmData, 0, sizeof(mavlink_gps_rtcm_data_t));
+    mavlink_gps_rtcm_data_t fragments[_maxFragments];
+    int fragmentCount = 0;
 
     if (message.size() < maxMessageLength) {
-        mavlinkRtcmData.len = message.size();
-        memcpy(&mavlinkRtcmData.data, message.data(), message.size());
-        sendMessageToVehicle(mavlinkRtcmData);
+        memset(&fragments[0], 0, sizeof(mavlink_gps_rtcm_data_t));
+        fragments[0].flags = _sequenceId << 3;
+        fragments[0].len = message.size();
+        memcpy(&fragments[0].data, message.data(), message.size());
+        fragmentCount = 1;
     } else {
         //we need to fragment
+        if (message.size() > maxMessageLength * _maxFragments) {
+            qWarning() << "RTCM message too large to send, dropped:" << message.size();
+            return;
+        }
         int start = 0;
         while (start < message.size()) {
             int length = std::min(message.size() - start, maxMessageLength);
-            mavlinkRtcmData.flags = 1; //fragmented
-            mavlinkRtcmData.len = length;
-            memcpy(&mavlinkRtcmData.data, message.data() + start, length);
-            sendMessageToVehicle(mavlinkRtcmData);
+            mavlink_gps_rtcm_data_t& fragment = fragments[fragmentCount];
+            memset(&fragment, 0, sizeof(mavlink_gps_rtcm_data_t));
+            // bit 0: fragmented, bits 1-2: fragment id, bits 3-7: sequence id
+            fragment.flags = 1 | (fragmentCount << 1) | (_sequenceId << 3);
+            fragment.len = length;
+            memcpy(&fragment.data, message.data() + start, length);
+            fragmentCount++;
             start += length;
         }
     }
+    _sequenceId = (_sequenceId + 1) & 0x1F;
+
+    sendMessageToVehicles(fragments, fragmentCount);
 }
 
-void RTCMMavlink::sendMessageToVehicle(const mavlink_gps_rtcm_data_t& msg)
+void RTCMMavlink::sendMessageToVehicles(const mavlink_gps_rtcm_data_t* fragments, int fragmentCount)
 {
     QmlObjectListModel& vehicles = *_toolbox.multiVehicleManager()->vehicles();
     MAVLinkProtocol* mavlinkProtocol = _toolbox.mavlinkProtocol();
+
+    // GPS_RTCM_DATA has no target, so vehicles sharing a link all pick up the same copy
+    QList<LinkInterface*> sentLinks;
+
     for (int i = 0; i < vehicles.count(); i++) {
         Vehicle* vehicle = qobject_cast<Vehicle*>(vehicles[i]);
-        mavlink_message_t message;
-        mavlink_msg_gps_rtcm_data_encode_chan(mavlinkProtocol->getSystemId(),
-                                              mavlinkProtocol->getComponentId(),
-                                              vehicle->priorityLink()->mavlinkChannel(),
-                                              &message,
-                                              &msg);
-        vehicle->sendMessageOnLink(vehicle->priorityLink(), message);
+        LinkInterface* link = vehicle->priorityLink();
+        if (!link || !link->isConnected() || sentLinks.contains(link)) {
+            continue;
+        }
+        sentLinks.append(link);
+
+        if (link->txQueuedBytes(LinkTxScheduler::PriorityCorrection) > _maxPendingBytes) {
+            // Skip the whole correction rather than single fragments, receivers see the sequence gap
+            _droppedCount++;
+            continue;
+        }
+
+        for (int fragment = 0; fragment < fragmentCount; fragment++) {
+            mavlink_message_t message;
+            mavlink_msg_gps_rtcm_data_encode_chan(mavlinkProtocol->getSystemId(),
+                                                  mavlinkProtocol->getComponentId(),
+                                                  link->mavlinkChannel(),
+                                                  &message,
+                                                  &fragments[fragment]);
+            vehicle->sendMessageOnLink(link, message);
+        }
     }
 }
@@ -30,10 +30,23 @@ public:
 public slots:
     void RTCMDataUpdate(QByteArray message);
 
+    /// Number of corrections not sent on a link because its transmit queue was backed up
+    quint32 droppedCount(void) const { return _droppedCount; }
+
 private:
-    void sendMessageToVehicle(const mavlink_gps_rtcm_data_t& msg);
+    /// Sends all fragments of a correction on every link which has a vehicle on it. Each link gets a
+    /// single encode and a single copy, no matter how many vehicles share it.
+    void sendMessageToVehicles(const mavlink_gps_rtcm_data_t* fragments, int fragmentCount);
+
+    /// Corrections are skipped on a link while it has more than this many correction bytes waiting to
+    /// go out. A late correction is worse than none, the next one will be along within a second. The
+    /// link queue never drops corrections itself, so this also bounds it.
+    static const int _maxPendingBytes = 2048;
+    static const int _maxFragments = 4;     ///< Fragment id is two bits of flags
 
     QGCToolbox& _toolbox;
     QElapsedTimer _bandwidthTimer;
     int _bandwidthByteCounter = 0;
+    uint8_t _sequenceId = 0;                ///< Five bit sequence id, shared by all fragments of a correction
+    quint32 _droppedCount = 0;
 };
@@ -9,6 +9,7 @@
 
 
 #include "Joystick.h"
+#include "ManualControlSender.h"
 #include "QGC.h"
 #include "AutoPilotPlugin.h"
 #include "UAS.h"
@@ -25,6 +26,7 @@ const char* Joystick::_throttleModeSettingsKey =    "ThrottleMode";
 const char* Joystick::_exponentialSettingsKey =     "Exponential";
 const char* Joystick::_accumulatorSettingsKey =     "Accumulator";
 const char* Joystick::_deadbandSettingsKey =        "Deadband";
+const char* Joystick::_pollRateSettingsKey =        "PollRate";
 
 const char* Joystick::_rgFunctionSettingsKey[Joystick::maxFunction] = {
     "RollAxis",
@@ -50,7 +52,12 @@ Joystick::Joystick(const QString& name, int axisCount, int buttonCount, int hatC
     , _exponential(false)
     , _accumulator(false)
     , _deadband(false)
+    , _throttleAccumulator(0)
+    , _pollRate(_defaultPollRate)
+    , _sampleUsecs(0)
+    , _sampleInputUsecs(0)
     , _activeVehicle(NULL)
+    , _polling(false)
     , _pollingStartedForCalibration(false)
     , _multiVehicleManager(multiVehicleManager)
 {
@@ -65,7 +72,12 @@ Joystick::Joystick(const QString& name, int axisCount, int buttonCount, int hatC
     for (int i=0; i<_totalButtonCount; i++) {
         _rgButtonValues[i] = false;
     }
+    _sample.valid = false;
+    _sample.sequence = 0;
+    _sample.changeSequence = 0;
+    _updateVehicleSettings();
 
+    _inputClock.start();
     _loadSettings();
 }
 
@@ -92,6 +104,7 @@ void Joystick::_loadSettings(void)
     _exponential = settings.value(_exponentialSettingsKey, false).toBool();
     _accumulator = settings.value(_accumulatorSettingsKey, false).toBool();
     _deadband = settings.value(_deadbandSettingsKey, false).toBool();
+    _pollRate = qBound(_minPollRate, settings.value(_pollRateSettingsKey, _defaultPollRate).toInt(), _maxPollRate);
 
     _throttleMode = (ThrottleMode_t)settings.value(_throttleModeSettingsKey, ThrottleModeCenterZero).toInt(&convertOk);
     badSettings |= !convertOk;
@@ -159,6 +172,7 @@ void Joystick::_saveSettings(void)
     settings.setValue(_accumulatorSettingsKey, _accumulator);
     settings.setValue(_deadbandSettingsKey, _deadband);
     settings.setValue(_throttleModeSettingsKey, _throttleMode);
+    settings.setValue(_pollRateSettingsKey, _pollRate);
 
     qCDebug(JoystickLog) << "_saveSettings calibrated:throttlemode:deadband" << _calibrated << _throttleMode << _deadband;
 
@@ -247,19 +261,49 @@ float Joystick::_adjustRange(int value, Calibration_t calibration, bool withDead
 }
 
 
+qint64 Joystick::_waitForInput(int timeoutMsecs)
+{
+    QGC::SLEEP::msleep(timeoutMsecs);
+    return -1;
+}
+
 void Joystick::run(void)
 {
     _open();
 
+    _sampleMutex.lock();
+    _sample.valid = false;
+    _sampleMutex.unlock();
+
+    qint64  inputUsecs = -1;        // Time the input being processed arrived, -1 if not known
+    qint64  lastLoopUsecs = _clockUsecs();
+    qint64  lastSendUsecs = 0;
+    qint64  lastRawUsecs = 0;
+    bool    sent = false;
+    float   lastRoll = 0, lastPitch = 0, lastYaw = 0, lastThrottle = 0;
+    quint16 lastButtons = 0;
+
     while (!_exitThread) {
     _update();
 
+        qint64 nowUsecs = _clockUsecs();
+        if (inputUsecs == -1) {
+            inputUsecs = nowUsecs;
+        }
+
+        // Calibration code requires the signal at a steady rate even if the value hasn't changed
+        bool rawRepeat = _calibrationMode != CalibrationModeOff && nowUsecs - lastRawUsecs >= _calibrationRawIntervalMsecs * 1000;
+        if (rawRepeat) {
+            lastRawUsecs = nowUsecs;
+        }
+
         // Update axes
         for (int axisIndex=0; axisIndex<_axisCount; axisIndex++) {
             int newAxisValue = _getAxis(axisIndex);
-            // Calibration code requires signal to be emitted even if value hasn't changed
-            _rgAxisValues[axisIndex] = newAxisValue;
-            emit rawAxisValueChanged(axisIndex, newAxisValue);
+            if (newAxisValue != _rgAxisValues[axisIndex] || rawRepeat) {
+                _rgAxisValues[axisIndex] = newAxisValue;
+                emit rawAxisValueChanged(axisIndex, newAxisValue);
+            }
         }
 
         // Update buttons
@@ -287,6 +331,10 @@ void Joystick::run(void)
         }
 
         if (_calibrationMode != CalibrationModeCalibrating) {
+            _sampleMutex.lock();
+            VehicleSettings_t vehicleSettings = _vehicleSettings;
+            _sampleMutex.unlock();
+
             int     axis = _rgFunctionAxis[rollFunction];
             float   roll = _adjustRange(_rgAxisValues[axis], _rgCalibration[axis], _deadband);
 
@@ -300,12 +348,11 @@ void Joystick::run(void)
             float   throttle = _adjustRange(_rgAxisValues[axis], _rgCalibration[axis], _throttleMode==ThrottleModeDownZero?false:_deadband);
 
             if ( _accumulator ) {
-                static float throttle_accu = 0.f;
-
-                throttle_accu += throttle*(40/1000.f); //for throttle to change from min to max it will take 1000ms (40ms is a loop time)
+                // For throttle to change from min to max it will take 1000ms
+                _throttleAccumulator += throttle * ((nowUsecs - lastLoopUsecs) / 1000000.0f);
 
-                throttle_accu = std::max(static_cast<float>(-1.f), std::min(throttle_accu, static_cast<float>(1.f)));
-                throttle = throttle_accu;
+                _throttleAccumulator = std::max(static_cast<float>(-1.f), std::min(_throttleAccumulator, static_cast<float>(1.f)));
+                throttle = _throttleAccumulator;
             }
 
             float roll_limited = std::max(static_cast<float>(-M_PI_4), std::min(roll, static_cast<float>(M_PI_4)));
@@ -332,7 +379,7 @@ void Joystick::run(void)
             }
 
             // Adjust throttle to 0:1 range
-            if (_throttleMode == ThrottleModeCenterZero && _activeVehicle->supportsThrottleModeCenterZero()) {
+            if (_throttleMode == ThrottleModeCenterZero && vehicleSettings.throttleModeCenterZero) {
                 throttle = std::max(0.0f, throttle);
             } else {
                 throttle = (throttle + 1.0f) / 2.0f;
@@ -341,7 +388,7 @@ void Joystick::run(void)
             // Set up button pressed information
 
             // We only send the buttons the firmwware has reserved
-            int reservedButtonCount = _activeVehicle->manualControlReservedButtonCount();
+            int reservedButtonCount = vehicleSettings.reservedButtonCount;
             if (reservedButtonCount == -1) {
                 reservedButtonCount = _totalButtonCount;
             }
@@ -364,7 +411,7 @@ void Joystick::run(void)
                             // Button is above firmware reserved set
                             QString buttonAction =_rgButtonActions[buttonIndex];
                             if (!buttonAction.isEmpty()) {
-                                _buttonAction(buttonAction);
+                                QMetaObject::invokeMethod(this, "_buttonAction", Qt::QueuedConnection, Q_ARG(QString, buttonAction));
                             }
                         }
                     }
@@ -376,13 +423,40 @@ void Joystick::run(void)
 
             _lastButtonBits = newButtonBits;
 
-            qCDebug(JoystickValuesLog) << "name:roll:pitch:yaw:throttle" << name() << roll << -pitch << yaw << throttle;
-
-            emit manualControl(roll, -pitch, yaw, throttle, buttonPressedBits, _activeVehicle->joystickMode());
+            // Only changes are sent right away, unchanged output is repeated at the keep alive rate
+            bool changed = !sent || roll != lastRoll || pitch != lastPitch || yaw != lastYaw || throttle != lastThrottle || buttonPressedBits != lastButtons;
+            if (changed || nowUsecs - lastSendUsecs >= _keepAliveMsecs * 1000) {
+                qCDebug(JoystickValuesLog) << "name:roll:pitch:yaw:throttle" << name() << roll << -pitch << yaw << throttle;
+
+                _sampleMutex.lock();
+                _sample.roll = roll;
+                _sample.pitch = -pitch;
+                _sample.yaw = yaw;
+                _sample.throttle = throttle;
+                _sample.buttons = buttonPressedBits;
+                _sample.valid = true;
+                _sample.sequence++;
+                if (changed) {
+                    _sample.changeSequence++;
+                    _sampleInputUsecs = inputUsecs;
+                }
+                _sampleUsecs = _clockUsecs();
+                _sampleMutex.unlock();
+
+                emit manualControl(roll, -pitch, yaw, throttle, buttonPressedBits, vehicleSettings.joystickMode);
+
+                sent = true;
+                lastSendUsecs = nowUsecs;
+                lastRoll = roll;
+                lastPitch = pitch;
+                lastYaw = yaw;
+                lastThrottle = throttle;
+                lastButtons = buttonPressedBits;
+            }
         }
 
-        // Sleep, update rate of joystick is approx. 25 Hz (1000 ms / 25 = 40 ms)
-        QGC::SLEEP::msleep(40);
+        lastLoopUsecs = nowUsecs;
+        inputUsecs = _waitForInput(1000 / _pollRate);
     }
 
     _close();
@@ -394,50 +468,136 @@ void Joystick::startPolling(Vehicle* vehicle)
 
         // If a vehicle is connected, disconnect it
         if (_activeVehicle) {
-            UAS* uas = _activeVehicle->uas();
-            disconnect(this, &Joystick::manualControl, uas, &UAS::setExternalControlSetpoint);
+            disconnect(_activeVehicle, &Vehicle::joystickModeChanged, this, &Joystick::_updateVehicleSettings);
+            removeVehicle(_activeVehicle);
         }
 
-        // Always set up the new vehicle
-        _activeVehicle = vehicle;
-
-        // If joystick is not calibrated, disable it
+        // If joystick is not calibrated, disable it. This calls stopPolling so it is done before the
+        // new vehicle is set up.
         if ( !_calibrated ) {
             vehicle->setJoystickEnabled(false);
         }
 
+        // Always set up the new vehicle
+        _activeVehicle = vehicle;
+        connect(_activeVehicle, &Vehicle::joystickModeChanged, this, &Joystick::_updateVehicleSettings);
+
         // Only connect the new vehicle if it wants joystick data
         if (vehicle->joystickEnabled()) {
             _pollingStartedForCalibration = false;
 
-            UAS* uas = _activeVehicle->uas();
-            connect(this, &Joystick::manualControl, uas, &UAS::setExternalControlSetpoint);
+            addVehicle(_activeVehicle, ManualControlSender::defaultRate);
             // FIXME: ****
             //connect(this, &Joystick::buttonActionTriggered, uas, &UAS::triggerAction);
         }
     }
 
 
-    if (!isRunning()) {
-        _exitThread = false;
-        start();
-    }
+    _polling = true;
+    _updateVehicleSettings();
+    _startThread();
 }
 
 void Joystick::stopPolling(void)
 {
-    if (isRunning()) {
-
-        if (_activeVehicle && _activeVehicle->joystickEnabled()) {
-            UAS* uas = _activeVehicle->uas();
+    if (_activeVehicle) {
+        // Cleared first, this is also called while the vehicle is being destroyed
+        Vehicle* vehicle = _activeVehicle;
+        _activeVehicle = NULL;
+        disconnect(vehicle, &Vehicle::joystickModeChanged, this, &Joystick::_updateVehicleSettings);
+        removeVehicle(vehicle);
+    }
+    // FIXME: ****
+    //disconnect(this, &Joystick::buttonActionTriggered,  uas, &UAS::triggerAction);
 
-            disconnect(this, &Joystick::manualControl,          uas, &UAS::setExternalControlSetpoint);
-        }
-        // FIXME: ****
-        //disconnect(this, &Joystick::buttonActionTriggered,  uas, &UAS::triggerAction);
+    _polling = false;
+    _updateVehicleSettings();
 
+    // Vehicles added for formation flying keep the thread running
+    if (_senders.isEmpty() && isRunning()) {
         _exitThread = true;
+    }
+}
+
+void Joystick::_startThread(void)
+{
+    if (isRunning() && !_exitThread) {
+        return;
+    }
+
+    // A thread which was told to exit finishes before it is started again
+    wait();
+    _exitThread = false;
+    start();
+}
+
+void Joystick::_updateVehicleSettings(void)
+{
+    VehicleSettings_t vehicleSettings;
+
+    Vehicle* vehicle = _activeVehicle ? _activeVehicle : (_senders.isEmpty() ? NULL : _senders.firstKey());
+    if (vehicle) {
+        vehicleSettings.throttleModeCenterZero = vehicle->supportsThrottleModeCenterZero();
+        vehicleSettings.reservedButtonCount = vehicle->manualControlReservedButtonCount();
+        vehicleSettings.joystickMode = vehicle->joystickMode();
+    } else {
+        vehicleSettings.throttleModeCenterZero = false;
+        vehicleSettings.reservedButtonCount = 0;
+        vehicleSettings.joystickMode = Vehicle::JoystickModeRC;
+    }
+
+    QMutexLocker lock(&_sampleMutex);
+    _vehicleSettings = vehicleSettings;
+}
+
+void Joystick::addVehicle(Vehicle* vehicle, int rate)
+{
+    ManualControlSender* sender = _senders.value(vehicle, NULL);
+
+    if (sender) {
+        sender->setRate(rate);
+    } else {
+        qCDebug(JoystickLog) << "addVehicle" << vehicle->id() << rate;
+        _senders[vehicle] = new ManualControlSender(this, vehicle, rate, this);
+        connect(vehicle, &QObject::destroyed, this, [this, vehicle]() {
+            if (vehicle == _activeVehicle) {
+                stopPolling();
+            } else {
+                removeVehicle(vehicle);
+            }
+        });
+        _updateVehicleSettings();
+    }
+
+    _startThread();
+}
+
+void Joystick::removeVehicle(Vehicle* vehicle)
+{
+    ManualControlSender* sender = _senders.take(vehicle);
+
+    if (sender) {
+        qCDebug(JoystickLog) << "removeVehicle sent:stale" << sender->sendCount() << sender->staleCount();
+        disconnect(vehicle, &QObject::destroyed, this, NULL);
+        delete sender;
+        _updateVehicleSettings();
+
+        // The thread only keeps running for formation vehicles while there are some left
+        if (_senders.isEmpty() && !_polling && isRunning()) {
+            _exitThread = true;
         }
+    }
+}
+
+Joystick::ManualControlSample_t Joystick::latestSample(void)
+{
+    QMutexLocker lock(&_sampleMutex);
+
+    ManualControlSample_t sample = _sample;
+    qint64 nowUsecs = _clockUsecs();
+    sample.ageUsecs = nowUsecs - _sampleUsecs;
+    sample.inputAgeUsecs = nowUsecs - _sampleInputUsecs;
+    return sample;
 }
 
 void Joystick::setCalibration(int axis, Calibration_t& calibration)
@@ -591,6 +751,19 @@ void Joystick::setDeadband(bool deadband)
     _saveSettings();
 }
 
+void Joystick::setPollRate(int rate)
+{
+    if (rate < _minPollRate || rate > _maxPollRate) {
+        qCWarning(JoystickLog) << "Invalid poll rate" << rate;
+        return;
+    }
+
+    _pollRate = rate;
+
+    _saveSettings();
+    emit pollRateChanged(_pollRate);
+}
+
 void Joystick::startCalibrationMode(CalibrationMode_t mode)
 {
     if (mode == CalibrationModeOff) {
@@ -13,6 +13,9 @@
 
 #include <QObject>
 #include <QThread>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMap>
 
 #include "QGCLoggingCategory.h"
 #include "Vehicle.h"
@@ -21,6 +24,8 @@
 Q_DECLARE_LOGGING_CATEGORY(JoystickLog)
 Q_DECLARE_LOGGING_CATEGORY(JoystickValuesLog)
 
+class ManualControlSender;
+
 class Joystick : public QThread
 {
     Q_OBJECT
@@ -46,6 +51,20 @@ public:
         maxFunction
     } AxisFunction_t;
 
+    /// Latest output of the joystick, the values of the manualControl signal
+    typedef struct {
+        float   roll;
+        float   pitch;
+        float   yaw;
+        float   throttle;
+        quint16 buttons;
+        bool    valid;          ///< false: no output since polling started
+        quint32 sequence;       ///< Incremented each time manualControl is signalled
+        quint32 changeSequence; ///< Incremented each time the output changes
+        qint64  ageUsecs;       ///< Time since the joystick thread computed the sample
+        qint64  inputAgeUsecs;  ///< Time since the input behind the last change arrived
+    } ManualControlSample_t;
+
     typedef enum {
         ThrottleModeCenterZero,
         ThrottleModeDownZero,
@@ -69,6 +88,10 @@ public:
     Q_PROPERTY(bool exponential READ exponential WRITE setExponential NOTIFY exponentialChanged)
     Q_PROPERTY(bool accumulator READ accumulator WRITE setAccumulator NOTIFY accumulatorChanged)
 
+    /// Rate in Hz the joystick is checked for new input. manualControl is only signalled when the
+    /// output changes, or at the keep alive rate when the sticks are still.
+    Q_PROPERTY(int pollRate READ pollRate WRITE setPollRate NOTIFY pollRateChanged)
+
     // Property accessors
 
     int axisCount(void) { return _axisCount; }
@@ -78,6 +101,19 @@ public:
     void startPolling(Vehicle* vehicle);
     void stopPolling(void);
 
+    /// Sends the joystick to the vehicle at up to the specified rate, in addition to any other vehicles.
+    /// This allows one stick to drive several vehicles in formation. startPolling adds the active vehicle.
+    /// The polling thread runs while there is a vehicle to send to, even after stopPolling.
+    ///     @param rate Maximum sends per second, the rate of an existing sender is changed
+    void addVehicle(Vehicle* vehicle, int rate);
+    void removeVehicle(Vehicle* vehicle);
+
+    /// @return Sender for the vehicle, NULL if the joystick is not sent to it
+    ManualControlSender* sender(Vehicle* vehicle) { return _senders.value(vehicle, NULL); }
+
+    /// @return Latest output. Thread safe.
+    ManualControlSample_t latestSample(void);
+
     void setCalibration(int axis, Calibration_t& calibration);
     Calibration_t getCalibration(int axis);
 
@@ -101,6 +137,9 @@ public:
     bool deadband(void);
     void setDeadband(bool accu);
 
+    int pollRate(void) const { return _pollRate; }
+    void setPollRate(int rate);
+
     typedef enum {
         CalibrationModeOff,         // Not calibrating
         CalibrationModeMonitor,     // Monitors are active, continue to send to vehicle if already polling
@@ -128,9 +167,12 @@ signals:
 
     void accumulatorChanged(bool accumulator);
 
+    void pollRateChanged(int pollRate);
+
     void enabledChanged(bool enabled);
 
-    /// Signal containing new joystick information
+    /// Signal containing new joystick information, signalled from the joystick thread when the output
+    /// changes or at the keep alive rate. latestSample returns the same values.
     ///     @param roll     Range is -1:1, negative meaning roll left, positive meaning roll right
     ///     @param pitch    Range i -1:1, negative meaning pitch down, positive meaning pitch up
     ///     @param yaw      Range is -1:1, negative meaning yaw left, positive meaning yaw right
@@ -140,14 +182,33 @@ signals:
 
     void buttonActionTriggered(int action);
 
+protected slots:
+    /// Called on the main thread for button presses seen by the joystick thread
+    void _buttonAction(const QString& action);
+
 protected:
     void _saveSettings(void);
     void _loadSettings(void);
     float _adjustRange(int value, Calibration_t calibration, bool withDeadbands);
-    void _buttonAction(const QString& action);
     bool _validAxis(int axis);
     bool _validButton(int button);
 
+    /// @return Usecs on the clock used for input timestamps
+    qint64 _clockUsecs(void) const { return _inputClock.nsecsElapsed() / 1000; }
+
+    /// Settings of the vehicle being flown which the joystick thread needs
+    typedef struct {
+        bool    throttleModeCenterZero; ///< Vehicle supports ThrottleModeCenterZero
+        int     reservedButtonCount;    ///< Buttons reserved by the firmware, -1 for all
+        int     joystickMode;           ///< See Vehicle::JoystickMode_t
+    } VehicleSettings_t;
+
+    /// Copies the settings of the active vehicle, or the first vehicle sent to, for the joystick thread
+    void _updateVehicleSettings(void);
+
+    /// Starts the polling thread if it is not running, or restarts it if it was told to exit
+    void _startThread(void);
+
 private:
     virtual bool _open() = 0;
     virtual void _close() = 0;
@@ -157,6 +218,11 @@ private:
     virtual int _getAxis(int i) = 0;
     virtual uint8_t _getHat(int hat,int i) = 0;
 
+    /// Blocks until new input may be available or timeoutMsecs has passed. The default polls. Backends
+    /// which are notified of input override this to wake up as soon as it arrives.
+    ///     @return _clockUsecs time the input arrived, -1 if not known
+    virtual qint64 _waitForInput(int timeoutMsecs);
+
     // Override from QThread
     virtual void run(void);
 
@@ -187,8 +253,21 @@ protected:
     bool                _exponential;
     bool                _accumulator;
     bool                _deadband;
+    float               _throttleAccumulator;
+    int                 _pollRate;
+
+    QElapsedTimer           _inputClock;
+
+    QMutex                  _sampleMutex;       ///< Protects _sample, _sampleUsecs, _sampleInputUsecs and _vehicleSettings
+    ManualControlSample_t   _sample;
+    qint64                  _sampleUsecs;       ///< _clockUsecs time _sample was computed
+    qint64                  _sampleInputUsecs;  ///< _clockUsecs time of the input behind the last change
+    VehicleSettings_t       _vehicleSettings;   ///< Written on the main thread, read by the joystick thread
 
-    Vehicle*            _activeVehicle;
+    QMap<Vehicle*, ManualControlSender*>    _senders;
+
+    Vehicle*            _activeVehicle;     ///< Only used on the main thread, NULL when not polling
+    bool                _polling;           ///< true: startPolling called, thread runs even with no vehicles
     bool                _pollingStartedForCalibration;
 
     MultiVehicleManager*    _multiVehicleManager;
@@ -203,6 +282,13 @@ private:
     static const char* _exponentialSettingsKey;
     static const char* _accumulatorSettingsKey;
     static const char* _deadbandSettingsKey;
+    static const char* _pollRateSettingsKey;
+
+    static const int _defaultPollRate = 100;
+    static const int _minPollRate = 25;
+    static const int _maxPollRate = 500;
+    static const int _keepAliveMsecs = 100;             ///< manualControl is signalled at least this often while sending
+    static const int _calibrationRawIntervalMsecs = 40; ///< Unchanged raw axis values are signalled this often for calibration
 };
 
 #endif
@@ -0,0 +1,284 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "JoystickTest.h"
+#include "MockJoystick.h"
+#include "ManualControlSender.h"
+#include "QGCApplication.h"
+#include "MultiVehicleManager.h"
+#include "MockLink.h"
+#include "ParameterManager.h"
+
+#include <QElapsedTimer>
+
+JoystickTest::JoystickTest(void)
+    : _manualControlCount(0)
+    , _lastRoll(0)
+    , _lastButtons(0)
+{
+
+}
+
+/// Creates a calibrated joystick sending to the mock link vehicle. manualControl is queued to _manualControl.
+MockJoystick* JoystickTest::_createJoystick(void)
+{
+    MockJoystick* joystick = new MockJoystick("MockJoystick", _axisCount, _buttonCount, qgcApp()->toolbox()->multiVehicleManager());
+
+    Joystick::Calibration_t calibration;
+    calibration.min = -32768;
+    calibration.max = 32767;
+    calibration.center = 0;
+    calibration.deadband = 0;
+    calibration.reversed = false;
+    for (int axis=0; axis<_axisCount; axis++) {
+        joystick->setCalibration(axis, calibration);
+    }
+    joystick->setFunctionAxis(Joystick::rollFunction,       0);
+    joystick->setFunctionAxis(Joystick::pitchFunction,      1);
+    joystick->setFunctionAxis(Joystick::yawFunction,        2);
+    joystick->setFunctionAxis(Joystick::throttleFunction,   3);
+
+    _manualControlCount = 0;
+    connect(joystick, &Joystick::manualControl, this, &JoystickTest::_manualControl);
+
+    _vehicle->setJoystickEnabled(true);
+    joystick->startPolling(_vehicle);
+
+    return joystick;
+}
+
+void JoystickTest::_manualControl(float roll, float pitch, float yaw, float throttle, quint16 buttons, int joystickMode)
+{
+    Q_UNUSED(pitch);
+    Q_UNUSED(yaw);
+    Q_UNUSED(throttle);
+    Q_UNUSED(joystickMode);
+
+    _manualControlCount++;
+    _lastRoll = roll;
+    _lastButtons = buttons;
+}
+
+/// Waits for the joystick roll output to change sign
+///     @return Roll as sent in MANUAL_CONTROL, 0 if the output did not change
+int JoystickTest::_waitForRoll(MockJoystick* joystick, bool positive)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while ((positive ? _lastRoll <= 0 : _lastRoll >= 0) && timer.elapsed() < 1000) {
+        QTest::qWait(1);
+    }
+
+    return (int16_t)(joystick->latestSample().roll * 1000.0f);
+}
+
+/// Waits for the mock link to receive MANUAL_CONTROL with the specified roll
+bool JoystickTest::_waitForManualControl(MockLink* mockLink, int roll)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (mockLink->lastManualControl().y != roll && timer.elapsed() < 1000) {
+        QTest::qWait(1);
+    }
+
+    return mockLink->lastManualControl().y == roll;
+}
+
+void JoystickTest::_testKeepAlive(void)
+{
+    _connectMockLink();
+
+    MockJoystick* joystick = _createJoystick();
+
+    // Sticks are still, so only keep alive updates go out. The old loop sent 25 a second.
+    QTest::qWait(1000);
+    QVERIFY(_manualControlCount >= 5);
+    QVERIFY(_manualControlCount <= 15);
+
+    joystick->stopPolling();
+    joystick->wait();
+    delete joystick;
+
+    _disconnectMockLink();
+}
+
+void JoystickTest::_testInputLatency(void)
+{
+    _connectMockLink();
+
+    MockJoystick* joystick = _createJoystick();
+    ManualControlSender* sender = joystick->sender(_vehicle);
+    QVERIFY(sender);
+    joystick->addVehicle(_vehicle, ManualControlSender::maxRate);
+    QTest::qWait(50);
+
+    // Each change is sent without waiting for the next poll or keep alive. Moves are spaced by the send
+    // period, only a keep alive sent just before a move can hold it back, by up to one send period.
+    const int cMoves = 20;
+    for (int i=1; i<=cMoves; i++) {
+        float previousRoll = _lastRoll;
+        int sendCount = sender->sendCount();
+        joystick->setAxis(0, i * 1000);
+
+        QElapsedTimer timer;
+        timer.start();
+        while ((_lastRoll <= previousRoll || sender->sendCount() == sendCount) && timer.elapsed() < 1000) {
+            QTest::qWait(1);
+        }
+        QVERIFY(_lastRoll > previousRoll);
+        QTest::qWait(1000 / sender->rate());
+    }
+    QVERIFY(sender->maxInputLatencyUsecs() > 0);
+    QVERIFY(sender->maxInputLatencyUsecs() < (1000000 / joystick->pollRate()) + (1000000 / sender->rate()));
+    QVERIFY(_waitForManualControl(_mockLink, (int16_t)(joystick->latestSample().roll * 1000.0f)));
+
+    // Buttons go through the same path
+    joystick->setButton(0, true);
+    QElapsedTimer timer;
+    timer.start();
+    while (!(_lastButtons & 1) && timer.elapsed() < 1000) {
+        QTest::qWait(1);
+    }
+    QCOMPARE(_lastButtons & 1, 1);
+
+    joystick->stopPolling();
+    joystick->wait();
+    delete joystick;
+
+    _disconnectMockLink();
+}
+
+void JoystickTest::_testManualControlSender(void)
+{
+    _connectMockLink();
+
+    MockJoystick* joystick = _createJoystick();
+
+    ManualControlSender* sender = joystick->sender(_vehicle);
+    QVERIFY(sender);
+    QCOMPARE(sender->rate(), (int)ManualControlSender::defaultRate);
+
+    // Output changing faster than the vehicle's rate is held to the rate
+    joystick->addVehicle(_vehicle, 20);
+    QCOMPARE(joystick->sender(_vehicle), sender);
+    QCOMPARE(sender->rate(), 20);
+    for (int i=0; i<240; i++) {
+        joystick->setAxis(0, (i % 10) * 1000);
+        QTest::qWait(5);
+    }
+    QVERIFY(sender->measuredRate() > 14 && sender->measuredRate() < 22);
+
+    // Below the rate each change is sent as it comes
+    joystick->addVehicle(_vehicle, ManualControlSender::maxRate);
+    for (int i=0; i<60; i++) {
+        joystick->setAxis(0, (i % 10) * 1000);
+        QTest::qWait(20);
+    }
+    QVERIFY(sender->measuredRate() > 35 && sender->measuredRate() < 65);
+    QVERIFY(sender->lastSampleAgeUsecs() < 100000);
+
+    // Calibrating stops the joystick output, the stale sample is not sent
+    int sendCount = sender->sendCount();
+    joystick->startCalibrationMode(Joystick::CalibrationModeCalibrating);
+    QTest::qWait(1000);
+    QVERIFY(sender->staleCount() > 0);
+    QVERIFY(sender->sendCount() - sendCount < 35);
+    sendCount = sender->sendCount();
+    QTest::qWait(200);
+    QCOMPARE(sender->sendCount(), sendCount);
+
+    // Output resumes once calibration is over
+    joystick->stopCalibrationMode(Joystick::CalibrationModeCalibrating);
+    QTest::qWait(200);
+    QVERIFY(sender->sendCount() > sendCount);
+
+    joystick->stopPolling();
+    QVERIFY(!joystick->sender(_vehicle));
+    joystick->wait();
+    delete joystick;
+
+    _disconnectMockLink();
+}
+
+void JoystickTest::_testFormation(void)
+{
+    _connectMockLink();
+
+    // Second vehicle on its own link
+    MultiVehicleManager* multiVehicleManager = qgcApp()->toolbox()->multiVehicleManager();
+    QSignalSpy spyVehicle(multiVehicleManager, SIGNAL(vehicleAdded(Vehicle*)));
+    MockLink* mockLink2 = MockLink::startPX4MockLink(false);
+    QVERIFY(spyVehicle.wait(10000));
+    Vehicle* vehicle2 = multiVehicleManager->getVehicleById(mockLink2->vehicleId());
+    QVERIFY(vehicle2);
+    QVERIFY(vehicle2 != _vehicle);
+    if (!vehicle2->parameterManager()->parametersReady()) {
+        QSignalSpy spyParameters(vehicle2->parameterManager(), SIGNAL(parametersReadyChanged(bool)));
+        QVERIFY(spyParameters.wait(10000));
+    }
+    _vehicle->setJoystickMode(Vehicle::JoystickModeRC);
+    vehicle2->setJoystickMode(Vehicle::JoystickModeRC);
+
+    MockJoystick* joystick = _createJoystick();
+    joystick->addVehicle(vehicle2, 20);
+    QVERIFY(joystick->sender(_vehicle));
+    QVERIFY(joystick->sender(vehicle2));
+
+    // One stick, both vehicles get the same MANUAL_CONTROL on their own link
+    joystick->setAxis(0, 16000);
+    int roll = _waitForRoll(joystick, true);
+    QVERIFY(roll > 0);
+    QVERIFY(_waitForManualControl(_mockLink, roll));
+    QVERIFY(_waitForManualControl(mockLink2, roll));
+
+    // Each at its own rate
+    int count1 = _mockLink->manualControlCount();
+    int count2 = mockLink2->manualControlCount();
+    for (int i=0; i<200; i++) {
+        joystick->setAxis(0, 1000 + ((i % 10) * 1000));
+        QTest::qWait(5);
+    }
+    count1 = _mockLink->manualControlCount() - count1;
+    count2 = mockLink2->manualControlCount() - count2;
+    QVERIFY(count2 > 0 && count2 <= 30);
+    QVERIFY(count1 > count2);
+
+    // The formation vehicle keeps flying from the stick once polling stops for the active vehicle
+    joystick->stopPolling();
+    QVERIFY(!joystick->sender(_vehicle));
+    QVERIFY(joystick->isRunning());
+    QTest::qWait(100);
+    count1 = _mockLink->manualControlCount();
+    joystick->setAxis(0, -16000);
+    roll = _waitForRoll(joystick, false);
+    QVERIFY(roll < 0);
+    QVERIFY(_waitForManualControl(mockLink2, roll));
+    QTest::qWait(200);
+    QCOMPARE(_mockLink->manualControlCount(), count1);
+
+    // Removing the last vehicle stops the thread, adding one starts it again
+    joystick->removeVehicle(vehicle2);
+    QVERIFY(joystick->wait(1000));
+    joystick->addVehicle(vehicle2, 20);
+    QVERIFY(joystick->isRunning());
+    joystick->setAxis(0, 16000);
+    roll = _waitForRoll(joystick, true);
+    QVERIFY(roll > 0);
+    QVERIFY(_waitForManualControl(mockLink2, roll));
+    joystick->removeVehicle(vehicle2);
+    QVERIFY(joystick->wait(1000));
+    delete joystick;
+
+    QSignalSpy spyLink(_linkManager, SIGNAL(linkDeleted(LinkInterface*)));
+    _linkManager->disconnectLink(mockLink2);
+    QVERIFY(spyLink.wait(1000));
+
+    _disconnectMockLink();
+}
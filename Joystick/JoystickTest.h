@@ -0,0 +1,46 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef JoystickTest_H
+#define JoystickTest_H
+
+#include "UnitTest.h"
+
+class MockJoystick;
+
+/// Runs the joystick input loop against MockJoystick
+class JoystickTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    JoystickTest(void);
+
+private slots:
+    void _testKeepAlive(void);
+    void _testInputLatency(void);
+    void _testManualControlSender(void);
+    void _testFormation(void);
+
+private:
+    MockJoystick*   _createJoystick         (void);
+    void            _manualControl          (float roll, float pitch, float yaw, float throttle, quint16 buttons, int joystickMode);
+    int             _waitForRoll            (MockJoystick* joystick, bool positive);
+    bool            _waitForManualControl   (MockLink* mockLink, int roll);
+
+    int     _manualControlCount;
+    float   _lastRoll;
+    quint16 _lastButtons;
+
+    static const int _axisCount = 4;
+    static const int _buttonCount = 2;
+};
+
+#endif
@@ -0,0 +1,128 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "ManualControlSender.h"
+#include "Joystick.h"
+#include "Vehicle.h"
+#include "UAS.h"
+
+ManualControlSender::ManualControlSender(Joystick* joystick, Vehicle* vehicle, int rate, QObject* parent)
+    : QObject(parent)
+    , _joystick(joystick)
+    , _vehicle(vehicle)
+    , _rate(defaultRate)
+    , _sendCount(0)
+    , _staleCount(0)
+    , _lastSequence(0)
+    , _lastChangeSequence(0)
+    , _lastSampleAgeUsecs(0)
+    , _maxSampleAgeUsecs(0)
+    , _lastInputLatencyUsecs(0)
+    , _maxInputLatencyUsecs(0)
+    , _rateSendCount(0)
+    , _measuredRate(0)
+{
+    _holdTimer.setSingleShot(true);
+    _holdTimer.setTimerType(Qt::PreciseTimer);
+    connect(&_holdTimer, &QTimer::timeout, this, &ManualControlSender::_send);
+
+    _staleTimer.setInterval(_staleMsecs);
+    connect(&_staleTimer, &QTimer::timeout, this, &ManualControlSender::_stale);
+
+    // Signalled from the joystick thread, so queued
+    connect(_joystick, &Joystick::manualControl, this, &ManualControlSender::_sampleAvailable);
+
+    // Only what the joystick outputs from now on is sent and timed
+    Joystick::ManualControlSample_t sample = _joystick->latestSample();
+    _lastSequence = sample.sequence;
+    _lastChangeSequence = sample.changeSequence;
+
+    setRate(rate);
+    _rateTimer.start();
+    _staleTimer.start();
+}
+
+void ManualControlSender::setRate(int rate)
+{
+    if (rate < minRate || rate > maxRate) {
+        qCWarning(JoystickLog) << "Invalid manual control rate" << rate;
+        return;
+    }
+
+    _rate = rate;
+}
+
+void ManualControlSender::_sampleAvailable(void)
+{
+    if (_holdTimer.isActive()) {
+        // The held send picks up this sample
+        return;
+    }
+
+    qint64 intervalUsecs = 1000000 / _rate;
+    qint64 sinceSendUsecs = _sendTimer.isValid() ? _sendTimer.nsecsElapsed() / 1000 : intervalUsecs;
+    if (sinceSendUsecs >= intervalUsecs) {
+        _send();
+    } else {
+        _holdTimer.start((intervalUsecs - sinceSendUsecs + 999) / 1000);
+    }
+}
+
+void ManualControlSender::_send(void)
+{
+    Joystick::ManualControlSample_t sample = _joystick->latestSample();
+
+    if (!sample.valid || sample.sequence == _lastSequence) {
+        // Already sent by an earlier signal
+        return;
+    }
+    if (sample.ageUsecs > _staleMsecs * 1000) {
+        _staleCount++;
+        return;
+    }
+
+    QElapsedTimer sendTimer;
+    sendTimer.start();
+    _vehicle->uas()->sendManualControl(sample.roll, sample.pitch, sample.yaw, sample.throttle, sample.buttons, _vehicle->joystickMode());
+    qint64 sendUsecs = sendTimer.nsecsElapsed() / 1000;
+
+    if (sample.changeSequence != _lastChangeSequence) {
+        _lastInputLatencyUsecs = sample.inputAgeUsecs + sendUsecs;
+        _maxInputLatencyUsecs = qMax(_maxInputLatencyUsecs, _lastInputLatencyUsecs);
+    }
+
+    _sendCount++;
+    _rateSendCount++;
+    _lastSequence = sample.sequence;
+    _lastChangeSequence = sample.changeSequence;
+    _lastSampleAgeUsecs = sample.ageUsecs;
+    _maxSampleAgeUsecs = qMax(_maxSampleAgeUsecs, sample.ageUsecs);
+    _sendTimer.start();
+    _staleTimer.start();
+
+    _updateMeasuredRate();
+}
+
+void ManualControlSender::_stale(void)
+{
+    // Nothing fresh from the joystick for _staleMsecs
+    _staleCount++;
+    _updateMeasuredRate();
+}
+
+void ManualControlSender::_updateMeasuredRate(void)
+{
+    if (_rateTimer.elapsed() >= 1000) {
+        _measuredRate = _rateSendCount * 1000.0 / _rateTimer.elapsed();
+        _rateSendCount = 0;
+        _rateTimer.restart();
+        qCDebug(JoystickLog) << "Manual control vehicle:rate:stale:max age usecs:max latency usecs" << _vehicle->id() << _measuredRate << _staleCount << _maxSampleAgeUsecs << _maxInputLatencyUsecs;
+    }
+}
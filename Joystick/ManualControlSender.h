@@ -0,0 +1,94 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef ManualControlSender_H
+#define ManualControlSender_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class Joystick;
+class Vehicle;
+
+/// Sends the latest joystick sample to one vehicle as soon as the joystick signals it, at no more than
+/// the vehicle's rate.
+///
+/// The joystick thread only replaces the sample, so when the link or the main thread falls behind the
+/// samples in between are skipped rather than queued and the vehicle always gets the freshest one. A
+/// sample which arrives inside the rate limit is held until the limit allows it. A sample older than
+/// _staleMsecs is not sent, so a stalled joystick thread lets the vehicle's manual control loss failsafe
+/// trigger instead of holding the last stick position.
+class ManualControlSender : public QObject
+{
+    Q_OBJECT
+
+public:
+    ManualControlSender(Joystick* joystick, Vehicle* vehicle, int rate, QObject* parent = NULL);
+
+    Vehicle* vehicle(void) { return _vehicle; }
+
+    /// Maximum sends per second
+    int rate(void) const { return _rate; }
+    void setRate(int rate);
+
+    /// Number of samples sent
+    int sendCount(void) const { return _sendCount; }
+
+    /// Number of stale samples skipped, plus the number of _staleMsecs periods nothing was sent
+    int staleCount(void) const { return _staleCount; }
+
+    /// Sends per second measured over the last second
+    double measuredRate(void) const { return _measuredRate; }
+
+    /// Age of the last sample sent, from the joystick computing it to the send
+    qint64 lastSampleAgeUsecs(void) const { return _lastSampleAgeUsecs; }
+    qint64 maxSampleAgeUsecs(void) const { return _maxSampleAgeUsecs; }
+
+    /// Usecs from the input behind a change arriving to the MANUAL_CONTROL carrying it being sent on the
+    /// link. For polled backends the time waiting for the next poll is not known and is not included.
+    qint64 lastInputLatencyUsecs(void) const { return _lastInputLatencyUsecs; }
+    qint64 maxInputLatencyUsecs(void) const { return _maxInputLatencyUsecs; }
+
+    static const int defaultRate = 50;
+    static const int minRate = 1;
+    static const int maxRate = 200;
+
+private slots:
+    void _sampleAvailable(void);
+    void _send(void);
+    void _stale(void);
+
+private:
+    void _updateMeasuredRate(void);
+
+    Joystick*       _joystick;
+    Vehicle*        _vehicle;
+    QTimer          _holdTimer;         ///< Runs while a sample is held back by the rate limit
+    QTimer          _staleTimer;        ///< Restarted on each send
+    QElapsedTimer   _sendTimer;         ///< Restarted on each send
+    int             _rate;
+
+    int             _sendCount;
+    int             _staleCount;
+    quint32         _lastSequence;          ///< Sequence of the last sample sent
+    quint32         _lastChangeSequence;    ///< Change sequence of the last sample sent
+    qint64          _lastSampleAgeUsecs;
+    qint64          _maxSampleAgeUsecs;
+    qint64          _lastInputLatencyUsecs;
+    qint64          _maxInputLatencyUsecs;
+    QElapsedTimer   _rateTimer;
+    int             _rateSendCount;     ///< Sends since _rateTimer was restarted
+    double          _measuredRate;
+
+    static const int _staleMsecs = 500;
+};
+
+#endif
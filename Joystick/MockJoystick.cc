@@ -0,0 +1,66 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "MockJoystick.h"
+
+MockJoystick::MockJoystick(const QString& name, int axisCount, int buttonCount, MultiVehicleManager* multiVehicleManager)
+    : Joystick(name, axisCount, buttonCount, 0, multiVehicleManager)
+    , _axisValues(axisCount, 0)
+    , _buttonValues(buttonCount, false)
+    , _inputUsecs(-1)
+{
+}
+
+void MockJoystick::setAxis(int axis, int value)
+{
+    QMutexLocker lock(&_mutex);
+
+    _axisValues[axis] = value;
+    if (_inputUsecs == -1) {
+        _inputUsecs = _clockUsecs();
+    }
+    _inputCondition.wakeAll();
+}
+
+void MockJoystick::setButton(int button, bool pressed)
+{
+    QMutexLocker lock(&_mutex);
+
+    _buttonValues[button] = pressed;
+    if (_inputUsecs == -1) {
+        _inputUsecs = _clockUsecs();
+    }
+    _inputCondition.wakeAll();
+}
+
+bool MockJoystick::_getButton(int i)
+{
+    QMutexLocker lock(&_mutex);
+    return _buttonValues[i];
+}
+
+int MockJoystick::_getAxis(int i)
+{
+    QMutexLocker lock(&_mutex);
+    return _axisValues[i];
+}
+
+qint64 MockJoystick::_waitForInput(int timeoutMsecs)
+{
+    QMutexLocker lock(&_mutex);
+
+    if (_inputUsecs == -1) {
+        _inputCondition.wait(&_mutex, timeoutMsecs);
+    }
+
+    qint64 inputUsecs = _inputUsecs;
+    _inputUsecs = -1;
+    return inputUsecs;
+}
@@ -0,0 +1,51 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef MockJoystick_H
+#define MockJoystick_H
+
+#include "Joystick.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+
+/// Joystick without hardware for unit testing. Input is set from the test thread and the joystick
+/// thread is woken up as soon as it changes, the same as an event driven backend.
+class MockJoystick : public Joystick
+{
+public:
+    MockJoystick(const QString& name, int axisCount, int buttonCount, MultiVehicleManager* multiVehicleManager);
+
+    /// Sets a raw axis value. Thread safe.
+    void setAxis(int axis, int value);
+
+    /// Sets a button state. Thread safe.
+    void setButton(int button, bool pressed);
+
+private:
+    bool _open() final { return true; }
+    void _close() final { }
+    bool _update() final { return true; }
+
+    bool _getButton(int i) final;
+    int _getAxis(int i) final;
+    uint8_t _getHat(int hat, int i) final { Q_UNUSED(hat); Q_UNUSED(i); return 0; }
+
+    qint64 _waitForInput(int timeoutMsecs) final;
+
+    QMutex          _mutex;
+    QWaitCondition  _inputCondition;
+    QVector<int>    _axisValues;
+    QVector<bool>   _buttonValues;
+    qint64          _inputUsecs;    ///< Time of input not yet seen by the joystick thread, -1 if none
+};
+
+#endif
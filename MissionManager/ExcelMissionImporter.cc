@@ -0,0 +1,327 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "ExcelMissionImporter.h"
+#include "xlsxzipreader_p.h"
+
+#include <QXmlStreamReader>
+#include <QHash>
+
+#include <exception>
+#include <GeographicLib/DMS.hpp>
+
+QGC_LOGGING_CATEGORY(ExcelMissionImporterLog, "ExcelMissionImporterLog")
+
+const double ExcelMissionImporter::defaultAltitude = 1000.0;
+
+/// Rows parsed between cancel and progress checks
+static const int _cRowsPerCheck = 256;
+
+ExcelMissionImporter::ExcelMissionImporter(const QString& fileName, QObject* parent)
+    : QThread(parent)
+    , _fileName(fileName)
+    , _cancel(false)
+    , _sheetIndex(0)
+    , _sheetCount(0)
+    , _lastPercent(-1)
+{
+
+}
+
+bool ExcelMissionImporter::importFile(void)
+{
+    _errorString.clear();
+    _sheets.clear();
+    _sharedStrings.clear();
+    _lastPercent = -1;
+
+    QXlsx::ZipReader zip(_fileName);
+    if (!zip.exists()) {
+        _errorString = tr("Unable to open %1").arg(_fileName);
+        return false;
+    }
+
+    QStringList paths = zip.filePaths();
+    if (!paths.contains(QStringLiteral("xl/workbook.xml"))) {
+        _errorString = tr("%1 is not an Excel workbook").arg(_fileName);
+        return false;
+    }
+    if (paths.contains(QStringLiteral("xl/sharedStrings.xml")) && !_readSharedStrings(zip.fileData(QStringLiteral("xl/sharedStrings.xml")))) {
+        return false;
+    }
+
+    QList<SheetEntry_t> entries;
+    if (!_readWorkbook(zip.fileData(QStringLiteral("xl/workbook.xml")), zip.fileData(QStringLiteral("xl/_rels/workbook.xml.rels")), entries)) {
+        return false;
+    }
+
+    _sheetCount = entries.count();
+    for (_sheetIndex = 0; _sheetIndex < _sheetCount; _sheetIndex++) {
+        const SheetEntry_t& entry = entries[_sheetIndex];
+        if (!paths.contains(entry.path)) {
+            qCWarning(ExcelMissionImporterLog) << "Sheet missing from workbook" << entry.name << entry.path;
+            continue;
+        }
+
+        // Only the compressed workbook and one uncompressed sheet are in memory at a time
+        Sheet_t sheet;
+        sheet.name = entry.name;
+        if (!_readSheet(zip.fileData(entry.path), sheet)) {
+            _sheets.clear();
+            return false;
+        }
+        if (sheet.coordinates.count()) {
+            qCDebug(ExcelMissionImporterLog) << "Sheet" << sheet.name << "points" << sheet.coordinates.count();
+            _sheets.append(sheet);
+        }
+    }
+    _updateProgress(1, 1);
+
+    return true;
+}
+
+bool ExcelMissionImporter::_readWorkbook(const QByteArray& workbookXml, const QByteArray& relsXml, QList<SheetEntry_t>& entries)
+{
+    // Relationship id to sheet path
+    QHash<QString, QString> targets;
+    QXmlStreamReader rels(relsXml);
+    while (!rels.atEnd()) {
+        if (rels.readNext() == QXmlStreamReader::StartElement && rels.name() == QLatin1String("Relationship")) {
+            QXmlStreamAttributes attributes = rels.attributes();
+            QString target = attributes.value(QStringLiteral("Target")).toString();
+            if (target.startsWith(QLatin1Char('/'))) {
+                target.remove(0, 1);
+            } else {
+                target.prepend(QStringLiteral("xl/"));
+            }
+            targets[attributes.value(QStringLiteral("Id")).toString()] = target;
+        }
+    }
+
+    QXmlStreamReader workbook(workbookXml);
+    while (!workbook.atEnd()) {
+        if (workbook.readNext() != QXmlStreamReader::StartElement || workbook.name() != QLatin1String("sheet")) {
+            continue;
+        }
+        SheetEntry_t entry;
+        foreach (const QXmlStreamAttribute& attribute, workbook.attributes()) {
+            if (attribute.name() == QLatin1String("name")) {
+                entry.name = attribute.value().toString();
+            } else if (attribute.name() == QLatin1String("id")) {
+                entry.path = targets.value(attribute.value().toString());
+            }
+        }
+        if (!entry.path.isEmpty()) {
+            entries.append(entry);
+        }
+    }
+    if (workbook.hasError()) {
+        _errorString = tr("Workbook is corrupt: %1").arg(workbook.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+bool ExcelMissionImporter::_readSharedStrings(const QByteArray& xml)
+{
+    QXmlStreamReader reader(xml);
+    QString value;
+    bool inString = false;
+
+    // A string item is either a single <t> or rich text runs each with their own <t>
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::StartElement) {
+            if (reader.name() == QLatin1String("si")) {
+                value.clear();
+                inString = true;
+            } else if (inString && reader.name() == QLatin1String("t")) {
+                value += reader.readElementText();
+            }
+        } else if (token == QXmlStreamReader::EndElement && reader.name() == QLatin1String("si")) {
+            _sharedStrings.append(value);
+            inString = false;
+        }
+    }
+    if (reader.hasError()) {
+        _errorString = tr("Shared strings are corrupt: %1").arg(reader.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+/// Reads the value of the current <c> element and leaves the reader on its end element
+bool ExcelMissionImporter::_readCellValue(QXmlStreamReader& reader, bool sharedString, QString& value)
+{
+    value.clear();
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::StartElement) {
+            if (reader.name() == QLatin1String("v") || reader.name() == QLatin1String("t")) {
+                value += reader.readElementText();
+            }
+        } else if (token == QXmlStreamReader::EndElement && reader.name() == QLatin1String("c")) {
+            break;
+        }
+    }
+
+    if (sharedString) {
+        bool ok;
+        int index = value.toInt(&ok);
+        if (!ok || index < 0 || index >= _sharedStrings.count()) {
+            _errorString = tr("Cell refers to unknown shared string %1").arg(value);
+            return false;
+        }
+        value = _sharedStrings[index];
+    }
+
+    return true;
+}
+
+bool ExcelMissionImporter::_readSheet(const QByteArray& xml, Sheet_t& sheet)
+{
+    static const char* rgColumnNames[] = { "Lat", "Lng", "Alt" };
+
+    QXmlStreamReader reader(xml);
+    QString cells[3];
+    bool    cellPresent[3] = { false, false, false };
+    bool    headerRow = false;
+    int     row = 0;
+    int     column = 0;
+    int     rowsParsed = 0;
+
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+
+        if (token == QXmlStreamReader::StartElement) {
+            if (reader.name() == QLatin1String("row")) {
+                QStringRef ref = reader.attributes().value(QStringLiteral("r"));
+                int nextRow = ref.isEmpty() ? row + 1 : ref.toInt();
+                if (headerRow && nextRow != row + 1) {
+                    _errorString = tr("Sheet %1 row %2 is empty").arg(sheet.name).arg(row + 1);
+                    return false;
+                }
+                row = nextRow;
+                column = 0;
+                cellPresent[0] = cellPresent[1] = cellPresent[2] = false;
+            } else if (reader.name() == QLatin1String("c")) {
+                QXmlStreamAttributes attributes = reader.attributes();
+                QStringRef ref = attributes.value(QStringLiteral("r"));
+                if (ref.isEmpty()) {
+                    column++;
+                } else {
+                    // Cell references are column letters followed by the row number
+                    column = 0;
+                    for (int i = 0; i < ref.length() && ref.at(i).isLetter(); i++) {
+                        column = (column * 26) + (ref.at(i).toUpper().unicode() - 'A' + 1);
+                    }
+                }
+                if (column >= 1 && column <= 3) {
+                    bool sharedString = attributes.value(QStringLiteral("t")) == QLatin1String("s");
+                    if (!_readCellValue(reader, sharedString, cells[column - 1])) {
+                        return false;
+                    }
+                    cellPresent[column - 1] = true;
+                } else {
+                    reader.skipCurrentElement();
+                }
+            }
+        } else if (token == QXmlStreamReader::EndElement && reader.name() == QLatin1String("row")) {
+            if (!headerRow) {
+                // Header row decides whether this sheet holds a boundary at all
+                if (row != 1 || !cellPresent[0] || cells[0].compare(QLatin1String(rgColumnNames[0]), Qt::CaseInsensitive)) {
+                    qCDebug(ExcelMissionImporterLog) << "Skipping sheet without Lat header" << sheet.name;
+                    return true;
+                }
+                for (int i = 1; i < 3; i++) {
+                    if (!cellPresent[i] || cells[i].compare(QLatin1String(rgColumnNames[i]), Qt::CaseInsensitive)) {
+                        _errorString = tr("Sheet %1 is missing the %2 column").arg(sheet.name).arg(rgColumnNames[i]);
+                        return false;
+                    }
+                }
+                headerRow = true;
+                continue;
+            }
+
+            for (int i = 0; i < 3; i++) {
+                if (!cellPresent[i]) {
+                    _errorString = tr("Sheet %1 row %2 has no %3 value").arg(sheet.name).arg(row).arg(rgColumnNames[i]);
+                    return false;
+                }
+            }
+
+            double lat, lng;
+            if (!_parseDegrees(cells[0], lat, rgColumnNames[0]) || !_parseDegrees(cells[1], lng, rgColumnNames[1])) {
+                _errorString = tr("Sheet %1 row %2: %3").arg(sheet.name).arg(row).arg(_errorString);
+                return false;
+            }
+            bool ok;
+            double alt = cells[2].toDouble(&ok);
+            if (!ok) {
+                alt = defaultAltitude;
+            }
+            sheet.coordinates.append(QGeoCoordinate(lat, lng, alt));
+
+            if (++rowsParsed % _cRowsPerCheck == 0) {
+                if (_cancel) {
+                    _errorString = tr("Import canceled");
+                    return false;
+                }
+                _updateProgress(reader.characterOffset(), xml.size());
+            }
+        }
+    }
+    if (reader.hasError()) {
+        _errorString = tr("Sheet %1 is corrupt: %2").arg(sheet.name).arg(reader.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+/// Decimal degrees, or degrees minutes seconds if the value has any of the DMS markers in it
+bool ExcelMissionImporter::_parseDegrees(const QString& value, double& degrees, const char* columnName)
+{
+    if (value.contains(QLatin1Char('d'), Qt::CaseInsensitive) || value.contains(QChar(0x00B0))
+            || value.contains(QLatin1Char('\'')) || value.contains(QLatin1Char('"'))) {
+        try {
+            GeographicLib::DMS::flag type;
+            degrees = GeographicLib::DMS::Decode(value.toStdString(), type);
+        }
+        catch (const std::exception& e) {
+            _errorString = tr("%1 %2: %3").arg(columnName).arg(value).arg(e.what());
+            return false;
+        }
+        return true;
+    }
+
+    bool ok;
+    degrees = value.toDouble(&ok);
+    if (!ok) {
+        _errorString = tr("%1 %2 is not a number").arg(columnName).arg(value);
+        return false;
+    }
+
+    return true;
+}
+
+void ExcelMissionImporter::_updateProgress(qint64 offset, qint64 size)
+{
+    int percent = 100;
+    if (_sheetCount && _sheetIndex < _sheetCount) {
+        percent = (int)((_sheetIndex + ((double)offset / qMax(size, (qint64)1))) * 100.0 / _sheetCount);
+    }
+    if (percent > _lastPercent) {
+        _lastPercent = percent;
+        emit importProgress(percent / 100.0);
+    }
+}
@@ -0,0 +1,97 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Streaming import of survey boundaries from xlsx workbooks
+ */
+
+#ifndef ExcelMissionImporter_H
+#define ExcelMissionImporter_H
+
+#include <QThread>
+#include <QGeoCoordinate>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+
+#include "QGCLoggingCategory.h"
+
+Q_DECLARE_LOGGING_CATEGORY(ExcelMissionImporterLog)
+
+class QXmlStreamReader;
+
+/// Reads the boundary points out of an xlsx workbook without loading it into a QXlsx::Document.
+///
+/// Each worksheet whose first row holds the headers Lat, Lng and Alt becomes one boundary. The sheet XML
+/// is parsed with a stream reader and only the first three columns are kept, straight into a coordinate
+/// array. Latitude and longitude are decimal degrees or DMS strings, an altitude which isn't a number
+/// falls back to defaultAltitude. Other sheets are skipped.
+///
+/// The import runs on the calling thread with importFile, or on its own thread with start(). In the latter
+/// case progress is reported through importProgress and the import can be stopped with cancel().
+class ExcelMissionImporter : public QThread
+{
+    Q_OBJECT
+
+public:
+    ExcelMissionImporter(const QString& fileName, QObject* parent = NULL);
+
+    typedef struct {
+        QString                 name;
+        QVector<QGeoCoordinate> coordinates;
+    } Sheet_t;
+
+    /// Reads the workbook. Results are available from sheets() once this returns true.
+    bool importFile(void);
+
+    /// Stops the import in progress at the next row. Thread safe.
+    void cancel(void) { _cancel = true; }
+
+    bool                    canceled    (void) const { return _cancel; }
+    const QString&          fileName    (void) const { return _fileName; }
+    const QString&          errorString (void) const { return _errorString; }
+    const QList<Sheet_t>&   sheets      (void) const { return _sheets; }
+
+    static const double defaultAltitude;
+
+signals:
+    /// Emitted from the importing thread as each percent of the sheet data is parsed
+    ///     @param progress 0.0 - 1.0
+    void importProgress(double progress);
+
+protected:
+    void run(void) final { importFile(); }
+
+private:
+    typedef struct {
+        QString name;
+        QString path;   ///< Path of the sheet XML inside the zip
+    } SheetEntry_t;
+
+    bool _readWorkbook          (const QByteArray& workbookXml, const QByteArray& relsXml, QList<SheetEntry_t>& entries);
+    bool _readSharedStrings     (const QByteArray& xml);
+    bool _readSheet             (const QByteArray& xml, Sheet_t& sheet);
+    bool _readCellValue         (QXmlStreamReader& reader, bool sharedString, QString& value);
+    bool _parseDegrees          (const QString& value, double& degrees, const char* columnName);
+    void _updateProgress        (qint64 offset, qint64 size);
+
+    QString             _fileName;
+    QString             _errorString;
+    QList<Sheet_t>      _sheets;
+    QStringList         _sharedStrings;
+    std::atomic<bool>   _cancel;
+    int                 _sheetIndex;        ///< Sheet being parsed, for progress
+    int                 _sheetCount;
+    int                 _lastPercent;
+};
+
+#endif
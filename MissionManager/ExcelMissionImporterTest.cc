@@ -0,0 +1,243 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "ExcelMissionImporterTest.h"
+#include "ExcelMissionImporter.h"
+#include "xlsxdocument.h"
+#include "xlsxzipwriter_p.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QtMath>
+
+ExcelMissionImporterTest::ExcelMissionImporterTest(void)
+{
+    
+}
+
+static QString _columnName(int column)
+{
+    return QString(QChar('A' + column));
+}
+
+/// Writes the minimal set of parts Excel itself needs. Cells which parse as numbers are written as numbers,
+/// everything else goes to the shared strings table, empty cells are left out.
+QString ExcelMissionImporterTest::_writeWorkbook(const QString& fileName, const QStringList& sheetNames, const QList<Rows_t>& sheets)
+{
+    QString path = _dir.path() + "/" + fileName;
+    QXlsx::ZipWriter zip(path);
+    
+    QByteArray contentTypes("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                            "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+                            "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+                            "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+                            "<Override PartName=\"/xl/workbook.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+                            "<Override PartName=\"/xl/sharedStrings.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sharedStrings+xml\"/>");
+    QByteArray workbook("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                        "<workbook xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" "
+                        "xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\"><sheets>");
+    QByteArray rels("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                    "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+                    "<Relationship Id=\"rIdStrings\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/sharedStrings\" Target=\"sharedStrings.xml\"/>");
+    QStringList sharedStrings;
+    
+    for (int sheetIndex = 0; sheetIndex < sheets.count(); sheetIndex++) {
+        QByteArray sheet("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                         "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\"><sheetData>");
+        const Rows_t& rows = sheets[sheetIndex];
+        for (int row = 0; row < rows.count(); row++) {
+            sheet += QString("<row r=\"%1\">").arg(row + 1).toUtf8();
+            for (int column = 0; column < rows[row].count(); column++) {
+                const QString& value = rows[row][column];
+                if (value.isEmpty()) {
+                    continue;
+                }
+                QString ref = _columnName(column) + QString::number(row + 1);
+                bool isNumber;
+                value.toDouble(&isNumber);
+                if (isNumber) {
+                    sheet += QString("<c r=\"%1\"><v>%2</v></c>").arg(ref).arg(value).toUtf8();
+                } else {
+                    if (!sharedStrings.contains(value)) {
+                        sharedStrings.append(value);
+                    }
+                    sheet += QString("<c r=\"%1\" t=\"s\"><v>%2</v></c>").arg(ref).arg(sharedStrings.indexOf(value)).toUtf8();
+                }
+            }
+            sheet += "</row>";
+        }
+        sheet += "</sheetData></worksheet>";
+        
+        QString sheetPath = QString("worksheets/sheet%1.xml").arg(sheetIndex + 1);
+        zip.addFile("xl/" + sheetPath, sheet);
+        contentTypes += QString("<Override PartName=\"/xl/%1\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>").arg(sheetPath).toUtf8();
+        workbook += QString("<sheet name=\"%1\" sheetId=\"%2\" r:id=\"rId%2\"/>").arg(sheetNames[sheetIndex]).arg(sheetIndex + 1).toUtf8();
+        rels += QString("<Relationship Id=\"rId%1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet\" Target=\"%2\"/>").arg(sheetIndex + 1).arg(sheetPath).toUtf8();
+    }
+    
+    QByteArray strings("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                       "<sst xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">");
+    foreach (const QString& value, sharedStrings) {
+        strings += "<si><t>" + value.toHtmlEscaped().toUtf8() + "</t></si>";
+    }
+    strings += "</sst>";
+    
+    zip.addFile("[Content_Types].xml", contentTypes + "</Types>");
+    zip.addFile("_rels/.rels", QByteArray("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                                          "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+                                          "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" Target=\"xl/workbook.xml\"/>"
+                                          "</Relationships>"));
+    zip.addFile("xl/workbook.xml", workbook + "</sheets></workbook>");
+    zip.addFile("xl/_rels/workbook.xml.rels", rels + "</Relationships>");
+    zip.addFile("xl/sharedStrings.xml", strings);
+    zip.close();
+    
+    return path;
+}
+
+/// Single boundary sheet with cRows points on a slow spiral
+QString ExcelMissionImporterTest::_writeLargeWorkbook(const QString& fileName, int cRows)
+{
+    Rows_t rows;
+    rows.reserve(cRows + 1);
+    rows.append(QStringList() << "Lat" << "Lng" << "Alt");
+    for (int i = 0; i < cRows; i++) {
+        double angle = i * 0.001;
+        double radius = 0.01 + (i * 0.0000001);
+        rows.append(QStringList() << QString::number(30.0 + radius * qSin(angle), 'f', 8)
+                                  << QString::number(114.0 + radius * qCos(angle), 'f', 8)
+                                  << QString::number(50 + (i % 100)));
+    }
+    
+    return _writeWorkbook(fileName, QStringList() << "Boundary", QList<Rows_t>() << rows);
+}
+
+void ExcelMissionImporterTest::_testImport(void)
+{
+    Rows_t boundary;
+    boundary << (QStringList() << "Lat" << "Lng" << "Alt")
+             << (QStringList() << "30.5" << "114.25" << "50")
+             << (QStringList() << "30d30'00\"N" << "114d15'00\"E" << "60")
+             << (QStringList() << "30.6" << "114.3" << "n/a");
+    Rows_t notes;
+    notes << (QStringList() << "Name" << "Comment")
+          << (QStringList() << "Field" << "North");
+    Rows_t second;
+    second << (QStringList() << "lat" << "LNG" << "alt")
+           << (QStringList() << "-12.125" << "-45.5" << "100.5")
+           << (QStringList() << "-12.25" << "-45.625" << "101");
+    
+    QString path = _writeWorkbook("import.xlsx", QStringList() << "Boundary" << "Notes" << "Second", QList<Rows_t>() << boundary << notes << second);
+    
+    ExcelMissionImporter importer(path);
+    QVERIFY(importer.importFile());
+    QVERIFY(importer.errorString().isEmpty());
+    
+    // The notes sheet has no Lat header and is skipped
+    const QList<ExcelMissionImporter::Sheet_t>& sheets = importer.sheets();
+    QCOMPARE(sheets.count(), 2);
+    QCOMPARE(sheets[0].name, QString("Boundary"));
+    QCOMPARE(sheets[1].name, QString("Second"));
+    
+    QCOMPARE(sheets[0].coordinates.count(), 3);
+    QCOMPARE(sheets[0].coordinates[0], QGeoCoordinate(30.5, 114.25, 50));
+    QVERIFY(qFuzzyCompare(sheets[0].coordinates[1].latitude(), 30.5));
+    QVERIFY(qFuzzyCompare(sheets[0].coordinates[1].longitude(), 114.25));
+    QCOMPARE(sheets[0].coordinates[1].altitude(), 60.0);
+    QCOMPARE(sheets[0].coordinates[2], QGeoCoordinate(30.6, 114.3, ExcelMissionImporter::defaultAltitude));
+    
+    QCOMPARE(sheets[1].coordinates.count(), 2);
+    QCOMPARE(sheets[1].coordinates[0], QGeoCoordinate(-12.125, -45.5, 100.5));
+    QCOMPARE(sheets[1].coordinates[1], QGeoCoordinate(-12.25, -45.625, 101));
+}
+
+void ExcelMissionImporterTest::_testErrors(void)
+{
+    Rows_t missingCell;
+    missingCell << (QStringList() << "Lat" << "Lng" << "Alt")
+                << (QStringList() << "30.5" << "114.25" << "50")
+                << (QStringList() << "30.6" << "" << "50");
+    Rows_t missingHeader;
+    missingHeader << (QStringList() << "Lat" << "Lon" << "Alt")
+                  << (QStringList() << "30.5" << "114.25" << "50");
+    Rows_t badNumber;
+    badNumber << (QStringList() << "Lat" << "Lng" << "Alt")
+              << (QStringList() << "thirty" << "114.25" << "50");
+    
+    QList<Rows_t> rgSheets;
+    rgSheets << missingCell << missingHeader << badNumber;
+    for (int i = 0; i < rgSheets.count(); i++) {
+        QString path = _writeWorkbook(QString("error%1.xlsx").arg(i), QStringList() << "Sheet1", QList<Rows_t>() << rgSheets[i]);
+        ExcelMissionImporter importer(path);
+        QVERIFY(!importer.importFile());
+        QVERIFY(!importer.errorString().isEmpty());
+        QVERIFY(importer.sheets().isEmpty());
+    }
+    
+    // Not a zip file at all
+    QString path = _dir.path() + "/text.xlsx";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("Lat,Lng,Alt\n30.5,114.25,50\n");
+    file.close();
+    ExcelMissionImporter importer(path);
+    QVERIFY(!importer.importFile());
+    QVERIFY(!importer.errorString().isEmpty());
+}
+
+void ExcelMissionImporterTest::_testCancel(void)
+{
+    QString path = _writeLargeWorkbook("cancel.xlsx", 50000);
+    
+    // Cancel from the import thread as soon as the first progress arrives
+    ExcelMissionImporter importer(path);
+    connect(&importer, &ExcelMissionImporter::importProgress, [&importer](double progress) { Q_UNUSED(progress); importer.cancel(); });
+    
+    importer.start();
+    QVERIFY(importer.wait(30000));
+    
+    QVERIFY(importer.canceled());
+    QVERIFY(!importer.errorString().isEmpty());
+    QVERIFY(importer.sheets().isEmpty());
+}
+
+void ExcelMissionImporterTest::_benchmarkImport(void)
+{
+    const int cRows = 100000;
+    QString path = _writeLargeWorkbook("benchmark.xlsx", cRows);
+    
+    ExcelMissionImporter importer(path);
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(importer.importFile());
+    qint64 streamingMsecs = timer.elapsed();
+    QCOMPARE(importer.sheets().count(), 1);
+    QCOMPARE(importer.sheets()[0].coordinates.count(), cRows);
+    
+    // Same sheet through a full QXlsx::Document, which is what the import used to do
+    timer.restart();
+    QXlsx::Document document(path);
+    QXlsx::Worksheet* sheet = static_cast<QXlsx::Worksheet*>(document.sheet("Boundary"));
+    QVERIFY(sheet);
+    int cPoints = 0;
+    for (int row = 2; row <= sheet->dimension().lastRow(); row++) {
+        if (sheet->cellAt(row, 1) && sheet->cellAt(row, 2) && sheet->cellAt(row, 3)) {
+            sheet->cellAt(row, 1)->value().toString().toDouble();
+            sheet->cellAt(row, 2)->value().toString().toDouble();
+            sheet->cellAt(row, 3)->value().toString().toDouble();
+            cPoints++;
+        }
+    }
+    qint64 documentMsecs = timer.elapsed();
+    QCOMPARE(cPoints, cRows);
+    
+    // Streaming the sheet never costs more than building the whole document
+    QVERIFY(streamingMsecs <= documentMsecs);
+}
@@ -0,0 +1,41 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef ExcelMissionImporterTest_H
+#define ExcelMissionImporterTest_H
+
+#include "UnitTest.h"
+
+#include <QTemporaryDir>
+
+/// Imports generated xlsx workbooks through ExcelMissionImporter
+class ExcelMissionImporterTest : public UnitTest
+{
+    Q_OBJECT
+    
+public:
+    ExcelMissionImporterTest(void);
+    
+private slots:
+    void _testImport(void);
+    void _testErrors(void);
+    void _testCancel(void);
+    void _benchmarkImport(void);
+    
+private:
+    typedef QList<QStringList> Rows_t;
+    
+    QString _writeWorkbook(const QString& fileName, const QStringList& sheetNames, const QList<Rows_t>& sheets);
+    QString _writeLargeWorkbook(const QString& fileName, int cRows);
+    
+    QTemporaryDir _dir;
+};
+
+#endif
@@ -20,12 +20,15 @@
 #include "ParameterManager.h"
 #include "QGroundControlQmlGlobal.h"
 
+#include <QElapsedTimer>
+#include <QPointer>
+
 #ifndef __mobile__
 #include "QGCFileDialog.h"
 #endif
 
 /* Changed by chu.fumin 2016122711 start : dms degree,minute,second convert */
-#include "xlsxdocument.h"
+#include "MissionFileLoader.h"
 #include <iostream>
 #include <exception>
 #include <string>
@@ -66,6 +69,8 @@ MissionController::MissionController(QObject *parent)
     , _cruiseDistance(0.0)
     , _hoverDistance(0.0)
     ,_ackTimeoutTimer(NULL)
+    , _fileLoader(NULL)
+    , _loadProgress(0.0)
 {
     _ackTimeoutTimer = new QTimer(this);
     _ackTimeoutTimer->setInterval(1000);
@@ -76,7 +81,7 @@ MissionController::MissionController(QObject *parent)
 
 MissionController::~MissionController()
 {
-
+    cancelLoadFromFile();
 }
 
 void MissionController::start(bool editMode)
@@ -729,183 +734,107 @@ void MissionController::removeAll(void)
     }
 }
 
-/* Changed by chu.fumin 2016122711 start : dms degree,minute,second convert */
-bool MissionController::_loadExcelMissionFile(const QString& fileName, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString){
-#ifndef __mobile__
-    if(fileName.isEmpty () || !visualItems || !complexItems){
-        errorString = tr("_loadExcelMissionFile error : arg is error.");
-        return false;
+void MissionController::_fileLoadProgress(MissionFileLoader* loader, double progress)
+{
+    if (!loader || loader != _fileLoader) {
+        return;
     }
-    QXlsx::Document xlsx(fileName);
-    int complexCount = 1;
-    foreach(QString sheetName, xlsx.sheetNames())
-    {
-        QXlsx::Worksheet *sheet = static_cast<QXlsx::Worksheet *>(xlsx.sheet(sheetName));
-        if(sheet){
-            QXlsx::CellRange srange = sheet->dimension();
-
-            if(srange.lastColumn () == 1 && srange.lastRow () == 1){
-                qDebug() <<  "_loadExcelMissionFile no data found : " + sheet->sheetName();
-                continue;
-            }
-
-            QXlsx::Cell *cellLat = sheet->cellAt (1, 1);
-            if(!cellLat){
-                qDebug() <<  "_loadExcelMissionFile no data found, cellLat is null : " + sheet->sheetName();
-                continue;
-            }
-            if(cellLat->value ().toString ().compare ("Lat", Qt::CaseInsensitive)){
-                qDebug() <<  "_loadExcelMissionFile no data found, not Lat format : " + sheet->sheetName();
-                continue;
-            }
-            qDebug()<<cellLat->value ().toString ();
+    _loadProgress = progress;
+    emit loadProgressChanged(_loadProgress);
+}
 
-            QXlsx::Cell *cellLng = sheet->cellAt (1, 2);
-            if(!cellLng || cellLng->value ().toString ().compare ("Lng", Qt::CaseInsensitive)){
-                errorString = "_loadExcelMissionFile error : Lng is null.";
-                continue;
-            }
-            qDebug()<<cellLng->value ().toString ();
+/// Builds the visual items from what the loader parsed, all in one go on the GUI thread
+void MissionController::_fileLoadFinished(MissionFileLoader* loader)
+{
+    // A cancelled or replaced loader may still have its finished call queued
+    if (!loader || loader != _fileLoader) {
+        return;
+    }
+    _fileLoader = NULL;
+    emit loadInProgressChanged(false);
 
-            QXlsx::Cell *cellAlt = sheet->cellAt (1, 3);
-            if(!cellAlt || cellAlt->value ().toString ().compare ("Alt", Qt::CaseInsensitive)){
-                errorString = tr("_loadExcelMissionFile error : Alt is null.");
-                continue;
-            }
-            qDebug()<<cellAlt->value ().toString ();
-
-            QVariantList polygonPath;
-            qDebug()<<sheet->dimension ().rowCount ()<<" "<<sheet->dimension ().lastRow ();
-            for(int i = 2; i <= sheet->dimension ().lastRow ();i++){
-                QXlsx::Cell *latCell = sheet->cellAt (i, 1);
-                if(!latCell){
-                    errorString =tr( "_loadExcelMissionFile error : sheet Lat is null.");
-                    return false;
-                }
+    QElapsedTimer buildTimer;
+    buildTimer.start();
 
-                QXlsx::Cell *lngCell = sheet->cellAt (i, 2);
-                if(!lngCell){
-                    errorString = "_loadExcelMissionFile error : sheet Lng is null.";
-                    return false;
-                }
+    QString errorString = loader->errorString();
+    bool fileFlag = true;
+    QmlObjectListModel* newVisualItems = new QmlObjectListModel(this);
+    QmlObjectListModel* newComplexItems = new QmlObjectListModel(this);
 
-                QXlsx::Cell *altCell = sheet->cellAt (i, 3);
-                if(!altCell){
-                    errorString = tr("_loadExcelMissionFile error : sheet Alt is null.");
-                    return false;
-                }
-                if(latCell && lngCell && altCell){
+    if (errorString.isEmpty()) {
+        switch (loader->fileType()) {
+        case MissionFileLoader::FileTypeExcel:
+            _loadExcelMissionFile(loader, newVisualItems, newComplexItems, errorString);
+            break;
+        case MissionFileLoader::FileTypeKml:
+            fileFlag = false;
+            _loadKmlMissionFile(loader, newVisualItems, newComplexItems, errorString);
+            break;
+        case MissionFileLoader::FileTypeText:
+        {
+            QByteArray bytes = loader->text();
+            QTextStream stream(&bytes);
+            _loadTextMissionFile(stream, newVisualItems, errorString);
+            break;
+        }
+        case MissionFileLoader::FileTypeJson:
+            _loadJsonMissionFile(loader->json(), newVisualItems, newComplexItems, errorString);
+            break;
+        case MissionFileLoader::FileTypeUnknown:
+            break;
+        }
+    }
 
-                }else{
-                    qDebug()<<"_loadExcelMissionFile no lat lng and alt data found.";
-                    break;
-                }
+    _setLoadedItems(newVisualItems, newComplexItems, errorString, fileFlag);
 
-                QString latStr = latCell->value ().toString ();
-                QString lngStr = lngCell->value ().toString ();
-                QString altStr = altCell->value ().toString ();
-
-                bool ok = false;
-                double lat = 0.0, lng = 0.0, alt = 1000.0;
-                if(latStr.contains ("d", Qt::CaseInsensitive) || latStr.contains ("°", Qt::CaseInsensitive)
-                        || latStr.contains ("\'", Qt::CaseInsensitive)
-                        || latStr.contains ("\"", Qt::CaseInsensitive)){
-                    try {
-                        DMS::flag type;
-                        lat = DMS::Decode(latStr.toStdString (), type);
-                    }
-                    catch (const exception& e) {
-                        errorString = tr("_loadExcelMissionFile error : ") + e.what ();
-                        qDebug()<<" errorString "<<errorString;
-                        return false;
-                    }
-                }else if(latStr.contains (".",  Qt::CaseInsensitive)){
-                    lat = latStr.toDouble (&ok);
-                    if(!ok){
-                        errorString = tr("_loadExcelMissionFile error : latStr toDouble is null.");
-                        return false;
-                    }
-                }else{
-                    errorString = tr("_loadExcelMissionFile error : latStr is null.");
-                    return false;
-                }
+    qCDebug(MissionControllerLog) << "Load" << loader->fileName() << "parse msecs" << loader->parseMsecs() << "build msecs" << buildTimer.elapsed()
+                                  << "items" << (_visualItems ? _visualItems->count() : 0);
+    loader->deleteLater();
+}
 
-                if(lngStr.contains ("d", Qt::CaseInsensitive) || lngStr.contains ("°", Qt::CaseInsensitive)
-                        || lngStr.contains ("\'", Qt::CaseInsensitive) 
-					    || lngStr.contains ("\"", Qt::CaseInsensitive)){
-                    try {
-                        DMS::flag type;
-                        lng = DMS::Decode(lngStr.toStdString (), type);
-                    }
-                    catch (const exception& e) {
-                        errorString = tr("_loadExcelMissionFile error : ") + e.what ();
-                        qDebug()<<" errorString "<<errorString;
-                        return false;
-                    }
-                }else if(lngStr.contains (".",  Qt::CaseInsensitive)){
-                    lng = lngStr.toDouble (&ok);
-                    if(!ok){
-                        errorString = tr("_loadExcelMissionFile error : latStr toDouble is null.");
-                        return false;
-                    }
-                }else{
-                    errorString = tr("_loadExcelMissionFile error : latStr is null.");
-                    return false;
-                }
+void MissionController::cancelLoadFromFile(void)
+{
+    if (_fileLoader) {
+        disconnect(_fileLoader, 0, this, 0);
+        _fileLoader->cancel();
+        _fileLoader->wait();
+        _fileLoader->deleteLater();
+        _fileLoader = NULL;
+        emit loadInProgressChanged(false);
+    }
+}
 
-                alt = altStr.toDouble (&ok);
-                if(!ok){
-                    errorString = tr("_loadExcelMissionFile error : alt toDouble is null.");
-                    //return false;
-                    alt = 1000.0;
-                }
+/* Changed by chu.fumin 2016122711 start : dms degree,minute,second convert */
+/// Builds a survey from each boundary sheet of the workbook
+bool MissionController::_loadExcelMissionFile(const MissionFileLoader* loader, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString)
+{
+    int complexCount = 1;
+    foreach (const MissionFileLoader::Shape_t& shape, loader->shapes()) {
+        QVariantList polygonPath;
+        polygonPath.reserve(shape.coordinates.count());
+        foreach (const QGeoCoordinate& coordinate, shape.coordinates) {
+            polygonPath << QVariant::fromValue(coordinate);
+        }
 
-                QGeoCoordinate coordinate;
-                coordinate.setAltitude (alt);
-                coordinate.setLatitude (lat);
-                coordinate.setLongitude (lng);
-                polygonPath << QVariant::fromValue(coordinate);
-                qDebug()<<coordinate;
-            }
-            if(polygonPath.count () > 0){
-                SurveyMissionItem* item = new SurveyMissionItem(_activeVehicle, this);
-                if (item->loadDMS (polygonPath, complexCount)) {
-                    complexCount++;
-                    complexItems->append(item);
-                    visualItems->append(item);
-                } else {
-                    delete item;
-                    item = NULL;
-                    return false;
-                }
-            }
+        SurveyMissionItem* item = new SurveyMissionItem(_activeVehicle, this);
+        if (item->loadDMS(polygonPath, complexCount)) {
+            complexCount++;
+            complexItems->append(item);
+            visualItems->append(item);
+        } else {
+            delete item;
+            errorString = tr("Unable to create survey from sheet %1").arg(shape.name);
+            return false;
         }
     }
     _addPlannedHomePosition(visualItems, true /* addToCenter */);
-    errorString.clear ();
+
     return true;
-#else
-    Q_UNUSED(fileName);
-    Q_UNUSED(visualItems);
-    Q_UNUSED(complexItems);
-    Q_UNUSED(errorString);
-    return false;
-#endif
 }
 /* Changed by chu.fumin 2016122711 end : dms degree,minute,second convert */
 
-bool MissionController::_loadJsonMissionFile(const QByteArray& bytes, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString)
+bool MissionController::_loadJsonMissionFile(const QJsonObject& json, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString)
 {
-    QJsonParseError jsonParseError;
-    QJsonDocument   jsonDoc(QJsonDocument::fromJson(bytes, &jsonParseError));
-
-    if (jsonParseError.error != QJsonParseError::NoError) {
-        errorString = jsonParseError.errorString();
-        return false;
-    }
-
-    QJsonObject json = jsonDoc.object();
-
     // Check for required keys
     QStringList requiredKeys;
     requiredKeys << JsonHelper::jsonVersionKey << _jsonPlannedHomePositionKey;
@@ -1136,219 +1065,77 @@ bool MissionController::_loadTextMissionFile(QTextStream& stream, QmlObjectListM
 }
 //===============================================================
 //edit by wang.lichen
-bool MissionController::_loadKmlMissionFile(const QString& fileName, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString){
-#ifndef __mobile__
-    if(_polygonn->count ()){
-        qDebug()<<"_polygon : "<<_polygonn;
-        _polygonn->deleteListAndContents ();
-        _polygonn = new QmlObjectListModel(this);
-        emit polygonnChanged ();
-    }
-    if(_lineString){
-        _lineString->deleteListAndContents ();
-        _lineString = new QmlObjectListModel(this);
-        emit lineStringChanged ();
+bool MissionController::_loadKmlMissionFile(const MissionFileLoader* loader, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString)
+{
+    foreach (const MissionFileLoader::Shape_t& shape, loader->shapes()) {
+        QVariantList path;
+        path.reserve(shape.coordinates.count());
+        foreach (const QGeoCoordinate& coordinate, shape.coordinates) {
+            path << QVariant::fromValue(coordinate);
+        }
 
+        SurveyMissionItem* item = new SurveyMissionItem(_activeVehicle, this);
+        bool loaded = shape.type == MissionFileLoader::ShapePolygon ? item->loadKMLPolygon(path, 0) : item->loadKMLLineString(path, 0);
+        if (loaded) {
+            complexItems->append(item);
+            visualItems->append(item);
+        } else {
+            delete item;
+        }
     }
-    if(fileName.isEmpty () || !visualItems || !complexItems){
-        errorString = tr("_loadKmlMissionFile error : arg is error.");
-        return false;
-    }
-    QFile xmlFile(fileName);
-    if (!xmlFile.exists()) {
-        qDebug() << "Internal error: metaDataFile mission" ;
-        return false;
-    }
-    if (!xmlFile.open(QIODevice::ReadOnly)) {
-        qDebug() << "Internal error: Unable to open parameter file:" ;
+    if (complexItems->count() == 0) {
+        errorString = tr("No polygons or line strings found in %1").arg(loader->fileName());
         return false;
     }
-    QXmlStreamReader xml(xmlFile.readAll());
-    xmlFile.close();
-    if (xml.hasError()) {
-        qDebug() << "Badly formed XML" ;
-        return false;
-    }
-    qDebug()<<"read kml success";
-    while (!xml.atEnd()) {
-        if (xml.isStartElement()) {
-            QString elementName = xml.name().toString();
-            if(elementName == "Polygon"){
-                parsePolygon(xml, visualItems, complexItems);
-            }
 
-            if(elementName == "LineString"){
-                parseLineString(xml,visualItems, complexItems);
-            }
-        }
-        xml.readNext();
-    }
-    for(int i = 0; i < complexItems->count (); i++){
-        if(_lineString)
-            _lineString->append (complexItems->get (i));
+    // Overlays are swapped in whole so QML only sees one change each
+    QmlObjectListModel* polygons = new QmlObjectListModel(this);
+    QmlObjectListModel* lineStrings = new QmlObjectListModel(this);
+    for (int i = 0; i < complexItems->count(); i++) {
+        polygons->append(complexItems->get(i));
+        lineStrings->append(complexItems->get(i));
     }
-    emit lineStringChanged ();
-    for(int i = 0; i < complexItems->count (); i++){
-        if(_polygonn)
-            _polygonn->append (complexItems->get (i));
-    }
-    emit polygonnChanged ();
+    _polygonn->deleteListAndContents();
+    _polygonn = polygons;
+    emit polygonnChanged();
+    _lineString->deleteListAndContents();
+    _lineString = lineStrings;
+    emit lineStringChanged();
+
     SimpleMissionItem* homeItem = new SimpleMissionItem(_activeVehicle, this);
     visualItems->insert(0, homeItem);
     VisualMissionItem* item = qobject_cast<VisualMissionItem*>(visualItems->get(1));
     double aa = _normalizeLat(item->coordinate().latitude());
     double bb = _normalizeLon(item->coordinate().longitude());
     homeItem->setCoordinate(QGeoCoordinate(aa-90.0,bb-180.0,0));
-    errorString.clear ();
     return true;
-#else
-    Q_UNUSED(fileName);
-    Q_UNUSED(visualItems);
-    Q_UNUSED(complexItems);
-    Q_UNUSED(errorString);
-    return false;
-#endif
-}
-
-void MissionController::parsePolygon(QXmlStreamReader &reader, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems)
-{
-    while(!reader.atEnd()){
-        reader.readNext();
-        if(reader.isStartElement ()){
-            QString elementName = reader.name ().toString ();
-            if(elementName == "coordinates"){
-                QVariantList polygonPath;
-                int complexCount = 0;
-                QString strVersion = reader.readElementText();
-                QString coorString = strVersion.simplified ();
-                QStringList coorArray = coorString.split (" ");
-                int length = coorArray.length();
-                QGeoCoordinate coordinate;
-                if(length > 2 ){
-                    for (int i=0;i<length;i++){
-                        QString coord = coorArray.at(i);
-                        int len = coord.split(",").length();
-                        for(int j=0;j<len;j++){
-                            QStringList coord1= coord.split(",");
-                            QString cor = coord1.at(j);
-                            if(j==0)coordinate.setLongitude(cor.toDouble());
-                            else if(j==1)coordinate.setLatitude(cor.toDouble());
-                            else coordinate.setAltitude(cor.toDouble());
-                        }
-                        polygonPath << QVariant::fromValue(coordinate);
-                    }
-                }
-                if(polygonPath.count () > 0){
-                    SurveyMissionItem* item = new SurveyMissionItem(_activeVehicle, this);
-                    if (item->loadKMLPolygon(polygonPath, complexCount)) {
-                        complexCount++;
-                        complexItems->append(item);
-                        visualItems->append(item);
-                        return;
-                    } else {
-                        delete item;
-                        item = NULL;
-                        return;
-                    }
-                }
-                return;
-            }
-        }
-    }
-}
-
-void MissionController::parseLineString(QXmlStreamReader &reader, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems)
-{
-    while(!reader.atEnd ()){
-        reader.readNext ();
-        QString elementName = reader.name ().toString ();
-        if(elementName == "coordinates"){
-            QVariantList lineString;
-            int complexCount = 0;
-            QString strVersion = reader.readElementText();
-            QString coorString = strVersion.simplified ();
-            QStringList coorArray = coorString.split (" ");
-            int length = coorArray.length();
-            QGeoCoordinate coordinate;
-            if(length > 1 ){
-                for (int i=0;i<length;i++){
-                    QString coord = coorArray.at(i);
-                    int len = coord.split(",").length();
-                    for(int j=0;j<len;j++){
-                        QStringList coord1= coord.split(",");
-                        QString cor = coord1.at(j);
-                        if(j==0)coordinate.setLongitude(cor.toDouble());
-                        else if(j==1)coordinate.setLatitude(cor.toDouble());
-                        else coordinate.setAltitude(cor.toDouble());
-                    }
-                    lineString << QVariant::fromValue(coordinate);
-                }
-            }
-            if(lineString.count ()){
-                SurveyMissionItem* item = new SurveyMissionItem(_activeVehicle, this);
-                if (item->loadKMLLineString (lineString, complexCount)) {
-                    complexCount++;
-                    complexItems->append (item);
-                    visualItems->append(item);
-                    return;
-                } else {
-                    delete item;
-                    item = NULL;
-                    return;
-                }
-            }
-            return;
-        }
-    }
-
 }
 //=========================================================
 void MissionController::loadFromFile(const QString& filename)
 {
-    QString errorString;
-
     if (filename.isEmpty()) {
         return;
     }
 
-    QmlObjectListModel* newVisualItems = new QmlObjectListModel(this);
-    QmlObjectListModel* newComplexItems = new QmlObjectListModel(this);
+    // A new load replaces any load still running
+    cancelLoadFromFile();
 
-    QFile file(filename);
-    bool fileFlag = false;
+    // Parsing happens in the background, the mission is replaced once it finishes
+    _fileLoader = new MissionFileLoader(filename, this);
+    QPointer<MissionFileLoader> loader = _fileLoader;
+    connect(_fileLoader, &MissionFileLoader::loadProgress,  this, [this, loader](double progress) { _fileLoadProgress(loader, progress); });
+    connect(_fileLoader, &QThread::finished,                this, [this, loader]() { _fileLoadFinished(loader); });
 
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        errorString = file.errorString();
-        fileFlag = true;
-    } else {
-        /* Changed by chu.fumin 2016122711 start : dms degree,minute,second convert */
-        QFileInfo fileInfo(filename);
-        if(fileInfo.suffix () == "xlsx"){
-            _loadExcelMissionFile(filename, newVisualItems, newComplexItems, errorString);
-            qDebug()<<errorString;
-            fileFlag = true;
-        }else if(fileInfo.suffix()=="kml" || fileInfo.suffix ()== "KML"){
-            fileFlag = false;
-            _loadKmlMissionFile(filename, newVisualItems, newComplexItems, errorString);
-        }else if(fileInfo.suffix () == "xls"){
-            fileFlag = true;
-            errorString = tr("Ground station does not support this type of file end with .xls : ") + filename;
-        }else{
-        /* Changed by chu.fumin 2016122711 end : dms degree,minute,second convert */
-            QByteArray  bytes = file.readAll();
-            QTextStream stream(&bytes);
-            fileFlag = true;
-            QString firstLine = stream.readLine();
-            if (firstLine.contains(QRegExp("QGC.*WPL"))) {
-                stream.seek(0);
-                _loadTextMissionFile(stream, newVisualItems, errorString);
-            } else {
-                _loadJsonMissionFile(bytes, newVisualItems, newComplexItems, errorString);
-            }
-        /* Changed by chu.fumin 2016122711 start : dms degree,minute,second convert */
-        }
-        /* Changed by chu.fumin 2016122711 end : dms degree,minute,second convert */
-    }
+    _loadProgress = 0.0;
+    emit loadProgressChanged(_loadProgress);
+    emit loadInProgressChanged(true);
+
+    _fileLoader->start();
+}
+
+/// Replaces the current mission with newly loaded items, or discards them if the load failed
+void MissionController::_setLoadedItems(QmlObjectListModel* newVisualItems, QmlObjectListModel* newComplexItems, const QString& errorString, bool fileFlag)
+{
     if (!errorString.isEmpty()) {
         for (int i=0; i<newVisualItems->count(); i++) {
             newVisualItems->get(i)->deleteLater();
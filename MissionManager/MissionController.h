@@ -24,6 +24,7 @@
 
 class CameraModelItem;
 class CoordinateVector;
+class MissionFileLoader;
 
 Q_DECLARE_LOGGING_CATEGORY(MissionControllerLog)
 
@@ -69,6 +70,8 @@ public:
     Q_PROPERTY(double               cruiseDistance      READ cruiseDistance                             NOTIFY cruiseDistanceChanged)
     Q_PROPERTY(double               hoverDistance       READ hoverDistance                              NOTIFY hoverDistanceChanged)
     Q_PROPERTY(QVariantList         polygonPathh                READ polygonPathh                    NOTIFY polygonPathhChanged)
+    Q_PROPERTY(bool                 loadInProgress      READ loadInProgress                             NOTIFY loadInProgressChanged)
+    Q_PROPERTY(double               loadProgress        READ loadProgress                               NOTIFY loadProgressChanged)
     Q_INVOKABLE void removeMissionItem(int index);
 
     Q_INVOKABLE void sendAltitudee(double alti);
@@ -85,6 +88,9 @@ public:
      Q_INVOKABLE void loadRecover(void);
     Q_INVOKABLE void loadMoveLineAdd(void);
      Q_INVOKABLE void loadRecoverAdd(void);
+
+    /// Stops a file load running in the background, the current mission is left as is
+    Q_INVOKABLE void cancelLoadFromFile(void);
     //========================================================
     /// Add a new simple mission item to the list
     ///     @param i: index to insert at
@@ -153,6 +159,8 @@ QVariantList polygonPathh(void) { return _polygonPathh; }
     double  missionMaxTelemetry     (void) const { return _missionMaxTelemetry; }
     double  cruiseDistance          (void) const { return _cruiseDistance; }
     double  hoverDistance           (void) const { return _hoverDistance; }
+    bool    loadInProgress          (void) const { return _fileLoader != NULL; }
+    double  loadProgress            (void) const { return _loadProgress; }
 
     void setMissionDistance         (double missionDistance );
     void setMissionMaxTelemetry     (double missionMaxTelemetry);
@@ -187,6 +195,8 @@ signals:
     void missionMaxTelemetryChanged(double missionMaxTelemetry);
     void cruiseDistanceChanged(double cruiseDistance);
     void hoverDistanceChanged(double hoverDistance);
+    void loadInProgressChanged(bool loadInProgress);
+    void loadProgressChanged(double loadProgress);
 
 private slots:
     void _newMissionItemsAvailableFromVehicle();
@@ -209,6 +219,8 @@ private slots:
     void _ackTimeStop(bool receive);
 
 private:
+    void _fileLoadProgress(MissionFileLoader* loader, double progress);
+    void _fileLoadFinished(MissionFileLoader* loader);
     void _recalcSequence(void);
     void _recalcChildItems(void);
     void _recalcAll(void);
@@ -224,16 +236,15 @@ private:
     void _addPlannedHomePosition(QmlObjectListModel* visualItems, bool addToCenter);
     double _normalizeLat(double lat);
     double _normalizeLon(double lon);
-    bool _loadJsonMissionFile(const QByteArray& bytes, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString);
+    bool _loadJsonMissionFile(const QJsonObject& json, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString);
     /* Changed by chu.fumin 2016122414 start : load items from excel */
-    bool _loadExcelMissionFile(const QString& fileName, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString);
+    bool _loadExcelMissionFile(const MissionFileLoader* loader, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString);
     /* Changed by chu.fumin 2016122414 end : load items from excel */
     bool _loadTextMissionFile(QTextStream& stream, QmlObjectListModel* visualItems, QString& errorString);
     int _nextSequenceNumber(void);
+    void _setLoadedItems(QmlObjectListModel* newVisualItems, QmlObjectListModel* newComplexItems, const QString& errorString, bool fileFlag);
     //edit by wang.lichen load the kml file
-    bool _loadKmlMissionFile(const QString& fileName, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString);
-    void parsePolygon(QXmlStreamReader &reader, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems);
-    void parseLineString(QXmlStreamReader &reader, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems);
+    bool _loadKmlMissionFile(const MissionFileLoader* loader, QmlObjectListModel* visualItems, QmlObjectListModel* complexItems, QString& errorString);
     //==========================================================
     // Overrides from PlanElementController
     void _activeVehicleBeingRemoved(void) final;
@@ -276,6 +287,9 @@ private:
      QTimer*             _ackTimeoutTimer;
      int                        _retrycount;
      int                        _currentMissionItem;
+
+    MissionFileLoader*      _fileLoader;        ///< Load running in the background, NULL for none
+    double                  _loadProgress;
 };
 
 class CameraModelItem : public QObject
@@ -0,0 +1,262 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "MissionFileLoader.h"
+
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QXmlStreamReader>
+#include <QRegExp>
+
+QGC_LOGGING_CATEGORY(MissionFileLoaderLog, "MissionFileLoaderLog")
+
+/// Xml tokens read between cancel and progress checks
+static const int _cTokensPerCheck = 64;
+
+MissionFileLoader::MissionFileLoader(const QString& fileName, QObject* parent)
+    : QThread(parent)
+    , _fileName(fileName)
+    , _fileType(FileTypeUnknown)
+    , _parseMsecs(0)
+    , _cancel(false)
+    , _lastPercent(-1)
+    , _excelImporter(fileName)
+    , _numberLength(0)
+    , _tupleCount(0)
+{
+    // Workbook progress is passed straight through from the loading thread
+    connect(&_excelImporter, &ExcelMissionImporter::importProgress, this, &MissionFileLoader::loadProgress, Qt::DirectConnection);
+}
+
+void MissionFileLoader::cancel(void)
+{
+    _cancel = true;
+    _excelImporter.cancel();
+}
+
+bool MissionFileLoader::loadFile(void)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    _errorString.clear();
+    _shapes.clear();
+    _json = QJsonObject();
+    _text.clear();
+    _lastPercent = -1;
+
+    bool success;
+    QString suffix = QFileInfo(_fileName).suffix();
+    if (suffix == QLatin1String("xlsx")) {
+        _fileType = FileTypeExcel;
+        success = _loadExcel();
+    } else if (suffix.compare(QLatin1String("kml"), Qt::CaseInsensitive) == 0) {
+        _fileType = FileTypeKml;
+        success = _loadKml();
+    } else if (suffix == QLatin1String("xls")) {
+        _errorString = tr("Ground station does not support this type of file end with .xls : ") + _fileName;
+        success = false;
+    } else {
+        success = _loadMission();
+    }
+
+    _parseMsecs = timer.elapsed();
+    qCDebug(MissionFileLoaderLog) << "Parsed" << _fileName << "type" << _fileType << "shapes" << _shapes.count() << "msecs" << _parseMsecs << _errorString;
+
+    return success;
+}
+
+bool MissionFileLoader::_loadExcel(void)
+{
+    if (!_excelImporter.importFile()) {
+        _errorString = _excelImporter.errorString();
+        return false;
+    }
+
+    foreach (const ExcelMissionImporter::Sheet_t& sheet, _excelImporter.sheets()) {
+        Shape_t shape;
+        shape.type = ShapeBoundary;
+        shape.name = sheet.name;
+        shape.coordinates = sheet.coordinates;
+        _shapes.append(shape);
+    }
+
+    return true;
+}
+
+/// Json and QGC WPL missions. These are small, only the json document is parsed here.
+bool MissionFileLoader::_loadMission(void)
+{
+    QFile file(_fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        _errorString = file.errorString();
+        return false;
+    }
+    QByteArray bytes = file.readAll();
+    _updateProgress(0.5);
+
+    int firstLineEnd = bytes.indexOf('\n');
+    QString firstLine = QString::fromUtf8(bytes.constData(), firstLineEnd == -1 ? bytes.size() : firstLineEnd);
+    if (firstLine.contains(QRegExp("QGC.*WPL"))) {
+        _fileType = FileTypeText;
+        _text = bytes;
+    } else {
+        _fileType = FileTypeJson;
+        QJsonParseError jsonParseError;
+        QJsonDocument jsonDoc(QJsonDocument::fromJson(bytes, &jsonParseError));
+        if (jsonParseError.error != QJsonParseError::NoError) {
+            _errorString = jsonParseError.errorString();
+            return false;
+        }
+        _json = jsonDoc.object();
+    }
+    _updateProgress(1.0);
+
+    return true;
+}
+
+bool MissionFileLoader::_loadKml(void)
+{
+    QFile file(_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        _errorString = file.errorString();
+        return false;
+    }
+    qint64 fileSize = qMax(file.size(), (qint64)1);
+
+    QXmlStreamReader xml(&file);
+    QString placemarkName;
+    bool inShape = false;
+    bool shapeHasCoordinates = false;
+    bool inCoordinates = false;
+    int tokens = 0;
+
+    while (!xml.atEnd()) {
+        QXmlStreamReader::TokenType token = xml.readNext();
+
+        if (token == QXmlStreamReader::Characters) {
+            if (inCoordinates) {
+                _parseCoordinates(xml.text(), _shapes.last().coordinates);
+            }
+        } else if (token == QXmlStreamReader::StartElement) {
+            QStringRef name = xml.name();
+            if (name == QLatin1String("Placemark")) {
+                placemarkName.clear();
+            } else if (name == QLatin1String("name") && !inShape) {
+                placemarkName = xml.readElementText();
+            } else if (name == QLatin1String("Polygon") || name == QLatin1String("LineString")) {
+                Shape_t shape;
+                shape.type = name == QLatin1String("Polygon") ? ShapePolygon : ShapeLineString;
+                shape.name = placemarkName;
+                _shapes.append(shape);
+                inShape = true;
+                shapeHasCoordinates = false;
+            } else if (name == QLatin1String("coordinates") && inShape && !shapeHasCoordinates) {
+                inCoordinates = true;
+                _numberLength = 0;
+                _tupleCount = 0;
+            }
+        } else if (token == QXmlStreamReader::EndElement) {
+            QStringRef name = xml.name();
+            if (name == QLatin1String("coordinates") && inCoordinates) {
+                _endComponent();
+                _endTuple(_shapes.last().coordinates);
+                inCoordinates = false;
+                shapeHasCoordinates = true;
+            } else if (name == QLatin1String("Polygon") || name == QLatin1String("LineString")) {
+                const Shape_t& shape = _shapes.last();
+                int minimumPoints = shape.type == ShapePolygon ? 3 : 2;
+                if (shape.coordinates.count() < minimumPoints) {
+                    qCDebug(MissionFileLoaderLog) << "Dropping shape with too few points" << shape.name << shape.coordinates.count();
+                    _shapes.removeLast();
+                } else {
+                    _shapes.last().coordinates.squeeze();
+                }
+                inShape = false;
+            }
+        }
+
+        if (++tokens % _cTokensPerCheck == 0) {
+            if (_cancel) {
+                _errorString = tr("Load canceled");
+                _shapes.clear();
+                return false;
+            }
+            _updateProgress((double)file.pos() / fileSize);
+        }
+    }
+
+    if (xml.hasError()) {
+        _errorString = tr("Badly formed KML at line %1: %2").arg(xml.lineNumber()).arg(xml.errorString());
+        _shapes.clear();
+        return false;
+    }
+    if (_shapes.isEmpty()) {
+        _errorString = tr("No polygons or line strings found in %1").arg(_fileName);
+        return false;
+    }
+    _updateProgress(1.0);
+
+    return true;
+}
+
+/// Consumes a chunk of "lon,lat[,alt] lon,lat[,alt] ..." text. Whatever is left of a tuple at the end of
+/// the chunk carries over to the next one.
+void MissionFileLoader::_parseCoordinates(const QStringRef& text, QVector<QGeoCoordinate>& coordinates)
+{
+    const QChar* chars = text.constData();
+    for (int i = 0; i < text.length(); i++) {
+        ushort c = chars[i].unicode();
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            _endComponent();
+            _endTuple(coordinates);
+        } else if (c == ',') {
+            _endComponent();
+        } else if (_numberLength < (int)sizeof(_number) - 1) {
+            _number[_numberLength++] = c < 128 ? (char)c : '?';
+        }
+    }
+}
+
+void MissionFileLoader::_endComponent(void)
+{
+    if (_numberLength == 0) {
+        return;
+    }
+    if (_tupleCount < 3) {
+        // Unparseable values end up as 0, which is what the previous loader did
+        _tuple[_tupleCount++] = QByteArray::fromRawData(_number, _numberLength).toDouble();
+    }
+    _numberLength = 0;
+}
+
+void MissionFileLoader::_endTuple(QVector<QGeoCoordinate>& coordinates)
+{
+    if (_tupleCount >= 2) {
+        QGeoCoordinate coordinate;
+        coordinate.setLongitude(_tuple[0]);
+        coordinate.setLatitude(_tuple[1]);
+        if (_tupleCount > 2) {
+            coordinate.setAltitude(_tuple[2]);
+        }
+        coordinates.append(coordinate);
+    }
+    _tupleCount = 0;
+}
+
+void MissionFileLoader::_updateProgress(double progress)
+{
+    int percent = (int)(progress * 100.0);
+    if (percent > _lastPercent) {
+        _lastPercent = percent;
+        emit loadProgress(percent / 100.0);
+    }
+}
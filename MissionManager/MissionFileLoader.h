@@ -0,0 +1,120 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Background parsing of mission, KML and xlsx files
+ */
+
+#ifndef MissionFileLoader_H
+#define MissionFileLoader_H
+
+#include <QThread>
+#include <QGeoCoordinate>
+#include <QJsonObject>
+#include <QVector>
+#include <QFile>
+
+#include <atomic>
+
+#include "ExcelMissionImporter.h"
+
+Q_DECLARE_LOGGING_CATEGORY(MissionFileLoaderLog)
+
+/// Parses a mission file into plain data off the GUI thread.
+///
+/// Nothing here creates mission items: the result is a QJsonObject for json missions, the raw text for
+/// QGC WPL files and coordinate arrays for KML and xlsx shapes. MissionController builds the visual items
+/// from that in a single step once the load has finished.
+///
+/// KML is parsed straight from the file with a stream reader. Coordinate tuples are split as the character
+/// data arrives, so a boundary with hundreds of thousands of points never exists as one big string.
+/// Only the first coordinates of each Polygon are used (its outer boundary). A polygon needs three points
+/// and a line string two, smaller shapes are dropped.
+class MissionFileLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    MissionFileLoader(const QString& fileName, QObject* parent = NULL);
+
+    typedef enum {
+        FileTypeUnknown,
+        FileTypeJson,       ///< QGC json mission
+        FileTypeText,       ///< QGC WPL text mission
+        FileTypeKml,
+        FileTypeExcel,
+    } FileType_t;
+
+    typedef enum {
+        ShapePolygon,
+        ShapeLineString,
+        ShapeBoundary,      ///< Survey boundary from a workbook sheet
+    } ShapeType_t;
+
+    typedef struct {
+        ShapeType_t             type;
+        QString                 name;           ///< Placemark or sheet name
+        QVector<QGeoCoordinate> coordinates;
+    } Shape_t;
+
+    /// Reads and parses the file on the calling thread
+    bool loadFile(void);
+
+    /// Stops the load in progress. Thread safe.
+    void cancel(void);
+
+    const QString&          fileName    (void) const { return _fileName; }
+    FileType_t              fileType    (void) const { return _fileType; }
+    const QString&          errorString (void) const { return _errorString; }
+    bool                    canceled    (void) const { return _cancel; }
+    const QList<Shape_t>&   shapes      (void) const { return _shapes; }
+    const QJsonObject&      json        (void) const { return _json; }
+    const QByteArray&       text        (void) const { return _text; }
+
+    /// Time spent reading and parsing the file
+    qint64                  parseMsecs  (void) const { return _parseMsecs; }
+
+signals:
+    /// Emitted from the loading thread as each percent of the file is parsed
+    ///     @param progress 0.0 - 1.0
+    void loadProgress(double progress);
+
+protected:
+    void run(void) final { loadFile(); }
+
+private:
+    bool _loadKml           (void);
+    bool _loadExcel         (void);
+    bool _loadMission       (void);
+    void _parseCoordinates  (const QStringRef& text, QVector<QGeoCoordinate>& coordinates);
+    void _endComponent      (void);
+    void _endTuple          (QVector<QGeoCoordinate>& coordinates);
+    void _updateProgress    (double progress);
+
+    QString                 _fileName;
+    FileType_t              _fileType;
+    QString                 _errorString;
+    QList<Shape_t>          _shapes;
+    QJsonObject             _json;
+    QByteArray              _text;
+    qint64                  _parseMsecs;
+    std::atomic<bool>       _cancel;
+    int                     _lastPercent;
+    ExcelMissionImporter    _excelImporter;
+
+    // Coordinate tuple being parsed, it may span several chunks of character data
+    char                    _number[64];
+    int                     _numberLength;
+    double                  _tuple[3];
+    int                     _tupleCount;
+};
+
+#endif
@@ -0,0 +1,229 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "MissionFileLoaderTest.h"
+#include "MissionFileLoader.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+
+MissionFileLoaderTest::MissionFileLoaderTest(void)
+{
+    
+}
+
+QString MissionFileLoaderTest::_writeFile(const QString& fileName, const QByteArray& contents)
+{
+    QString path = _dir.path() + "/" + fileName;
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(contents);
+    }
+    return path;
+}
+
+QByteArray MissionFileLoaderTest::_kmlDocument(const QByteArray& placemarks)
+{
+    return QByteArray("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n<Document>\n<name>Corpus</name>\n")
+            + placemarks + "</Document>\n</kml>\n";
+}
+
+/// Points on a slow diagonal so each one is distinct
+QGeoCoordinate MissionFileLoaderTest::_point(int index)
+{
+    return QGeoCoordinate(30.0 + (index * 0.000001), 114.0 + (index * 0.000002), 10.0 + (index % 50));
+}
+
+QByteArray MissionFileLoaderTest::_kmlCoordinates(int cPoints, int firstPoint, bool altitude, const char* separator)
+{
+    QByteArray text;
+    text.reserve(cPoints * 40);
+    for (int i = firstPoint; i < firstPoint + cPoints; i++) {
+        QGeoCoordinate point = _point(i);
+        text += QByteArray::number(point.longitude(), 'f', 7) + "," + QByteArray::number(point.latitude(), 'f', 7);
+        if (altitude) {
+            text += "," + QByteArray::number(point.altitude(), 'f', 1);
+        }
+        text += separator;
+    }
+    return text;
+}
+
+/// Single polygon the way GIS exports write them: one tuple per line with an inner boundary which is ignored
+QString MissionFileLoaderTest::_writeBoundaryKml(const QString& fileName, int cPoints)
+{
+    QByteArray placemark("<Placemark>\n<name>Field</name>\n<Polygon>\n<outerBoundaryIs><LinearRing><coordinates>\n");
+    placemark += _kmlCoordinates(cPoints, 0, true, "\n\t\t");
+    placemark += "</coordinates></LinearRing></outerBoundaryIs>\n<innerBoundaryIs><LinearRing><coordinates>";
+    placemark += _kmlCoordinates(10, cPoints, true, " ");
+    placemark += "</coordinates></LinearRing></innerBoundaryIs>\n</Polygon>\n</Placemark>\n";
+    
+    return _writeFile(fileName, _kmlDocument(placemark));
+}
+
+void MissionFileLoaderTest::_testLargeBoundary(void)
+{
+    const int cPoints = 200000;
+    QString path = _writeBoundaryKml("boundary.kml", cPoints);
+    
+    MissionFileLoader loader(path);
+    QVERIFY(loader.loadFile());
+    QCOMPARE(loader.fileType(), MissionFileLoader::FileTypeKml);
+    QCOMPARE(loader.shapes().count(), 1);
+    
+    // Every tuple has to survive being split across the chunks the reader hands out
+    const MissionFileLoader::Shape_t& shape = loader.shapes()[0];
+    QCOMPARE(shape.type, MissionFileLoader::ShapePolygon);
+    QCOMPARE(shape.name, QString("Field"));
+    QCOMPARE(shape.coordinates.count(), cPoints);
+    for (int i = 0; i < cPoints; i++) {
+        QGeoCoordinate expected = _point(i);
+        const QGeoCoordinate& actual = shape.coordinates[i];
+        if (qAbs(actual.latitude() - expected.latitude()) > 1e-9 || qAbs(actual.longitude() - expected.longitude()) > 1e-9 || actual.altitude() != expected.altitude()) {
+            QFAIL(qPrintable(QString("Point %1 mismatch").arg(i)));
+        }
+    }
+}
+
+void MissionFileLoaderTest::_testManyPlacemarks(void)
+{
+    const int cPlacemarks = 500;
+    
+    QByteArray placemarks;
+    for (int i = 0; i < cPlacemarks; i++) {
+        placemarks += QString("<Placemark><name>Shape %1</name>").arg(i).toUtf8();
+        if (i % 2) {
+            placemarks += "<LineString><coordinates>" + _kmlCoordinates(50, i * 1000, false, " ") + "</coordinates></LineString>";
+        } else {
+            placemarks += "<Polygon><outerBoundaryIs><LinearRing><coordinates>" + _kmlCoordinates(100, i * 1000, false, " ") + "</coordinates></LinearRing></outerBoundaryIs></Polygon>";
+        }
+        placemarks += "</Placemark>\n";
+    }
+    
+    // Too small to be a polygon
+    placemarks += "<Placemark><name>Degenerate</name><Polygon><outerBoundaryIs><LinearRing><coordinates>" + _kmlCoordinates(2, 0, false, " ") + "</coordinates></LinearRing></outerBoundaryIs></Polygon></Placemark>\n";
+    
+    // Two polygons in one placemark
+    placemarks += "<Placemark><name>Multi</name><MultiGeometry>";
+    placemarks += "<Polygon><outerBoundaryIs><LinearRing><coordinates>" + _kmlCoordinates(4, 0, true, " ") + "</coordinates></LinearRing></outerBoundaryIs></Polygon>";
+    placemarks += "<Polygon><outerBoundaryIs><LinearRing><coordinates>" + _kmlCoordinates(5, 10, true, " ") + "</coordinates></LinearRing></outerBoundaryIs></Polygon>";
+    placemarks += "</MultiGeometry></Placemark>\n";
+    
+    QString path = _writeFile("placemarks.kml", _kmlDocument(placemarks));
+    
+    MissionFileLoader loader(path);
+    QVERIFY(loader.loadFile());
+    
+    const QList<MissionFileLoader::Shape_t>& shapes = loader.shapes();
+    QCOMPARE(shapes.count(), cPlacemarks + 2);
+    for (int i = 0; i < cPlacemarks; i++) {
+        QCOMPARE(shapes[i].name, QString("Shape %1").arg(i));
+        QCOMPARE(shapes[i].type, i % 2 ? MissionFileLoader::ShapeLineString : MissionFileLoader::ShapePolygon);
+        QCOMPARE(shapes[i].coordinates.count(), i % 2 ? 50 : 100);
+        QVERIFY(qAbs(shapes[i].coordinates[0].latitude() - _point(i * 1000).latitude()) < 1e-9);
+        QVERIFY(qIsNaN(shapes[i].coordinates[0].altitude()));
+    }
+    QCOMPARE(shapes[cPlacemarks].name, QString("Multi"));
+    QCOMPARE(shapes[cPlacemarks].coordinates.count(), 4);
+    QCOMPARE(shapes[cPlacemarks + 1].name, QString("Multi"));
+    QCOMPARE(shapes[cPlacemarks + 1].coordinates.count(), 5);
+    QCOMPARE(shapes[cPlacemarks + 1].coordinates[0].altitude(), _point(10).altitude());
+}
+
+void MissionFileLoaderTest::_testMissionFiles(void)
+{
+    // QGC WPL text is passed through untouched
+    QByteArray text("QGC WPL 110\n0\t1\t0\t16\t0\t0\t0\t0\t30.0\t114.0\t10\t1\n");
+    for (int i = 1; i < 5000; i++) {
+        QGeoCoordinate point = _point(i);
+        text += QString("%1\t0\t3\t16\t0\t0\t0\t0\t%2\t%3\t%4\t1\n").arg(i).arg(point.latitude(), 0, 'f', 7).arg(point.longitude(), 0, 'f', 7).arg(point.altitude()).toUtf8();
+    }
+    MissionFileLoader textLoader(_writeFile("waypoints.txt", text));
+    QVERIFY(textLoader.loadFile());
+    QCOMPARE(textLoader.fileType(), MissionFileLoader::FileTypeText);
+    QVERIFY(textLoader.text() == text);
+    
+    // Json is parsed into an object
+    QByteArray json("{ \"version\": \"1.0\", \"groundStation\": \"QGroundControl\", \"items\": [");
+    for (int i = 0; i < 5000; i++) {
+        json += QString("%1{ \"id\": %2 }").arg(i ? "," : "").arg(i).toUtf8();
+    }
+    json += "] }";
+    MissionFileLoader jsonLoader(_writeFile("plan.mission", json));
+    QVERIFY(jsonLoader.loadFile());
+    QCOMPARE(jsonLoader.fileType(), MissionFileLoader::FileTypeJson);
+    QCOMPARE(jsonLoader.json()["version"].toString(), QString("1.0"));
+    QCOMPARE(jsonLoader.json()["items"].toArray().count(), 5000);
+}
+
+void MissionFileLoaderTest::_testErrors(void)
+{
+    QStringList rgPaths;
+    rgPaths << _writeFile("broken.mission", "{ \"version\": ")
+            << _writeFile("legacy.xls", "not supported")
+            << _writeFile("empty.kml", _kmlDocument("<Placemark><name>Point</name><Point><coordinates>114,30</coordinates></Point></Placemark>"))
+            << _writeFile("truncated.kml", _kmlDocument("<Placemark><Polygon><outerBoundaryIs>").left(120))
+            << _dir.path() + "/missing.mission";
+    
+    foreach (const QString& path, rgPaths) {
+        MissionFileLoader loader(path);
+        QVERIFY2(!loader.loadFile(), qPrintable(path));
+        QVERIFY2(!loader.errorString().isEmpty(), qPrintable(path));
+        QVERIFY(loader.shapes().isEmpty());
+    }
+}
+
+void MissionFileLoaderTest::_testCancel(void)
+{
+    QString path = _writeBoundaryKml("cancel.kml", 200000);
+    
+    // Cancel from the loading thread as soon as the first progress arrives
+    MissionFileLoader loader(path);
+    connect(&loader, &MissionFileLoader::loadProgress, [&loader](double progress) { Q_UNUSED(progress); loader.cancel(); });
+    
+    loader.start();
+    QVERIFY(loader.wait(30000));
+    
+    QVERIFY(loader.canceled());
+    QVERIFY(!loader.errorString().isEmpty());
+    QVERIFY(loader.shapes().isEmpty());
+}
+
+void MissionFileLoaderTest::_benchmarkCorpus(void)
+{
+    QStringList rgPaths;
+    
+    QByteArray corpusDir = qgetenv("QGC_MISSION_CORPUS_DIR");
+    if (!corpusDir.isEmpty()) {
+        QDir dir(QString::fromLocal8Bit(corpusDir));
+        foreach (const QFileInfo& fileInfo, dir.entryInfoList(QDir::Files, QDir::Name)) {
+            rgPaths << fileInfo.absoluteFilePath();
+        }
+    }
+    bool generated = rgPaths.isEmpty();
+    if (generated) {
+        rgPaths << _writeBoundaryKml("benchmark.kml", 500000);
+    }
+    
+    foreach (const QString& path, rgPaths) {
+        MissionFileLoader loader(path);
+        bool success = loader.loadFile();
+        
+        // A corpus may hold files the loader does not support, only the generated boundary must load
+        if (generated) {
+            QVERIFY(success);
+            QCOMPARE(loader.shapes().count(), 1);
+            QCOMPARE(loader.shapes()[0].coordinates.count(), 500000);
+        }
+    }
+}
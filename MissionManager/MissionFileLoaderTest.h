@@ -0,0 +1,48 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef MissionFileLoaderTest_H
+#define MissionFileLoaderTest_H
+
+#include "UnitTest.h"
+
+#include <QTemporaryDir>
+#include <QGeoCoordinate>
+
+/// Loads a generated corpus of large KML and mission files through MissionFileLoader.
+///
+/// The benchmark additionally loads every file in the directory named by the QGC_MISSION_CORPUS_DIR
+/// environment variable, if it is set.
+class MissionFileLoaderTest : public UnitTest
+{
+    Q_OBJECT
+    
+public:
+    MissionFileLoaderTest(void);
+    
+private slots:
+    void _testLargeBoundary(void);
+    void _testManyPlacemarks(void);
+    void _testMissionFiles(void);
+    void _testErrors(void);
+    void _testCancel(void);
+    void _benchmarkCorpus(void);
+    
+private:
+    QString         _writeFile          (const QString& fileName, const QByteArray& contents);
+    QByteArray      _kmlDocument        (const QByteArray& placemarks);
+    QByteArray      _kmlCoordinates     (int cPoints, int firstPoint, bool altitude, const char* separator);
+    QString         _writeBoundaryKml   (const QString& fileName, int cPoints);
+    static QGeoCoordinate _point        (int index);
+    
+    QTemporaryDir _dir;
+};
+
+#endif
@@ -27,6 +27,14 @@ MissionManager::MissionManager(Vehicle* vehicle)
     , _expectedAck(AckNone)
     , _readTransactionInProgress(false)
     , _writeTransactionInProgress(false)
+    , _itemsToWriteCount(0)
+    , _itemsWrittenCount(0)
+    , _writeFirstIndex(0)
+    , _itemsToReadCount(0)
+    , _nextReadRequest(0)
+    , _readRequestsInFlight(0)
+    , _transferWindow(_defaultTransferWindow)
+    , _lastTransferItemsPerSecond(0)
     , _currentMissionItem(-1)
 {
     connect(_vehicle, &Vehicle::mavlinkMessageReceived, this, &MissionManager::_mavlinkMessageReceived);
@@ -79,15 +87,19 @@ void MissionManager::writeMissionItems(const QList<MissionItem*>& missionItems)
 
     //qCDebug(MissionManagerLog) << "writeMissionItems count:" << _missionItems.count();
 
-    // Prime write list
-    for (int i=0; i<_missionItems.count(); i++) {
-        _itemIndicesToWrite << i;
-    }
-
+    _itemsWrittenCount = 0;
     _writeTransactionInProgress = true;
     _retryCount = 0;
+    _transferTimer.start();
     emit inProgressChanged(true);
-    _writeMissionCount();
+
+    if (_findChangedRanges()) {
+        // Make sure the vehicle still has the mission we last saw before sending only the changes
+        qCDebug(MissionManagerLog) << "writeMissionItems partial write ranges" << _partialWriteRanges;
+        _sendRequestList();
+    } else {
+        _writeMissionCount();
+    }
 }
 
 /// This begins the write sequence with the vehicle. This may be called during a retry.
@@ -95,6 +107,11 @@ void MissionManager::_writeMissionCount(void)
 {
     qCDebug(MissionManagerLog) << "_writeMissionCount retry count" << _retryCount;
 
+    // Prime write list
+    _itemIndicesWritten.fill(false, _missionItems.count());
+    _itemsToWriteCount = _missionItems.count();
+    _writeFirstIndex = 0;
+
     mavlink_message_t       message;
     mavlink_mission_count_t missionCount;
 
@@ -167,6 +184,7 @@ void MissionManager::requestMissionItems(void)
 
     _retryCount = 0;
     _readTransactionInProgress = true;
+    _transferTimer.start();
     emit inProgressChanged(true);
     _requestList();
 }
@@ -176,12 +194,15 @@ void MissionManager::_requestList(void)
 {
     qCDebug(MissionManagerLog) << "_requestList retry count" << _retryCount;
 
-    mavlink_message_t               message;
-    mavlink_mission_request_list_t  request;
-
-    _itemIndicesToRead.clear();
     _readTransactionInProgress = true;
     _clearMissionItems();
+    _sendRequestList();
+}
+
+void MissionManager::_sendRequestList(void)
+{
+    mavlink_message_t               message;
+    mavlink_mission_request_list_t  request;
 
     request.target_system = _vehicle->id();
     request.target_component = MAV_COMP_ID_MISSIONPLANNER;
@@ -210,7 +231,12 @@ void MissionManager::_ackTimeout(void)
         break;
     case AckMissionCount:
         // MISSION_COUNT message expected
-        if (_retryCount > _maxRetryCount) {
+        if (_writeTransactionInProgress) {
+            // No answer to the check before a partial write, send everything instead
+            qCDebug(MissionManagerLog) << "No MISSION_COUNT before partial write, writing full mission";
+            _partialWriteRanges.clear();
+            _writeMissionCount();
+        } else if (_retryCount > _maxRetryCount) {
             _sendError(VehicleError, QString(tr("Mission request list failed, maximum retries exceeded.")));
             _finishTransaction(false);
         } else {
@@ -225,26 +251,33 @@ void MissionManager::_ackTimeout(void)
             _sendError(VehicleError, QString(tr("Mission read failed, maximum retries exceeded.")));
             _finishTransaction(false);
         } else {
+            // Only the items which have not arrived are requested again
             _retryCount++;
-            qCDebug(MissionManagerLog) << "Retrying MISSION_REQUEST retry Count" << _retryCount;
-            _requestNextMissionItem();
+            qCDebug(MissionManagerLog) << "Retrying MISSION_REQUEST retry Count:missing" << _retryCount << _itemsToReadCount;
+            _nextReadRequest = 0;
+            _readRequestsInFlight = 0;
+            _requestMissionItems();
         }
         break;
     case AckMissionRequest:
         // MISSION_REQUEST is expected, or MISSION_ACK to end sequence
-        if (_itemIndicesToWrite.count() == 0) {
+        if (_itemsToWriteCount == 0) {
             // Vehicle did not send final MISSION_ACK at end of sequence
             _sendError(VehicleError, QString(tr("Mission write failed, vehicle failed to send final ack.")));
             _finishTransaction(false);
-        } else if (_itemIndicesToWrite[0] == 0) {
-            // Vehicle did not respond to MISSION_COUNT, try again
+        } else if (!_itemIndicesWritten.testBit(_writeFirstIndex)) {
+            // Vehicle did not respond to MISSION_COUNT or MISSION_WRITE_PARTIAL_LIST, try again
             if (_retryCount > _maxRetryCount) {
                 _sendError(VehicleError, QString(tr("Mission write mission count failed, maximum retries exceeded.")));
                 _finishTransaction(false);
             } else {
                 _retryCount++;
                 qCDebug(MissionManagerLog) << "Retrying MISSION_COUNT retry Count" << _retryCount;
-                _writeMissionCount();
+                if (_partialWriteRanges.count()) {
+                    _writePartialList();
+                } else {
+                    _writeMissionCount();
+                }
             }
         } else {
             // Vehicle did not request all items from ground station
@@ -293,6 +326,21 @@ void MissionManager::_readTransactionComplete(void)
 {
     qCDebug(MissionManagerLog) << "_readTransactionComplete read sequence complete";
 
+    _sendMissionAck();
+
+    foreach (MissionItem* item, _readItems) {
+        _missionItems.append(item);
+    }
+    _setVehicleMissionItems(_missionItems, true);
+    _transferStatistics(_missionItems.count());
+
+    _finishTransaction(true);
+    emit newMissionItemsAvailable();
+}
+
+/// Ends the vehicle side of a read sequence
+void MissionManager::_sendMissionAck(void)
+{
     mavlink_message_t       message;
     mavlink_mission_ack_t   missionAck;
 
@@ -307,9 +355,6 @@ void MissionManager::_readTransactionComplete(void)
                                         &missionAck);
 
     _vehicle->sendMessageOnLink(_dedicatedLink, message);
-
-    _finishTransaction(true);
-    emit newMissionItemsAvailable();
 }
 
 void MissionManager::_handleMissionCount(const mavlink_message_t& message)
@@ -325,41 +370,110 @@ void MissionManager::_handleMissionCount(const mavlink_message_t& message)
     mavlink_msg_mission_count_decode(&message, &missionCount);
     qCDebug(MissionManagerLog) << "_handleMissionCount count:" << missionCount.count;
 
-    if (missionCount.count == 0) {
+    if (_writeTransactionInProgress) {
+        _handleWriteCheckCount(missionCount.count);
+    } else if (missionCount.count == 0) {
         _readTransactionComplete();
     } else {
         // Prime read list
-        for (int i=0; i<missionCount.count; i++) {
-            _itemIndicesToRead << i;
-        }
-        _requestNextMissionItem();
+        _readItems.fill(NULL, missionCount.count);
+        _itemsToReadCount = missionCount.count;
+        _nextReadRequest = 0;
+        _readRequestsInFlight = 0;
+        _requestMissionItems();
     }
 }
 
-void MissionManager::_requestNextMissionItem(void)
+/// Fills the request window with the lowest sequence numbers which have not been received yet
+void MissionManager::_requestMissionItems(void)
 {
-    if (_itemIndicesToRead.count() == 0) {
-        _sendError(InternalError, "Internal Error: Call to Vehicle _requestNextMissionItem with no more indices to read");
+    if (_itemsToReadCount == 0) {
+        _sendError(InternalError, "Internal Error: Call to Vehicle _requestMissionItems with no more indices to read");
         return;
     }
 
-    qCDebug(MissionManagerLog) << "_requestNextMissionItem sequenceNumber:retry" << _itemIndicesToRead[0] << _retryCount;
+    int readWindow = _readWindow();
+    while (_readRequestsInFlight < readWindow && _nextReadRequest < _readItems.count()) {
+        if (!_readItems[_nextReadRequest]) {
+            _requestMissionItem(_nextReadRequest);
+            _readRequestsInFlight++;
+        }
+        _nextReadRequest++;
+    }
 
-    mavlink_message_t           message;
-    mavlink_mission_request_t   missionRequest;
+    _startAckTimeout(AckMissionItem);
+}
+
+void MissionManager::_requestMissionItem(int sequenceNumber)
+{
+    qCDebug(MissionManagerLog) << "_requestMissionItem sequenceNumber:retry" << sequenceNumber << _retryCount;
+
+    mavlink_message_t message;
 
-    missionRequest.target_system =      _vehicle->id();
-    missionRequest.target_component =   MAV_COMP_ID_MISSIONPLANNER;
-    missionRequest.seq =                _itemIndicesToRead[0];
+    if (_useMissionItemInt()) {
+        mavlink_mission_request_int_t missionRequest;
 
-    mavlink_msg_mission_request_encode_chan(qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
-                                            qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
-                                            _dedicatedLink->mavlinkChannel(),
-                                            &message,
-                                            &missionRequest);
+        missionRequest.target_system =      _vehicle->id();
+        missionRequest.target_component =   MAV_COMP_ID_MISSIONPLANNER;
+        missionRequest.seq =                sequenceNumber;
+
+        mavlink_msg_mission_request_int_encode_chan(qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
+                                                    qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
+                                                    _dedicatedLink->mavlinkChannel(),
+                                                    &message,
+                                                    &missionRequest);
+    } else {
+        mavlink_mission_request_t missionRequest;
+
+        missionRequest.target_system =      _vehicle->id();
+        missionRequest.target_component =   MAV_COMP_ID_MISSIONPLANNER;
+        missionRequest.seq =                sequenceNumber;
+
+        mavlink_msg_mission_request_encode_chan(qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
+                                                qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
+                                                _dedicatedLink->mavlinkChannel(),
+                                                &message,
+                                                &missionRequest);
+    }
 
     _vehicle->sendMessageOnLink(_dedicatedLink, message);
-    _startAckTimeout(AckMissionItem);
+}
+
+/// Checks an incoming MISSION_ITEM or MISSION_ITEM_INT against the items still needed
+/// @return true: item should be added to the read list
+bool MissionManager::_expectingReadItem(int sequenceNumber)
+{
+    if (!_checkForExpectedAck(AckMissionItem)) {
+        return false;
+    }
+
+    if (sequenceNumber >= _readItems.count() || _readItems[sequenceNumber]) {
+        qCDebug(MissionManagerLog) << "_expectingReadItem mission item received item index which was not requested, disregrarding:" << sequenceNumber;
+        // We have to put the ack timeout back since it was removed above
+        _startAckTimeout(AckMissionItem);
+        return false;
+    }
+
+    return true;
+}
+
+void MissionManager::_addReadItem(MissionItem* item)
+{
+    if (item->command() == MAV_CMD_DO_JUMP && !_vehicle->firmwarePlugin()->sendHomePositionToVehicle()) {
+        // Home is in position 0
+        item->setParam1((int)item->param1() + 1);
+    }
+
+    _readItems[item->sequenceNumber()] = item;
+    _itemsToReadCount--;
+    _readRequestsInFlight = qMax(0, _readRequestsInFlight - 1);
+
+    _retryCount = 0;
+    if (_itemsToReadCount == 0) {
+        _readTransactionComplete();
+    } else {
+        _requestMissionItems();
+    }
 }
 
 void MissionManager::_handleMissionItem(const mavlink_message_t& message)
@@ -369,122 +483,167 @@ void MissionManager::_handleMissionItem(const mavlink_message_t& message)
     double xx;
     double yy;
 
-    if (!_checkForExpectedAck(AckMissionItem)) {
+    mavlink_msg_mission_item_decode(&message, &missionItem);
+
+    qCDebug(MissionManagerLog) << "_handleMissionItem sequenceNumber:" << missionItem.seq;
+
+    if (!_expectingReadItem(missionItem.seq)) {
         return;
     }
 
-    mavlink_msg_mission_item_decode(&message, &missionItem);
+    //edit by wang.lichen ============================
+    int mm;
+    memcpy(&mm,&missionItem.x,4);
+    xx = (double)((double)mm/10000000.0);
+    memcpy(&mm,&missionItem.y,4);
+    yy = (double)((double)mm/10000000.0);
+      //=====================
+    MissionItem* item = new MissionItem(missionItem.seq,
+                                        (MAV_CMD)missionItem.command,
+                                        (MAV_FRAME)missionItem.frame,
+                                        missionItem.param1,
+                                        missionItem.param2,
+                                        missionItem.param3,
+                                        missionItem.param4,
+                                        //edit by wang.lichen
+                                        xx,
+                                        yy,
+                                        missionItem.z,
+                                        missionItem.autocontinue,
+                                        missionItem.current,
+                                        this);
+    _addReadItem(item);
+}
 
-    qCDebug(MissionManagerLog) << "_handleMissionItem sequenceNumber:" << missionItem.seq;
+void MissionManager::_handleMissionItemInt(const mavlink_message_t& message)
+{
+    mavlink_mission_item_int_t missionItem;
 
-    if (_itemIndicesToRead.contains(missionItem.seq)) {
-        _itemIndicesToRead.removeOne(missionItem.seq);
-        //edit by wang.lichen ============================
-        int mm;
-        memcpy(&mm,&missionItem.x,4);
-        xx = (double)((double)mm/10000000.0);
-        memcpy(&mm,&missionItem.y,4);
-        yy = (double)((double)mm/10000000.0);
-          //=====================
-        MissionItem* item = new MissionItem(missionItem.seq,
-                                            (MAV_CMD)missionItem.command,
-                                            (MAV_FRAME)missionItem.frame,
-                                            missionItem.param1,
-                                            missionItem.param2,
-                                            missionItem.param3,
-                                            missionItem.param4,
-                                            //edit by wang.lichen
-                                            xx,
-                                            yy,
-                                            missionItem.z,
-                                            missionItem.autocontinue,
-                                            missionItem.current,
-                                            this);
-
-        if (item->command() == MAV_CMD_DO_JUMP && !_vehicle->firmwarePlugin()->sendHomePositionToVehicle()) {
-            // Home is in position 0
-            item->setParam1((int)item->param1() + 1);
-        }
+    mavlink_msg_mission_item_int_decode(&message, &missionItem);
 
-        _missionItems.append(item);
-    } else {
-        qCDebug(MissionManagerLog) << "_handleMissionItem mission item received item index which was not requested, disregrarding:" << missionItem.seq;
-        // We have to put the ack timeout back since it was removed above
-        _startAckTimeout(AckMissionItem);
+    qCDebug(MissionManagerLog) << "_handleMissionItemInt sequenceNumber:" << missionItem.seq;
+
+    if (!_expectingReadItem(missionItem.seq)) {
         return;
     }
 
-    _retryCount = 0;
-    if (_itemIndicesToRead.count() == 0) {
-        _readTransactionComplete();
-    } else {
-        _requestNextMissionItem();
-    }
+    double scale = _intScaleForFrame((MAV_FRAME)missionItem.frame);
+    MissionItem* item = new MissionItem(missionItem.seq,
+                                        (MAV_CMD)missionItem.command,
+                                        (MAV_FRAME)missionItem.frame,
+                                        missionItem.param1,
+                                        missionItem.param2,
+                                        missionItem.param3,
+                                        missionItem.param4,
+                                        missionItem.x / scale,
+                                        missionItem.y / scale,
+                                        missionItem.z,
+                                        missionItem.autocontinue,
+                                        missionItem.current,
+                                        this);
+    _addReadItem(item);
 }
 
 void MissionManager::_clearMissionItems(void)
 {
-    _itemIndicesToRead.clear();
+    _readItems.clear();
+    _itemsToReadCount = 0;
     _missionItems.clear();
 }
 
-void MissionManager::_handleMissionRequest(const mavlink_message_t& message)
+/// Answers MISSION_REQUEST with MISSION_ITEM and MISSION_REQUEST_INT with MISSION_ITEM_INT. The vehicle may
+/// have several requests outstanding, each is answered as it arrives.
+void MissionManager::_handleMissionRequest(const mavlink_message_t& message, bool missionItemInt)
 {
-    mavlink_mission_request_t missionRequest;
-
     if (!_checkForExpectedAck(AckMissionRequest)) {
         return;
     }
 
-    mavlink_msg_mission_request_decode(&message, &missionRequest);
-
-    qCDebug(MissionManagerLog) << "_handleMissionRequest sequenceNumber:" << missionRequest.seq;
+    // Both request messages carry the same fields
+    mavlink_mission_request_t missionRequest;
+    if (missionItemInt) {
+        mavlink_mission_request_int_t missionRequestInt;
 
-    if (!_itemIndicesToWrite.contains(missionRequest.seq)) {
-        if (missionRequest.seq > _missionItems.count()) {
-            _sendError(RequestRangeError, QString(tr("Vehicle requested item outside range, count:request %1:%2. Send to Vehicle failed.")).arg(_missionItems.count()).arg(missionRequest.seq));
-            _finishTransaction(false);
-            return;
-        } else {
-            qCDebug(MissionManagerLog) << "_handleMissionRequest sequence number requested which has already been sent, sending again:" << missionRequest.seq;
-        }
+        mavlink_msg_mission_request_int_decode(&message, &missionRequestInt);
+        missionRequest.seq = missionRequestInt.seq;
     } else {
-        _itemIndicesToWrite.removeOne(missionRequest.seq);
+        mavlink_msg_mission_request_decode(&message, &missionRequest);
     }
 
-    mavlink_message_t       messageOut;
-    mavlink_mission_item_t  missionItem;
+    qCDebug(MissionManagerLog) << "_handleMissionRequest sequenceNumber:int" << missionRequest.seq << missionItemInt;
 
-    MissionItem* item = _missionItems[missionRequest.seq];
+    if (missionRequest.seq >= _missionItems.count()) {
+        _sendError(RequestRangeError, QString(tr("Vehicle requested item outside range, count:request %1:%2. Send to Vehicle failed.")).arg(_missionItems.count()).arg(missionRequest.seq));
+        _finishTransaction(false);
+        return;
+    } else if (_itemIndicesWritten.testBit(missionRequest.seq)) {
+        qCDebug(MissionManagerLog) << "_handleMissionRequest sequence number requested which has already been sent, sending again:" << missionRequest.seq;
+    } else {
+        _itemIndicesWritten.setBit(missionRequest.seq);
+        _itemsToWriteCount--;
+        _itemsWrittenCount++;
+    }
 
-    missionItem.target_system =     _vehicle->id();
-    missionItem.target_component =  MAV_COMP_ID_MISSIONPLANNER;
-    missionItem.seq =               missionRequest.seq;
-    missionItem.command =           item->command();
-    missionItem.param1 =            item->param1();
-    missionItem.param2 =            item->param2();
-    missionItem.param3 =            item->param3();
-    missionItem.param4 =            item->param4();
-    missionItem.x =                 item->param5();
-    missionItem.y =                 item->param6();
-    missionItem.z =                 item->param7();
-    //edit by wang.lichen
-    missionItem.frame =             item->frame()+100;
-    missionItem.current =           missionRequest.seq == 0;
-    missionItem.autocontinue =      item->autoContinue();
-    //edit by wang.lichen =============================
-    missionItem.command = item->command()+200;
-    int tmp;
-    tmp = item->param5()*10000000;
-    memcpy(&missionItem.x,&tmp,sizeof(tmp));
-    tmp = item->param6()*10000000;
-    memcpy(&missionItem.y,&tmp,sizeof(tmp));
-    //===================================================
-    mavlink_msg_mission_item_encode_chan(qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
-                                         qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
-                                         _dedicatedLink->mavlinkChannel(),
-                                         &messageOut,
-                                         &missionItem);
+    mavlink_message_t   messageOut;
+    MissionItem*        item = _missionItems[missionRequest.seq];
+
+    if (missionItemInt) {
+        mavlink_mission_item_int_t missionItem;
+
+        double scale = _intScaleForFrame(item->frame());
+
+        missionItem.target_system =     _vehicle->id();
+        missionItem.target_component =  MAV_COMP_ID_MISSIONPLANNER;
+        missionItem.seq =               missionRequest.seq;
+        missionItem.command =           item->command();
+        missionItem.param1 =            item->param1();
+        missionItem.param2 =            item->param2();
+        missionItem.param3 =            item->param3();
+        missionItem.param4 =            item->param4();
+        missionItem.x =                 qRound64(item->param5() * scale);
+        missionItem.y =                 qRound64(item->param6() * scale);
+        missionItem.z =                 item->param7();
+        missionItem.frame =             item->frame();
+        missionItem.current =           missionRequest.seq == 0;
+        missionItem.autocontinue =      item->autoContinue();
+
+        mavlink_msg_mission_item_int_encode_chan(qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
+                                                 qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
+                                                 _dedicatedLink->mavlinkChannel(),
+                                                 &messageOut,
+                                                 &missionItem);
+    } else {
+        mavlink_mission_item_t  missionItem;
+
+        missionItem.target_system =     _vehicle->id();
+        missionItem.target_component =  MAV_COMP_ID_MISSIONPLANNER;
+        missionItem.seq =               missionRequest.seq;
+        missionItem.command =           item->command();
+        missionItem.param1 =            item->param1();
+        missionItem.param2 =            item->param2();
+        missionItem.param3 =            item->param3();
+        missionItem.param4 =            item->param4();
+        missionItem.x =                 item->param5();
+        missionItem.y =                 item->param6();
+        missionItem.z =                 item->param7();
+        //edit by wang.lichen
+        missionItem.frame =             item->frame()+100;
+        missionItem.current =           missionRequest.seq == 0;
+        missionItem.autocontinue =      item->autoContinue();
+        //edit by wang.lichen =============================
+        missionItem.command = item->command()+200;
+        int tmp;
+        tmp = item->param5()*10000000;
+        memcpy(&missionItem.x,&tmp,sizeof(tmp));
+        tmp = item->param6()*10000000;
+        memcpy(&missionItem.y,&tmp,sizeof(tmp));
+        //===================================================
+        mavlink_msg_mission_item_encode_chan(qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
+                                             qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
+                                             _dedicatedLink->mavlinkChannel(),
+                                             &messageOut,
+                                             &missionItem);
+    }
 
     _vehicle->sendMessageOnLink(_dedicatedLink, messageOut);
     _startAckTimeout(AckMissionRequest);
@@ -527,11 +686,21 @@ void MissionManager::_handleMissionAck(const mavlink_message_t& message)
         case AckMissionRequest:
             // MISSION_REQUEST is expected, or MISSION_ACK to end sequence
             if (missionAck.type == MAV_MISSION_ACCEPTED) {
-                if (_itemIndicesToWrite.count() == 0) {
-                    qCDebug(MissionManagerLog) << "_handleMissionAck write sequence complete";
-                    _finishTransaction(true);
+                if (_itemsToWriteCount == 0) {
+                    if (_partialWriteRanges.count()) {
+                        _partialWriteRanges.removeFirst();
+                    }
+                    if (_partialWriteRanges.count()) {
+                        _retryCount = 0;
+                        _writeNextPartialRange();
+                    } else {
+                        qCDebug(MissionManagerLog) << "_handleMissionAck write sequence complete";
+                        _setVehicleMissionItems(_missionItems, false);
+                        _transferStatistics(_itemsWrittenCount);
+                        _finishTransaction(true);
+                    }
                 } else {
-                    _sendError(MissingRequestsError, QString(tr("Vehicle did not request all items during write sequence, missed count %1. Vehicle only has partial list of mission items.")).arg(_itemIndicesToWrite.count()));
+                    _sendError(MissingRequestsError, QString(tr("Vehicle did not request all items during write sequence, missed count %1. Vehicle only has partial list of mission items.")).arg(_itemsToWriteCount));
                     _finishTransaction(false);
                 }
             } else {
@@ -603,8 +772,16 @@ void MissionManager::_mavlinkMessageReceived(const mavlink_message_t& message)
         }
             break;
 
+        case MAVLINK_MSG_ID_MISSION_ITEM_INT:
+            _handleMissionItemInt(message);
+            break;
+
         case MAVLINK_MSG_ID_MISSION_REQUEST:
-            _handleMissionRequest(message);
+            _handleMissionRequest(message, false);
+            break;
+
+        case MAVLINK_MSG_ID_MISSION_REQUEST_INT:
+            _handleMissionRequest(message, true);
             break;
 
         case MAVLINK_MSG_ID_MISSION_ACK:
@@ -736,8 +913,16 @@ void MissionManager::_finishTransaction(bool success)
         emit newMissionItemsAvailable();
     }
 
-    _itemIndicesToRead.clear();
-    _itemIndicesToWrite.clear();
+    if (!success) {
+        // Don't know what the vehicle has now, the next write sends everything
+        _setVehicleMissionItems(QList<MissionItem*>(), false);
+    }
+    _partialWriteRanges.clear();
+
+    _readItems.clear();
+    _itemsToReadCount = 0;
+    _itemIndicesWritten.clear();
+    _itemsToWriteCount = 0;
 
     if (_readTransactionInProgress || _writeTransactionInProgress) {
         _readTransactionInProgress = false;
@@ -763,3 +948,176 @@ void MissionManager::_handleMissionCurrent(const mavlink_message_t& message)
         emit currentItemChanged(_currentMissionItem);
     }
 }
+
+/// Vehicles which report MAV_PROTOCOL_CAPABILITY_MISSION_INT are read with MISSION_REQUEST_INT. Writes always
+/// answer in the form the vehicle requested.
+bool MissionManager::_useMissionItemInt(void)
+{
+    return (_vehicle->capabilityBits() & MAV_PROTOCOL_CAPABILITY_MISSION_INT) != 0;
+}
+
+/// PX4 rejects a MISSION_REQUEST for anything but the next item or a repeat of the last one and ends the
+/// transfer, so a read window is only used when the firmware says out of order requests are answered.
+int MissionManager::_readWindow(void)
+{
+    return _vehicle->firmwarePlugin()->supportsMissionReadWindow() ? _transferWindow : 1;
+}
+
+/// MISSION_ITEM_INT carries x and y as integers: degrees * 1e7 for global frames, meters * 1e4 for local
+/// frames and the plain param5/param6 value for everything else.
+double MissionManager::_intScaleForFrame(MAV_FRAME frame)
+{
+    switch (frame) {
+    case MAV_FRAME_GLOBAL:
+    case MAV_FRAME_GLOBAL_RELATIVE_ALT:
+    case MAV_FRAME_GLOBAL_INT:
+    case MAV_FRAME_GLOBAL_RELATIVE_ALT_INT:
+    case MAV_FRAME_GLOBAL_TERRAIN_ALT:
+    case MAV_FRAME_GLOBAL_TERRAIN_ALT_INT:
+        return 1e7;
+    case MAV_FRAME_LOCAL_NED:
+    case MAV_FRAME_LOCAL_ENU:
+    case MAV_FRAME_LOCAL_OFFSET_NED:
+    case MAV_FRAME_BODY_NED:
+    case MAV_FRAME_BODY_OFFSET_NED:
+        return 1e4;
+    default:
+        return 1.0;
+    }
+}
+
+void MissionManager::_transferStatistics(int itemCount)
+{
+    qint64 msecs = _transferTimer.elapsed();
+
+    _lastTransferItemsPerSecond = itemCount * 1000.0 / qMax(msecs, (qint64)1);
+    qCDebug(MissionManagerLog) << "Transfer complete items:msecs:items/sec" << itemCount << msecs << _lastTransferItemsPerSecond;
+    emit transferComplete(itemCount, _lastTransferItemsPerSecond);
+}
+
+/// Compares the items being written with the vehicle's copy from the last transfer. Nearby changes are merged
+/// into one range since bridging a one item gap costs no more than another MISSION_WRITE_PARTIAL_LIST.
+/// @return true: _partialWriteRanges holds the changed items, false: the whole mission must be written
+bool MissionManager::_findChangedRanges(void)
+{
+    _partialWriteRanges.clear();
+
+    if (!_vehicle->firmwarePlugin()->supportsMissionWritePartialList() || _missionItems.count() == 0 || _vehicleMissionItems.count() != _missionItems.count()) {
+        return false;
+    }
+
+    int partialMessages = 2;    // MISSION_REQUEST_LIST and MISSION_ACK to check the vehicle count
+    for (int i=0; i<_missionItems.count(); i++) {
+        if (!_sameVehicleItem(_missionItems[i], _vehicleMissionItems[i])) {
+            if (_partialWriteRanges.count() && i - _partialWriteRanges.last().second <= 2) {
+                partialMessages += i - _partialWriteRanges.last().second;
+                _partialWriteRanges.last().second = i;
+            } else {
+                partialMessages += 2;
+                _partialWriteRanges.append(ItemRange_t(i, i));
+            }
+        }
+    }
+
+    // MISSION_COUNT plus every item is cheaper when most of the mission changed
+    if (partialMessages >= _missionItems.count() + 1) {
+        _partialWriteRanges.clear();
+        return false;
+    }
+
+    return true;
+}
+
+/// Answer to the MISSION_REQUEST_LIST sent before a partial write
+void MissionManager::_handleWriteCheckCount(int count)
+{
+    // Close the vehicle's read sequence, no items will be requested
+    _sendMissionAck();
+
+    if (count != _missionItems.count()) {
+        qCDebug(MissionManagerLog) << "_handleWriteCheckCount vehicle mission changed, writing full mission" << count << _missionItems.count();
+        _partialWriteRanges.clear();
+        _writeMissionCount();
+    } else {
+        _writeNextPartialRange();
+    }
+}
+
+void MissionManager::_writeNextPartialRange(void)
+{
+    if (_partialWriteRanges.isEmpty()) {
+        qCDebug(MissionManagerLog) << "_writeNextPartialRange vehicle mission is already up to date";
+        _setVehicleMissionItems(_missionItems, false);
+        _transferStatistics(0);
+        _finishTransaction(true);
+        return;
+    }
+
+    const ItemRange_t& range = _partialWriteRanges.first();
+
+    _itemIndicesWritten.fill(true, _missionItems.count());
+    for (int i=range.first; i<=range.second; i++) {
+        _itemIndicesWritten.clearBit(i);
+    }
+    _itemsToWriteCount = range.second - range.first + 1;
+    _writeFirstIndex = range.first;
+
+    _writePartialList();
+}
+
+void MissionManager::_writePartialList(void)
+{
+    const ItemRange_t& range = _partialWriteRanges.first();
+
+    qCDebug(MissionManagerLog) << "_writePartialList start:end:retry" << range.first << range.second << _retryCount;
+
+    mavlink_message_t                       message;
+    mavlink_mission_write_partial_list_t    partialList;
+
+    partialList.target_system =     _vehicle->id();
+    partialList.target_component =  MAV_COMP_ID_MISSIONPLANNER;
+    partialList.start_index =       range.first;
+    partialList.end_index =         range.second;
+
+    mavlink_msg_mission_write_partial_list_encode_chan(qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
+                                                       qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
+                                                       _dedicatedLink->mavlinkChannel(),
+                                                       &message,
+                                                       &partialList);
+
+    _vehicle->sendMessageOnLink(_dedicatedLink, message);
+    _startAckTimeout(AckMissionRequest);
+}
+
+/// Remembers the mission the vehicle now has for comparison against the next write
+///     @param fromRead true: items came from a read and use editor jump numbering
+void MissionManager::_setVehicleMissionItems(const QList<MissionItem*>& missionItems, bool fromRead)
+{
+    qDeleteAll(_vehicleMissionItems);
+    _vehicleMissionItems.clear();
+
+    bool adjustJump = fromRead && !_vehicle->firmwarePlugin()->sendHomePositionToVehicle();
+    foreach (const MissionItem* item, missionItems) {
+        MissionItem* vehicleItem = new MissionItem(*item, this);
+
+        if (adjustJump && vehicleItem->command() == MAV_CMD_DO_JUMP) {
+            vehicleItem->setParam1((int)vehicleItem->param1() - 1);
+        }
+        _vehicleMissionItems.append(vehicleItem);
+    }
+}
+
+/// @return true: both items are stored the same on the vehicle
+bool MissionManager::_sameVehicleItem(const MissionItem* item1, const MissionItem* item2)
+{
+    return item1->command() == item2->command() &&
+            item1->frame() == item2->frame() &&
+            item1->param1() == item2->param1() &&
+            item1->param2() == item2->param2() &&
+            item1->param3() == item2->param3() &&
+            item1->param4() == item2->param4() &&
+            item1->param5() == item2->param5() &&
+            item1->param6() == item2->param6() &&
+            item1->param7() == item2->param7() &&
+            item1->autoContinue() == item2->autoContinue();
+}
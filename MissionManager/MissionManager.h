@@ -16,6 +16,10 @@
 #include <QThread>
 #include <QMutex>
 #include <QTimer>
+#include <QVector>
+#include <QBitArray>
+#include <QElapsedTimer>
+#include <QPair>
 
 #include "MissionItem.h"
 #include "QGCMAVLink.h"
@@ -45,7 +49,8 @@ public:
 
     void requestMissionItems(void);
 
-    /// Writes the specified set of mission items to the vehicle
+    /// Writes the specified set of mission items to the vehicle. If the firmware supports partial list writes
+    /// and the vehicle still has the mission from the last transfer, only the changed items are sent.
     ///     @param missionItems Items to send to vehicle
     void writeMissionItems(const QList<MissionItem*>& missionItems);
 
@@ -54,6 +59,14 @@ public:
     ///     @param altChangeOnly true: only altitude change, false: lat/lon/alt change
     void writeArduPilotGuidedMissionItem(const QGeoCoordinate& gotoCoord, bool altChangeOnly);
 
+    /// Sets the number of MISSION_REQUESTs kept in flight while reading items from the vehicle. Only used with
+    /// firmware which supports a read window, others are always read one item at a time.
+    void setTransferWindow(int window) { _transferWindow = qMax(1, window); }
+    int transferWindow(void) const { return _transferWindow; }
+
+    /// @return Items per second of the last completed read or write
+    double lastTransferItemsPerSecond(void) const { return _lastTransferItemsPerSecond; }
+
     /// Error codes returned in error signal
     typedef enum {
         InternalError,
@@ -69,6 +82,7 @@ public:
     // These values are public so the unit test can set appropriate signal wait times
     static const int _ackTimeoutMilliseconds= 2000;
     static const int _maxRetryCount = 5;
+    static const int _defaultTransferWindow = 8;
 
 signals:
     void missionItemsTempChanged (double latitude, double longtitude, double altitude);
@@ -78,6 +92,7 @@ signals:
     void currentItemChanged(int currentItem);
     void cameraFeedItemsChanged(int currentItem);
     void missionItemReceived(bool receive);
+    void transferComplete(int itemCount, double itemsPerSecond);
 
 private slots:
     void _mavlinkMessageReceived(const mavlink_message_t& message);
@@ -98,17 +113,34 @@ private:
     void _readTransactionComplete(void);
     void _handleMissionCount(const mavlink_message_t& message);
     void _handleMissionItem(const mavlink_message_t& message);
-    void _handleMissionRequest(const mavlink_message_t& message);
+    void _handleMissionItemInt(const mavlink_message_t& message);
+    bool _expectingReadItem(int sequenceNumber);
+    void _addReadItem(MissionItem* item);
+    void _handleMissionRequest(const mavlink_message_t& message, bool missionItemInt);
     void _handleMissionAck(const mavlink_message_t& message);
     void _handleMissionCurrent(const mavlink_message_t& message);
-    void _requestNextMissionItem(void);
+    void _requestMissionItems(void);
+    void _requestMissionItem(int sequenceNumber);
     void _clearMissionItems(void);
     void _sendError(ErrorCode_t errorCode, const QString& errorMsg);
     QString _ackTypeToString(AckType_t ackType);
     QString _missionResultToString(MAV_MISSION_RESULT result);
     void _finishTransaction(bool success);
     void _requestList(void);
+    void _sendRequestList(void);
+    void _sendMissionAck(void);
     void _writeMissionCount(void);
+    bool _findChangedRanges(void);
+    void _handleWriteCheckCount(int count);
+    void _writeNextPartialRange(void);
+    void _writePartialList(void);
+    void _setVehicleMissionItems(const QList<MissionItem*>& missionItems, bool fromRead);
+    bool _useMissionItemInt(void);
+    int  _readWindow(void);
+    void _transferStatistics(int itemCount);
+
+    static double _intScaleForFrame(MAV_FRAME frame);
+    static bool _sameVehicleItem(const MissionItem* item1, const MissionItem* item2);
 
 private:
     Vehicle*            _vehicle;
@@ -120,8 +152,24 @@ private:
 
     bool        _readTransactionInProgress;
     bool        _writeTransactionInProgress;
-    QList<int>  _itemIndicesToWrite;    ///< List of mission items which still need to be written to vehicle
-    QList<int>  _itemIndicesToRead;     ///< List of mission items which still need to be requested from vehicle
+    QBitArray   _itemIndicesWritten;    ///< Mission items which the vehicle has requested at least once
+    int         _itemsToWriteCount;     ///< Number of mission items which still need to be written to vehicle
+    int         _itemsWrittenCount;     ///< Number of mission items sent in this write
+    int         _writeFirstIndex;       ///< First item the vehicle should request
+
+    typedef QPair<int, int> ItemRange_t;    ///< First and last sequence number
+
+    QList<MissionItem*>     _vehicleMissionItems;   ///< Mission the vehicle had after the last successful transfer, vehicle sequence numbers
+    QList<ItemRange_t>      _partialWriteRanges;    ///< Changed items still to be written with MISSION_WRITE_PARTIAL_LIST
+
+    QVector<MissionItem*>   _readItems;             ///< Items read from the vehicle by sequence number, NULL until received
+    int                     _itemsToReadCount;      ///< Number of mission items not yet received from vehicle
+    int                     _nextReadRequest;       ///< Lowest sequence number not yet requested in this window pass
+    int                     _readRequestsInFlight;  ///< MISSION_REQUESTs sent which have not been answered
+    int                     _transferWindow;
+
+    QElapsedTimer   _transferTimer;
+    double          _lastTransferItemsPerSecond;
 
     QMutex _dataMutex;
 
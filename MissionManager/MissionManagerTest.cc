@@ -22,6 +22,9 @@ const MissionManagerTest::TestCase_t MissionManagerTest::_rgTestCases[] = {
 };
 const size_t MissionManagerTest::_cTestCases = sizeof(_rgTestCases)/sizeof(_rgTestCases[0]);
 
+const double MissionManagerTest::_largeMissionLatitude =    47.3977419;
+const double MissionManagerTest::_largeMissionLongitude =   8.5455938;
+
 MissionManagerTest::MissionManagerTest(void)
 {
     
@@ -327,3 +330,226 @@ void MissionManagerTest::_testReadFailureHandlingPX4(void)
     _initForFirmwareType(MAV_AUTOPILOT_PX4);
     _testReadFailureHandlingWorker();
 }
+
+/// Writes a survey sized mission with coordinates 1e-7 degrees apart
+void MissionManagerTest::_writeLargeMission(int itemCount, double& itemsPerSecond)
+{
+    // PX4 does not get the home position item at index 0
+    QList<MissionItem*> missionItems;
+    for (int i=0; i<=itemCount; i++) {
+        missionItems.append(new MissionItem(i, MAV_CMD_NAV_WAYPOINT, MAV_FRAME_GLOBAL_RELATIVE_ALT, 0, 0, 0, 0,
+                                            _largeMissionLatitude + i * 1e-7, _largeMissionLongitude - i * 1e-7, 50, true, false, false, this));
+    }
+
+    _missionManager->writeMissionItems(missionItems);
+    QVERIFY(_missionManager->inProgress());
+    _multiSpyMissionManager->clearAllSignals();
+
+    _multiSpyMissionManager->waitForSignalByIndex(inProgressChangedSignalIndex, _missionManagerSignalWaitTime);
+    QCOMPARE(_multiSpyMissionManager->checkOnlySignalByMask(inProgressChangedSignalMask), true);
+    _checkInProgressValues(false);
+    itemsPerSecond = _missionManager->lastTransferItemsPerSecond();
+    _multiSpyMissionManager->clearAllSignals();
+}
+
+/// Reads back the mission from _writeLargeMission, checking every coordinate survives at full precision
+void MissionManagerTest::_readLargeMission(int itemCount, double& itemsPerSecond)
+{
+    // ArduPilot returns the home position item as item 0
+    int homeItemCount = _mockLink->getFirmwareType() == MAV_AUTOPILOT_ARDUPILOTMEGA ? 1 : 0;
+
+    _missionManager->requestMissionItems();
+    QVERIFY(_missionManager->inProgress());
+    _multiSpyMissionManager->clearAllSignals();
+
+    _multiSpyMissionManager->waitForSignalByIndex(inProgressChangedSignalIndex, _missionManagerSignalWaitTime);
+    QCOMPARE(_multiSpyMissionManager->checkSignalByMask(newMissionItemsAvailableSignalMask | inProgressChangedSignalMask), true);
+    QCOMPARE(_multiSpyMissionManager->checkSignalByMask(errorSignalMask), false);
+    _checkInProgressValues(false);
+    itemsPerSecond = _missionManager->lastTransferItemsPerSecond();
+    _multiSpyMissionManager->clearAllSignals();
+
+    QCOMPARE(_missionManager->missionItems().count(), itemCount + homeItemCount);
+    for (int i=homeItemCount; i<itemCount + homeItemCount; i++) {
+        MissionItem* actual = _missionManager->missionItems()[i];
+        int itemIndex = i + 1 - homeItemCount;
+
+        QCOMPARE(actual->sequenceNumber(), i);
+        QCOMPARE(qRound64(actual->param5() * 1e7), qRound64((_largeMissionLatitude + itemIndex * 1e-7) * 1e7));
+        QCOMPARE(qRound64(actual->param6() * 1e7), qRound64((_largeMissionLongitude - itemIndex * 1e-7) * 1e7));
+        QCOMPARE(actual->param7(), 50.0);
+        QCOMPARE((int)actual->frame(), (int)MAV_FRAME_GLOBAL_RELATIVE_ALT);
+    }
+}
+
+void MissionManagerTest::_testWindowedTransfer(void)
+{
+    // ArduPilot answers requests in any order so reads use the window
+    _initForFirmwareType(MAV_AUTOPILOT_ARDUPILOTMEGA);
+
+    double itemsPerSecond;
+
+    // Latency, and loss in both directions. Only the missing items are requested again.
+    _mockLink->setMissionTransferFaults(8, 20, 37);
+    _missionManager->setTransferWindow(8);
+    _writeLargeMission(300, itemsPerSecond);
+    _readLargeMission(300, itemsPerSecond);
+
+    // Vehicle which only knows MISSION_REQUEST, the write is answered with MISSION_ITEM
+    _mockLink->setMissionItemIntSupport(false);
+    _mockLink->setMissionTransferFaults(4, 5, 0);
+    _writeLargeMission(50, itemsPerSecond);
+}
+
+void MissionManagerTest::_testSequentialReadPX4(void)
+{
+    // PX4 fails the read on any request other than the next item or a repeat, so it is still read one item
+    // at a time whatever the window, including the requests repeated after a loss
+    _initForFirmwareType(MAV_AUTOPILOT_PX4);
+
+    double itemsPerSecond;
+
+    _mockLink->setMissionTransferFaults(8, 20, 37);
+    _missionManager->setTransferWindow(8);
+    _writeLargeMission(100, itemsPerSecond);
+    _readLargeMission(100, itemsPerSecond);
+}
+
+/// Coordinates are whole 1e-7 degrees so they compare equal after a MISSION_ITEM_INT round trip
+MissionItem* MissionManagerTest::_partialMissionItem(int sequenceNumber, double altitude)
+{
+    return new MissionItem(sequenceNumber, MAV_CMD_NAV_WAYPOINT, MAV_FRAME_GLOBAL_RELATIVE_ALT, 0, 0, 0, 0,
+                           (473977419 + sequenceNumber * 1000) / 1e7, (85455938 - sequenceNumber * 1000) / 1e7, altitude, true, false, false, this);
+}
+
+/// Writes the mission and returns the number of mission messages the vehicle received
+void MissionManagerTest::_writePartialMission(const QList<MissionItem*>& missionItems, int& messageCount)
+{
+    _mockLink->resetMissionMessageCount();
+
+    _missionManager->writeMissionItems(missionItems);
+    QVERIFY(_missionManager->inProgress());
+    _multiSpyMissionManager->clearAllSignals();
+
+    _multiSpyMissionManager->waitForSignalByIndex(inProgressChangedSignalIndex, _missionManagerSignalWaitTime);
+    QCOMPARE(_multiSpyMissionManager->checkOnlySignalByMask(inProgressChangedSignalMask), true);
+    _checkInProgressValues(false);
+    _multiSpyMissionManager->clearAllSignals();
+
+    messageCount = _mockLink->missionMessageCount();
+}
+
+/// Reads the mission back from the vehicle and compares it with what was written
+void MissionManagerTest::_checkPartialMission(const QList<MissionItem*>& missionItems)
+{
+    _missionManager->requestMissionItems();
+    QVERIFY(_missionManager->inProgress());
+    _multiSpyMissionManager->clearAllSignals();
+
+    _multiSpyMissionManager->waitForSignalByIndex(inProgressChangedSignalIndex, _missionManagerSignalWaitTime);
+    QCOMPARE(_multiSpyMissionManager->checkSignalByMask(errorSignalMask), false);
+    _checkInProgressValues(false);
+    _multiSpyMissionManager->clearAllSignals();
+
+    QCOMPARE(_missionManager->missionItems().count(), missionItems.count());
+    for (int i=0; i<missionItems.count(); i++) {
+        MissionItem* actual = _missionManager->missionItems()[i];
+
+        QCOMPARE(actual->sequenceNumber(), i);
+        QCOMPARE(actual->param5(), missionItems[i]->param5());
+        QCOMPARE(actual->param6(), missionItems[i]->param6());
+        QCOMPARE(actual->param7(), missionItems[i]->param7());
+    }
+}
+
+void MissionManagerTest::_testPartialWrite(void)
+{
+    // ArduPilot supports MISSION_WRITE_PARTIAL_LIST, home position is item 0
+    _initForFirmwareType(MAV_AUTOPILOT_ARDUPILOTMEGA);
+
+    const int itemCount = 100;
+    int messageCount;
+
+    QList<MissionItem*> missionItems;
+    for (int i=0; i<itemCount; i++) {
+        missionItems.append(_partialMissionItem(i, 50));
+    }
+
+    // MISSION_COUNT and every item
+    _writePartialMission(missionItems, messageCount);
+    QCOMPARE(messageCount, itemCount + 1);
+    _checkPartialMission(missionItems);
+
+    // The rest send MISSION_REQUEST_LIST and MISSION_ACK to check the vehicle count, then
+    // MISSION_WRITE_PARTIAL_LIST and the items for each changed range
+
+    // One altitude change
+    missionItems[50]->setParam7(60);
+    _writePartialMission(missionItems, messageCount);
+    QCOMPARE(messageCount, 2 + 1 + 1);
+    _checkPartialMission(missionItems);
+
+    // Nearby changes are sent as one range including the item between them
+    missionItems[40]->setParam7(70);
+    missionItems[42]->setParam7(70);
+    _writePartialMission(missionItems, messageCount);
+    QCOMPARE(messageCount, 2 + 1 + 3);
+    _checkPartialMission(missionItems);
+
+    // Changes far apart are sent as separate ranges
+    missionItems[10]->setParam7(80);
+    missionItems[90]->setParam7(80);
+    _writePartialMission(missionItems, messageCount);
+    QCOMPARE(messageCount, 2 + (1 + 1) * 2);
+    _checkPartialMission(missionItems);
+
+    // Nothing changed, only the count check
+    _writePartialMission(missionItems, messageCount);
+    QCOMPARE(messageCount, 2);
+    _checkPartialMission(missionItems);
+
+    // An insert changes the count so everything is sent
+    missionItems.insert(30, _partialMissionItem(30, 90));
+    for (int i=0; i<missionItems.count(); i++) {
+        missionItems[i]->setSequenceNumber(i);
+    }
+    _writePartialMission(missionItems, messageCount);
+    QCOMPARE(messageCount, itemCount + 2);
+    _checkPartialMission(missionItems);
+
+    // A vehicle whose mission changed behind our back gets everything
+    _mockLink->resetMissionItemHandler();
+    missionItems[20]->setParam7(100);
+    _writePartialMission(missionItems, messageCount);
+    QCOMPARE(messageCount, 2 + 1 + itemCount + 1);
+    _checkPartialMission(missionItems);
+}
+
+void MissionManagerTest::_benchmarkTransfer(void)
+{
+    // Read windows are only used with ArduPilot
+    _initForFirmwareType(MAV_AUTOPILOT_ARDUPILOTMEGA);
+
+    // Telemetry radio like round trip
+    int windows[] = { 1, 8 };
+    double stopAndWaitWriteItemsPerSecond = 0, stopAndWaitReadItemsPerSecond = 0;
+    for (size_t i=0; i<sizeof(windows)/sizeof(windows[0]); i++) {
+        double writeItemsPerSecond, readItemsPerSecond;
+
+        // Full write each pass rather than a partial write of nothing
+        _mockLink->resetMissionItemHandler();
+        _mockLink->setMissionTransferFaults(windows[i], 10, 0);
+        _missionManager->setTransferWindow(windows[i]);
+        _writeLargeMission(200, writeItemsPerSecond);
+        _readLargeMission(200, readItemsPerSecond);
+
+        // Several items in flight hide the round trip
+        if (windows[i] == 1) {
+            stopAndWaitWriteItemsPerSecond = writeItemsPerSecond;
+            stopAndWaitReadItemsPerSecond = readItemsPerSecond;
+        } else {
+            QVERIFY(writeItemsPerSecond > stopAndWaitWriteItemsPerSecond);
+            QVERIFY(readItemsPerSecond > stopAndWaitReadItemsPerSecond);
+        }
+    }
+}
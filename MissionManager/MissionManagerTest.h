@@ -31,12 +31,24 @@ private slots:
     void _testWriteFailureHandlingAPM(void);
     void _testReadFailureHandlingPX4(void);
     void _testReadFailureHandlingAPM(void);
+    void _testWindowedTransfer(void);
+    void _testSequentialReadPX4(void);
+    void _testPartialWrite(void);
+    void _benchmarkTransfer(void);
 
 private:
     void _roundTripItems(MockLinkMissionItemHandler::FailureMode_t failureMode, bool shouldFail);
     void _writeItems(MockLinkMissionItemHandler::FailureMode_t failureMode, bool shouldFail);
     void _testWriteFailureHandlingWorker(void);
     void _testReadFailureHandlingWorker(void);
+    void _writeLargeMission(int itemCount, double& itemsPerSecond);
+    void _readLargeMission(int itemCount, double& itemsPerSecond);
+    void _writePartialMission(const QList<MissionItem*>& missionItems, int& messageCount);
+    void _checkPartialMission(const QList<MissionItem*>& missionItems);
+    MissionItem* _partialMissionItem(int sequenceNumber, double altitude);
+
+    static const double _largeMissionLatitude;
+    static const double _largeMissionLongitude;
     
     static const TestCase_t _rgTestCases[];
     static const size_t     _cTestCases;
@@ -10,7 +10,9 @@
 
 #include "QGC.h"
 #include <qmath.h>
+#include <QtEndian>
 #include <float.h>
+#include <string.h>
 
 namespace QGC
 {
@@ -117,12 +119,90 @@ static const quint32 crctab[] =
     0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
+/// Tables for slice-by-8, table[k][i] is the CRC of byte i followed by k zero bytes
+struct Crc32Slices {
+    quint32 table[8][256];
+
+    Crc32Slices()
+    {
+        for (int i = 0; i < 256; i++) {
+            table[0][i] = crctab[i];
+        }
+        for (int k = 1; k < 8; k++) {
+            for (int i = 0; i < 256; i++) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ crctab[table[k - 1][i] & 0xff];
+            }
+        }
+    }
+};
+
+static const Crc32Slices& crc32Slices(void)
+{
+    static const Crc32Slices slices;
+    return slices;
+}
+
 quint32 crc32(const quint8 *src, unsigned len, unsigned state)
 {
+    const quint32 (*table)[256] = crc32Slices().table;
+
+    // Eight bytes per step with independent table lookups
+    while (len >= 8) {
+        quint32 one = qFromLittleEndian<quint32>(src) ^ state;
+        quint32 two = qFromLittleEndian<quint32>(src + 4);
+        state = table[7][one & 0xff] ^ table[6][(one >> 8) & 0xff] ^ table[5][(one >> 16) & 0xff] ^ table[4][one >> 24] ^
+                table[3][two & 0xff] ^ table[2][(two >> 8) & 0xff] ^ table[1][(two >> 16) & 0xff] ^ table[0][two >> 24];
+        src += 8;
+        len -= 8;
+    }
     for (unsigned i = 0; i < len; i++) {
         state = crctab[(state ^ src[i]) & 0xff] ^ (state >> 8);
     }
     return state;
 }
 
+/// Multiplies a vector by a 32x32 GF(2) matrix stored as columns
+static quint32 gf2MatrixTimes(const quint32* matrix, quint32 vector)
+{
+    quint32 sum = 0;
+    while (vector) {
+        if (vector & 1) {
+            sum ^= *matrix;
+        }
+        vector >>= 1;
+        matrix++;
+    }
+    return sum;
+}
+
+quint32 crc32Fill(quint8 fill, quint32 count, quint32 state)
+{
+    // Feeding one byte is the affine map state -> M * state ^ crctab[fill], where M is the linear map
+    // state -> crctab[state & 0xff] ^ (state >> 8). Applying it count times is done by repeated squaring,
+    // each squaring doubling the number of bytes the map stands for.
+    quint32 matrix[32];
+    quint32 square[32];
+    quint32 constant = crctab[fill];
+    for (int n = 0; n < 32; n++) {
+        quint32 column = 1u << n;
+        matrix[n] = crctab[column & 0xff] ^ (column >> 8);
+    }
+
+    while (count) {
+        if (count & 1) {
+            state = gf2MatrixTimes(matrix, state) ^ constant;
+        }
+        count >>= 1;
+        if (count) {
+            constant = gf2MatrixTimes(matrix, constant) ^ constant;
+            for (int n = 0; n < 32; n++) {
+                square[n] = gf2MatrixTimes(matrix, matrix[n]);
+            }
+            memcpy(matrix, square, sizeof(matrix));
+        }
+    }
+
+    return state;
+}
+
 }
@@ -48,8 +48,12 @@ public:
     using QThread::usleep;
 };
 
+/// CRC-32 (reflected 0xEDB88320, no pre or post inversion) of src continued from state. Runs slice-by-8.
 quint32 crc32(const quint8 *src, unsigned len, unsigned state);
 
+/// Same result as crc32 over count bytes of fill, in O(log count) time
+quint32 crc32Fill(quint8 fill, quint32 count, quint32 state);
+
 }
 
 #define QGC_EVENTLOOP_DEBUG 0
@@ -135,6 +135,7 @@ void Tx1Controller::_activeVehicleBeingRemoved(void)
     }
 
     disconnect(tx1Manager, &Tx1Manager::tx1StatusTrackedTargetChanged,   this, &Tx1Controller::tx1StatusTrackedTargetChanged);
+    disconnect(tx1Manager, &Tx1Manager::tx1StatusTrackedTargetCleared,   this, &Tx1Controller::tx1StatusTrackedTargetCleared);
     disconnect(tx1Manager, &Tx1Manager::tx1StatusFeaturePointChanged,   this, &Tx1Controller::tx1StatusFeaturePointChanged);
     disconnect(tx1Manager, &Tx1Manager::tx1PipeComTrackingChanged,       this, &Tx1Controller::tx1PipeComTracking);
     disconnect(tx1Manager, &Tx1Manager::tx1PipeComRecordingChanged,      this, &Tx1Controller::tx1PipeComRecording);
@@ -156,6 +157,7 @@ void Tx1Controller::_activeVehicleSet(void)
         return ;
     }
     connect(tx1Manager, &Tx1Manager::tx1StatusTrackedTargetChanged,   this, &Tx1Controller::tx1StatusTrackedTargetChanged);
+    connect(tx1Manager, &Tx1Manager::tx1StatusTrackedTargetCleared,   this, &Tx1Controller::tx1StatusTrackedTargetCleared);
     connect(tx1Manager, &Tx1Manager::tx1PipeComTrackingChanged,       this, &Tx1Controller::tx1PipeComTracking);
     connect(tx1Manager, &Tx1Manager::tx1PipeComRecordingChanged,      this, &Tx1Controller::tx1PipeComRecording);
     connect(tx1Manager, &Tx1Manager::tx1StatusFeaturePointChanged,   this, &Tx1Controller::tx1StatusFeaturePointChanged);
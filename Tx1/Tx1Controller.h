@@ -69,6 +69,7 @@ public:
 
 signals:
     void tx1StatusTrackedTargetChanged(float tl_x, float tl_y, float rb_x, float rb_y,float c_x,float c_y);
+    void tx1StatusTrackedTargetCleared();
     void tx1StatusTrackedPossibleTargetChanged(float tl_x, float tl_y, float rb_x, float rb_y);
     void tx1StatusFeaturePointChanged(float x,float y,int z);
     void tx1FpSendingChanged();
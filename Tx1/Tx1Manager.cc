@@ -12,6 +12,8 @@
 #include "Tx1Manager.h"
 #include "Vehicle.h"
 #include "QGCApplication.h"
+#include "LinkManager.h"
+#include "VideoManager.h"
 
 // define for including file order
 /* Wrong include order: MAVLINK_TX1.H MUST NOT BE DIRECTLY USED.
@@ -60,6 +62,7 @@
 //    TX1_COM_PIPE_CHAN_TYPE_ENUM_END = TX1_COM_CHAN_TYPE_ENUM_END, /*  | */
 //} TX1_COM_PIPE_CHAN_TYPE;
 
+QGC_LOGGING_CATEGORY(Tx1ManagerLog, "Tx1ManagerLog")
 
 Tx1Manager::Tx1Manager(Vehicle* vehicle)
     : _vehicle(vehicle)
@@ -68,11 +71,36 @@ Tx1Manager::Tx1Manager(Vehicle* vehicle)
     , _runing(false)
     , _recording(false)
     , _tracking(false)
-    #ifdef QGC_TX1_TEST_UDP
-    , _id(1)       // Test target id
-    #endif
+    , _id(1)
+    , _componentId(0)
+    , _link(NULL)
+    , _fpRequested(false)
+    , _lastRoundTripMsecs(-1)
+    , _maxRoundTripMsecs(-1)
 {
     _mavlink = qgcApp()->toolbox()->mavlinkProtocol();
+
+    connect(&_trackedTargetOverlay,  &Tx1TargetOverlay::targetChanged, this, &Tx1Manager::tx1StatusTrackedTargetChanged);
+    connect(&_trackedTargetOverlay,  &Tx1TargetOverlay::targetCleared, this, &Tx1Manager::tx1StatusTrackedTargetCleared);
+    connect(&_possibleTargetOverlay, &Tx1TargetOverlay::targetChanged, this, &Tx1Manager::tx1StatusTrackedPossibleTargetChanged);
+
+    // The boxes are drawn over the video, predict them to the frame being shown
+    VideoManager* videoManager = qgcApp()->toolbox()->videoManager();
+    if (videoManager) {
+        _trackedTargetOverlay.setVideoReceiver(videoManager->videoReceiver());
+        _possibleTargetOverlay.setVideoReceiver(videoManager->videoReceiver());
+    }
+
+#ifndef QGC_TX1_TEST_UDP
+    if(_vehicle){
+        _id = _vehicle->id();
+        _componentId = _vehicle->defaultComponentId();
+    }
+#else
+    // Test target id
+    _componentId = _mavlink->getComponentId();
+#endif
+
 #ifndef QGC_TX1_TEST_UDP
     if(_vehicle){
         QObject::connect(_vehicle, &Vehicle::mavlinkMessageReceived, this, &Tx1Manager::_handleTx1Message);
@@ -94,36 +122,73 @@ void Tx1Manager::_testTargetTracked(){
     //emit tx1StatusTrackedTargetChanged(200, 200, 303, 303);
 }
 
-void Tx1Manager::_sendMessageOnLink(const mavlink_message_t &message){
-    LinkManager *linkManager = qgcApp()->toolbox()->linkManager ();
-    if(0 && linkManager->links ()->contains (_link)){
-        if(_link && _link->isConnected()){
-            uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
-            int len = mavlink_msg_to_send_buffer(buffer, &message);
-            _link->writeBytesSafe((const char*)buffer, len);
-        }
-        return ;
+void Tx1Manager::_handleTx1Message(LinkInterface *link,const mavlink_message_t message){
+    // Every message on every link comes through here, only the tx1 ones are looked at
+    if(message.msgid < _firstTx1MessageId){
+        return;
     }
-
-    for (int i = 0; i < linkManager->links()->count(); i++) {
-        LinkInterface* links = linkManager->links()->value<LinkInterface*>(i);
-        if(links && links->isConnected()){
-            uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
-            int len = mavlink_msg_to_send_buffer(buffer, &message);
-            links->writeBytesSafe((const char*)buffer, len);
-        }
+    if(_link != link){
+        qCDebug(Tx1ManagerLog) << "Companion heard on link" << link->getName() << message.sysid << message.compid;
     }
-}
-
-void Tx1Manager::_handleTx1Message(LinkInterface *link,const mavlink_message_t message){
     _link = link;
+    _id = message.sysid;
+    _componentId = message.compid;
     this->_handleTx1Message(message);
 }
 #endif
 
+/// @return Link to send commands to the companion on: the link it was last heard on, otherwise the vehicle's
+LinkInterface* Tx1Manager::_commandLink(void){
+    LinkManager *linkManager = qgcApp()->toolbox()->linkManager();
+    if(_link && linkManager->links()->contains(_link) && _link->isConnected()){
+        return _link;
+    }
+    _link = NULL;
+
+    LinkInterface* link = _vehicle ? _vehicle->priorityLink() : NULL;
+    if(!link){
+        qCWarning(Tx1ManagerLog) << "No link to the companion, command not sent";
+    }
+    return link;
+}
+
+/// Sends the message, already encoded for the link's channel, to the link only
+void Tx1Manager::_sendMessageOnLink(LinkInterface* link, const mavlink_message_t &message){
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    int len = mavlink_msg_to_send_buffer(buffer, &message);
+    link->writeMessageSafe((const char*)buffer, len, LinkTxScheduler::priorityForMessage(message.msgid));
+}
+
+/// Times the command until the status which reflects it. A repeated command is timed from the latest send,
+/// and a command cancels the pending timing of its opposite since that status can no longer be matched.
+void Tx1Manager::_startRoundTrip(RoundTripCommand_t command){
+    _roundTripTimer[command].start();
+    if(command == RoundTripTrackingStart){
+        _roundTripTimer[RoundTripTrackingStop].invalidate();
+    }else if(command == RoundTripTrackingStop){
+        _roundTripTimer[RoundTripTrackingStart].invalidate();
+    }
+}
+
+void Tx1Manager::_finishRoundTrip(RoundTripCommand_t command, uint32_t msgid){
+    if(!_roundTripTimer[command].isValid()){
+        return;
+    }
+
+    _lastRoundTripMsecs = _roundTripTimer[command].elapsed();
+    _maxRoundTripMsecs = qMax(_maxRoundTripMsecs, _lastRoundTripMsecs);
+    _roundTripTimer[command].invalidate();
+    qCDebug(Tx1ManagerLog) << "Command round trip msecs:max" << _lastRoundTripMsecs << _maxRoundTripMsecs << "command" << command << "status" << msgid;
+    emit tx1RoundTripMeasured(_lastRoundTripMsecs);
+}
+
 /// Called when a new mavlink message for out vehicle is received
 void Tx1Manager::_handleTx1Message(const mavlink_message_t& message)
 {
+    if(message.msgid < _firstTx1MessageId){
+        return;
+    }
+
     switch (message.msgid) {
 
     case MAVLINK_MSG_ID_TX1_STATUS_SYSTEM:  // 65500
@@ -154,24 +219,38 @@ void Tx1Manager::_handleTx1StatusTrackedTarget(const mavlink_message_t& message)
 //           <<" ,tl_x : "<<tx1_status_tracked_target.tl_x <<" ,tl_y : "<<tx1_status_tracked_target.tl_y
 //          <<" ,rb_x : "<<tx1_status_tracked_target.br_x <<" ,rb_y : "<<tx1_status_tracked_target.br_y
 //            <<" ,status : "<<tx1_status_tracked_target.c_x <<" ,num : "<<tx1_status_tracked_target.c_y;
-    emit tx1StatusTrackedTargetChanged( tx1_status_tracked_target.tl_x
-                                        , tx1_status_tracked_target.tl_y
-                                        , tx1_status_tracked_target.br_x
-                                        , tx1_status_tracked_target.br_y
-                                        , tx1_status_tracked_target.c_x
-                                        , tx1_status_tracked_target.c_y);
+    Tx1TargetFilter::Box_t box;
+    box.tlX = tx1_status_tracked_target.tl_x;
+    box.tlY = tx1_status_tracked_target.tl_y;
+    box.brX = tx1_status_tracked_target.br_x;
+    box.brY = tx1_status_tracked_target.br_y;
+    if(tx1_status_tracked_target.c_x != 0){
+        // Not the tracked box, c_x/c_y tag the boxes of a point group which are drawn as they come
+        emit tx1StatusTrackedTargetChanged(box.tlX, box.tlY, box.brX, box.brY, tx1_status_tracked_target.c_x, tx1_status_tracked_target.c_y);
+        return;
+    }
+    _trackedTargetOverlay.addStatus(box, tx1_status_tracked_target.c_x, tx1_status_tracked_target.c_y, Tx1TargetOverlay::clockUsecs());
 }
 
 void Tx1Manager::_handleTx1StatusSystem(const mavlink_message_t& message){
     mavlink_tx1_status_system_t tx1_status_system;
     mavlink_msg_tx1_status_system_decode(&message,&tx1_status_system);
-    qDebug()<<"tx1 current status:"<<tx1_status_system.tracking;
+    qCDebug(Tx1ManagerLog) << "tx1 current status:" << tx1_status_system.tracking;
+
+    // Tracking commands are acted on when the reported tracking state changes to match
+    uint8_t tracking = tx1_status_system.tracking ? 1 : 0;
+    if(tracking != _tracking){
+        _tracking = tracking;
+        _finishRoundTrip(_tracking ? RoundTripTrackingStart : RoundTripTrackingStop, message.msgid);
+        emit tx1PipeComTrackingChanged(_tracking);
+    }
 }
 
 void Tx1Manager::_handleTx1StatusFpTracked(const mavlink_message_t &message)
 {
     mavlink_tx1_debug_status_fp_tracked_t tx1_status_fp_tracked;
     mavlink_msg_tx1_debug_status_fp_tracked_decode(&message,&tx1_status_fp_tracked);
+    _finishRoundTrip(RoundTripFpStart, message.msgid);
 
 //    qDebug()<<"error:"<<tx1_status_fp_tracked.error
 //           <<"orientation:"<<tx1_status_fp_tracked.orientation
@@ -226,41 +305,28 @@ void Tx1Manager::tx1ControlPipeFlow(uint8_t target_id){
 
 void Tx1Manager::tx1ControlPipeFp(uint8_t target_id, uint8_t send){
     Q_UNUSED(target_id)
-#ifndef QGC_TX1_TEST_UDP
-    if(_vehicle && _mavlink){
+    LinkInterface* link = _commandLink();
+    if(_mavlink && link){
         mavlink_message_t msg;
         mavlink_tx1_debug_request_fp_tracked_t tx1_control_pipe_fp;
-        tx1_control_pipe_fp.target_system = _vehicle->id ();
-        tx1_control_pipe_fp.target_component = _vehicle->defaultComponentId ();       // The id of the target pipeline
+        tx1_control_pipe_fp.target_system = _id;
+        tx1_control_pipe_fp.target_component = _componentId;
         tx1_control_pipe_fp.send = send;                                              // Start/Stop send on the pipeline
-//        memset(tx1_control_pipe_record.fileName, 0, sizeof(tx1_control_pipe_record.fileName));  ?
-
-        _dedicatedLink = _vehicle->priorityLink();
-        if(_dedicatedLink){
-            // MAVLINK_MSG_ID_TX1_CONTROL_PIPE_RECORD 65501
-            mavlink_msg_tx1_debug_request_fp_tracked_encode_chan(_mavlink->getSystemId(),
-                                                                 _mavlink->getComponentId(),
-                                                                 _dedicatedLink->mavlinkChannel(),
-                                                                 &msg,
-                                                                 &tx1_control_pipe_record);
-            _vehicle->sendMessageOnLink (_dedicatedLink, msg);
+        mavlink_msg_tx1_debug_request_fp_tracked_encode_chan(_mavlink->getSystemId(),
+                                                             _mavlink->getComponentId(),
+                                                             link->mavlinkChannel(),
+                                                             &msg,
+                                                             &tx1_control_pipe_fp);
+        this->_sendMessageOnLink(link, msg);
+
+        // Only a request which turns feature points on has a status to wait for
+        if(send && !_fpRequested){
+            _startRoundTrip(RoundTripFpStart);
+        }else if(!send){
+            _roundTripTimer[RoundTripFpStart].invalidate();
         }
+        _fpRequested = send;
     }
-#else
-    if(_mavlink){
-        mavlink_message_t msg;
-        mavlink_tx1_debug_request_fp_tracked_t tx1_control_pipe_fp;
-        tx1_control_pipe_fp.target_system = _id;
-        tx1_control_pipe_fp.target_component = _mavlink->getComponentId();
-        tx1_control_pipe_fp.send = send;
- //       memset(tx1_control_pipe_record.fileName, 0, sizeof(tx1_control_pipe_record.fileName));
-        mavlink_msg_tx1_debug_request_fp_tracked_encode(_mavlink->getSystemId(),
-                                                        _mavlink->getComponentId(),
-                                                        &msg,
-                                                        &tx1_control_pipe_fp);
-        this->_sendMessageOnLink(msg);
-    }
-#endif
 }
 
 /// Message to control the screenshot function of a pipeline
@@ -320,52 +386,30 @@ void Tx1Manager::tx1ControlPipeScreenee(uint8_t target_id, uint8_t screenee, cha
 void Tx1Manager::tx1ControlPipeTrack(uint8_t target_id, uint8_t track,int topLeftX, int topLeftY, int bottomRightX, int bottomRightY){
     Q_UNUSED(target_id);
     Q_UNUSED(track);
-#ifndef QGC_TX1_TEST_UDP
-    if(_vehicle && _mavlink){
+    LinkInterface* link = _commandLink();
+    if(_mavlink && link){
         mavlink_message_t msg;
         mavlink_tx1_control_tracking_start_t tx1_control_pipe_track;
-        tx1_control_pipe_track.target_system = _vehicle->id ();                    /*< System ID*/
-        tx1_control_pipe_track.target_component = _vehicle->defaultComponentId (); // Component ID
+        tx1_control_pipe_track.target_system = _id;                           /*< System ID*/
+        tx1_control_pipe_track.target_component = _componentId;               // Component ID
         tx1_control_pipe_track.tl_x = topLeftX;      // Top left corner x coordinate of target to track
         tx1_control_pipe_track.tl_y = topLeftY;      // Top left corner y coordinate of target to track
         tx1_control_pipe_track.br_x = bottomRightX;  // Bottom right corner x coordinate of target to track
         tx1_control_pipe_track.br_y = bottomRightY;  // Bottom right corner y coordinate of target to track
 
-        _dedicatedLink = _vehicle->priorityLink();
-        if(_dedicatedLink){
-            // MAVLINK_MSG_ID_TX1_CONTROL_PIPE_TRACK 65503
-            mavlink_msg_tx1_control_tracking_start_pack_chan(_mavlink->getSystemId(),     // system_id ID of this system
+        // MAVLINK_MSG_ID_TX1_CONTROL_PIPE_TRACK 65503
+        mavlink_msg_tx1_control_tracking_start_encode_chan(_mavlink->getSystemId(),     // system_id ID of this system
                                                            _mavlink->getComponentId(),  // component_id ID of this component (e.g. 200 for IMU)
-                                                           _dedicatedLink->mavlinkChannel(),
+                                                           link->mavlinkChannel(),
                                                            &msg,
-                                                           tx1_control_pipe_track.target_system,
-                                                           tx1_control_pipe_track.target_component,
-                                                           tx1_control_pipe_track.tl_x
-                                                           tx1_control_pipe_track.tl_y
-                                                           tx1_control_pipe_track.br_x
-                                                           tx1_control_pipe_track.br_y);
-            _vehicle->sendMessageOnLink (_dedicatedLink, msg);
-        }
-    }
-#else
-    if(_mavlink){
-        mavlink_message_t msg;
-        mavlink_tx1_control_tracking_start_t tx1_control_pipe_track;
-        tx1_control_pipe_track.target_system = _id;                           /*< System ID*/
-        tx1_control_pipe_track.target_component = _mavlink->getComponentId(); // Component ID
-        tx1_control_pipe_track.tl_x = topLeftX;      // Top left corner x coordinate of target to track
-        tx1_control_pipe_track.tl_y = topLeftY;      // Top left corner y coordinate of target to track
-        tx1_control_pipe_track.br_x = bottomRightX;  // Bottom right corner x coordinate of target to track
-        tx1_control_pipe_track.br_y = bottomRightY;  // Bottom right corner y coordinate of target to track
+                                                           &tx1_control_pipe_track);
+        this->_sendMessageOnLink(link, msg);
 
-        // MAVLINK_MSG_ID_TX1_CONTROL_PIPE_TRACK 65503
-        mavlink_msg_tx1_control_tracking_start_encode(_mavlink->getSystemId(),     // system_id ID of this system
-                                                  _mavlink->getComponentId(),  // component_id ID of this component (e.g. 200 for IMU)
-                                                  &msg,
-                                                  &tx1_control_pipe_track);
-        this->_sendMessageOnLink(msg);
+        // A new target while already tracking doesn't change the tracking state, there is nothing to time it to
+        if(!_tracking){
+            _startRoundTrip(RoundTripTrackingStart);
+        }
     }
-#endif
 }
 
 /// To control the activation of a com channel
@@ -545,38 +589,27 @@ void Tx1Manager::tx1StatusAck(uint8_t status){
 void Tx1Manager::tx1StopTracking(uint8_t target_id)
 {
     Q_UNUSED(target_id);
-#ifndef QGC_TX1_TEST_UDP
-    if(_vehicle && _mavlink){
-        mavlink_message_t msg;
-        mavlink_tx1_control_tracking_stop_t tx1_control_track;
-        tx1_control_track.target_system = _vehicle->id();                           /*< System ID*/
-        tx1_control_track.target_component = _vehicle->defaultComponentId();
-
-        _dedicatedLink = _vehicle->priorityLink();
-
-        if(_dedicatedLink){
-            mavlink_msg_tx1_control_tracking_stop_encode_chan(_mavlink->getSystemId(),
-                                                              _mavlink->getComponentId(),
-                                                              _dedicatedLink,
-                                                              &msg,
-                                                              &tx1_control_track
-                        );
-            _vehicle->sendMessageOnLink(_vehicle,msg);
-    }
-#else
-    if(_mavlink){
+    LinkInterface* link = _commandLink();
+    if(_mavlink && link){
         mavlink_message_t msg;
         mavlink_tx1_control_tracking_stop_t tx1_control_track;
         tx1_control_track.target_system = _id;                           /*< System ID*/
-        tx1_control_track.target_component = _mavlink->getComponentId();
-        mavlink_msg_tx1_control_tracking_stop_encode(_mavlink->getSystemId(),
-                                                     _mavlink->getComponentId(),
-                                                     &msg,
-                                                     &tx1_control_track
+        tx1_control_track.target_component = _componentId;
+        mavlink_msg_tx1_control_tracking_stop_encode_chan(_mavlink->getSystemId(),
+                                                          _mavlink->getComponentId(),
+                                                          link->mavlinkChannel(),
+                                                          &msg,
+                                                          &tx1_control_track
                     );
-        this->_sendMessageOnLink(msg);
+        this->_sendMessageOnLink(link, msg);
+
+        if(_tracking){
+            _startRoundTrip(RoundTripTrackingStop);
+        }
     }
-#endif
+
+    // Don't leave the last box drifting on the video
+    _trackedTargetOverlay.reset();
 }
 
 //// !!! dummy messages - not used right now. just fror blocking the ids !!!
@@ -598,11 +631,17 @@ void Tx1Manager::tx1Dummy5(){
 void Tx1Manager::_handleTx1StatusPossibleTrackedTarget(const mavlink_message_t& message){
     mavlink_tx1_status_possible_target_location_t tx1_status_tracked_target;
     mavlink_msg_tx1_status_possible_target_location_decode(&message, &tx1_status_tracked_target);
-    emit tx1StatusTrackedPossibleTargetChanged( tx1_status_tracked_target.tl_x
-                                        , tx1_status_tracked_target.tl_y
-                                        , tx1_status_tracked_target.br_x
-                                        , tx1_status_tracked_target.br_y
-                                        );
+    Tx1TargetFilter::Box_t box;
+    box.tlX = tx1_status_tracked_target.tl_x;
+    box.tlY = tx1_status_tracked_target.tl_y;
+    box.brX = tx1_status_tracked_target.br_x;
+    box.brY = tx1_status_tracked_target.br_y;
+    if(box.brX < 0){
+        // Negative br_x marks a state or point count report rather than a box
+        emit tx1StatusTrackedPossibleTargetChanged(box.tlX, box.tlY, box.brX, box.brY);
+        return;
+    }
+    _possibleTargetOverlay.addStatus(box, (box.tlX + box.brX) / 2.0, (box.tlY + box.brY) / 2.0, Tx1TargetOverlay::clockUsecs());
 }
 
 //// !!! dummy messages - not used right now. just fror blocking the ids !!!
@@ -22,9 +22,14 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QElapsedTimer>
 
 #include "QGCMAVLink.h"
 #include "MAVLinkProtocol.h"
+#include "QGCLoggingCategory.h"
+#include "Tx1TargetOverlay.h"
+
+Q_DECLARE_LOGGING_CATEGORY(Tx1ManagerLog)
 
 class Vehicle;
 
@@ -96,10 +101,19 @@ public:
     void tx1Dummy5();
     //// !!! dummy messages - not used right now. just fror blocking the ids !!!
 
+    /// Msecs from a command to the status showing the companion acted on it, -1 if none measured yet
+    int lastRoundTripMsecs(void) const { return _lastRoundTripMsecs; }
+    int maxRoundTripMsecs(void) const { return _maxRoundTripMsecs; }
+
+    /// Overlays publishing the filtered target boxes at display rate
+    Tx1TargetOverlay* trackedTargetOverlay(void) { return &_trackedTargetOverlay; }
+    Tx1TargetOverlay* possibleTargetOverlay(void) { return &_possibleTargetOverlay; }
+
 signals:
-    /// A message acknowledging fllow target
-    ///     @param newTarget : enum TX1_STATUS_ACK : ACK status of the command this message is acknowledgeing
+    /// Tracked and possible target boxes are filtered and emitted at display refresh rate, not once per status
     void tx1StatusTrackedTargetChanged( float tl_x, float tl_y, float rb_x, float rb_y,float c_x,float c_y);
+    /// Tracked target box should be hidden, tracking stopped or the track went stale
+    void tx1StatusTrackedTargetCleared(void);
     void tx1StatusFeaturePointChanged(float x,float y,int z);
     void tx1StatusTrackedPossibleTargetChanged(float tl_x, float tl_y, float rb_x, float rb_y);
     /// Type of the pipeline or com changed
@@ -114,6 +128,10 @@ signals:
     /// Tracking status of the pinpeline or com changed
     void tx1PipeComTrackingChanged(uint8_t tracking);
 
+    /// The status showing the companion acted on a command arrived
+    ///     @param msecs : time from sending the command to the status
+    void tx1RoundTripMeasured(int msecs);
+
 private slots:
     void _handleTx1Message( const mavlink_message_t& message);
 #ifdef QGC_TX1_TEST_UDP
@@ -128,9 +146,19 @@ private:
     void _handleTx1StatusSystem(const mavlink_message_t& message);
     void _handleTx1StatusFpTracked(const mavlink_message_t& message);
 
-#ifdef QGC_TX1_TEST_UDP
-    void _sendMessageOnLink(const mavlink_message_t& message);
-#endif
+    LinkInterface* _commandLink(void);
+    void _sendMessageOnLink(LinkInterface* link, const mavlink_message_t& message);
+
+    /// Commands with a round trip timed, each to the status which shows it took effect
+    typedef enum {
+        RoundTripTrackingStart,     ///< Status system reports tracking on
+        RoundTripTrackingStop,      ///< Status system reports tracking off
+        RoundTripFpStart,           ///< First feature point status
+        RoundTripMax
+    } RoundTripCommand_t;
+
+    void _startRoundTrip(RoundTripCommand_t command);
+    void _finishRoundTrip(RoundTripCommand_t command, uint32_t msgid);
 
 private:
     Vehicle*         _vehicle;
@@ -142,9 +170,18 @@ private:
     uint8_t          _recording; // Recording status of the pipeline or com
     uint8_t          _tracking;  // Tracking status of the pinpeline or com
 
-#ifdef QGC_TX1_TEST_UDP
-    int              _id;       // Test target id
-    LinkInterface   *_link;
-#endif
+    int              _id;               // System id of the companion
+    int              _componentId;      // Component id of the companion
+    LinkInterface   *_link;             // Link the companion was last heard on, NULL if not heard yet
+
+    QElapsedTimer    _roundTripTimer[RoundTripMax]; // Started when the command is sent, invalid while none is pending
+    bool             _fpRequested;      // Feature points were last requested on
+    int              _lastRoundTripMsecs;
+    int              _maxRoundTripMsecs;
+
+    static const uint32_t _firstTx1MessageId = 65000;   // Lowest id of the tx1 dialect
+
+    Tx1TargetOverlay _trackedTargetOverlay;
+    Tx1TargetOverlay _possibleTargetOverlay;
 };
 #endif    //TX1_MANAGER_H
@@ -0,0 +1,184 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/// @file
+///     @brief Smoothed video overlay for Tx1 target boxes
+
+#include "Tx1TargetOverlay.h"
+#include "VideoReceiver.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+#include <QSettings>
+
+#include <chrono>
+#include <cmath>
+
+const qint64 Tx1TargetFilter::staleUsecs;
+const qint64 Tx1TargetFilter::maxPredictUsecs;
+const qint64 Tx1TargetOverlay::defaultLatencyUsecs;
+const double Tx1TargetOverlay::_minMovePixels = 0.25;
+const char*  Tx1TargetOverlay::_latencySettingsKey = "Tx1TargetLatencyMsecs";
+
+Tx1TargetFilter::Tx1TargetFilter(void)
+    : _valid(false)
+    , _lastUsecs(0)
+    , _alpha(0.5)
+    , _beta(0.15)
+{
+    for (int i=0; i<StateCount; i++) {
+        _position[i] = 0;
+        _velocity[i] = 0;
+    }
+}
+
+void Tx1TargetFilter::update(const Box_t& box, qint64 frameUsecs)
+{
+    double measured[StateCount];
+    measured[CentreX]   = (box.tlX + box.brX) / 2.0;
+    measured[CentreY]   = (box.tlY + box.brY) / 2.0;
+    measured[Width]     = box.brX - box.tlX;
+    measured[Height]    = box.brY - box.tlY;
+
+    if (!_valid || frameUsecs - _lastUsecs > staleUsecs) {
+        // New track, nothing to go on for the velocity yet
+        for (int i=0; i<StateCount; i++) {
+            _position[i] = measured[i];
+            _velocity[i] = 0;
+        }
+        _lastUsecs = frameUsecs;
+        _valid = true;
+        return;
+    }
+
+    if (frameUsecs <= _lastUsecs) {
+        // Out of order or from the same frame, the filter has already moved past it
+        return;
+    }
+
+    double dt = (frameUsecs - _lastUsecs) / 1000000.0;
+    for (int i=0; i<StateCount; i++) {
+        double predicted = _position[i] + (_velocity[i] * dt);
+        double residual = measured[i] - predicted;
+        _position[i] = predicted + (_alpha * residual);
+        _velocity[i] += (_beta * residual) / dt;
+    }
+    _lastUsecs = frameUsecs;
+}
+
+bool Tx1TargetFilter::predict(qint64 usecs, Box_t& box) const
+{
+    if (!_valid || usecs - _lastUsecs > staleUsecs) {
+        return false;
+    }
+
+    double dt = qBound((qint64)0, usecs - _lastUsecs, maxPredictUsecs) / 1000000.0;
+    double centreX  = _position[CentreX] + (_velocity[CentreX] * dt);
+    double centreY  = _position[CentreY] + (_velocity[CentreY] * dt);
+    double width    = qMax(0.0, _position[Width] + (_velocity[Width] * dt));
+    double height   = qMax(0.0, _position[Height] + (_velocity[Height] * dt));
+
+    box.tlX = centreX - (width / 2.0);
+    box.tlY = centreY - (height / 2.0);
+    box.brX = centreX + (width / 2.0);
+    box.brY = centreY + (height / 2.0);
+
+    return true;
+}
+
+Tx1TargetOverlay::Tx1TargetOverlay(QObject* parent)
+    : QObject(parent)
+    , _latencyUsecs(defaultLatencyUsecs)
+    , _centreX(0)
+    , _centreY(0)
+    , _published(false)
+    , _statusCount(0)
+    , _publishCount(0)
+{
+    _lastBox.tlX = _lastBox.tlY = _lastBox.brX = _lastBox.brY = 0;
+
+    QSettings settings;
+    _latencyUsecs = settings.value(_latencySettingsKey, defaultLatencyUsecs / 1000).toLongLong() * 1000;
+
+    QScreen* screen = QGuiApplication::primaryScreen();
+    setRefreshRate(screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60.0);
+    _refreshTimer.setTimerType(Qt::PreciseTimer);
+    connect(&_refreshTimer, &QTimer::timeout, this, &Tx1TargetOverlay::_refresh);
+}
+
+qint64 Tx1TargetOverlay::clockUsecs(void)
+{
+    // Same clock as VideoFrameTap::monotonicUsecs
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tx1TargetOverlay::setRefreshRate(double hz)
+{
+    _refreshTimer.setInterval(qMax(1, qRound(1000.0 / hz)));
+}
+
+void Tx1TargetOverlay::addStatus(const Tx1TargetFilter::Box_t& box, double centreX, double centreY, qint64 arrivalUsecs)
+{
+    _statusCount++;
+    _centreX = centreX;
+    _centreY = centreY;
+    _filter.update(box, arrivalUsecs - _latencyUsecs);
+
+    if (!_refreshTimer.isActive()) {
+        _refreshTimer.start();
+    }
+}
+
+void Tx1TargetOverlay::reset(void)
+{
+    _filter.reset();
+    _clear();
+}
+
+/// Stops publishing and hides the box if one is showing
+void Tx1TargetOverlay::_clear(void)
+{
+    _refreshTimer.stop();
+    if (_published) {
+        _published = false;
+        emit targetCleared();
+    }
+}
+
+void Tx1TargetOverlay::_refresh(void)
+{
+    qint64 frameUsecs = _videoReceiver ? _videoReceiver->displayedFrameUsecs() : 0;
+    publish(frameUsecs > 0 ? frameUsecs : clockUsecs());
+}
+
+void Tx1TargetOverlay::publish(qint64 usecs)
+{
+    Tx1TargetFilter::Box_t box;
+
+    if (!_filter.predict(usecs, box)) {
+        // Track went stale, the timer is started again by the next status
+        _clear();
+        return;
+    }
+
+    if (_published &&
+            std::fabs(box.tlX - _lastBox.tlX) < _minMovePixels &&
+            std::fabs(box.tlY - _lastBox.tlY) < _minMovePixels &&
+            std::fabs(box.brX - _lastBox.brX) < _minMovePixels &&
+            std::fabs(box.brY - _lastBox.brY) < _minMovePixels) {
+        return;
+    }
+
+    _lastBox = box;
+    _published = true;
+    _publishCount++;
+
+    emit targetChanged(box.tlX, box.tlY, box.brX, box.brY, _centreX, _centreY);
+}
@@ -0,0 +1,150 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/// @file
+///     @brief Smoothed video overlay for Tx1 target boxes
+
+#ifndef TX1_TARGET_OVERLAY_H
+#define TX1_TARGET_OVERLAY_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+class VideoReceiver;
+
+/// Constant velocity (alpha-beta) filter for a target box in video pixel coordinates.
+///
+/// The box is filtered as centre and size, each with its own velocity. Measurements are stamped with
+/// the time of the video frame they were computed on, so the box can be predicted forward to the time a
+/// display frame is drawn.
+class Tx1TargetFilter
+{
+public:
+    Tx1TargetFilter(void);
+
+    typedef struct {
+        double tlX;
+        double tlY;
+        double brX;
+        double brY;
+    } Box_t;
+
+    /// Adds a measured box. Measurements older than the last one are ignored.
+    ///     @param frameUsecs Video clock time of the frame the box was found on
+    void update(const Box_t& box, qint64 frameUsecs);
+
+    /// Predicts the box at the specified time. Prediction stops maxPredictUsecs after the last measurement.
+    /// @return false: no measurement within staleUsecs of usecs
+    bool predict(qint64 usecs, Box_t& box) const;
+
+    void reset(void) { _valid = false; }
+    bool valid(void) const { return _valid; }
+
+    qint64 lastFrameUsecs(void) const { return _lastUsecs; }
+
+    /// Gains used for each measurement, 0 < beta < alpha <= 1. Lower values are smoother but lag more.
+    void setGains(double alpha, double beta) { _alpha = alpha; _beta = beta; }
+
+    static const qint64 staleUsecs = 1000000;       ///< Track is dropped if there is no measurement for this long
+    static const qint64 maxPredictUsecs = 200000;   ///< Longest time the box is moved on without a measurement
+
+private:
+    enum { CentreX, CentreY, Width, Height, StateCount };
+
+    bool    _valid;
+    qint64  _lastUsecs;
+    double  _alpha;
+    double  _beta;
+    double  _position[StateCount];
+    double  _velocity[StateCount];  ///< Per second
+};
+
+/// Publishes a Tx1 target box to the overlay at display refresh rate.
+///
+/// Tx1 status messages arrive at telemetry rate with jitter in both the box and the arrival time, drawing
+/// each one as it arrives makes the overlay jump. Statuses are fed to a Tx1TargetFilter instead and the
+/// filtered box is published once per display frame, only when it has moved. The timer only runs while
+/// there is a live track, targetCleared is signalled when the track goes stale or is reset.
+///
+/// Statuses are placed on the video clock at the time the frame they were computed on reached the video
+/// sink, using the Tx1TargetLatencyMsecs setting (defaultLatencyUsecs if it is not set). Each refresh
+/// predicts the box to the frame the video receiver is showing, so the box stays with the video rather
+/// than running ahead of it by the video pipeline latency.
+class Tx1TargetOverlay : public QObject
+{
+    Q_OBJECT
+
+public:
+    Tx1TargetOverlay(QObject* parent = NULL);
+
+    /// Adds a box from a Tx1 status.
+    ///     @param centreX,centreY Target point values from the status, published unchanged with the box
+    ///     @param arrivalUsecs Video clock time the status arrived
+    void addStatus(const Tx1TargetFilter::Box_t& box, double centreX, double centreY, qint64 arrivalUsecs);
+
+    /// Drops the current track and hides the overlay
+    void reset(void);
+
+    /// Publishes the box for the specified video frame, called by the refresh timer
+    ///     @param usecs Video clock time the frame on screen reached the video sink
+    void publish(qint64 usecs);
+
+    /// Video receiver whose displayed frame time is used by the refresh timer. The current clock time is
+    /// used while there is no receiver or it has no frame.
+    void setVideoReceiver(VideoReceiver* videoReceiver) { _videoReceiver = videoReceiver; }
+
+    /// Time between the video frame a status was computed on reaching the video sink and the status arriving.
+    /// Negative if statuses arrive before their frame.
+    qint64 latencyUsecs(void) const { return _latencyUsecs; }
+    void setLatencyUsecs(qint64 latencyUsecs) { _latencyUsecs = latencyUsecs; }
+
+    /// Sets the publish rate, the display refresh rate by default
+    void setRefreshRate(double hz);
+
+    Tx1TargetFilter& filter(void) { return _filter; }
+
+    quint64 statusCount(void) const { return _statusCount; }
+    quint64 publishCount(void) const { return _publishCount; }
+
+    /// Clock used for arrival and display times, the same clock video frames are stamped with
+    static qint64 clockUsecs(void);
+
+    /// Latency of a Tx1 tracking over a telemetry radio with its video over a separate video link
+    static const qint64 defaultLatencyUsecs = 75000;
+
+signals:
+    void targetChanged(float tlX, float tlY, float brX, float brY, float centreX, float centreY);
+
+    /// The box was hidden, nothing is drawn until the next targetChanged
+    void targetCleared(void);
+
+private slots:
+    void _refresh(void);
+
+private:
+    void _clear(void);
+
+    Tx1TargetFilter     _filter;
+    QTimer              _refreshTimer;
+    QPointer<VideoReceiver> _videoReceiver;
+    qint64              _latencyUsecs;
+    double              _centreX;           ///< Target point values from the latest status
+    double              _centreY;
+    bool                _published;         ///< A box is showing
+    Tx1TargetFilter::Box_t _lastBox;
+    quint64             _statusCount;
+    quint64             _publishCount;
+
+    static const double _minMovePixels;     ///< Smaller changes are not published
+    static const char*  _latencySettingsKey;
+};
+
+#endif // TX1_TARGET_OVERLAY_H
@@ -0,0 +1,295 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "Tx1TargetOverlayTest.h"
+
+#include <QFile>
+#include <QSettings>
+#include <QTextStream>
+
+#include <cmath>
+
+Tx1TargetOverlayTest::Tx1TargetOverlayTest(void)
+{
+
+}
+
+/// Target box moving around a 1280x720 frame
+Tx1TargetFilter::Box_t Tx1TargetOverlayTest::_truthBox(qint64 usecs)
+{
+    double seconds = usecs / 1000000.0;
+    double centreX = 640 + (300 * std::sin(2 * M_PI * seconds / 8));
+    double centreY = 360 + (150 * std::sin(2 * M_PI * seconds / 5));
+
+    Tx1TargetFilter::Box_t box;
+    box.tlX = centreX - 60;
+    box.tlY = centreY - 40;
+    box.brX = centreX + 60;
+    box.brY = centreY + 40;
+    return box;
+}
+
+/// Video clock time the frame on screen at the display time reached the video sink
+qint64 Tx1TargetOverlayTest::_shownFrameUsecs(qint64 displayUsecs)
+{
+    return displayUsecs - (displayUsecs % _videoFrameUsecs);
+}
+
+double Tx1TargetOverlayTest::_centreDistance(const Tx1TargetFilter::Box_t& a, const Tx1TargetFilter::Box_t& b)
+{
+    double dx = ((a.tlX + a.brX) - (b.tlX + b.brX)) / 2.0;
+    double dy = ((a.tlY + a.brY) - (b.tlY + b.brY)) / 2.0;
+    return std::sqrt((dx * dx) + (dy * dy));
+}
+
+/// 20Hz statuses with +/-10ms frame jitter, +/-15ms of jitter around the arrival latency and +/-3 pixels of noise on each corner.
+/// The latency is from the frame reaching the video sink, _videoLatencyUsecs after the camera took it.
+QList<Tx1TargetOverlayTest::Status_t> Tx1TargetOverlayTest::_syntheticStream(qint64 meanLatencyUsecs)
+{
+    QList<Status_t> statuses;
+
+    // Fixed seed so every run replays the same stream
+    quint32 seed = 12345;
+    auto random = [&seed]() {
+        seed = (seed * 1103515245u) + 12345u;
+        return ((seed >> 16) & 0x7fff) / 32767.0;
+    };
+
+    qint64 previousArrival = 0;
+    for (int i=0; i<400; i++) {
+        qint64 frameUsecs = (i * 50000LL) + (qint64)((random() - 0.5) * 20000);
+        Tx1TargetFilter::Box_t truth = _truthBox(frameUsecs);
+
+        Status_t status;
+        status.box.tlX = truth.tlX + ((random() - 0.5) * 6);
+        status.box.tlY = truth.tlY + ((random() - 0.5) * 6);
+        status.box.brX = truth.brX + ((random() - 0.5) * 6);
+        status.box.brY = truth.brY + ((random() - 0.5) * 6);
+        status.arrivalUsecs = qMax(previousArrival + 1, frameUsecs + _videoLatencyUsecs + meanLatencyUsecs - 15000 + (qint64)(random() * 30000));
+        previousArrival = status.arrivalUsecs;
+
+        statuses.append(status);
+    }
+
+    return statuses;
+}
+
+QList<Tx1TargetOverlayTest::Status_t> Tx1TargetOverlayTest::_loadStream(const QString& fileName)
+{
+    QList<Status_t> statuses;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Unable to open Tx1 replay file" << fileName << file.errorString();
+        return statuses;
+    }
+
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        QStringList values = stream.readLine().split(',');
+        bool ok = values.count() >= 5;
+        Status_t status;
+        if (ok) {
+            status.arrivalUsecs = values[0].toLongLong(&ok);
+        }
+        if (ok) {
+            status.box.tlX = values[1].toDouble();
+            status.box.tlY = values[2].toDouble();
+            status.box.brX = values[3].toDouble();
+            status.box.brY = values[4].toDouble();
+            statuses.append(status);
+        }
+    }
+
+    return statuses;
+}
+
+/// Feeds the statuses to an overlay configured as it ships as they arrive and publishes once per simulated
+/// display frame, for the video frame shown at that time. The raw overlay is what was drawn before filtering:
+/// the latest status, as soon as it arrives. Both are scored against the target in the video frame shown.
+Tx1TargetOverlayTest::ReplayResult_t Tx1TargetOverlayTest::_replay(const QList<Status_t>& statuses, bool truth)
+{
+    ReplayResult_t result;
+    result.tickCount = 0;
+    result.publishCount = 0;
+    result.publishAfterEndCount = 0;
+    result.clearCount = 0;
+    result.filteredError = truth ? 0 : -1;
+    result.rawError = truth ? 0 : -1;
+    result.filteredJitter = 0;
+    result.rawJitter = 0;
+
+    Tx1TargetOverlay overlay;
+
+    Tx1TargetFilter::Box_t drawn = { 0, 0, 0, 0 };
+    connect(&overlay, &Tx1TargetOverlay::targetChanged, [&drawn](float tlX, float tlY, float brX, float brY, float centreX, float centreY) {
+        Q_UNUSED(centreX);
+        Q_UNUSED(centreY);
+        drawn.tlX = tlX;
+        drawn.tlY = tlY;
+        drawn.brX = brX;
+        drawn.brY = brY;
+    });
+    connect(&overlay, &Tx1TargetOverlay::targetCleared, [&result]() {
+        result.clearCount++;
+    });
+
+    qint64 lastArrival = statuses.last().arrivalUsecs;
+    Tx1TargetFilter::Box_t raw = statuses.first().box;
+    double drawnCentre[2] = { 0, 0 };
+    double rawCentre[2] = { 0, 0 };
+    int nextStatus = 0;
+    int liveTickCount = 0;
+
+    for (qint64 tick = statuses.first().arrivalUsecs; tick < lastArrival + Tx1TargetFilter::staleUsecs + 500000; tick += _displayFrameUsecs) {
+        while (nextStatus < statuses.count() && statuses[nextStatus].arrivalUsecs <= tick) {
+            const Status_t& status = statuses[nextStatus++];
+            overlay.addStatus(status.box, (status.box.tlX + status.box.brX) / 2.0, (status.box.tlY + status.box.brY) / 2.0, status.arrivalUsecs);
+            raw = status.box;
+        }
+
+        result.tickCount++;
+        qint64 frameUsecs = _shownFrameUsecs(tick);
+        quint64 publishCount = overlay.publishCount();
+        overlay.publish(frameUsecs);
+        if (tick > lastArrival + Tx1TargetFilter::maxPredictUsecs + _displayFrameUsecs) {
+            result.publishAfterEndCount += overlay.publishCount() - publishCount;
+        }
+
+        if (tick > lastArrival) {
+            continue;
+        }
+
+        if (truth) {
+            Tx1TargetFilter::Box_t truthBox = _truthBox(frameUsecs - _videoLatencyUsecs);
+            result.filteredError += _centreDistance(drawn, truthBox);
+            result.rawError += _centreDistance(raw, truthBox);
+        }
+
+        double drawnX = (drawn.tlX + drawn.brX) / 2.0;
+        double rawX = (raw.tlX + raw.brX) / 2.0;
+        if (liveTickCount >= 2) {
+            result.filteredJitter += std::fabs(drawnX - (2 * drawnCentre[1]) + drawnCentre[0]);
+            result.rawJitter += std::fabs(rawX - (2 * rawCentre[1]) + rawCentre[0]);
+        }
+        drawnCentre[0] = drawnCentre[1];
+        drawnCentre[1] = drawnX;
+        rawCentre[0] = rawCentre[1];
+        rawCentre[1] = rawX;
+
+        liveTickCount++;
+    }
+
+    result.publishCount = overlay.publishCount();
+    if (truth) {
+        result.filteredError /= liveTickCount;
+        result.rawError /= liveTickCount;
+    }
+    result.filteredJitter /= qMax(1, liveTickCount - 2);
+    result.rawJitter /= qMax(1, liveTickCount - 2);
+
+    return result;
+}
+
+void Tx1TargetOverlayTest::_testReplay(void)
+{
+    // Replay with the latency the overlay ships with
+    QSettings().remove("Tx1TargetLatencyMsecs");
+    QCOMPARE(Tx1TargetOverlay().latencyUsecs(), Tx1TargetOverlay::defaultLatencyUsecs);
+
+    ReplayResult_t result = _replay(_syntheticStream(Tx1TargetOverlay::defaultLatencyUsecs), true);
+
+    // Updates come from the display clock: never more than one per display frame and none once the box stops
+    QVERIFY(result.publishCount <= (quint64)result.tickCount);
+    QCOMPARE(result.publishAfterEndCount, (quint64)0);
+
+    // The box is hidden once, when the track goes stale after the last status
+    QCOMPARE(result.clearCount, 1);
+
+    // Predicting over the latency and between statuses beats drawing each status as it arrives
+    QVERIFY(result.filteredError < result.rawError / 2);
+    QVERIFY(result.filteredJitter < result.rawJitter / 2);
+
+    // Links which are faster or slower than the default are still better than drawing the raw status
+    qint64 rgLatencyUsecs[] = { 40000, 110000 };
+    for (size_t i=0; i<sizeof(rgLatencyUsecs) / sizeof(rgLatencyUsecs[0]); i++) {
+        result = _replay(_syntheticStream(rgLatencyUsecs[i]), true);
+        QVERIFY(result.filteredError < result.rawError);
+        QVERIFY(result.filteredJitter < result.rawJitter);
+    }
+
+    QString replayFile = QString::fromLocal8Bit(qgetenv("QGC_TX1_REPLAY_FILE"));
+    if (!replayFile.isEmpty()) {
+        QList<Status_t> statuses = _loadStream(replayFile);
+        QVERIFY(statuses.count() > 0);
+        result = _replay(statuses, false);
+        QVERIFY(result.publishCount <= (quint64)result.tickCount);
+        QCOMPARE(result.publishAfterEndCount, (quint64)0);
+        QCOMPARE(result.clearCount, 1);
+    }
+}
+
+void Tx1TargetOverlayTest::_testStaleTrack(void)
+{
+    Tx1TargetOverlay overlay;
+    QSignalSpy spy(&overlay, SIGNAL(targetChanged(float, float, float, float, float, float)));
+    QSignalSpy clearedSpy(&overlay, SIGNAL(targetCleared()));
+    QVERIFY(spy.isValid());
+    QVERIFY(clearedSpy.isValid());
+
+    Tx1TargetFilter::Box_t box = { 100, 100, 200, 150 };
+    overlay.addStatus(box, 150, 125, 1000000);
+    box.tlX += 10;
+    box.brX += 10;
+    overlay.addStatus(box, 160, 125, 1100000);
+
+    // Moving right, prediction stops at maxPredictUsecs past the last status
+    Tx1TargetFilter::Box_t predicted;
+    QVERIFY(overlay.filter().predict(1100000 + Tx1TargetFilter::maxPredictUsecs, predicted));
+    Tx1TargetFilter::Box_t limit = predicted;
+    QVERIFY(overlay.filter().predict(1100000 + Tx1TargetFilter::maxPredictUsecs * 2, predicted));
+    QCOMPARE(predicted.tlX, limit.tlX);
+    QVERIFY(limit.tlX > 105);
+
+    // Out of order statuses are dropped
+    Tx1TargetFilter::Box_t old = { 0, 0, 10, 10 };
+    overlay.addStatus(old, 5, 5, 1050000);
+    QVERIFY(overlay.filter().predict(1100000 + Tx1TargetFilter::maxPredictUsecs, predicted));
+    QCOMPARE(predicted.tlX, limit.tlX);
+
+    // Target point values are passed through as they came in the status
+    overlay.publish(1100000);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.last()[4].toFloat(), 160.0f);
+    QCOMPARE(spy.last()[5].toFloat(), 125.0f);
+
+    // The box is hidden once the track is stale and nothing more is published
+    overlay.publish(1100000 + Tx1TargetFilter::staleUsecs + 1);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(clearedSpy.count(), 1);
+    overlay.publish(1100000 + Tx1TargetFilter::staleUsecs + 2);
+    QCOMPARE(clearedSpy.count(), 1);
+
+    // A status after the gap starts a new track without the old velocity
+    box = { 300, 300, 400, 350 };
+    qint64 restart = 1100000 + (Tx1TargetFilter::staleUsecs * 2);
+    overlay.addStatus(box, 350, 325, restart);
+    QVERIFY(overlay.filter().predict(restart + Tx1TargetFilter::maxPredictUsecs, predicted));
+    QCOMPARE(predicted.tlX, 300.0);
+    overlay.publish(restart);
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.last()[0].toFloat(), 300.0f);
+
+    // Stopping tracking hides the box, a second reset has nothing to hide
+    overlay.reset();
+    QCOMPARE(clearedSpy.count(), 2);
+    overlay.reset();
+    QCOMPARE(clearedSpy.count(), 2);
+}
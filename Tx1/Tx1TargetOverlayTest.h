@@ -0,0 +1,65 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef Tx1TargetOverlayTest_H
+#define Tx1TargetOverlayTest_H
+
+#include "UnitTest.h"
+#include "Tx1TargetOverlay.h"
+
+/// Replays Tx1 tracked target status streams through Tx1TargetOverlay on a simulated display clock
+///
+/// The replay uses the stream named by the QGC_TX1_REPLAY_FILE environment variable if it is set, lines of
+/// "arrival_usecs,tl_x,tl_y,br_x,br_y". Otherwise a stream is generated from a known target path with
+/// telemetry jitter and pixel noise, which also allows the overlay error to be measured against the video
+/// frame shown at each display refresh.
+class Tx1TargetOverlayTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    Tx1TargetOverlayTest(void);
+
+private slots:
+    void _testReplay(void);
+    void _testStaleTrack(void);
+
+private:
+    typedef struct {
+        qint64                  arrivalUsecs;
+        Tx1TargetFilter::Box_t  box;
+    } Status_t;
+
+    typedef struct {
+        int     tickCount;              ///< Display frames replayed
+        quint64 publishCount;
+        quint64 publishAfterEndCount;   ///< Published after the prediction limit past the last status
+        int     clearCount;
+        double  filteredError;          ///< Mean centre error in pixels, -1 if there is no truth
+        double  rawError;
+        double  filteredJitter;         ///< Mean second difference of the drawn centre in pixels per display frame
+        double  rawJitter;
+    } ReplayResult_t;
+
+    QList<Status_t> _syntheticStream    (qint64 meanLatencyUsecs);
+    QList<Status_t> _loadStream         (const QString& fileName);
+    ReplayResult_t  _replay             (const QList<Status_t>& statuses, bool truth);
+
+    static Tx1TargetFilter::Box_t _truthBox(qint64 usecs);
+    static double _centreDistance(const Tx1TargetFilter::Box_t& a, const Tx1TargetFilter::Box_t& b);
+
+    static qint64 _shownFrameUsecs(qint64 displayUsecs);
+
+    static const qint64 _displayFrameUsecs = 16667;     ///< 60Hz display
+    static const qint64 _videoFrameUsecs = 33333;       ///< 30Hz video
+    static const qint64 _videoLatencyUsecs = 120000;    ///< Camera to video sink
+};
+
+#endif
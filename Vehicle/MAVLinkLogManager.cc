@@ -104,17 +104,111 @@ MAVLinkLogFiles::setUploaded(bool uploaded)
     emit uploadedChanged();
 }
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+MAVLinkLogWriter::MAVLinkLogWriter()
+    : _quit(false)
+    , _error(false)
+    , _bytesWritten(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+MAVLinkLogWriter::~MAVLinkLogWriter()
+{
+    stopWorker();
+}
+
+//-----------------------------------------------------------------------------
+bool
+MAVLinkLogWriter::open(const QString& fileName)
+{
+    _file.setFileName(fileName);
+    if(!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    _quit = false;
+    start();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkLogWriter::write(QByteArray& batch)
+{
+    QMutexLocker locker(&_mutex);
+    _queue.append(batch);
+    if(_free.isEmpty()) {
+        batch = QByteArray();
+        batch.reserve(kBatchBytes);
+    } else {
+        batch = _free.takeLast();
+    }
+    _batchAvailable.wakeAll();
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkLogWriter::stopWorker()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _quit = true;
+        _batchAvailable.wakeAll();
+    }
+    wait();
+    if(_file.isOpen()) {
+        _file.close();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkLogWriter::run()
+{
+    forever {
+        QByteArray batch;
+        {
+            QMutexLocker locker(&_mutex);
+            //-- Queued batches are still written when quitting
+            while(!_quit && _queue.isEmpty()) {
+                _batchAvailable.wait(&_mutex);
+            }
+            if(_queue.isEmpty()) {
+                break;
+            }
+            batch = _queue.takeFirst();
+        }
+        if(!_error) {
+            if(_file.write(batch) != batch.size()) {
+                qCDebug(MAVLinkLogManagerLog) << "File IO error:" << batch.size() << "bytes into" << _file.fileName();
+                _error = true;
+            } else {
+                _bytesWritten += batch.size();
+            }
+        }
+        //-- Reserved capacity survives the resize, so the buffer can be filled again without allocating
+        batch.resize(0);
+        QMutexLocker locker(&_mutex);
+        _free.append(batch);
+    }
+    _file.flush();
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 MAVLinkLogProcessor::MAVLinkLogProcessor()
-    : _fd(NULL)
+    : _writer(NULL)
     , _written(0)
     , _sequence(-1)
     , _numDrops(0)
     , _gotHeader(false)
-    , _error(false)
+    , _dropoutPending(false)
+    , _lastTimestamp(0)
     , _record(NULL)
 {
+    _batch.reserve(MAVLinkLogWriter::kBatchBytes);
+    _batchTimer.start();
 }
 
 //-----------------------------------------------------------------------------
@@ -127,9 +221,11 @@ MAVLinkLogProcessor::~MAVLinkLogProcessor()
 void
 MAVLinkLogProcessor::close()
 {
-    if(_fd) {
-        fclose(_fd);
-        _fd = NULL;
+    if(_writer) {
+        _flushBatch();
+        _writer->stopWorker();
+        delete _writer;
+        _writer = NULL;
     }
 }
 
@@ -137,7 +233,7 @@ MAVLinkLogProcessor::close()
 bool
 MAVLinkLogProcessor::valid()
 {
-    return (_fd != NULL) && (_record != NULL);
+    return (_writer != NULL) && (_record != NULL);
 }
 
 //-----------------------------------------------------------------------------
@@ -149,13 +245,15 @@ MAVLinkLogProcessor::create(MAVLinkLogManager* manager, const QString path, uint
         id,
         QDateTime::currentDateTime().toString("yyyy-MM-dd-hh-mm-ss-zzz").toLatin1().data(),
         kUlogExtension);
-    _fd = fopen(_fileName.toLatin1().data(), "wb");
-    if(_fd) {
+    _writer = new MAVLinkLogWriter;
+    if(_writer->open(_fileName)) {
         _record = new MAVLinkLogFiles(manager, _fileName, true);
         _record->setWriting(true);
         _sequence = -1;
         return true;
     }
+    delete _writer;
+    _writer = NULL;
     return false;
 }
 
@@ -195,98 +293,125 @@ MAVLinkLogProcessor::_checkSequence(uint16_t seq, int& num_drops)
 
 //-----------------------------------------------------------------------------
 void
-MAVLinkLogProcessor::_writeData(void* data, int len)
+MAVLinkLogProcessor::_writeData(const void* data, int len)
 {
-    if(!_error) {
-        _error = fwrite(data, 1, len, _fd) != (size_t)len;
-        if(!_error) {
-            _written += len;
-            if(_record) {
-                _record->setSize(_written);
-            }
-        } else {
-            qCDebug(MAVLinkLogManagerLog) << "File IO error:" << len << "bytes into" << _fileName;
+    _batch.append((const char*)data, len);
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkLogProcessor::_flushBatch()
+{
+    if(_batch.size() && _writer) {
+        _written += _batch.size();
+        _writer->write(_batch);
+        if(_record) {
+            _record->setSize(_written);
         }
     }
+    _batchTimer.start();
 }
 
 //-----------------------------------------------------------------------------
-QByteArray
-MAVLinkLogProcessor::_writeUlogMessage(QByteArray& data)
+void
+MAVLinkLogProcessor::_writeUlogMessage(const uint8_t* message, int length)
 {
-    //-- Write ulog data w/o integrity checking, assuming data starts with a
-    //   valid ulog message. returns the remaining data at the end.
-    while(data.length() > 2) {
-        uint8_t* ptr = (uint8_t*)data.data();
-        int message_length = ptr[0] + (ptr[1] * 256) + 3; // 3 = ULog msg header
-        if(message_length > data.length())
-            break;
-        _writeData(data.data(), message_length);
-        data.remove(0, message_length);
-        return data;
+    //-- Data ('D') and logging ('L') messages carry a timestamp, which is what
+    //   tells us how long a dropout actually lasted.
+    const int kTimestampOffset = message[2] == 'D' ? 5 : 4;
+    if((message[2] == 'D' || message[2] == 'L') && length >= kTimestampOffset + 8) {
+        quint64 timestamp;
+        memcpy(&timestamp, message + kTimestampOffset, sizeof(timestamp));
+        if(_dropoutPending && _lastTimestamp != 0) {
+            quint64 durationMs = timestamp > _lastTimestamp ? (timestamp - _lastTimestamp) / 1000 : 0;
+            uint8_t dropout[] = {2, 0, 'O', 0, 0};
+            durationMs = qMin(durationMs, (quint64)0xffff);
+            dropout[3] = durationMs & 0xff;
+            dropout[4] = (durationMs >> 8) & 0xff;
+            _writeData(dropout, sizeof(dropout));
+        }
+        _dropoutPending = false;
+        _lastTimestamp = timestamp;
     }
-    return data;
+    _writeData(message, length);
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkLogProcessor::_completePending(const uint8_t* data, int length, uint8_t first_message)
+{
+    //-- A message is waiting for its remainder. If a new message starts in this
+    //   packet, everything before it belongs to the pending one and has to
+    //   complete it exactly, otherwise the stream is out of step.
+    if(first_message == 255) {
+        _pending.append((const char*)data, length);
+        return;
+    }
+    _pending.append((const char*)data, qMin((int)first_message, length));
+    const uint8_t* ptr = (const uint8_t*)_pending.constData();
+    if(_pending.size() >= 3 && ptr[0] + (ptr[1] * 256) + 3 == _pending.size()) {
+        _writeUlogMessage(ptr, _pending.size());
+    } else {
+        qCWarning(MAVLinkLogManagerLog) << "Discarding inconsistent log message of" << _pending.size() << "bytes";
+    }
+    _pending.resize(0);
 }
 
 //-----------------------------------------------------------------------------
 bool
-MAVLinkLogProcessor::processStreamData(uint16_t sequence, uint8_t first_message, QByteArray data)
+MAVLinkLogProcessor::processStreamData(uint16_t sequence, uint8_t first_message, const QByteArray& data)
 {
     int num_drops = 0;
-    _error = false;
-    while(_checkSequence(sequence, num_drops)) {
-        //-- The first 16 bytes need special treatment (this sounds awfully brittle)
-        if(!_gotHeader) {
-            if(data.size() < 16) {
-                //-- Shouldn't happen but if it does, we might as well close shop.
-                qCCritical(MAVLinkLogManagerLog) << "Corrupt log header. Canceling log download.";
-                return false;
-            }
-            //-- Write header
-            _writeData(data.data(), 16);
-            data.remove(0, 16);
-            _gotHeader = true;
-            // What about data start offset now that we removed 16 bytes off the start?
-        }
-        if(_gotHeader && num_drops > 0) {
-            if(num_drops > 25) num_drops = 25;
-            //-- Hocus Pocus
-            //   Write a dropout message. We don't really know the actual duration,
-            //   so just use the number of drops * 10 ms
-            uint8_t bogus[] = {2, 0, 79, 0, 0};
-            bogus[3] = num_drops * 10;
-            _writeData(bogus, sizeof(bogus));
+    if(!_checkSequence(sequence, num_drops)) {
+        //-- Duplicate or late packet
+        return !_writer->error();
+    }
+    const uint8_t* ptr = (const uint8_t*)data.constData();
+    int length = data.size();
+    int cursor = 0;
+    //-- The first 16 bytes are the file header, messages follow
+    if(!_gotHeader) {
+        if(length < 16) {
+            //-- Shouldn't happen but if it does, we might as well close shop.
+            qCCritical(MAVLinkLogManagerLog) << "Corrupt log header. Canceling log download.";
+            return false;
         }
-        if(num_drops > 0) {
-            _writeUlogMessage(_ulogMessage);
-            _ulogMessage.clear();
-            //-- If no usefull information in this message. Drop it.
-            if(first_message == 255) {
-                break;
-            }
-            if(first_message > 0) {
-                data.remove(0, first_message);
-                first_message = 0;
-            }
+        _writeData(ptr, 16);
+        cursor = 16;
+        _gotHeader = true;
+    }
+    if(num_drops > 0) {
+        //-- The message spanning the gap can't be completed
+        _pending.resize(0);
+        _dropoutPending = true;
+    }
+    if(_pending.size()) {
+        _completePending(ptr + cursor, length - cursor, first_message);
+        if(first_message == 255) {
+            return !_writer->error();
         }
-        if(first_message == 255 && _ulogMessage.length() > 0) {
-            _ulogMessage.append(data);
+    }
+    if(first_message == 255) {
+        //-- Middle of a message we don't have the start of
+        return !_writer->error();
+    }
+    cursor = qMax(cursor, (int)first_message);
+    //-- Complete messages are taken straight from the packet
+    while(cursor + 3 <= length) {
+        int message_length = ptr[cursor] + (ptr[cursor + 1] * 256) + 3; // 3 = ULog msg header
+        if(cursor + message_length > length) {
             break;
         }
-        if(_ulogMessage.length()) {
-            _writeData(_ulogMessage.data(), _ulogMessage.length());
-            if(first_message) {
-                _writeData(data.left(first_message).data(), first_message);
-            }
-            _ulogMessage.clear();
-        }
-        if(first_message) {
-            data.remove(0, first_message);
-        }
-        _ulogMessage = _writeUlogMessage(data);
-        break;
+        _writeUlogMessage(ptr + cursor, message_length);
+        cursor += message_length;
+    }
+    if(cursor < length) {
+        _pending.append((const char*)ptr + cursor, length - cursor);
+    }
+    if(_batch.size() >= MAVLinkLogWriter::kBatchBytes || (_batch.size() && _batchTimer.elapsed() > kTimeOutMilliseconds)) {
+        _flushBatch();
     }
-    return !_error;
+    return !_writer->error();
 }
 
 //-----------------------------------------------------------------------------
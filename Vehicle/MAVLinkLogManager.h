@@ -12,6 +12,13 @@
 #define MAVLinkLogManager_H
 
 #include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFile>
+#include <QElapsedTimer>
+
+#include <atomic>
 
 #include "QmlObjectListModel.h"
 #include "QGCLoggingCategory.h"
@@ -73,6 +80,47 @@ private:
 };
 
 //-----------------------------------------------------------------------------
+/// Writes batches of log data to disk on its own thread. Written buffers are
+/// recycled so a steady stream does not allocate.
+class MAVLinkLogWriter : public QThread
+{
+    Q_OBJECT
+public:
+    MAVLinkLogWriter    ();
+    ~MAVLinkLogWriter   ();
+    bool                open        (const QString& fileName);
+    /// Queues the batch for writing and hands back an empty buffer to fill next
+    void                write       (QByteArray& batch);
+    /// Writes whatever is still queued, then stops the thread and closes the file
+    void                stopWorker  ();
+    bool                error       () const { return _error.load(); }
+    quint64             bytesWritten() const { return _bytesWritten.load(); }
+
+    static const int    kBatchBytes = 16 * 1024;
+
+protected:
+    void                run         () final;
+
+private:
+    QFile               _file;
+    QMutex              _mutex;
+    QWaitCondition      _batchAvailable;
+    QList<QByteArray>   _queue;
+    QList<QByteArray>   _free;
+    bool                _quit;
+    std::atomic<bool>   _error;
+    std::atomic<quint64> _bytesWritten;
+};
+
+//-----------------------------------------------------------------------------
+/// Turns the LOGGING_DATA stream back into a ULog file.
+///
+/// Packets are parsed in place with a cursor, only a message split across
+/// packets is copied aside until its remainder arrives. Complete messages are
+/// collected in a batch which goes to the writer thread. After a gap in the
+/// stream the partial message is discarded, parsing resumes at the first
+/// message start in the packet and a dropout record is written whose duration
+/// comes from the timestamps on either side of the gap.
 class MAVLinkLogProcessor
 {
 public:
@@ -83,19 +131,25 @@ public:
     bool                create      (MAVLinkLogManager *manager, const QString path, uint8_t id);
     MAVLinkLogFiles*    record      () { return _record; }
     QString             fileName    () { return _fileName; }
-    bool                processStreamData(uint16_t _sequence, uint8_t first_message, QByteArray data);
+    bool                processStreamData(uint16_t _sequence, uint8_t first_message, const QByteArray& data);
+    int                 numDrops    () { return _numDrops; }
 private:
     bool                _checkSequence(uint16_t seq, int &num_drops);
-    QByteArray          _writeUlogMessage(QByteArray &data);
-    void                _writeData(void* data, int len);
+    void                _completePending(const uint8_t* data, int length, uint8_t first_message);
+    void                _writeUlogMessage(const uint8_t* message, int length);
+    void                _writeData(const void* data, int len);
+    void                _flushBatch ();
 private:
-    FILE*               _fd;
+    MAVLinkLogWriter*   _writer;
     quint32             _written;
     int                 _sequence;
     int                 _numDrops;
     bool                _gotHeader;
-    bool                _error;
-    QByteArray          _ulogMessage;
+    QByteArray          _pending;           ///< Start of a message continued in the next packet
+    QByteArray          _batch;             ///< Complete messages not handed to the writer yet
+    QElapsedTimer       _batchTimer;        ///< Age of the oldest data in the batch
+    bool                _dropoutPending;    ///< A gap was seen, the dropout record waits for the next timestamp
+    quint64             _lastTimestamp;     ///< Timestamp of the last data or logging message, 0 for none
     QString             _fileName;
     MAVLinkLogFiles*    _record;
 };
@@ -620,6 +620,9 @@ public:
     void setFirmwareVersion(int majorVersion, int minorVersion, int patchVersion, FIRMWARE_VERSION_TYPE versionType = FIRMWARE_VERSION_TYPE_OFFICIAL);
     static const int versionNotSetValue = -1;
 
+    /// @return MAV_PROTOCOL_CAPABILITY bits from AUTOPILOT_VERSION, 0 until it is received
+    uint64_t capabilityBits(void) const { return _capabilityBits; }
+
     bool soloFirmware(void) const { return _soloFirmware; }
     void setSoloFirmware(bool soloFirmware);
 
@@ -905,6 +908,7 @@ private:
     ///< but should allow to identify the commit using the main version number even for very large code bases.
     QString _flightCustomVersion;
     FIRMWARE_VERSION_TYPE _firmwareVersionType;
+    uint64_t            _capabilityBits;
 
     static const int    _lowBatteryAnnounceRepeatMSecs; // Amount of time in between each low battery announcement
     QElapsedTimer       _lowBatteryAnnounceTimer;
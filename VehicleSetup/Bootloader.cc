@@ -21,16 +21,34 @@
 #else
 #include <qserialportinfo.h>
 #endif
+#ifndef __android__
+#include <QSerialPort>
+#else
+#include "qserialport.h"
+#endif
 #include <QDebug>
 #include <QTime>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QSettings>
+
+#include <string.h>
 
 #include "QGC.h"
 #include "TEA.h"
 
+const int   Bootloader::_maxProgramWindow;
+const char* Bootloader::_programWindowKey = "BootloaderProgramWindow";
+
 Bootloader::Bootloader(QObject *parent) :
     QObject(parent)
+    , _programWindow(1)
+    , _eraseMsecs(0)
+    , _programMsecs(0)
+    , _verifyMsecs(0)
 {
-
+    QSettings settings;
+    setProgramWindow(settings.value(_programWindowKey, 1).toInt());
 }
 
 bool Bootloader::_write(QextSerialPort* port, const uint8_t* data, qint64 maxSize)
@@ -72,7 +90,7 @@ bool Bootloader::_read(QextSerialPort* port, uint8_t* data, qint64 maxSize, int
         }
         
         qint64 bytesRead;
-        bytesRead = port->read((char*)&data[bytesAlreadyRead], maxSize);
+        bytesRead = port->read((char*)&data[bytesAlreadyRead], maxSize - bytesAlreadyRead);
         
         if (bytesRead == -1) {
             _errorString = tr("Read failed: error: %1").arg(port->errorString());
@@ -164,8 +182,13 @@ Error:
 
 bool Bootloader::erase(QextSerialPort* port)
 {
+    QElapsedTimer timer;
+    timer.start();
+    
     // Erase is slow, need larger timeout
-    if (!_sendCommand(port, PROTO_CHIP_ERASE, _eraseTimeout)) {
+    bool ret = _sendCommand(port, PROTO_CHIP_ERASE, _eraseTimeout);
+    _eraseMsecs = timer.elapsed();
+    if (!ret) {
         _errorString = tr("Board erase failed: %1").arg(_errorString);
         return false;
     }
@@ -175,87 +198,94 @@ bool Bootloader::erase(QextSerialPort* port)
 
 bool Bootloader::program(QextSerialPort* port, const FirmwareImage* image)
 {
+    QElapsedTimer timer;
+    timer.start();
+    
+    bool ret;
     if (image->imageIsBinFormat()) {
-        return _binProgram(port, image);
+        ret = _binProgram(port, image);
     } else {
-        return _ihxProgram(port, image);
+        ret = _ihxProgram(port, image);
+    }
+    _programMsecs = timer.elapsed();
+    
+    return ret;
+}
+
+/// Calculates the CRCs the board is checked against after it is flashed. Both cover the entire flash size
+/// with the remainder after the image filled with 0xFF.
+void Bootloader::_calcImageCRCs(const QByteArray& image)
+{
+    uint32_t imageSize = (uint32_t)image.size();
+    
+    _imageDCRC = QGC::crc32((const uint8_t*)image.constData(), imageSize, 0);
+    
+    // Each full 8 byte block is decrypted, a trailing partial block is left as is
+    QByteArray decrypted(image);
+    uint8_t* decryptedBytes = (uint8_t*)decrypted.data();
+    for (uint32_t i = 0; i + 8 <= imageSize; i += 8) {
+        decrypt_qgc((uint32_t*)&decryptedBytes[i]);
+    }
+    _imageCRC = QGC::crc32(decryptedBytes, imageSize, 0);
+    
+    if (_boardFlashSize > imageSize) {
+        _imageCRC = QGC::crc32Fill(0xFF, _boardFlashSize - imageSize, _imageCRC);
+        _imageDCRC = QGC::crc32Fill(0xFF, _boardFlashSize - imageSize, _imageDCRC);
     }
 }
 
 bool Bootloader::_binProgram(QextSerialPort* port, const FirmwareImage* image)
 {
-    QFile firmwareFile(image->binFilename());
-    if (!firmwareFile.open(QIODevice::ReadOnly)) {
-        _errorString = tr("Unable to open firmware file %1: %2").arg(image->binFilename()).arg(firmwareFile.errorString());
+    // The image is already in memory, nothing here waits on the file
+    const QByteArray& binImage = image->binImage();
+    if (binImage.isEmpty()) {
+        _errorString = tr("Firmware image %1 is empty").arg(image->binFilename());
         return false;
     }
-    uint32_t imageSize = (uint32_t)firmwareFile.size();
+    _calcImageCRCs(binImage);
     
-    uint8_t imageBuf[PROG_MULTI_MAX];
+    const uint8_t* imageBytes = (const uint8_t*)binImage.constData();
+    uint32_t imageSize = (uint32_t)binImage.size();
     uint32_t bytesSent = 0;
-    _imageCRC = 0;
-    _imageDCRC = 0;
+    uint32_t bytesAcked = 0;
+    
+    // Start address of each PROTO_PROG_MULTI which has been sent but not yet responded to. The bootloader
+    // handles commands in order, so responses come back in the same order.
+    QQueue<uint32_t> pendingAddresses;
+    
+    uint8_t commandBuf[PROG_MULTI_MAX + 3];
     
     Q_ASSERT(PROG_MULTI_MAX <= 0x8F);
     
-    while (bytesSent < imageSize) {
-        int bytesToSend = imageSize - bytesSent;
-        if (bytesToSend > (int)sizeof(imageBuf)) {
-            bytesToSend = (int)sizeof(imageBuf);
-        }
-        
-        Q_ASSERT((bytesToSend % 4) == 0);
-        
-        int bytesRead = firmwareFile.read((char *)imageBuf, bytesToSend);
-        if (bytesRead == -1 || bytesRead != bytesToSend) {
-            _errorString = tr("Firmware file read failed: %1").arg(firmwareFile.errorString());
-            return false;
-        }
-        
-        Q_ASSERT(bytesToSend <= 0x8F);
-        
-        bool failed = true;
-        if (_write(port, PROTO_PROG_MULTI)) {
-            if (_write(port, (uint8_t)bytesToSend)) {
-                if (_write(port, imageBuf, bytesToSend)) {
-                    if (_write(port, PROTO_EOC)) {
-                        port->flush();
-                        if (_getCommandResponse(port)) {
-                            failed = false;
-                        }
-                    }
-                }
+    while (bytesAcked < imageSize) {
+        // Keep the window full so the bootloader always has the next chunk waiting while it writes flash
+        while (bytesSent < imageSize && pendingAddresses.count() < _programWindow) {
+            int bytesToSend = qMin(imageSize - bytesSent, (uint32_t)PROG_MULTI_MAX);
+            
+            Q_ASSERT((bytesToSend % 4) == 0);
+            
+            commandBuf[0] = PROTO_PROG_MULTI;
+            commandBuf[1] = (uint8_t)bytesToSend;
+            memcpy(&commandBuf[2], &imageBytes[bytesSent], bytesToSend);
+            commandBuf[bytesToSend + 2] = PROTO_EOC;
+            if (!_write(port, commandBuf, bytesToSend + 3)) {
+                _errorString = tr("Flash failed: %1 at address 0x%2").arg(_errorString).arg(bytesSent, 8, 16, QLatin1Char('0'));
+                return false;
             }
+            
+            pendingAddresses.enqueue(bytesSent);
+            bytesSent += bytesToSend;
         }
-        if (failed) {
-            _errorString = tr("Flash failed: %1 at address 0x%2").arg(_errorString).arg(bytesSent, 8, 16, QLatin1Char('0'));
-            return false;
-        }
-        
-        bytesSent += bytesToSend;
+        port->flush();
         
-        // Calculate the CRC now so we can test it after the board is flashed.
-        _imageDCRC = QGC::crc32((uint8_t *)imageBuf, bytesToSend, _imageDCRC);
-
-        int crcBytes = bytesToSend;
-        if(bytesToSend%8 != 0){
-            crcBytes = bytesToSend - bytesToSend%8;
-        }
-        for(int i = 0; i < crcBytes ; i += 8){
-             decrypt_qgc((uint32_t*)&imageBuf[i]);
+        uint32_t address = pendingAddresses.dequeue();
+        if (!_getCommandResponse(port)) {
+            _errorString = tr("Flash failed: %1 at address 0x%2").arg(_errorString).arg(address, 8, 16, QLatin1Char('0'));
+            return false;
         }
-        _imageCRC = QGC::crc32((uint8_t *)imageBuf, bytesToSend, _imageCRC);
         
-        emit updateProgress(bytesSent, imageSize);
-    }
-    firmwareFile.close();
-    
-    // We calculate the CRC using the entire flash size, filling the remainder with 0xFF.
-    while (bytesSent < _boardFlashSize) {
-        const uint8_t fill = 0xFF;
-        _imageCRC = QGC::crc32(&fill, 1, _imageCRC);
-        _imageDCRC = QGC::crc32(&fill, 1, _imageDCRC);
-        bytesSent++;
+        bytesAcked = pendingAddresses.isEmpty() ? bytesSent : pendingAddresses.head();
+        emit updateProgress(bytesAcked, imageSize);
     }
     
     return true;
@@ -338,6 +368,9 @@ bool Bootloader::_ihxProgram(QextSerialPort* port, const FirmwareImage* image)
 
 bool Bootloader::verify(QextSerialPort* port, const FirmwareImage* image)
 {
+    QElapsedTimer timer;
+    timer.start();
+    
     bool ret;
     
     if (!image->imageIsBinFormat() || _bootloaderVersion <= 2) {
@@ -345,6 +378,7 @@ bool Bootloader::verify(QextSerialPort* port, const FirmwareImage* image)
     } else {
         ret = _verifyCRC(port);
     }
+    _verifyMsecs = timer.elapsed();
     
     reboot(port);
     
@@ -365,18 +399,13 @@ bool Bootloader::_binVerifyBytes(QextSerialPort* port, const FirmwareImage* imag
 {
     Q_ASSERT(image->imageIsBinFormat());
     
-    QFile firmwareFile(image->binFilename());
-    if (!firmwareFile.open(QIODevice::ReadOnly)) {
-        _errorString = tr("Unable to open firmware file %1: %2").arg(image->binFilename()).arg(firmwareFile.errorString());
-        return false;
-    }
-    uint32_t imageSize = (uint32_t)firmwareFile.size();
+    const uint8_t* imageBytes = (const uint8_t*)image->binImage().constData();
+    uint32_t imageSize = (uint32_t)image->binImage().size();
     
     if (!_sendCommand(port, PROTO_CHIP_VERIFY)) {
         return false;
     }
     
-    uint8_t fileBuf[READ_MULTI_MAX];
     uint8_t readBuf[READ_MULTI_MAX];
     uint32_t bytesVerified = 0;
     
@@ -390,12 +419,6 @@ bool Bootloader::_binVerifyBytes(QextSerialPort* port, const FirmwareImage* imag
         
         Q_ASSERT((bytesToRead % 4) == 0);
         
-        int bytesRead = firmwareFile.read((char *)fileBuf, bytesToRead);
-        if (bytesRead == -1 || bytesRead != bytesToRead) {
-            _errorString = tr("Firmware file read failed: %1").arg(firmwareFile.errorString());
-            return false;
-        }
-        
         Q_ASSERT(bytesToRead <= 0x8F);
         
         bool failed = true;
@@ -414,6 +437,7 @@ bool Bootloader::_binVerifyBytes(QextSerialPort* port, const FirmwareImage* imag
             return false;
         }
 
+        const uint8_t* fileBuf = &imageBytes[bytesVerified];
         for (int i=0; i<bytesToRead; i++) {
             if (fileBuf[i] != readBuf[i]) {
                 _errorString = tr("Compare failed: expected(0x%1) actual(0x%2) at address: 0x%3").arg(fileBuf[i], 2, 16, QLatin1Char('0')).arg(readBuf[i], 2, 16, QLatin1Char('0')).arg(bytesVerified + i, 8, 16, QLatin1Char('0'));
@@ -426,8 +450,6 @@ bool Bootloader::_binVerifyBytes(QextSerialPort* port, const FirmwareImage* imag
         emit updateProgress(bytesVerified, imageSize);
     }
     
-    firmwareFile.close();
-    
     return true;
 }
 
@@ -639,3 +661,48 @@ bool Bootloader::reboot(QextSerialPort* port)
 {
     return _write(port, PROTO_BOOT) && _write(port, PROTO_EOC);
 }
+
+bool Bootloader::force3DRRadioBootloader(const QString& portName)
+{
+    QSerialPort port;
+    
+    port.setPortName(portName);
+    port.setBaudRate(QSerialPort::Baud57600);
+    
+    // Wait a little while for the USB port to initialize. 3DR Radio boot is really slow.
+    QGC::SLEEP::msleep(2000);
+    port.open(QIODevice::ReadWrite);
+    
+    if (!port.isOpen()) {
+        _errorString = tr("Unable to open port: %1 error: %2").arg(portName).arg(port.errorString());
+        return false;
+    }
+
+    // Put radio into command mode
+    QGC::SLEEP::msleep(2000);
+    port.write("+++", 3);
+    if (!port.waitForReadyRead(1500)) {
+        _errorString = tr("Unable to put radio into command mode");
+        return false;
+    }
+    QByteArray bytes = port.readAll();
+    if (!bytes.contains("OK")) {
+        qCDebug(FirmwareUpgradeLog) << bytes;
+        _errorString = tr("Unable to put radio into command mode");
+        return false;
+    }
+
+    port.write("AT&UPDATE\r\n");
+    if (!port.waitForBytesWritten(1500)) {
+        _errorString = tr("Unable to reboot radio (bytes written)");
+        return false;
+    }
+    if (!port.waitForReadyRead(1500)) {
+        _errorString = tr("Unable to reboot radio (ready read)");
+        return false;
+    }
+    port.close();
+    QGC::SLEEP::msleep(2000);
+
+    return true;
+}
@@ -60,6 +60,24 @@ public:
     /// @brief Sends a PROTO_REBOOT command to the bootloader
     bool reboot(QextSerialPort* port);
     
+    /// @brief Reboots a 3DR Radio running its normal firmware into its bootloader using "+++" followed by
+    ///         AT&UPDATE. The port must not be open. Blocks for several seconds while the radio restarts.
+    bool force3DRRadioBootloader(const QString& portName);
+    
+    /// @brief Sets the number of PROTO_PROG_MULTI commands which may be waiting for a response while
+    ///         programming a bin image. 1 waits for each response before sending the next chunk.
+    ///
+    /// The default is 1, or the BootloaderProgramWindow setting. The bootloader receive buffer is small and
+    /// bytes arriving while flash is written are lost, so larger windows are only for boards which have been
+    /// tested with them.
+    void setProgramWindow(int window) { _programWindow = qBound(1, window, _maxProgramWindow); }
+    int programWindow(void) const { return _programWindow; }
+    
+    /// @brief Msecs taken by the last erase, program and verify
+    qint64 eraseMsecs(void) const { return _eraseMsecs; }
+    qint64 programMsecs(void) const { return _programMsecs; }
+    qint64 verifyMsecs(void) const { return _verifyMsecs; }
+    
     // Supported bootloader board ids
     static const int boardIDPX4FMUV1 = 5;   ///< PX4 V1 board, as from USB PID
     static const int boardIDPX4FMUV2 = 9;   ///< PX4 V2 board, as from USB PID
@@ -77,6 +95,7 @@ signals:
     
 private:
     bool _binProgram(QextSerialPort* port, const FirmwareImage* image);
+    void _calcImageCRCs(const QByteArray& image);
     bool _ihxProgram(QextSerialPort* port, const FirmwareImage* image);
     
     bool _write(QextSerialPort* port, const uint8_t* data, qint64 maxSize);
@@ -136,6 +155,12 @@ private:
     
     QString _firmwareFilename;      ///< Currently selected firmware file to flash
     
+    int         _programWindow;     ///< Max PROTO_PROG_MULTI commands awaiting a response
+    
+    qint64  _eraseMsecs;
+    qint64  _programMsecs;
+    qint64  _verifyMsecs;
+    
     QString _errorString;           ///< Last error
     
     static const int _eraseTimeout = 20000;     ///< Msecs to wait for response from erase command
@@ -143,6 +168,8 @@ private:
     static const int _verifyTimeout = 5000;     ///< Msecs to wait for response to PROTO_GET_CRC command
     static const int _readTimout = 2000;        ///< Msecs to wait for read bytes to become available
     static const int _responseTimeout = 2000;   ///< Msecs to wait for command response bytes
+    static const int _maxProgramWindow = 8;     ///< PROTO_PROG_MULTI commands in flight, 536 bytes on the wire
+    static const char* _programWindowKey;
 };
 
 #endif // PX4FirmwareUpgrade_H
@@ -0,0 +1,237 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "BootloaderSimulator.h"
+#include "QGC.h"
+
+#include <QDebug>
+#include <QtEndian>
+
+#include <string.h>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+enum {
+    PROTO_INSYNC =      0x12,
+    PROTO_EOC =         0x20,
+    PROTO_OK =          0x10,
+    PROTO_FAILED =      0x11,
+    PROTO_INVALID =     0x13,
+    PROTO_GET_SYNC =    0x21,
+    PROTO_GET_DEVICE =  0x22,
+    PROTO_CHIP_ERASE =  0x23,
+    PROTO_CHIP_VERIFY = 0x24,
+    PROTO_PROG_MULTI =  0x27,
+    PROTO_READ_MULTI =  0x28,
+    PROTO_GET_CRC =     0x29,
+    PROTO_BOOT =        0x30,
+};
+
+BootloaderSimulator::BootloaderSimulator(uint32_t flashSize, uint32_t bootloaderRev, int latencyMsecs, uint32_t boardID)
+    : _flashSize(flashSize)
+    , _bootloaderRev(bootloaderRev)
+    , _latencyMsecs(latencyMsecs)
+    , _boardID(boardID)
+    , _failAddress(0xFFFFFFFF)
+    , _address(0)
+    , _booted(false)
+    , _maxInFlight(0)
+    , _master(-1)
+    , _slave(-1)
+    , _stop(false)
+{
+    _flash.fill((char)0xFF, flashSize);
+}
+
+BootloaderSimulator::~BootloaderSimulator()
+{
+    stop();
+#ifdef Q_OS_UNIX
+    if (_slave != -1) {
+        ::close(_slave);
+    }
+    if (_master != -1) {
+        ::close(_master);
+    }
+#endif
+}
+
+bool BootloaderSimulator::open(void)
+{
+#ifdef Q_OS_UNIX
+    _master = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if (_master == -1 || ::grantpt(_master) != 0 || ::unlockpt(_master) != 0) {
+        return false;
+    }
+    _portName = QString::fromLocal8Bit(::ptsname(_master));
+
+    // Held open so the master never sees a hangup while the port is closed and reopened
+    _slave = ::open(_portName.toLocal8Bit().constData(), O_RDWR | O_NOCTTY);
+    if (_slave == -1) {
+        return false;
+    }
+    struct termios tio;
+    ::tcgetattr(_slave, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(_slave, TCSANOW, &tio);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void BootloaderSimulator::stop(void)
+{
+    _stop = true;
+    wait();
+}
+
+void BootloaderSimulator::run(void)
+{
+#ifdef Q_OS_UNIX
+    _clock.start();
+    while (!_stop) {
+        while (!_responses.isEmpty() && _responses.first().first <= _clock.elapsed()) {
+            QByteArray response = _responses.takeFirst().second;
+            if (::write(_master, response.constData(), response.size()) != response.size()) {
+                qWarning() << "BootloaderSimulator write failed";
+            }
+        }
+
+        struct pollfd pfd = { _master, POLLIN, 0 };
+        if (::poll(&pfd, 1, _responses.isEmpty() ? 10 : 1) > 0 && (pfd.revents & POLLIN)) {
+            char buf[4096];
+            ssize_t cBytes = ::read(_master, buf, sizeof(buf));
+            if (cBytes > 0) {
+                _rx.append(buf, (int)cBytes);
+            }
+        }
+
+        int consumed;
+        while ((consumed = _processCommand()) > 0) {
+            _rx.remove(0, consumed);
+        }
+    }
+#endif
+}
+
+void BootloaderSimulator::_respond(const QByteArray& data, uint8_t status)
+{
+    QByteArray response(data);
+    response.append((char)PROTO_INSYNC);
+    response.append((char)status);
+    _responses.append(qMakePair(_clock.elapsed() + _latencyMsecs, response));
+    _maxInFlight = qMax(_maxInFlight, _responses.count());
+}
+
+QByteArray BootloaderSimulator::_word(uint32_t value)
+{
+    uint8_t bytes[4];
+    qToLittleEndian(value, bytes);
+    return QByteArray((const char*)bytes, sizeof(bytes));
+}
+
+/// Handles the command at the start of _rx
+///     @return Bytes consumed, 0 if the command is not complete yet
+int BootloaderSimulator::_processCommand(void)
+{
+    if (_rx.isEmpty()) {
+        return 0;
+    }
+
+    int length;
+    switch ((uint8_t)_rx[0]) {
+    case PROTO_GET_DEVICE:
+    case PROTO_READ_MULTI:
+        length = 3;
+        break;
+    case PROTO_PROG_MULTI:
+        length = _rx.count() < 2 ? 3 : (uint8_t)_rx[1] + 3;
+        break;
+    default:
+        length = 2;
+        break;
+    }
+    if (_rx.count() < length) {
+        return 0;
+    }
+    if ((uint8_t)_rx[length - 1] != PROTO_EOC) {
+        _respond(QByteArray(), PROTO_INVALID);
+        return 1;
+    }
+
+    switch ((uint8_t)_rx[0]) {
+    case PROTO_GET_SYNC:
+        _respond(QByteArray(), PROTO_OK);
+        break;
+    case PROTO_GET_DEVICE:
+        switch (_rx[1]) {
+        case 1:
+            _respond(_word(_bootloaderRev), PROTO_OK);
+            break;
+        case 2:
+            _respond(_word(_boardID), PROTO_OK);
+            break;
+        case 4:
+            _respond(_word(_flashSize), PROTO_OK);
+            break;
+        default:
+            _respond(QByteArray(), PROTO_INVALID);
+            break;
+        }
+        break;
+    case PROTO_CHIP_ERASE:
+        _flash.fill((char)0xFF);
+        _address = 0;
+        _respond(QByteArray(), PROTO_OK);
+        break;
+    case PROTO_PROG_MULTI:
+    {
+        uint32_t cBytes = (uint8_t)_rx[1];
+        if (_address + cBytes > _flashSize || (_failAddress >= _address && _failAddress < _address + cBytes)) {
+            _respond(QByteArray(), PROTO_FAILED);
+        } else {
+            memcpy(_flash.data() + _address, _rx.constData() + 2, cBytes);
+            _respond(QByteArray(), PROTO_OK);
+        }
+        _address += cBytes;
+        break;
+    }
+    case PROTO_GET_CRC:
+        _respond(_word(QGC::crc32((const quint8*)_flash.constData(), _flashSize, 0)), PROTO_OK);
+        break;
+    case PROTO_CHIP_VERIFY:
+        _address = 0;
+        _respond(QByteArray(), PROTO_OK);
+        break;
+    case PROTO_READ_MULTI:
+    {
+        uint32_t cBytes = (uint8_t)_rx[1];
+        _respond(_flash.mid(_address, cBytes), PROTO_OK);
+        _address += cBytes;
+        break;
+    }
+    case PROTO_BOOT:
+        _booted = true;
+        _respond(QByteArray(), PROTO_OK);
+        break;
+    default:
+        _respond(QByteArray(), PROTO_INVALID);
+        break;
+    }
+
+    return length;
+}
@@ -0,0 +1,77 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef BootloaderSimulator_H
+#define BootloaderSimulator_H
+
+#include <QThread>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+
+#include <atomic>
+#include <stdint.h>
+
+/// PX4 bootloader protocol on the master side of a pty, for unit tests. Bootloader talks to the slave
+/// side as if it were the board's serial port.
+///
+/// Responses are held back for a fixed latency the way a USB link does, while later commands are still
+/// processed, so commands sent without waiting for a response overlap on the link.
+class BootloaderSimulator : public QThread
+{
+public:
+    BootloaderSimulator(uint32_t flashSize, uint32_t bootloaderRev, int latencyMsecs, uint32_t boardID = 9);
+    ~BootloaderSimulator();
+
+    /// Creates the pty
+    ///     @return false: this platform has no ptys
+    bool open(void);
+
+    /// Stops the simulator thread
+    void stop(void);
+
+    /// PROTO_PROG_MULTI for a chunk containing this address fails
+    void setFailAddress(uint32_t address) { _failAddress = address; }
+
+    const QString&      portName    (void) const { return _portName; }
+    const QByteArray&   flash       (void) const { return _flash; }
+    bool                booted      (void) const { return _booted; }
+
+    /// Most responses which were waiting on the link at once, which is how many commands were in flight
+    int                 maxInFlight (void) const { return _maxInFlight; }
+
+protected:
+    void run(void) final;
+
+private:
+    void                _respond        (const QByteArray& data, uint8_t status);
+    int                 _processCommand (void);
+    static QByteArray   _word           (uint32_t value);
+
+    uint32_t            _flashSize;
+    uint32_t            _bootloaderRev;
+    int                 _latencyMsecs;
+    uint32_t            _boardID;
+    uint32_t            _failAddress;
+    uint32_t            _address;
+    QByteArray          _flash;
+    bool                _booted;
+    int                 _maxInFlight;
+    QString             _portName;
+    int                 _master;
+    int                 _slave;
+    std::atomic<bool>   _stop;
+    QByteArray          _rx;
+    QElapsedTimer       _clock;
+    QList<QPair<qint64, QByteArray> > _responses;   ///< Due time and bytes of responses on the link
+};
+
+#endif
@@ -0,0 +1,173 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "BootloaderTest.h"
+#include "Bootloader.h"
+#include "FirmwareImage.h"
+#include "BootloaderSimulator.h"
+#include "QGC.h"
+
+#include <QFile>
+#include <QSettings>
+
+BootloaderTest::BootloaderTest(void)
+{
+
+}
+
+/// Byte at a time CRC which QGC::crc32 must match
+static quint32 _referenceCrc32(const quint8* src, unsigned len, quint32 state)
+{
+    for (unsigned i = 0; i < len; i++) {
+        quint32 c = (state ^ src[i]) & 0xff;
+        for (int bit = 0; bit < 8; bit++) {
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+        state = c ^ (state >> 8);
+    }
+    return state;
+}
+
+QString BootloaderTest::_writeImage(int size)
+{
+    _image.resize(size);
+    for (int i = 0; i < size; i++) {
+        _image[i] = (char)(qrand() & 0xFF);
+    }
+
+    QString path = _dir.path() + "/image.bin";
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(_image);
+    }
+    return path;
+}
+
+/// Runs the same sequence as PX4FirmwareUpgradeThreadWorker: sync, board info, erase, program, verify
+bool BootloaderTest::_flash(BootloaderSimulator& simulator, Bootloader& bootloader, const QString& imageFile)
+{
+    QextSerialPort port(QextSerialPort::Polling);
+    if (!bootloader.open(&port, simulator.portName()) || !bootloader.sync(&port)) {
+        return false;
+    }
+
+    uint32_t bootloaderVersion, boardID, flashSize;
+    if (!bootloader.getPX4BoardInfo(&port, bootloaderVersion, boardID, flashSize)) {
+        return false;
+    }
+
+    FirmwareImage image;
+    if (!image.load(imageFile, boardID)) {
+        return false;
+    }
+
+    return bootloader.erase(&port) && bootloader.program(&port, &image) && bootloader.verify(&port, &image);
+}
+
+void BootloaderTest::_testCrc(void)
+{
+    QByteArray bytes(4096, 0);
+    for (int i = 0; i < bytes.count(); i++) {
+        bytes[i] = (char)(qrand() & 0xFF);
+    }
+    const quint8* data = (const quint8*)bytes.constData();
+
+    // Every tail length and alignment of the slice-by-8 loop
+    for (int offset = 0; offset < 8; offset++) {
+        for (unsigned len = 0; len < 300; len++) {
+            QCOMPARE(QGC::crc32(data + offset, len, 0x12345678), _referenceCrc32(data + offset, len, 0x12345678));
+        }
+    }
+    QCOMPARE(QGC::crc32(data, bytes.count(), 0), _referenceCrc32(data, bytes.count(), 0));
+
+    quint32 fillCounts[] = { 0, 1, 7, 8, 1000, 100003 };
+    for (size_t i = 0; i < sizeof(fillCounts) / sizeof(fillCounts[0]); i++) {
+        quint32 expected = 0xDEADBEEF;
+        const quint8 fill = 0xFF;
+        for (quint32 j = 0; j < fillCounts[i]; j++) {
+            expected = _referenceCrc32(&fill, 1, expected);
+        }
+        QCOMPARE(QGC::crc32Fill(0xFF, fillCounts[i], 0xDEADBEEF), expected);
+    }
+}
+
+void BootloaderTest::_testFlash(void)
+{
+    QString imageFile = _writeImage(256 * 1024);
+
+    // Without the setting each chunk waits for its response, the bootloader can't buffer more
+    QSettings().remove("BootloaderProgramWindow");
+
+    // Revision 5 verifies with PROTO_GET_CRC, revision 2 reads the flash back
+    uint32_t revisions[] = { 5, 2 };
+    for (size_t i = 0; i < sizeof(revisions) / sizeof(revisions[0]); i++) {
+        BootloaderSimulator simulator(_flashSize, revisions[i], 0);
+        if (!simulator.open()) {
+            QSKIP("No pty support");
+        }
+        simulator.start();
+
+        Bootloader bootloader;
+        QCOMPARE(bootloader.programWindow(), 1);
+        bool success = _flash(simulator, bootloader, imageFile);
+        simulator.stop();
+
+        QVERIFY2(success, qPrintable(bootloader.errorString()));
+        QVERIFY(simulator.booted());
+        QCOMPARE(simulator.flash().left(_image.count()), _image);
+        QCOMPARE(simulator.flash().mid(_image.count()), QByteArray(_flashSize - _image.count(), (char)0xFF));
+    }
+}
+
+void BootloaderTest::_testProgramFailure(void)
+{
+    QString imageFile = _writeImage(64 * 1024);
+
+    BootloaderSimulator simulator(_flashSize, 5, 1);
+    if (!simulator.open()) {
+        QSKIP("No pty support");
+    }
+    simulator.setFailAddress(0x8040);
+    simulator.start();
+
+    Bootloader bootloader;
+    bootloader.setProgramWindow(8);
+    bool success = _flash(simulator, bootloader, imageFile);
+    simulator.stop();
+
+    // The failure is reported against the chunk which failed, not the last one sent
+    QVERIFY(!success);
+    QVERIFY2(bootloader.errorString().contains("Flash failed"), qPrintable(bootloader.errorString()));
+    QVERIFY2(bootloader.errorString().contains("0x00008040"), qPrintable(bootloader.errorString()));
+    QVERIFY(!simulator.booted());
+}
+
+void BootloaderTest::_benchmarkFlash(void)
+{
+    QString imageFile = _writeImage(256 * 1024);
+
+    int windows[] = { 1, 8 };
+    for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+        BootloaderSimulator simulator(_flashSize, 5, 1);
+        if (!simulator.open()) {
+            QSKIP("No pty support");
+        }
+        simulator.start();
+
+        Bootloader bootloader;
+        bootloader.setProgramWindow(windows[i]);
+        bool success = _flash(simulator, bootloader, imageFile);
+        simulator.stop();
+
+        QVERIFY2(success, qPrintable(bootloader.errorString()));
+        QVERIFY(simulator.maxInFlight() <= windows[i]);
+        QVERIFY(windows[i] == 1 || simulator.maxInFlight() > 1);
+    }
+}
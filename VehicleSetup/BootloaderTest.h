@@ -0,0 +1,48 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef BootloaderTest_H
+#define BootloaderTest_H
+
+#include "UnitTest.h"
+
+#include <QTemporaryDir>
+
+class Bootloader;
+class BootloaderSimulator;
+
+/// Flashes images through Bootloader into a simulated PX4 bootloader on the other end of a pty.
+///
+/// The simulator holds responses back for a fixed latency, the way a USB link does, so the benchmark
+/// shows the effect of keeping several PROTO_PROG_MULTI commands in flight.
+class BootloaderTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    BootloaderTest(void);
+
+private slots:
+    void _testCrc(void);
+    void _testFlash(void);
+    void _testProgramFailure(void);
+    void _benchmarkFlash(void);
+
+private:
+    QString     _writeImage (int size);
+    bool        _flash      (BootloaderSimulator& simulator, Bootloader& bootloader, const QString& imageFile);
+
+    QTemporaryDir   _dir;
+    QByteArray      _image;     ///< Contents of the last image written
+
+    static const uint32_t _flashSize = 1024 * 1024;
+};
+
+#endif
@@ -28,6 +28,10 @@
 #include <QSettings>
 #include <QFileInfo>
 #include <QDir>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 
 const char* FirmwareImage::_jsonBoardIdKey =            "board_id";
 const char* FirmwareImage::_jsonParamXmlSizeKey =       "parameter_xml_size";
@@ -38,17 +42,92 @@ const char* FirmwareImage::_jsonImageSizeKey =          "image_size";
 const char* FirmwareImage::_jsonImageKey =              "image";
 const char* FirmwareImage::_jsonMavAutopilotKey =       "mav_autopilot";
 
+/// Decoded images keyed by the SHA-1 of the file contents, least recently used first in lru
+struct FirmwareImage::Cache_t {
+    QMutex                                  mutex;
+    QHash<QByteArray, DecodedImage_t>       images;
+    QList<QByteArray>                       lru;
+    qint64                                  bytes;
+    QByteArray                              metaDataHash;   ///< File whose meta data was saved last
+    
+    Cache_t(void) : bytes(0) { }
+    
+    static qint64 imageBytes(const DecodedImage_t& decoded)
+    {
+        qint64 total = decoded.image.count() + decoded.parameterXml.count() + decoded.airframeXml.count();
+        foreach (const IntelHexBlock_t& block, decoded.ihxBlocks) {
+            total += block.bytes.count();
+        }
+        return total;
+    }
+};
+
 FirmwareImage::FirmwareImage(QObject* parent) :
     QObject(parent),
-    _imageSize(0)
+    _imageSize(0),
+    _loadedFromCache(false)
+{
+    
+}
+
+FirmwareImage::Cache_t& FirmwareImage::_cache(void)
+{
+    static Cache_t cache;
+    return cache;
+}
+
+void FirmwareImage::clearCache(void)
+{
+    Cache_t& cache = _cache();
+    QMutexLocker lock(&cache.mutex);
+    cache.images.clear();
+    cache.lru.clear();
+    cache.bytes = 0;
+    cache.metaDataHash.clear();
+}
+
+bool FirmwareImage::_cacheLookup(const QByteArray& hash, DecodedImage_t& decoded)
+{
+    Cache_t& cache = _cache();
+    QMutexLocker lock(&cache.mutex);
+    
+    QHash<QByteArray, DecodedImage_t>::const_iterator iter = cache.images.constFind(hash);
+    if (iter == cache.images.constEnd()) {
+        return false;
+    }
+    decoded = iter.value();
+    cache.lru.removeOne(hash);
+    cache.lru.append(hash);
+    
+    return true;
+}
+
+void FirmwareImage::_cacheInsert(const QByteArray& hash, const DecodedImage_t& decoded)
 {
+    Cache_t& cache = _cache();
+    QMutexLocker lock(&cache.mutex);
     
+    if (cache.images.contains(hash)) {
+        return;
+    }
+    cache.images[hash] = decoded;
+    cache.lru.append(hash);
+    cache.bytes += Cache_t::imageBytes(decoded);
+    
+    // Always keep the newest image, even if it alone is over the limit
+    while (cache.bytes > _cacheMaxBytes && cache.lru.count() > 1) {
+        QByteArray oldest = cache.lru.takeFirst();
+        cache.bytes -= Cache_t::imageBytes(cache.images.take(oldest));
+    }
 }
 
 bool FirmwareImage::load(const QString& imageFilename, uint32_t boardId)
 {
     _imageSize = 0;
     _boardId = boardId;
+    _binImage.clear();
+    _ihxBlocks.clear();
+    _loadedFromCache = false;
     
     if (imageFilename.endsWith(".bin") || imageFilename.endsWith(".txt")) {
         _binFormat = true;
@@ -66,131 +145,134 @@ bool FirmwareImage::load(const QString& imageFilename, uint32_t boardId)
     }
 }
 
-bool FirmwareImage::_readByteFromStream(QTextStream& stream, uint8_t& byte)
+bool FirmwareImage::_ihxLoad(const QString& ihxFilename)
 {
-    QString hex = stream.read(2);
+    _imageSize = 0;
+    _ihxBlocks.clear();
     
-    if (hex.count() != 2) {
+    QFile ihxFile(ihxFilename);
+    if (!ihxFile.open(QIODevice::ReadOnly)) {
+        emit statusMessage(QString(tr("Unable to open firmware file %1, error: %2")).arg(ihxFilename).arg(ihxFile.errorString()));
         return false;
     }
+    QByteArray bytes = ihxFile.readAll();
+    ihxFile.close();
     
-    bool success;
-    byte = (uint8_t)hex.toInt(&success, 16);
-    
-    return success;
-}
-
-bool FirmwareImage::_readWordFromStream(QTextStream& stream, uint16_t& word)
-{
-    QString hex = stream.read(4);
-    
-    if (hex.count() != 4) {
-        return false;
+    QByteArray hash = QCryptographicHash::hash(bytes, QCryptographicHash::Sha1);
+    DecodedImage_t decoded;
+    _loadedFromCache = _cacheLookup(hash, decoded);
+    if (!_loadedFromCache) {
+        if (!_ihxDecode(bytes, decoded)) {
+            return false;
+        }
+        _cacheInsert(hash, decoded);
     }
     
-    bool success;
-    word = (uint16_t)hex.toInt(&success, 16);
+    _ihxBlocks = decoded.ihxBlocks;
+    _imageSize = decoded.imageSize;
     
-    return success;
+    return true;
 }
 
-bool FirmwareImage::_readBytesFromStream(QTextStream& stream, uint8_t byteCount, QByteArray& bytes)
+/// @return Value of a hex digit, -1 if it isn't one
+static inline int _hexDigit(char c)
 {
-    bytes.clear();
-    
-    while (byteCount) {
-        uint8_t byte;
-        
-        if (!_readByteFromStream(stream, byte)) {
-            return false;
-        }
-        bytes += byte;
-        
-        byteCount--;
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
     }
-    
-    return true;
+    return -1;
 }
 
-bool FirmwareImage::_ihxLoad(const QString& ihxFilename)
+/// Decodes Intel Hex records straight from the file bytes, a line at a time
+bool FirmwareImage::_ihxDecode(const QByteArray& bytes, DecodedImage_t& decoded)
 {
-    _imageSize = 0;
-    _ihxBlocks.clear();
+    const char* data = bytes.constData();
+    const int   size = bytes.count();
+    int         pos = 0;
+    int         lineNumber = 0;
+    uint8_t     record[255 + 5];    // count, address, type, data, checksum
     
-    QFile ihxFile(ihxFilename);
-    if (!ihxFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        emit statusMessage(QString(tr("Unable to open firmware file %1, error: %2")).arg(ihxFilename).arg(ihxFile.errorString()));
-        return false;
-    }
-    
-    QTextStream stream(&ihxFile);
+    decoded.imageSize = 0;
+    decoded.ihxBlocks.clear();
     
     while (true) {
-        if (stream.read(1) != ":") {
+        while (pos < size && (data[pos] == '\r' || data[pos] == '\n')) {
+            pos++;
+        }
+        lineNumber++;
+        
+        if (pos >= size || data[pos] != ':') {
             emit statusMessage(tr("Incorrectly formatted .ihx file, line does not begin with :"));
             return false;
         }
+        pos++;
         
-        uint8_t     blockByteCount;
-        uint16_t    address;
-        uint8_t     recordType;
-        QByteArray  bytes;
-        uint8_t     crc;
+        int cRecordBytes = 0;
+        while (pos < size && data[pos] != '\r' && data[pos] != '\n' && data[pos] != ' ' && data[pos] != '\t') {
+            int high = _hexDigit(data[pos]);
+            int low = pos + 1 < size ? _hexDigit(data[pos + 1]) : -1;
+            if (high == -1 || low == -1 || cRecordBytes == (int)sizeof(record)) {
+                emit statusMessage(tr("Incorrectly formatted line %1 in .ihx file").arg(lineNumber));
+                return false;
+            }
+            record[cRecordBytes++] = (uint8_t)((high << 4) | low);
+            pos += 2;
+        }
+        while (pos < size && data[pos] != '\n') {
+            pos++;
+        }
         
-        if (!_readByteFromStream(stream, blockByteCount) ||
-            !_readWordFromStream(stream, address) ||
-            !_readByteFromStream(stream, recordType) ||
-            !_readBytesFromStream(stream, blockByteCount, bytes) ||
-            !_readByteFromStream(stream, crc)) {
+        if (cRecordBytes < 5 || cRecordBytes < record[0] + 5) {
             emit statusMessage(tr("Incorrectly formatted line in .ihx file, line too short"));
             return false;
         }
         
+        uint8_t checksum = 0;
+        for (int i = 0; i < record[0] + 5; i++) {
+            checksum += record[i];
+        }
+        if (checksum != 0) {
+            emit statusMessage(tr("Checksum mismatch on line %1 in .ihx file").arg(lineNumber));
+            return false;
+        }
+        
+        uint8_t     blockByteCount = record[0];
+        uint16_t    address = (record[1] << 8) | record[2];
+        uint8_t     recordType = record[3];
+        
         if (!(recordType == 0 || recordType == 1)) {
             emit statusMessage(QString(tr("Unsupported record type in file: %1")).arg(recordType));
             return false;
         }
         
         if (recordType == 0) {
-            bool appendToLastBlock = false;
+            QList<IntelHexBlock_t>& blocks = decoded.ihxBlocks;
             
             // Can we append this block to the last one?
-            
-            if (_ihxBlocks.count()) {
-                int lastBlockIndex = _ihxBlocks.count() - 1;
-                
-                if (_ihxBlocks[lastBlockIndex].address + _ihxBlocks[lastBlockIndex].bytes.count() == address) {
-                    appendToLastBlock = true;
-                }
-            }
-            
-            if (appendToLastBlock) {
-                _ihxBlocks[_ihxBlocks.count() - 1].bytes += bytes;
-                // Too noisy even for verbose
-                //qCDebug(FirmwareUpgradeVerboseLog) << QString("_ihxLoad - append - address:%1 size:%2 block:%3").arg(address).arg(blockByteCount).arg(ihxBlockCount());
+            if (blocks.count() && blocks.last().address + blocks.last().bytes.count() == address) {
+                blocks.last().bytes.append((const char*)&record[4], blockByteCount);
             } else {
                 IntelHexBlock_t block;
                 
                 block.address = address;
-                block.bytes = bytes;
+                block.bytes = QByteArray((const char*)&record[4], blockByteCount);
                 
-                _ihxBlocks += block;
-                qCDebug(FirmwareUpgradeVerboseLog) << QString("_ihxLoad - new block - address:%1 size:%2 block:%3").arg(address).arg(blockByteCount).arg(ihxBlockCount());
+                blocks += block;
+                qCDebug(FirmwareUpgradeVerboseLog) << QString("_ihxLoad - new block - address:%1 size:%2 block:%3").arg(address).arg(blockByteCount).arg(blocks.count());
             }
             
-            _imageSize += blockByteCount;
-        } else if (recordType == 1) {
+            decoded.imageSize += blockByteCount;
+        } else {
             // EOF
             qCDebug(FirmwareUpgradeLog) << QString("_ihxLoad - EOF");
             break;
         }
-        
-        // Move to next line
-        stream.readLine();
     }
     
-    ihxFile.close();
-    
     return true;
 }
 
@@ -208,6 +290,57 @@ bool FirmwareImage::_px4Load(const QString& imageFilename)
     
     QByteArray bytes = px4File.readAll();
     px4File.close();
+    
+    QByteArray hash = QCryptographicHash::hash(bytes, QCryptographicHash::Sha1);
+    DecodedImage_t decoded;
+    _loadedFromCache = _cacheLookup(hash, decoded);
+    if (_loadedFromCache) {
+        qCDebug(FirmwareUpgradeLog) << "Using cached decode of" << imageFilename;
+    } else {
+        if (!_px4Decode(bytes, decoded)) {
+            return false;
+        }
+        _cacheInsert(hash, decoded);
+    }
+    
+    if (decoded.firmwareBoardId != _boardId) {
+        emit statusMessage(QString(tr("Downloaded firmware board id does not match hardware board id: %1 != %2")).arg(decoded.firmwareBoardId).arg(_boardId));
+        return false;
+    }
+    emit statusMessage(QString("MAV_AUTOPILOT = %1").arg(decoded.mavAutopilot));
+    
+    _px4SaveMetaData(hash, decoded);
+    
+    _imageSize = decoded.imageSize;
+    _binImage = decoded.image;
+    
+    // Store decompressed image file in same location as original download file unless told otherwise
+    QString decompressFilename = _decompressFilename;
+    if (decompressFilename.isEmpty()) {
+        decompressFilename = QFileInfo(imageFilename).dir().filePath("PX4FlashUpgrade.bin");
+    }
+    
+    QFile decompressFile(decompressFilename);
+    if (!decompressFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        emit statusMessage(QString(tr("Unable to open decompressed file %1 for writing, error: %2")).arg(decompressFilename).arg(decompressFile.errorString()));
+        return false;
+    }
+    
+    qint64 bytesWritten = decompressFile.write(_binImage);
+    if (bytesWritten != _binImage.count()) {
+        emit statusMessage(QString(tr("Write failed for decompressed image file, error: %1")).arg(decompressFile.errorString()));
+        return false;
+    }
+    decompressFile.close();
+    
+    _binFilename = decompressFilename;
+    
+    return true;
+}
+
+/// Parses the .px4 json and decompresses the image and meta data it holds
+bool FirmwareImage::_px4Decode(const QByteArray& bytes, DecodedImage_t& decoded)
+{
     QJsonDocument doc = QJsonDocument::fromJson(bytes);
     
     if (doc.isNull()) {
@@ -236,24 +369,43 @@ bool FirmwareImage::_px4Load(const QString& imageFilename)
         return false;
     }
 
-    uint32_t firmwareBoardId = (uint32_t)px4Json.value(_jsonBoardIdKey).toInt();
-    if (firmwareBoardId != _boardId) {
-        emit statusMessage(QString(tr("Downloaded firmware board id does not match hardware board id: %1 != %2")).arg(firmwareBoardId).arg(_boardId));
+    decoded.firmwareBoardId = (uint32_t)px4Json.value(_jsonBoardIdKey).toInt();
+    decoded.mavAutopilot = px4Json[_jsonMavAutopilotKey].toInt(MAV_AUTOPILOT_PX4);
+    
+    // Meta data is optional
+    if (!_decompressJsonValue(px4Json, bytes, _jsonParamXmlSizeKey, _jsonParamXmlKey, decoded.parameterXml)) {
+        decoded.parameterXml.clear();
+    }
+    if (!_decompressJsonValue(px4Json, bytes, _jsonAirframeXmlSizeKey, _jsonAirframeXmlKey, decoded.airframeXml)) {
+        decoded.airframeXml.clear();
+    }
+    
+    decoded.imageSize = px4Json.value(QString("image_size")).toInt();
+    if (!_decompressJsonValue(px4Json, bytes, _jsonImageSizeKey, _jsonImageKey, decoded.image)) {
         return false;
     }
+    
+    // Pad image to 4-byte boundary
+    while ((decoded.image.count() % 4) != 0) {
+        decoded.image.append(static_cast<char>(static_cast<unsigned char>(0xFF)));
+    }
+    
+    return true;
+}
 
-    // What firmware type is this?
-    MAV_AUTOPILOT firmwareType = (MAV_AUTOPILOT)px4Json[_jsonMavAutopilotKey].toInt(MAV_AUTOPILOT_PX4);
-    emit statusMessage(QString("MAV_AUTOPILOT = %1").arg(firmwareType));
-    
-    // Decompress the parameter xml and save to file
-    QByteArray decompressedBytes;
-    bool success = _decompressJsonValue(px4Json,               // JSON object
-                                        bytes,                 // Raw bytes of JSON document
-                                        _jsonParamXmlSizeKey,  // key which holds byte size
-                                        _jsonParamXmlKey,      // key which holds compressed bytes
-                                        decompressedBytes);    // Returned decompressed bytes
-    if (success) {
+/// Writes the parameter and airframe meta data next to the settings file. Skipped when the meta data
+/// there already came from this same file. The files are shared by every image, so the cache lock is
+/// held while they are written.
+void FirmwareImage::_px4SaveMetaData(const QByteArray& hash, const DecodedImage_t& decoded)
+{
+    Cache_t& cache = _cache();
+    QMutexLocker lock(&cache.mutex);
+    if (cache.metaDataHash == hash) {
+        return;
+    }
+    cache.metaDataHash = hash;
+    
+    if (!decoded.parameterXml.isEmpty()) {
         // Use settings location as our work directory, this way is something goes wrong the file is still there
         // sitting next to the cache files.
         QSettings settings;
@@ -262,8 +414,8 @@ bool FirmwareImage::_px4Load(const QString& imageFilename)
         QFile parameterFile(parameterFilename);
 
         if (parameterFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-            qint64 bytesWritten = parameterFile.write(decompressedBytes);
-            if (bytesWritten != decompressedBytes.count()) {
+            qint64 bytesWritten = parameterFile.write(decoded.parameterXml);
+            if (bytesWritten != decoded.parameterXml.count()) {
                 emit statusMessage(QString(tr("Write failed for parameter meta data file, error: %1")).arg(parameterFile.errorString()));
                 parameterFile.close();
                 QFile::remove(parameterFilename);
@@ -275,26 +427,19 @@ bool FirmwareImage::_px4Load(const QString& imageFilename)
         }
 
         // Cache this file with the system
-        ParameterManager::cacheMetaDataFile(parameterFilename, firmwareType);
+        ParameterManager::cacheMetaDataFile(parameterFilename, (MAV_AUTOPILOT)decoded.mavAutopilot);
     }
 
-    // Decompress the airframe xml and save to file
-    success = _decompressJsonValue(px4Json,                         // JSON object
-                                        bytes,                      // Raw bytes of JSON document
-                                        _jsonAirframeXmlSizeKey,    // key which holds byte size
-                                        _jsonAirframeXmlKey,        // key which holds compressed bytes
-                                        decompressedBytes);         // Returned decompressed bytes
-    if (success) {
+    if (!decoded.airframeXml.isEmpty()) {
         // We cache the airframe xml in the same location as settings and parameters
         QSettings settings;
         QDir airframeDir = QFileInfo(settings.fileName()).dir();
         QString airframeFilename = airframeDir.filePath("PX4AirframeFactMetaData.xml");
-        //qDebug() << airframeFilename;
         QFile airframeFile(airframeFilename);
 
         if (airframeFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-            qint64 bytesWritten = airframeFile.write(decompressedBytes);
-            if (bytesWritten != decompressedBytes.count()) {
+            qint64 bytesWritten = airframeFile.write(decoded.airframeXml);
+            if (bytesWritten != decoded.airframeXml.count()) {
                 // FIXME: What about these warnings?
                 emit statusMessage(QString(tr("Write failed for airframe meta data file, error: %1")).arg(airframeFile.errorString()));
                 airframeFile.close();
@@ -306,43 +451,6 @@ bool FirmwareImage::_px4Load(const QString& imageFilename)
             emit statusMessage(QString(tr("Unable to open airframe meta data file %1 for writing, error: %2")).arg(airframeFilename).arg(airframeFile.errorString()));
         }
     }
-    
-    // Decompress the image and save to file
-    _imageSize = px4Json.value(QString("image_size")).toInt();
-    success = _decompressJsonValue(px4Json,               // JSON object
-                                   bytes,                 // Raw bytes of JSON document
-                                   _jsonImageSizeKey,     // key which holds byte size
-                                   _jsonImageKey,         // key which holds compressed bytes
-                                   decompressedBytes);    // Returned decompressed bytes
-    if (!success) {
-        return false;
-    }
-    
-    // Pad image to 4-byte boundary
-    while ((decompressedBytes.count() % 4) != 0) {
-        decompressedBytes.append(static_cast<char>(static_cast<unsigned char>(0xFF)));
-    }
-    
-    // Store decompressed image file in same location as original download file
-    QDir imageDir = QFileInfo(imageFilename).dir();
-    QString decompressFilename = imageDir.filePath("PX4FlashUpgrade.bin");
-    
-    QFile decompressFile(decompressFilename);
-    if (!decompressFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        emit statusMessage(QString(tr("Unable to open decompressed file %1 for writing, error: %2")).arg(decompressFilename).arg(decompressFile.errorString()));
-        return false;
-    }
-    
-    qint64 bytesWritten = decompressFile.write(decompressedBytes);
-    if (bytesWritten != decompressedBytes.count()) {
-        emit statusMessage(QString(tr("Write failed for decompressed image file, error: %1")).arg(decompressFile.errorString()));
-        return false;
-    }
-    decompressFile.close();
-    
-    _binFilename = decompressFilename;
-    
-    return true;
 }
 
 /// Decompress a set of bytes stored in a Json document.
@@ -369,13 +477,17 @@ bool FirmwareImage::_decompressJsonValue(const QJsonObject&	jsonObject,			///< J
     // for the image string. Since its compressed / checksummed
     // this should be fine.
     
-    QStringList parts = QString(jsonDocBytes).split(QString("\"%1\": \"").arg(bytesKey));
-    if (parts.count() == 1) {
+    // The raw bytes are searched rather than converting the whole document to a string and splitting it.
+    // The last occurrence of the key is used, same as the split did.
+    QByteArray keyMarker = QString("\"%1\": \"").arg(bytesKey).toUtf8();
+    int valueStart = jsonDocBytes.lastIndexOf(keyMarker);
+    if (valueStart == -1) {
         emit statusMessage(QString(tr("Could not find compressed bytes for %1 in Firmware file")).arg(bytesKey));
         return false;
     }
-    parts = parts.last().split("\"");
-    if (parts.count() == 1) {
+    valueStart += keyMarker.count();
+    int valueEnd = jsonDocBytes.indexOf('"', valueStart);
+    if (valueEnd == -1) {
         emit statusMessage(QString(tr("Incorrectly formed compressed bytes section for %1 in Firmware file")).arg(bytesKey));
         return false;
     }
@@ -387,8 +499,7 @@ bool FirmwareImage::_decompressJsonValue(const QJsonObject&	jsonObject,			///< J
     raw.append((unsigned char)((decompressedSize >> 8) & 0xFF));
     raw.append((unsigned char)((decompressedSize >> 0) & 0xFF));
     
-    QByteArray raw64 = parts.first().toUtf8();
-    raw.append(QByteArray::fromBase64(raw64));
+    raw.append(QByteArray::fromBase64(QByteArray::fromRawData(jsonDocBytes.constData() + valueStart, valueEnd - valueStart)));
     decompressedBytes = qUncompress(raw);
     
     if (decompressedBytes.count() == 0) {
@@ -432,8 +543,13 @@ bool FirmwareImage::_binLoad(const QString& imageFilename)
         return false;
     }
     
-    _imageSize = (uint32_t)binFile.size();
-    _binFilename = imageFilename;
+    _binImage = binFile.readAll();
+    if (_binImage.count() != binFile.size()) {
+        emit statusMessage(QString(tr("Unabled to read firmware file %1, %2")).arg(imageFilename).arg(binFile.errorString()));
+        _binImage.clear();
+        return false;
+    }
+    _imageSize = (uint32_t)_binImage.count();
     
     binFile.close();
     
@@ -23,6 +23,10 @@
 #include <stdint.h>
 
 /// Support for Intel Hex firmware file
+///
+/// Decoded .px4 and .ihx images are cached by the hash of the file contents, so loading the same file
+/// again skips the json parse, decompression and hex decode. The cache is shared by all instances and is
+/// safe to use from several threads.
 class FirmwareImage : public QObject
 {
     Q_OBJECT
@@ -37,6 +41,10 @@ public:
     /// @return true: success, false: failure
     bool load(const QString& imageFilename, uint32_t boardId);
     
+    /// Sets the file a .px4 image is decompressed to, default is PX4FlashUpgrade.bin next to the .px4 file.
+    /// Images loaded at the same time from the same directory need a file each.
+    void setDecompressFilename(const QString& decompressFilename) { _decompressFilename = decompressFilename; }
+    
     /// Returns the number of bytes in the image.
     uint32_t imageSize(void) const { return _imageSize; }
     
@@ -46,6 +54,15 @@ public:
     /// @return Filename for .bin file
     QString binFilename(void) const { return _binFilename; }
     
+    /// @return Contents of the .bin file, for .px4 the decompressed image padded to 4 bytes
+    const QByteArray& binImage(void) const { return _binImage; }
+    
+    /// @return true: last load came from the decoded image cache
+    bool loadedFromCache(void) const { return _loadedFromCache; }
+    
+    /// Drops all cached decoded images
+    static void clearCache(void);
+    
     /// @return Block count from .ihx image
     uint16_t ihxBlockCount(void) const;
     
@@ -65,10 +82,6 @@ private:
     bool _px4Load(const QString& px4Filename);
     bool _ihxLoad(const QString& ihxFilename);
     
-    bool _readByteFromStream(QTextStream& stream, uint8_t& byte);
-    bool _readWordFromStream(QTextStream& stream, uint16_t& word);
-    bool _readBytesFromStream(QTextStream& stream, uint8_t byteCount, QByteArray& bytes);
-    
     bool _decompressJsonValue(const QJsonObject&	jsonObject,
                               const QByteArray&     jsonDocBytes,
                               const QString&		sizeKey,
@@ -79,12 +92,38 @@ private:
         uint16_t    address;
         QByteArray  bytes;
     } IntelHexBlock_t;
+    
+    /// Everything needed from a .px4 or .ihx file once it has been decoded
+    typedef struct {
+        uint32_t                firmwareBoardId;
+        int                     mavAutopilot;
+        uint32_t                imageSize;
+        QByteArray              image;          ///< .px4 image, padded to 4 bytes
+        QByteArray              parameterXml;   ///< .px4 parameter meta data, empty if none
+        QByteArray              airframeXml;    ///< .px4 airframe meta data, empty if none
+        QList<IntelHexBlock_t>  ihxBlocks;
+    } DecodedImage_t;
+    
+    struct Cache_t;
+    
+    bool _px4Decode         (const QByteArray& bytes, DecodedImage_t& decoded);
+    void _px4SaveMetaData   (const QByteArray& hash, const DecodedImage_t& decoded);
+    bool _ihxDecode         (const QByteArray& bytes, DecodedImage_t& decoded);
+    
+    static Cache_t& _cache  (void);
+    static bool _cacheLookup(const QByteArray& hash, DecodedImage_t& decoded);
+    static void _cacheInsert(const QByteArray& hash, const DecodedImage_t& decoded);
 
     bool                    _binFormat;
     uint32_t                _boardId;
     QString                 _binFilename;
+    QString                 _decompressFilename;
+    QByteArray              _binImage;
     QList<IntelHexBlock_t>  _ihxBlocks;
     uint32_t                _imageSize;
+    bool                    _loadedFromCache;
+    
+    static const qint64 _cacheMaxBytes = 64 * 1024 * 1024;  ///< Decoded bytes kept before the least recently used image is dropped
 
     static const char* _jsonBoardIdKey;
     static const char* _jsonParamXmlSizeKey;
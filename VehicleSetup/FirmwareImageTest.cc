@@ -0,0 +1,203 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "FirmwareImageTest.h"
+#include "FirmwareImage.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+FirmwareImageTest::FirmwareImageTest(void)
+{
+
+}
+
+QByteArray FirmwareImageTest::_ihxRecord(uint16_t address, uint8_t recordType, const QByteArray& data)
+{
+    QByteArray record;
+    record.append((char)data.count());
+    record.append((char)(address >> 8));
+    record.append((char)(address & 0xFF));
+    record.append((char)recordType);
+    record.append(data);
+
+    uint8_t checksum = 0;
+    for (int i = 0; i < record.count(); i++) {
+        checksum += (uint8_t)record[i];
+    }
+    record.append((char)(uint8_t)(0x100 - checksum));
+
+    return ":" + record.toHex().toUpper() + "\r\n";
+}
+
+QByteArray FirmwareImageTest::_ihxFile(const QByteArray& image, int bytesPerRecord)
+{
+    QByteArray ihx;
+    for (int i = 0; i < image.count(); i += bytesPerRecord) {
+        ihx += _ihxRecord(i, 0, image.mid(i, bytesPerRecord));
+    }
+    ihx += _ihxRecord(0, 1, QByteArray());
+    return ihx;
+}
+
+/// Same layout as the PX4 build: json with the zlib streams base64 encoded
+QByteArray FirmwareImageTest::_px4File(uint32_t boardId, const QByteArray& image)
+{
+    QJsonObject json;
+    json["board_id"] = (int)boardId;
+    json["mav_autopilot"] = 12;
+    json["image_size"] = image.count();
+    json["image"] = QString::fromLatin1(qCompress(image).mid(4).toBase64());
+    json["description"] = QStringLiteral("Firmware for unit test");
+    return QJsonDocument(json).toJson(QJsonDocument::Indented);
+}
+
+QString FirmwareImageTest::_writeFile(const QString& fileName, const QByteArray& contents)
+{
+    QString path = _dir.path() + "/" + fileName;
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(contents);
+    }
+    return path;
+}
+
+/// Firmware-like bytes, repetitive enough to compress about as well as a real image
+QByteArray FirmwareImageTest::_imageBytes(int size)
+{
+    QByteArray bytes(size, 0);
+    for (int i = 0; i < size; i++) {
+        bytes[i] = (char)((qrand() % 4 == 0) ? qrand() : (i >> 4));
+    }
+    return bytes;
+}
+
+void FirmwareImageTest::_testIhx(void)
+{
+    FirmwareImage::clearCache();
+
+    // Two contiguous records become one block, the record after the gap starts another. Lower case hex
+    // and bare newlines are accepted too.
+    QByteArray first = _imageBytes(32);
+    QByteArray second = _imageBytes(8);
+    QByteArray ihx = _ihxRecord(0x0000, 0, first.left(16)) + _ihxRecord(0x0010, 0, first.mid(16)).toLower().replace("\r\n", "\n")
+            + _ihxRecord(0x1000, 0, second) + _ihxRecord(0, 1, QByteArray());
+    QString path = _writeFile("test.ihx", ihx);
+
+    FirmwareImage image;
+    QVERIFY(image.load(path, _boardId));
+    QVERIFY(!image.imageIsBinFormat());
+    QVERIFY(!image.loadedFromCache());
+    QCOMPARE(image.imageSize(), (uint32_t)40);
+    QCOMPARE((int)image.ihxBlockCount(), 2);
+
+    uint16_t address;
+    QByteArray bytes;
+    QVERIFY(image.ihxGetBlock(0, address, bytes));
+    QCOMPARE((int)address, 0);
+    QCOMPARE(bytes, first);
+    QVERIFY(image.ihxGetBlock(1, address, bytes));
+    QCOMPARE((int)address, 0x1000);
+    QCOMPARE(bytes, second);
+
+    // Second load is served from the cache with the same blocks
+    FirmwareImage cached;
+    QVERIFY(cached.load(path, _boardId));
+    QVERIFY(cached.loadedFromCache());
+    QCOMPARE(cached.imageSize(), (uint32_t)40);
+    QCOMPARE((int)cached.ihxBlockCount(), 2);
+    QVERIFY(cached.ihxGetBlock(1, address, bytes));
+    QCOMPARE(bytes, second);
+}
+
+void FirmwareImageTest::_testIhxErrors(void)
+{
+    QByteArray good = _ihxRecord(0, 0, _imageBytes(16));
+
+    QByteArray badChecksum = good;
+    badChecksum[badChecksum.count() - 3] = badChecksum[badChecksum.count() - 3] == '0' ? '1' : '0';
+
+    QList<QByteArray> badFiles;
+    badFiles << badChecksum + _ihxRecord(0, 1, QByteArray())    // Checksum mismatch
+             << good.mid(1) + _ihxRecord(0, 1, QByteArray())     // Line without :
+             << good                                            // No end of file record
+             << good + _ihxRecord(0, 4, QByteArray(2, 0))       // Extended address records are not supported
+             << good.left(9) + "\r\n" + _ihxRecord(0, 1, QByteArray())  // Line too short
+             << good.left(9) + "xz" + good.mid(11);             // Not hex
+
+    for (int i = 0; i < badFiles.count(); i++) {
+        FirmwareImage image;
+        QVERIFY2(!image.load(_writeFile(QString("bad%1.ihx").arg(i), badFiles[i]), _boardId), qPrintable(QString::number(i)));
+    }
+}
+
+void FirmwareImageTest::_testPx4Cache(void)
+{
+    FirmwareImage::clearCache();
+
+    // Odd size to check the padding
+    QByteArray imageBytes = _imageBytes(100001);
+    QByteArray paddedBytes = imageBytes + QByteArray(3, (char)0xFF);
+    QString path = _writeFile("test.px4", _px4File(_boardId, imageBytes));
+
+    FirmwareImage image;
+    QVERIFY(image.load(path, _boardId));
+    QVERIFY(image.imageIsBinFormat());
+    QVERIFY(!image.loadedFromCache());
+    QCOMPARE(image.imageSize(), (uint32_t)imageBytes.count());
+    QCOMPARE(image.binImage(), paddedBytes);
+
+    // The decoded image is still written out for the code which uploads files
+    QFile binFile(image.binFilename());
+    QVERIFY(binFile.open(QIODevice::ReadOnly));
+    QCOMPARE(binFile.readAll(), paddedBytes);
+    binFile.close();
+
+    FirmwareImage cached;
+    QVERIFY(cached.load(path, _boardId));
+    QVERIFY(cached.loadedFromCache());
+    QCOMPARE(cached.imageSize(), (uint32_t)imageBytes.count());
+    QCOMPARE(cached.binImage(), paddedBytes);
+
+    // Board id is still checked on a cached image
+    FirmwareImage wrongBoard;
+    QVERIFY(!wrongBoard.load(path, _boardId + 1));
+
+    // Different contents under the same name are decoded again
+    QByteArray otherBytes = _imageBytes(4096);
+    path = _writeFile("test.px4", _px4File(_boardId, otherBytes));
+    FirmwareImage changed;
+    QVERIFY(changed.load(path, _boardId));
+    QVERIFY(!changed.loadedFromCache());
+    QCOMPARE(changed.binImage(), otherBytes);
+}
+
+void FirmwareImageTest::_benchmarkLoad(void)
+{
+    // Largest image a 16 bit .ihx can address and a 2 MB .px4
+    QString ihxPath = _writeFile("large.ihx", _ihxFile(_imageBytes(0x10000), 16));
+    QString px4Path = _writeFile("large.px4", _px4File(_boardId, _imageBytes(2 * 1024 * 1024)));
+
+    QStringList paths;
+    paths << ihxPath << px4Path;
+    foreach (const QString& path, paths) {
+        FirmwareImage::clearCache();
+
+        FirmwareImage decoded;
+        QVERIFY(decoded.load(path, _boardId));
+
+        FirmwareImage cached;
+        QVERIFY(cached.load(path, _boardId));
+
+        QVERIFY(cached.loadedFromCache());
+        QCOMPARE(cached.imageSize(), decoded.imageSize());
+    }
+}
@@ -0,0 +1,44 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef FirmwareImageTest_H
+#define FirmwareImageTest_H
+
+#include "UnitTest.h"
+
+#include <QTemporaryDir>
+
+/// Loads generated .ihx and .px4 files through FirmwareImage, with and without the decoded image cache
+class FirmwareImageTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    FirmwareImageTest(void);
+
+private slots:
+    void _testIhx(void);
+    void _testIhxErrors(void);
+    void _testPx4Cache(void);
+    void _benchmarkLoad(void);
+
+private:
+    QByteArray  _ihxRecord  (uint16_t address, uint8_t recordType, const QByteArray& data);
+    QByteArray  _ihxFile    (const QByteArray& image, int bytesPerRecord);
+    QByteArray  _px4File    (uint32_t boardId, const QByteArray& image);
+    QString     _writeFile  (const QString& fileName, const QByteArray& contents);
+    QByteArray  _imageBytes (int size);
+
+    QTemporaryDir _dir;
+
+    static const uint32_t _boardId = 9;
+};
+
+#endif
@@ -0,0 +1,367 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/// @file
+///     @brief Production line flashing of several boards at once
+
+#include "FlashStation.h"
+#include "Bootloader.h"
+#include "FirmwareImage.h"
+#include "QGCSerialPortInfo.h"
+#include "QGCLoggingCategory.h"
+#include "QGC.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryFile>
+#include <QTextStream>
+
+FlashStationWorker::FlashStationWorker(const QString& portName, bool radio, const QMap<uint32_t, QString>& images, int syncTimeoutMsecs, QObject* parent)
+    : QThread(parent)
+    , _images(images)
+    , _syncTimeoutMsecs(syncTimeoutMsecs)
+    , _cancel(false)
+{
+    _result.portName = portName;
+    _result.radio = radio;
+    _result.boardID = 0;
+    _result.bootloaderVersion = 0;
+    _result.flashSize = 0;
+    _result.success = false;
+    _result.eraseMsecs = 0;
+    _result.programMsecs = 0;
+    _result.verifyMsecs = 0;
+}
+
+bool FlashStationWorker::_fail(const QString& errorString)
+{
+    _result.success = false;
+    _result.errorString = errorString;
+    _result.finished = QDateTime::currentDateTime();
+    qCDebug(FirmwareUpgradeLog) << "Station flash failed" << _result.portName << errorString;
+    return false;
+}
+
+bool FlashStationWorker::_canceled(void)
+{
+    if (_cancel) {
+        _fail(tr("Canceled"));
+        return true;
+    }
+    return false;
+}
+
+bool FlashStationWorker::flashBoard(void)
+{
+    // Created here so they belong to the flashing thread
+    Bootloader bootloader;
+    QextSerialPort port(QextSerialPort::Polling);
+    connect(&bootloader, &Bootloader::updateProgress, this, &FlashStationWorker::boardProgress, Qt::DirectConnection);
+
+    // The bootloader only runs for a short while after power up and the port may take a moment to
+    // become usable, keep trying until it answers. A 3DR Radio running its normal firmware never
+    // answers, it is rebooted into its bootloader once the first sync fails.
+    emit boardStatus(tr("Connecting to bootloader"));
+    QElapsedTimer syncTimer;
+    syncTimer.start();
+    bool synced = false;
+    bool radioForced = false;
+    while (!synced) {
+        if (bootloader.open(&port, _result.portName)) {
+            synced = bootloader.sync(&port);
+            if (!synced) {
+                port.close();
+            }
+        }
+        if (!synced && _result.radio && !radioForced) {
+            radioForced = true;
+            emit boardStatus(tr("Rebooting radio to bootloader"));
+            if (!bootloader.force3DRRadioBootloader(_result.portName)) {
+                return _fail(bootloader.errorString());
+            }
+            syncTimer.restart();
+            continue;
+        }
+        if (!synced) {
+            if (syncTimer.elapsed() > _syncTimeoutMsecs) {
+                return _fail(bootloader.errorString());
+            }
+            if (_canceled()) {
+                return false;
+            }
+            QGC::SLEEP::msleep(100);
+        }
+    }
+
+    bool success;
+    if (_result.radio) {
+        success = bootloader.get3DRRadioBoardId(&port, _result.boardID);
+    } else {
+        success = bootloader.getPX4BoardInfo(&port, _result.bootloaderVersion, _result.boardID, _result.flashSize);
+    }
+    if (!success) {
+        return _fail(bootloader.errorString());
+    }
+
+    _result.imageFile = _images.value(_result.boardID);
+    if (_result.imageFile.isEmpty()) {
+        return _fail(tr("No firmware for board id %1").arg(_result.boardID));
+    }
+    FirmwareImage image;
+    connect(&image, &FirmwareImage::statusMessage, this, &FlashStationWorker::boardStatus, Qt::DirectConnection);
+
+    // The bootloader programs from the image in memory. The decompressed copy of a .px4 goes to a file of
+    // this worker's own so boards loading the same image at the same time don't write over each other.
+    QTemporaryFile binFile(QDir::temp().filePath("FlashStationXXXXXX.bin"));
+    if (!binFile.open()) {
+        return _fail(tr("Unable to create temporary file: %1").arg(binFile.errorString()));
+    }
+    binFile.close();
+    image.setDecompressFilename(binFile.fileName());
+
+    if (!image.load(_result.imageFile, _result.boardID)) {
+        return _fail(tr("Unable to load firmware %1").arg(_result.imageFile));
+    }
+
+    if (_canceled()) {
+        return false;
+    }
+    emit boardStatus(tr("Erasing previous program..."));
+    success = bootloader.erase(&port);
+    _result.eraseMsecs = bootloader.eraseMsecs();
+    if (!success) {
+        return _fail(bootloader.errorString());
+    }
+
+    if (_canceled()) {
+        return false;
+    }
+    emit boardStatus(tr("Programming new version..."));
+    success = bootloader.program(&port, &image);
+    _result.programMsecs = bootloader.programMsecs();
+    if (!success) {
+        return _fail(bootloader.errorString());
+    }
+
+    // Uses the board CRC with PX4 bootloaders which support it, reads the flash back otherwise
+    emit boardStatus(tr("Verifying program..."));
+    success = bootloader.verify(&port, &image);
+    _result.verifyMsecs = bootloader.verifyMsecs();
+    if (!success) {
+        return _fail(bootloader.errorString());
+    }
+
+    _result.success = true;
+    _result.finished = QDateTime::currentDateTime();
+    qCDebug(FirmwareUpgradeLog) << "Station flash complete" << _result.portName << "board id" << _result.boardID
+                                << "erase msecs" << _result.eraseMsecs << "program msecs" << _result.programMsecs << "verify msecs" << _result.verifyMsecs;
+    emit boardStatus(tr("Verify complete"));
+
+    return true;
+}
+
+FlashStation::FlashStation(QObject* parent)
+    : QObject(parent)
+    , _passCount(0)
+    , _syncTimeoutMsecs(_defaultSyncTimeoutMsecs)
+{
+    _scanTimer.setInterval(_scanIntervalMsecs);
+    connect(&_scanTimer, &QTimer::timeout, this, &FlashStation::_scanPorts);
+    _clock.start();
+}
+
+FlashStation::~FlashStation()
+{
+    _scanTimer.stop();
+    foreach (FlashStationWorker* worker, _workers) {
+        worker->cancel();
+    }
+    foreach (FlashStationWorker* worker, _workers) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+void FlashStation::setImage(int boardID, const QString& fileName)
+{
+    if (fileName.isEmpty()) {
+        _images.remove(boardID);
+    } else {
+        _images[boardID] = fileName;
+    }
+}
+
+void FlashStation::start(void)
+{
+    if (!_scanTimer.isActive()) {
+        _knownPorts.clear();
+        _finishedPorts.clear();
+        _scanTimer.start();
+        emit runningChanged(true);
+        _scanPorts();
+    }
+}
+
+void FlashStation::stop(void)
+{
+    if (_scanTimer.isActive()) {
+        _scanTimer.stop();
+        emit runningChanged(false);
+    }
+}
+
+void FlashStation::_scanPorts(void)
+{
+    QList<Port_t> ports;
+
+    foreach (QGCSerialPortInfo info, QGCSerialPortInfo::availablePorts()) {
+        Port_t port;
+        port.radio = info.boardType() == QGCSerialPortInfo::BoardTypeSikRadio;
+        if (!port.radio && !info.boardTypePixhawk()) {
+            continue;
+        }
+        port.name = info.systemLocation();
+        port.description = info.description();
+        port.bootloader = info.isBootloader();
+        ports.append(port);
+    }
+
+    _updatePorts(ports);
+}
+
+/// Starts a worker for each bootloader port which was not there on the last scan
+void FlashStation::_updatePorts(const QList<Port_t>& ports)
+{
+    qint64 now = _clock.elapsed();
+    QSet<QString> portNames;
+
+    foreach (const Port_t& port, ports) {
+        if (_finishedPorts.contains(port.name)) {
+            // Finished board coming back up after its reboot, or still plugged in
+            _finishedPorts[port.name] = now;
+            continue;
+        }
+        if (!port.radio && !port.bootloader) {
+            // Pixhawk running its application, there is no bootloader to sync with
+            continue;
+        }
+
+        portNames.insert(port.name);
+        if (!_knownPorts.contains(port.name)) {
+            qCDebug(FirmwareUpgradeLog) << "Station found board" << port.name << port.description;
+            flashPort(port.name, port.radio);
+        }
+    }
+
+    _knownPorts = portNames;
+
+    // Gone for longer than a reboot takes, so it was unplugged and the next board there gets flashed
+    QMutableMapIterator<QString, qint64> iter(_finishedPorts);
+    while (iter.hasNext()) {
+        iter.next();
+        if (now - iter.value() > _finishedPortForgetMsecs) {
+            iter.remove();
+        }
+    }
+}
+
+bool FlashStation::flashPort(const QString& portName, bool radio)
+{
+    if (_workers.contains(portName)) {
+        return false;
+    }
+
+    FlashStationWorker* worker = new FlashStationWorker(portName, radio, _images, _syncTimeoutMsecs);
+    connect(worker, &FlashStationWorker::boardProgress, this, &FlashStation::_workerProgress);
+    connect(worker, &FlashStationWorker::boardStatus,   this, &FlashStation::_workerStatus);
+    connect(worker, &QThread::finished,                 this, &FlashStation::_workerFinished);
+    _workers[portName] = worker;
+
+    emit boardStarted(portName);
+    emit activeCountChanged(_workers.count());
+    worker->start();
+
+    return true;
+}
+
+void FlashStation::_workerProgress(int curr, int total)
+{
+    FlashStationWorker* worker = qobject_cast<FlashStationWorker*>(sender());
+    if (worker) {
+        emit boardProgress(worker->result().portName, curr, total);
+    }
+}
+
+void FlashStation::_workerStatus(const QString& status)
+{
+    FlashStationWorker* worker = qobject_cast<FlashStationWorker*>(sender());
+    if (worker) {
+        emit boardStatus(worker->result().portName, status);
+    }
+}
+
+void FlashStation::_workerFinished(void)
+{
+    FlashStationWorker* worker = qobject_cast<FlashStationWorker*>(sender());
+    if (!worker) {
+        return;
+    }
+
+    const FlashStationWorker::Result_t& result = worker->result();
+    _workers.remove(result.portName);
+    _finishedPorts[result.portName] = _clock.elapsed();
+    _results.append(result);
+    if (result.success) {
+        _passCount++;
+    }
+    _logResult(result);
+    worker->deleteLater();
+
+    emit activeCountChanged(_workers.count());
+    emit boardFinished(result.portName, result.success, result.errorString);
+}
+
+/// Quotes a CSV field, doubling any quotes inside it
+static QString _csvQuote(QString field)
+{
+    field.replace(QLatin1Char('"'), QLatin1String("\"\""));
+    return QLatin1Char('"') + field + QLatin1Char('"');
+}
+
+void FlashStation::_logResult(const FlashStationWorker::Result_t& result)
+{
+    if (_logFile.isEmpty()) {
+        return;
+    }
+
+    QFile file(_logFile);
+    bool newFile = !file.exists();
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "Unable to open flash station log" << _logFile << file.errorString();
+        return;
+    }
+
+    QTextStream stream(&file);
+    if (newFile) {
+        stream << "time,port,board_id,bootloader_rev,flash_size,firmware,result,erase_ms,program_ms,verify_ms,error\n";
+    }
+    stream << result.finished.toString(Qt::ISODate) << ','
+           << result.portName << ','
+           << result.boardID << ','
+           << result.bootloaderVersion << ','
+           << result.flashSize << ','
+           << _csvQuote(result.imageFile) << ','
+           << (result.success ? "PASS" : "FAIL") << ','
+           << result.eraseMsecs << ','
+           << result.programMsecs << ','
+           << result.verifyMsecs << ','
+           << _csvQuote(result.errorString) << '\n';
+}
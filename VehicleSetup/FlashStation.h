@@ -0,0 +1,170 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/// @file
+///     @brief Production line flashing of several boards at once
+
+#ifndef FlashStation_H
+#define FlashStation_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QSet>
+
+#include <atomic>
+#include <stdint.h>
+
+/// Flashes the board on one bootloader port from start to finish on its own thread: sync, board info,
+/// erase, program and verify. The firmware file is picked by the board id the bootloader reports.
+class FlashStationWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    FlashStationWorker(const QString& portName, bool radio, const QMap<uint32_t, QString>& images, int syncTimeoutMsecs, QObject* parent = NULL);
+
+    typedef struct {
+        QString     portName;
+        bool        radio;              ///< 3DR Radio bootloader instead of PX4
+        uint32_t    boardID;
+        uint32_t    bootloaderVersion;
+        uint32_t    flashSize;
+        QString     imageFile;
+        bool        success;
+        QString     errorString;
+        qint64      eraseMsecs;
+        qint64      programMsecs;
+        qint64      verifyMsecs;
+        QDateTime   finished;
+    } Result_t;
+
+    /// Flashes the board on the calling thread
+    bool flashBoard(void);
+
+    /// Stops before the next phase. Thread safe.
+    void cancel(void) { _cancel = true; }
+
+    const Result_t& result(void) const { return _result; }
+
+signals:
+    void boardProgress(int curr, int total);
+    void boardStatus(const QString& status);
+
+protected:
+    void run(void) final { flashBoard(); }
+
+private:
+    bool _fail      (const QString& errorString);
+    bool _canceled  (void);
+
+    Result_t                _result;
+    QMap<uint32_t, QString> _images;
+    int                     _syncTimeoutMsecs;
+    std::atomic<bool>       _cancel;
+};
+
+/// Station mode for flashing boards on a production line.
+///
+/// While running, the serial ports are scanned for Pixhawk bootloaders and 3DR Radios. Each new port gets
+/// its own FlashStationWorker so any number of boards flash at the same time, each with its own progress.
+/// Pixhawk ports running the application are left alone. A port is not flashed again until it has been
+/// gone for longer than a reboot takes, so a finished board coming back up after verify, or staying plugged
+/// in until the operator gets to it, is not flashed twice. Every board's result is appended to the log
+/// file as a line of CSV.
+///
+/// This opens the same ports as FirmwareUpgradeController's board search, only one of them should run.
+class FlashStation : public QObject
+{
+    Q_OBJECT
+
+    friend class FlashStationTest; ///< This allows our unit test to feed port scans
+
+public:
+    FlashStation(QObject* parent = NULL);
+    ~FlashStation();
+
+    Q_PROPERTY(bool running     READ running        NOTIFY runningChanged)
+    Q_PROPERTY(int  activeCount READ activeCount    NOTIFY activeCountChanged)
+    Q_PROPERTY(int  passCount   READ passCount      NOTIFY boardFinished)
+    Q_PROPERTY(int  failCount   READ failCount      NOTIFY boardFinished)
+
+    /// Sets the firmware file flashed to boards reporting this board id
+    Q_INVOKABLE void setImage(int boardID, const QString& fileName);
+
+    /// Sets the CSV file results are appended to, none if empty
+    Q_INVOKABLE void setLogFile(const QString& fileName) { _logFile = fileName; }
+
+    /// Starts watching for boards
+    Q_INVOKABLE void start(void);
+
+    /// Stops watching for boards. Boards being flashed are finished.
+    Q_INVOKABLE void stop(void);
+
+    /// Starts flashing the board on the specified port
+    ///     @param radio true: 3DR Radio bootloader, false: PX4 bootloader
+    /// @return false: port is already being flashed
+    Q_INVOKABLE bool flashPort(const QString& portName, bool radio);
+
+    /// Msecs to keep trying to sync with a bootloader after its port shows up
+    void setSyncTimeoutMsecs(int msecs) { _syncTimeoutMsecs = msecs; }
+
+    bool running        (void) const { return _scanTimer.isActive(); }
+    int  activeCount    (void) const { return _workers.count(); }
+    int  passCount      (void) const { return _passCount; }
+    int  failCount      (void) const { return _results.count() - _passCount; }
+
+    const QList<FlashStationWorker::Result_t>& results(void) const { return _results; }
+
+signals:
+    void runningChanged(bool running);
+    void activeCountChanged(int activeCount);
+    void boardStarted(const QString& portName);
+    void boardProgress(const QString& portName, int curr, int total);
+    void boardStatus(const QString& portName, const QString& status);
+    void boardFinished(const QString& portName, bool success, const QString& errorString);
+
+private slots:
+    void _scanPorts         (void);
+    void _workerProgress    (int curr, int total);
+    void _workerStatus      (const QString& status);
+    void _workerFinished    (void);
+
+private:
+    typedef struct {
+        QString name;
+        QString description;
+        bool    radio;
+        bool    bootloader;     ///< false: Pixhawk running its application
+    } Port_t;
+
+    void _updatePorts(const QList<Port_t>& ports);
+    void _logResult(const FlashStationWorker::Result_t& result);
+
+    QTimer                                  _scanTimer;
+    QElapsedTimer                           _clock;
+    QMap<uint32_t, QString>                 _images;            ///< Board id to firmware file
+    QMap<QString, FlashStationWorker*>      _workers;           ///< Port name to worker flashing it
+    QSet<QString>                           _knownPorts;        ///< Bootloader ports seen on the last scan
+    QMap<QString, qint64>                   _finishedPorts;     ///< Ports of finished boards to _clock msecs they were last seen
+    QList<FlashStationWorker::Result_t>     _results;
+    int                                     _passCount;
+    int                                     _syncTimeoutMsecs;
+    QString                                 _logFile;
+
+    static const int _scanIntervalMsecs = 500;
+    static const int _defaultSyncTimeoutMsecs = 5000;
+    static const int _finishedPortForgetMsecs = 15000;  ///< Longer than a board takes to reboot after verify
+};
+
+#endif
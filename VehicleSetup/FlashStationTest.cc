@@ -0,0 +1,286 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "FlashStationTest.h"
+#include "FlashStation.h"
+#include "BootloaderSimulator.h"
+#include "Bootloader.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSignalSpy>
+
+FlashStationTest::FlashStationTest(void)
+{
+
+}
+
+QByteArray FlashStationTest::_randomBytes(int size)
+{
+    QByteArray bytes(size, 0);
+    for (int i = 0; i < size; i++) {
+        bytes[i] = (char)(qrand() & 0xFF);
+    }
+    return bytes;
+}
+
+QByteArray FlashStationTest::_px4File(uint32_t boardID, const QByteArray& image)
+{
+    QJsonObject json;
+    json["board_id"] = (int)boardID;
+    json["mav_autopilot"] = 12;
+    json["image_size"] = image.count();
+    json["image"] = QString::fromLatin1(qCompress(image).mid(4).toBase64());
+    json["description"] = QStringLiteral("Firmware for unit test");
+    return QJsonDocument(json).toJson(QJsonDocument::Indented);
+}
+
+QString FlashStationTest::_writeFile(const QString& fileName, const QByteArray& contents)
+{
+    QString path = _dir.path() + "/" + fileName;
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(contents);
+    }
+    return path;
+}
+
+bool FlashStationTest::_waitIdle(FlashStation& station, int timeoutMsecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (station.activeCount() && timer.elapsed() < timeoutMsecs) {
+        QTest::qWait(20);
+    }
+    return station.activeCount() == 0;
+}
+
+void FlashStationTest::_testConcurrentFlash(void)
+{
+    const int cBoards = 5;
+    const int failBoard = 3;
+    const int unknownBoard = 4;
+
+    // Two board types each with their own image, one board which fails programming and one nobody has an image for
+    QByteArray v2Image = _randomBytes(128 * 1024);
+    QByteArray v4Image = _randomBytes(192 * 1024);
+    uint32_t boardIDs[cBoards] = { Bootloader::boardIDPX4FMUV2, Bootloader::boardIDPX4FMUV4, Bootloader::boardIDPX4FMUV2, Bootloader::boardIDPX4FMUV4, Bootloader::boardIDTAPV1 };
+
+    QList<BootloaderSimulator*> simulators;
+    for (int i = 0; i < cBoards; i++) {
+        BootloaderSimulator* simulator = new BootloaderSimulator(_flashSize, 5, 1, boardIDs[i]);
+        simulators.append(simulator);
+        if (!simulator->open()) {
+            qDeleteAll(simulators);
+            QSKIP("No pty support");
+        }
+        if (i == failBoard) {
+            simulator->setFailAddress(0x10000);
+        }
+        simulator->start();
+    }
+
+    QString logFile = _dir.path() + "/station.csv";
+    FlashStation station;
+    station.setImage(Bootloader::boardIDPX4FMUV2, _writeFile("v2.bin", v2Image));
+    station.setImage(Bootloader::boardIDPX4FMUV4, _writeFile("v4.bin", v4Image));
+    station.setLogFile(logFile);
+
+    QSignalSpy spyFinished(&station, SIGNAL(boardFinished(QString, bool, QString)));
+    QSignalSpy spyProgress(&station, SIGNAL(boardProgress(QString, int, int)));
+
+    for (int i = 0; i < cBoards; i++) {
+        QVERIFY(station.flashPort(simulators[i]->portName(), false));
+    }
+    QVERIFY(!station.flashPort(simulators[0]->portName(), false));
+    QCOMPARE(station.activeCount(), cBoards);
+
+    bool idle = _waitIdle(station, 60000);
+    foreach (BootloaderSimulator* simulator, simulators) {
+        simulator->stop();
+    }
+    QVERIFY(idle);
+
+    QCOMPARE(spyFinished.count(), cBoards);
+    QCOMPARE(station.results().count(), cBoards);
+    QCOMPARE(station.passCount(), cBoards - 2);
+    QCOMPARE(station.failCount(), 2);
+
+    for (int i = 0; i < cBoards; i++) {
+        const BootloaderSimulator* simulator = simulators[i];
+        FlashStationWorker::Result_t result;
+        foreach (const FlashStationWorker::Result_t& candidate, station.results()) {
+            if (candidate.portName == simulator->portName()) {
+                result = candidate;
+            }
+        }
+        QCOMPARE(result.portName, simulator->portName());
+        QCOMPARE(result.boardID, boardIDs[i]);
+
+        if (i == failBoard) {
+            QVERIFY(!result.success);
+            QVERIFY2(result.errorString.contains("0x00010000"), qPrintable(result.errorString));
+        } else if (i == unknownBoard) {
+            QVERIFY(!result.success);
+            QVERIFY2(result.errorString.contains("No firmware"), qPrintable(result.errorString));
+        } else {
+            QVERIFY2(result.success, qPrintable(result.errorString));
+            QVERIFY(simulator->booted());
+            const QByteArray& image = boardIDs[i] == (uint32_t)Bootloader::boardIDPX4FMUV2 ? v2Image : v4Image;
+            QCOMPARE(simulator->flash().left(image.count()), image);
+
+            // Progress is reported per port
+            bool progressSeen = false;
+            for (int j = 0; j < spyProgress.count() && !progressSeen; j++) {
+                progressSeen = spyProgress[j][0].toString() == simulator->portName();
+            }
+            QVERIFY(progressSeen);
+        }
+    }
+
+    // Header plus one line per board
+    QFile log(logFile);
+    QVERIFY(log.open(QIODevice::ReadOnly | QIODevice::Text));
+    QList<QByteArray> lines = log.readAll().trimmed().split('\n');
+    QCOMPARE(lines.count(), cBoards + 1);
+    QVERIFY(lines[0].startsWith("time,port,board_id"));
+    int passLines = 0;
+    for (int i = 1; i < lines.count(); i++) {
+        if (lines[i].contains(",PASS,")) {
+            passLines++;
+        }
+    }
+    QCOMPARE(passLines, cBoards - 2);
+
+    qDeleteAll(simulators);
+}
+
+void FlashStationTest::_testNoBootloader(void)
+{
+    // Port exists but nothing answers on it
+    BootloaderSimulator simulator(_flashSize, 5, 0);
+    if (!simulator.open()) {
+        QSKIP("No pty support");
+    }
+
+    FlashStation station;
+    station.setSyncTimeoutMsecs(200);
+    QVERIFY(station.flashPort(simulator.portName(), false));
+    QVERIFY(_waitIdle(station, 10000));
+
+    QCOMPARE(station.results().count(), 1);
+    QVERIFY(!station.results()[0].success);
+    QVERIFY(!station.results()[0].errorString.isEmpty());
+}
+
+void FlashStationTest::_testMixedPx4Flash(void)
+{
+    const int cBoards = 4;
+
+    // .px4 images for two board types in the same directory, loaded by all the workers at once
+    QByteArray v2Image = _randomBytes(96 * 1024);
+    QByteArray v4Image = _randomBytes(160 * 1024);
+    uint32_t boardIDs[cBoards] = { Bootloader::boardIDPX4FMUV2, Bootloader::boardIDPX4FMUV4, Bootloader::boardIDPX4FMUV4, Bootloader::boardIDPX4FMUV2 };
+
+    QList<BootloaderSimulator*> simulators;
+    for (int i = 0; i < cBoards; i++) {
+        BootloaderSimulator* simulator = new BootloaderSimulator(_flashSize, 5, 1, boardIDs[i]);
+        simulators.append(simulator);
+        if (!simulator->open()) {
+            qDeleteAll(simulators);
+            QSKIP("No pty support");
+        }
+        simulator->start();
+    }
+
+    // Comma in the file name checks the CSV quoting
+    QString logFile = _dir.path() + "/px4station.csv";
+    QString v2Path = _writeFile("fmu-v2,rev1.px4", _px4File(Bootloader::boardIDPX4FMUV2, v2Image));
+    FlashStation station;
+    station.setImage(Bootloader::boardIDPX4FMUV2, v2Path);
+    station.setImage(Bootloader::boardIDPX4FMUV4, _writeFile("fmu-v4.px4", _px4File(Bootloader::boardIDPX4FMUV4, v4Image)));
+    station.setLogFile(logFile);
+
+    for (int i = 0; i < cBoards; i++) {
+        QVERIFY(station.flashPort(simulators[i]->portName(), false));
+    }
+    bool idle = _waitIdle(station, 60000);
+    foreach (BootloaderSimulator* simulator, simulators) {
+        simulator->stop();
+    }
+    QVERIFY(idle);
+    QCOMPARE(station.passCount(), cBoards);
+
+    // Each board got the image for its own board id
+    for (int i = 0; i < cBoards; i++) {
+        const QByteArray& image = boardIDs[i] == (uint32_t)Bootloader::boardIDPX4FMUV2 ? v2Image : v4Image;
+        QVERIFY(simulators[i]->booted());
+        QCOMPARE(simulators[i]->flash().left(image.count()), image);
+    }
+
+    // No shared decompressed file next to the images
+    QVERIFY(!QFile::exists(QDir(_dir.path()).filePath("PX4FlashUpgrade.bin")));
+
+    QFile log(logFile);
+    QVERIFY(log.open(QIODevice::ReadOnly | QIODevice::Text));
+    QList<QByteArray> lines = log.readAll().trimmed().split('\n');
+    QCOMPARE(lines.count(), cBoards + 1);
+    int v2Lines = 0;
+    for (int i = 1; i < lines.count(); i++) {
+        if (lines[i].contains(QString(",\"%1\",PASS,").arg(v2Path).toUtf8())) {
+            v2Lines++;
+        }
+    }
+    QCOMPARE(v2Lines, 2);
+
+    qDeleteAll(simulators);
+}
+
+void FlashStationTest::_testFinishedBoardNotReflashed(void)
+{
+    BootloaderSimulator simulator(_flashSize, 5, 1, Bootloader::boardIDPX4FMUV2);
+    if (!simulator.open()) {
+        QSKIP("No pty support");
+    }
+    simulator.start();
+
+    FlashStation station;
+    station.setImage(Bootloader::boardIDPX4FMUV2, _writeFile("reboot.bin", _randomBytes(64 * 1024)));
+    QVERIFY(station.flashPort(simulator.portName(), false));
+    bool idle = _waitIdle(station, 30000);
+    simulator.stop();
+    QVERIFY(idle);
+    QCOMPARE(station.passCount(), 1);
+
+    FlashStation::Port_t port;
+    port.name = simulator.portName();
+    port.radio = false;
+
+    // Board comes back up running its application after verify
+    port.bootloader = false;
+    station._updatePorts(QList<FlashStation::Port_t>() << port);
+    QCOMPARE(station.activeCount(), 0);
+
+    // A board which shows up as a bootloader port again, like a radio does, is still the board just flashed
+    port.bootloader = true;
+    station._updatePorts(QList<FlashStation::Port_t>() << port);
+    QCOMPARE(station.activeCount(), 0);
+
+    // Application ports are never flashed
+    FlashStation::Port_t otherPort = port;
+    otherPort.name = port.name + "-app";
+    otherPort.bootloader = false;
+    station._updatePorts(QList<FlashStation::Port_t>() << port << otherPort);
+    QCOMPARE(station.activeCount(), 0);
+    QCOMPARE(station.results().count(), 1);
+}
@@ -0,0 +1,45 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef FlashStationTest_H
+#define FlashStationTest_H
+
+#include "UnitTest.h"
+
+#include <QTemporaryDir>
+
+class FlashStation;
+
+/// Flashes several simulated bootloaders at once through FlashStation
+class FlashStationTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    FlashStationTest(void);
+
+private slots:
+    void _testConcurrentFlash(void);
+    void _testNoBootloader(void);
+    void _testMixedPx4Flash(void);
+    void _testFinishedBoardNotReflashed(void);
+
+private:
+    QByteArray  _randomBytes    (int size);
+    QByteArray  _px4File        (uint32_t boardID, const QByteArray& image);
+    QString     _writeFile      (const QString& fileName, const QByteArray& contents);
+    bool        _waitIdle       (FlashStation& station, int timeoutMsecs);
+
+    QTemporaryDir _dir;
+
+    static const uint32_t _flashSize = 512 * 1024;
+};
+
+#endif
@@ -162,48 +162,12 @@ void PX4FirmwareUpgradeThreadWorker::_3drRadioForceBootloader(const QGCSerialPor
 
     // Couldn't find the bootloader. We'll need to reboot the radio into bootloader.
     
-    QSerialPort port(portInfo);
-    
-    port.setBaudRate(QSerialPort::Baud57600);
-    
-    emit status("Putting radio into command mode");
-    
-    // Wait a little while for the USB port to initialize. 3DR Radio boot is really slow.
-    QGC::SLEEP::msleep(2000);
-    port.open(QIODevice::ReadWrite);
-    
-    if (!port.isOpen()) {
-        emit error(QString("Unable to open port: %1 error: %2").arg(portInfo.systemLocation()).arg(port.errorString()));
-        return;
-    }
-
-    // Put radio into command mode
-    QGC::SLEEP::msleep(2000);
-    port.write("+++", 3);
-    if (!port.waitForReadyRead(1500)) {
-        emit error("Unable to put radio into command mode");
-        return;
-    }
-    QByteArray bytes = port.readAll();
-    if (!bytes.contains("OK")) {
-        qCDebug(FirmwareUpgradeLog) << bytes;
-        emit error("Unable to put radio into command mode");
-        return;
-    }
-
     emit status("Rebooting radio to bootloader");
     
-    port.write("AT&UPDATE\r\n");
-    if (!port.waitForBytesWritten(1500)) {
-        emit error("Unable to reboot radio (bytes written)");
-        return;
-    }
-    if (!port.waitForReadyRead(1500)) {
-        emit error("Unable to reboot radio (ready read)");
+    if (!_bootloader->force3DRRadioBootloader(portInfo.systemLocation())) {
+        emit error(_bootloader->errorString());
         return;
     }
-    port.close();
-    QGC::SLEEP::msleep(2000);
 
     // The bootloader should be waiting for us now
     
@@ -307,8 +271,9 @@ void PX4FirmwareUpgradeThreadWorker::_flash(void)
         emit status(tr("Verifying program..."));
         
         if (_bootloader->verify(_bootloaderPort, _controller->image())) {
-            qCDebug(FirmwareUpgradeLog) << "Verify complete";
+            qCDebug(FirmwareUpgradeLog) << "Verify complete - erase msecs" << _bootloader->eraseMsecs() << "program msecs" << _bootloader->programMsecs() << "verify msecs" << _bootloader->verifyMsecs();
             emit status(tr("Verify complete"));
+            emit status(tr("Erase %1s, program %2s, verify %3s").arg(_bootloader->eraseMsecs() / 1000.0, 0, 'f', 1).arg(_bootloader->programMsecs() / 1000.0, 0, 'f', 1).arg(_bootloader->verifyMsecs() / 1000.0, 0, 'f', 1));
         } else {
             qCDebug(FirmwareUpgradeLog) << "Verify failed:" << _bootloader->errorString();
             emit error(_bootloader->errorString());
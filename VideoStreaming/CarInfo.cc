@@ -1,15 +1,10 @@
 #include "CarInfo.h"
-#include <synchapi.h>
+// The plate tap attaches itself on the first saveImg() and stays in the pipeline, so there is nothing
+// to start or stop here. saveImg() is queued to the receiver's thread, which is where the recognizer
+// is created and deleted.
 void CarInfo::run(){
-	if(_rece){
-        if(_flag){
-                _rece->startroirecording();
-                Sleep(1000);
-                _rece->stopimagerecording();
-        }else{
-                _rece->saveImg();
-        }
-
+	if(_rece && !_flag){
+        QMetaObject::invokeMethod(_rece, "saveImg", Qt::QueuedConnection);
 	}
 }
 void CarInfo::setVideoRece(VideoReceiver* rece){
@@ -0,0 +1,200 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Background subtraction motion detector worker
+ */
+
+#include "MotionDetector.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <string.h>
+
+MotionDetector::MotionDetector(QObject* parent)
+    : QThread(parent)
+    , _framePending(false)
+    , _resetRequested(false)
+    , _quit(false)
+    , _pyramidLevels(2)
+    , _frameStride(1)
+    , _fpsFrameCount(0)
+    , _erodeKernelLevels(-1)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+MotionDetector::~MotionDetector()
+{
+    stopWorker();
+}
+
+void MotionDetector::setPyramidLevels(int levels)
+{
+    QMutexLocker locker(&_mutex);
+    levels = qBound(0, levels, 4);
+    if (levels != _pyramidLevels) {
+        // The background model is resolution specific
+        _pyramidLevels = levels;
+        _resetRequested = true;
+    }
+}
+
+void MotionDetector::setFrameStride(int stride)
+{
+    QMutexLocker locker(&_mutex);
+    _frameStride = qMax(1, stride);
+}
+
+void MotionDetector::submitFrame(const cv::Mat& frame)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_stats.framesSubmitted++ % _frameStride != 0) {
+        _stats.framesSkipped++;
+        return;
+    }
+    if (_framePending) {
+        _stats.framesDropped++;
+    }
+
+    // Reuses the buffer handed back by the worker when the frame size stays the same
+    frame.copyTo(_pendingFrame);
+    _framePending = true;
+    _frameAvailable.wakeOne();
+}
+
+cv::Rect MotionDetector::interestRect(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _interestRect;
+}
+
+void MotionDetector::reset(void)
+{
+    QMutexLocker locker(&_mutex);
+    _resetRequested = true;
+    _framePending = false;
+    _interestRect = cv::Rect();
+}
+
+MotionDetector::Stats_t MotionDetector::stats(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _stats;
+}
+
+void MotionDetector::stopWorker(void)
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _quit = true;
+        _frameAvailable.wakeAll();
+    }
+    wait();
+}
+
+cv::Rect MotionDetector::analyze(const cv::Mat& frame)
+{
+    int levels;
+    bool resetRequested;
+    {
+        QMutexLocker locker(&_mutex);
+        levels = _pyramidLevels;
+        resetRequested = _resetRequested;
+        _resetRequested = false;
+    }
+
+    if (resetRequested || !_subtractor) {
+        _subtractor = cv::createBackgroundSubtractorMOG2();
+    }
+
+    const cv::Mat* level = &frame;
+    if (frame.channels() == 3) {
+        cv::cvtColor(frame, _gray, cv::COLOR_BGR2GRAY);
+        level = &_gray;
+    }
+    for (int i = 0; i < levels; i++) {
+        // Ping pong between the two buffers so pyrDown never works in place
+        cv::Mat& dest = _pyramid[i & 1];
+        cv::pyrDown(*level, dest);
+        level = &dest;
+    }
+
+    _subtractor->apply(*level, _mask);
+
+    // Remove noise, the kernel shrinks with the image
+    if (_erodeKernelLevels != levels) {
+        int size = qMax(2, 6 >> levels);
+        _erodeKernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(size, size));
+        _erodeKernelLevels = levels;
+    }
+    cv::erode(_mask, _mask, _erodeKernel);
+
+    // Only the overall extent matters, so the outer contours are enough
+    cv::findContours(_mask, _contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+
+    cv::Rect motion;
+    for (size_t i = 0; i < _contours.size(); i++) {
+        cv::Rect bounds = cv::boundingRect(_contours[i]);
+        motion = motion.area() == 0 ? bounds : (motion | bounds);
+    }
+    if (motion.area() == 0) {
+        return cv::Rect();
+    }
+
+    int scale = 1 << levels;
+    cv::Rect scaled(motion.x * scale, motion.y * scale, motion.width * scale, motion.height * scale);
+    return scaled & cv::Rect(0, 0, frame.cols, frame.rows);
+}
+
+void MotionDetector::run(void)
+{
+    forever {
+        {
+            QMutexLocker locker(&_mutex);
+            while (!_quit && !_framePending) {
+                _frameAvailable.wait(&_mutex);
+            }
+            if (_quit) {
+                break;
+            }
+            // Hand our previous buffer back for the next submit to fill
+            cv::swap(_workFrame, _pendingFrame);
+            _framePending = false;
+        }
+
+        cv::Rect rect = analyze(_workFrame);
+
+        bool changed;
+        {
+            QMutexLocker locker(&_mutex);
+            changed = rect != _interestRect;
+            _interestRect = rect;
+            _stats.framesAnalyzed++;
+
+            if (!_fpsTimer.isValid()) {
+                _fpsTimer.start();
+            }
+            _fpsFrameCount++;
+            qint64 elapsed = _fpsTimer.elapsed();
+            if (elapsed >= 1000) {
+                _stats.analyzedFps = _fpsFrameCount * 1000.0 / elapsed;
+                _fpsFrameCount = 0;
+                _fpsTimer.restart();
+            }
+        }
+
+        if (changed) {
+            emit interestRectChanged(QRect(rect.x, rect.y, rect.width, rect.height));
+        }
+    }
+}
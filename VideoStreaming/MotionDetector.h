@@ -0,0 +1,112 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Background subtraction motion detector worker
+ */
+
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QRect>
+
+#include "opencv2/video/background_segm.hpp"
+
+#include "VideoFrameTap.h"
+
+/// Finds the area of motion in a video stream on its own thread.
+///
+/// Analysis runs on a downscaled (pyrDown) grayscale copy of the frame and the resulting rectangle is
+/// scaled back up to full frame coordinates. Only the newest frame is kept: a frame which arrives while
+/// the previous one is still waiting to be analyzed replaces it. The background model lives as long as
+/// the stream, call reset() when the stream restarts.
+class MotionDetector : public QThread, public VideoFrameTap::Client
+{
+    Q_OBJECT
+
+public:
+    MotionDetector(QObject* parent = NULL);
+    ~MotionDetector();
+
+    typedef struct {
+        quint64 framesSubmitted;
+        quint64 framesSkipped;      ///< Skipped because of the frame stride
+        quint64 framesDropped;      ///< Replaced by a newer frame before being analyzed
+        quint64 framesAnalyzed;
+        double  analyzedFps;        ///< Analysis throughput over the last second
+    } Stats_t;
+
+    /// Number of pyrDown steps before analysis, each one halves width and height. Default 2.
+    void setPyramidLevels(int levels);
+
+    /// Only every stride'th submitted frame is analyzed. Default 1.
+    void setFrameStride(int stride);
+
+    /// Queues a frame for analysis, replacing any frame still waiting. Thread safe.
+    ///     @param frame CV_8UC1 or CV_8UC3 (BGR) frame, only needs to be valid for the duration of the call
+    void submitFrame(const cv::Mat& frame);
+
+    /// @return Latest area of motion in full frame coordinates, empty if there is none. Thread safe.
+    cv::Rect interestRect(void) const;
+
+    /// Discards the background model and the latest result. Thread safe.
+    void reset(void);
+
+    /// Analyzes a single frame synchronously. Must only be called from one thread at a time, which is the
+    /// worker thread once it has been started.
+    ///     @return Area of motion in full frame coordinates
+    cv::Rect analyze(const cv::Mat& frame);
+
+    Stats_t stats(void) const;
+
+    /// Stops the worker thread and waits for the analysis in progress to finish
+    void stopWorker(void);
+
+    // Overrides from VideoFrameTap::Client
+    void frameCaptured(const cv::Mat& frame, qint64 requestUsecs) final { Q_UNUSED(requestUsecs); submitFrame(frame); }
+
+signals:
+    /// Emitted from the worker thread after each analyzed frame whose result differs from the previous one
+    void interestRectChanged(QRect rect);
+
+protected:
+    void run(void) final;
+
+private:
+    mutable QMutex      _mutex;
+    QWaitCondition      _frameAvailable;
+    cv::Mat             _pendingFrame;
+    bool                _framePending;
+    bool                _resetRequested;
+    bool                _quit;
+    int                 _pyramidLevels;
+    int                 _frameStride;
+    cv::Rect            _interestRect;
+    Stats_t             _stats;
+    QElapsedTimer       _fpsTimer;
+    quint64             _fpsFrameCount;
+
+    // Analysis state, only touched by the analyzing thread
+    cv::Ptr<cv::BackgroundSubtractor>   _subtractor;
+    cv::Mat                             _workFrame;
+    cv::Mat                             _gray;
+    cv::Mat                             _pyramid[2];
+    cv::Mat                             _mask;
+    cv::Mat                             _erodeKernel;
+    int                                 _erodeKernelLevels;
+    std::vector<std::vector<cv::Point> > _contours;
+};
+
+#endif // MOTION_DETECTOR_H
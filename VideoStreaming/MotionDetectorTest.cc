@@ -0,0 +1,181 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "MotionDetectorTest.h"
+#include "MotionDetector.h"
+
+#include "opencv2/opencv.hpp"
+
+#include <QElapsedTimer>
+#include <QSemaphore>
+
+#include <atomic>
+
+/// Number of frames of static background before the object starts moving
+static const int _cBackgroundFrames = 30;
+
+MotionDetectorTest::MotionDetectorTest(void)
+{
+
+}
+
+/// Static textured background with a bright object moving left to right once the background frames are over
+cv::Mat MotionDetectorTest::_syntheticFrame(int width, int height, int index, cv::Rect* objectRect)
+{
+    cv::Mat frame(height, width, CV_8UC1);
+    for (int y = 0; y < height; y++) {
+        uchar* row = frame.ptr<uchar>(y);
+        for (int x = 0; x < width; x++) {
+            row[x] = (uchar)(48 + ((x / 16 + y / 16) % 2) * 32);
+        }
+    }
+
+    cv::Rect object;
+    if (index >= _cBackgroundFrames) {
+        int objectWidth = width / 6;
+        int objectHeight = height / 6;
+        int step = width / 80;
+        int x = ((index - _cBackgroundFrames) * step) % (width - objectWidth);
+        object = cv::Rect(x, height / 2 - objectHeight / 2, objectWidth, objectHeight);
+        cv::rectangle(frame, object, cv::Scalar(240), CV_FILLED);
+    }
+    if (objectRect) {
+        *objectRect = object;
+    }
+
+    return frame;
+}
+
+QList<cv::Mat> MotionDetectorTest::_loadClip(void)
+{
+    QList<cv::Mat> frames;
+
+    QByteArray clipPath = qgetenv("QGC_MOTION_BENCHMARK_CLIP");
+    if (!clipPath.isEmpty()) {
+        cv::VideoCapture capture(clipPath.constData());
+        cv::Mat frame;
+        while (capture.read(frame)) {
+            cv::Mat gray;
+            cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+            frames.append(gray);
+        }
+    }
+
+    if (frames.isEmpty()) {
+        for (int i = 0; i < 150; i++) {
+            frames.append(_syntheticFrame(1920, 1080, i, NULL));
+        }
+    }
+
+    return frames;
+}
+
+void MotionDetectorTest::_testTracksMovingObject(void)
+{
+    MotionDetector detector;
+    detector.setPyramidLevels(2);
+
+    for (int i = 0; i < _cBackgroundFrames + 40; i++) {
+        cv::Rect object;
+        cv::Mat frame = _syntheticFrame(640, 480, i, &object);
+        cv::Rect motion = detector.analyze(frame);
+
+        if (i < _cBackgroundFrames) {
+            continue;
+        }
+        if (i > _cBackgroundFrames + 5) {
+            // The result is in full frame coordinates and covers most of the object without wandering off
+            QVERIFY(motion.area() > 0);
+            QVERIFY((motion & object).area() >= object.area() / 2);
+            QVERIFY(motion.area() <= object.area() * 4);
+            QVERIFY((motion & cv::Rect(0, 0, frame.cols, frame.rows)) == motion);
+        }
+    }
+}
+
+void MotionDetectorTest::_testWorkerDropsStaleFrames(void)
+{
+    MotionDetector detector;
+    detector.setPyramidLevels(2);
+    detector.setFrameStride(2);
+
+    // Slow consumer: while hold is set the worker parks in the callback until the test lets it go
+    std::atomic<bool> hold(true);
+    QSemaphore entered;
+    QSemaphore resume;
+    connect(&detector, &MotionDetector::interestRectChanged, [&hold, &entered, &resume](QRect rect) {
+        Q_UNUSED(rect);
+        if (hold) {
+            entered.release();
+            resume.acquire();
+        }
+    }, Qt::DirectConnection);
+    detector.start();
+
+    // Feed the moving object until the worker reports a change and gets stuck
+    int index = 0;
+    bool blocked = false;
+    while (!blocked && index < _cBackgroundFrames + 40) {
+        detector.submitFrame(_syntheticFrame(640, 480, index++, NULL));
+        blocked = entered.tryAcquire(1, 50);
+    }
+    QVERIFY(blocked);
+
+    const int cFrames = 20;
+    MotionDetector::Stats_t before = detector.stats();
+    for (int i = 0; i < cFrames; i++) {
+        detector.submitFrame(_syntheticFrame(640, 480, index++, NULL));
+    }
+    MotionDetector::Stats_t stats = detector.stats();
+
+    // Nothing analyzed while the worker is busy, only the newest frame which passed the stride waits
+    QCOMPARE(stats.framesSubmitted - before.framesSubmitted, (quint64)cFrames);
+    QCOMPARE(stats.framesSkipped - before.framesSkipped, (quint64)cFrames / 2);
+    QCOMPARE(stats.framesAnalyzed, before.framesAnalyzed);
+    QVERIFY(stats.framesDropped - before.framesDropped > 0);
+    QVERIFY(stats.framesDropped - before.framesDropped >= (quint64)cFrames / 2 - 1);
+
+    hold = false;
+    resume.release();
+
+    // Once the worker is free every frame which passed the stride has been analyzed or replaced, never queued
+    quint64 passed = stats.framesSubmitted - stats.framesSkipped;
+    QElapsedTimer timeout;
+    timeout.start();
+    do {
+        QTest::qWait(20);
+        stats = detector.stats();
+    } while (stats.framesAnalyzed + stats.framesDropped < passed && timeout.elapsed() < 5000);
+
+    QCOMPARE(stats.framesAnalyzed + stats.framesDropped, passed);
+
+    detector.stopWorker();
+}
+
+void MotionDetectorTest::_benchmarkAnalysis(void)
+{
+    QList<cv::Mat> frames = _loadClip();
+
+    int rgLevels[] = { 0, 2 };
+    for (size_t i = 0; i < sizeof(rgLevels) / sizeof(rgLevels[0]); i++) {
+        MotionDetector detector;
+        detector.setPyramidLevels(rgLevels[i]);
+
+        QElapsedTimer timer;
+        timer.start();
+        foreach (const cv::Mat& frame, frames) {
+            detector.analyze(frame);
+        }
+        qint64 elapsed = qMax((qint64)1, timer.elapsed());
+
+        double fps = frames.count() * 1000.0 / elapsed;
+        QVERIFY(fps > 0);
+    }
+}
@@ -0,0 +1,39 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef MotionDetectorTest_H
+#define MotionDetectorTest_H
+
+#include "UnitTest.h"
+
+#include "opencv2/core/core.hpp"
+
+/// Unit test and benchmark for MotionDetector
+///
+/// The benchmark runs over the clip named by the QGC_MOTION_BENCHMARK_CLIP environment variable if it
+/// is set, otherwise over a generated 1080p clip with a single moving object.
+class MotionDetectorTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    MotionDetectorTest(void);
+
+private slots:
+    void _testTracksMovingObject(void);
+    void _testWorkerDropsStaleFrames(void);
+    void _benchmarkAnalysis(void);
+
+private:
+    cv::Mat     _syntheticFrame(int width, int height, int index, cv::Rect* objectRect);
+    QList<cv::Mat> _loadClip(void);
+};
+
+#endif
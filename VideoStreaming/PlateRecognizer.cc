@@ -0,0 +1,152 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief License plate recognition worker
+ */
+
+#include "PlateRecognizer.h"
+#include "VideoReceiver.h"
+
+#include <alpr.h>
+
+PlateRecognizer::PlateRecognizer(const QString& country, const QString& configFile, QObject* parent)
+    : QThread(parent)
+    , _country(country)
+    , _configFile(configFile)
+    , _quit(false)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+PlateRecognizer::~PlateRecognizer()
+{
+    stopWorker();
+}
+
+void PlateRecognizer::setRoi(const cv::Rect& roi)
+{
+    QMutexLocker locker(&_mutex);
+    _roi = roi;
+}
+
+void PlateRecognizer::_smooth(double& average, double sample, quint64 count)
+{
+    average = count <= 1 ? sample : (0.8 * average) + (0.2 * sample);
+}
+
+void PlateRecognizer::submitFrame(const cv::Mat& frame, qint64 requestUsecs)
+{
+    qint64 arrivalUsecs = VideoFrameTap::monotonicUsecs();
+
+    cv::Rect roi;
+    {
+        QMutexLocker locker(&_mutex);
+        roi = _roi;
+    }
+    roi &= cv::Rect(0, 0, frame.cols, frame.rows);
+    if (roi.area() == 0) {
+        roi = cv::Rect(0, 0, frame.cols, frame.rows);
+    }
+
+    // Deep copy of just the region, the frame itself belongs to the caller
+    Frame_t queued;
+    frame(roi).copyTo(queued.image);
+    qint64 croppedUsecs = VideoFrameTap::monotonicUsecs();
+
+    QMutexLocker locker(&_mutex);
+
+    _stats.framesSubmitted++;
+    _smooth(_stats.captureMsecs, (arrivalUsecs - requestUsecs) / 1000.0, _stats.framesSubmitted);
+    _smooth(_stats.cropMsecs, (croppedUsecs - arrivalUsecs) / 1000.0, _stats.framesSubmitted);
+
+    if (_frames.count() >= maxQueuedFrames) {
+        _frames.dequeue();
+        _stats.framesDropped++;
+    }
+    _frames.enqueue(queued);
+    _frameAvailable.wakeOne();
+}
+
+PlateRecognizer::Stats_t PlateRecognizer::stats(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _stats;
+}
+
+void PlateRecognizer::stopWorker(void)
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _quit = true;
+        _frameAvailable.wakeAll();
+    }
+    wait();
+}
+
+void PlateRecognizer::run(void)
+{
+    // Model load is the expensive part, it is only done once per worker
+    alpr::Alpr recognizer(_country.toStdString(), _configFile.toStdString());
+    recognizer.setTopN(10);
+    recognizer.setDefaultRegion("");
+    if (!recognizer.isLoaded()) {
+        qWarning() << "PlateRecognizer: failed to load OpenALPR" << _country << _configFile;
+    }
+
+    forever {
+        Frame_t frame;
+        {
+            QMutexLocker locker(&_mutex);
+            while (!_quit && _frames.isEmpty()) {
+                _frameAvailable.wait(&_mutex);
+            }
+            if (_quit) {
+                break;
+            }
+            frame = _frames.dequeue();
+        }
+
+        if (!recognizer.isLoaded()) {
+            continue;
+        }
+
+        qint64 startUsecs = VideoFrameTap::monotonicUsecs();
+
+        std::vector<alpr::AlprRegionOfInterest> regionsOfInterest;
+        regionsOfInterest.push_back(alpr::AlprRegionOfInterest(0, 0, frame.image.cols, frame.image.rows));
+        alpr::AlprResults results = recognizer.recognize(frame.image.data, frame.image.elemSize(), frame.image.cols, frame.image.rows, regionsOfInterest);
+
+        double recognizeMsecs = (VideoFrameTap::monotonicUsecs() - startUsecs) / 1000.0;
+
+        QString result;
+        for (size_t i = 0; i < results.plates.size(); i++) {
+            const alpr::AlprPlateResult& plate = results.plates[i];
+            result.append(QStringLiteral("plate%1: %2 results\n").arg(i).arg(plate.topNPlates.size()));
+            for (size_t k = 0; k < plate.topNPlates.size(); k++) {
+                const alpr::AlprPlate& candidate = plate.topNPlates[k];
+                result.append(QStringLiteral("    - %1 confidence: %2\n").arg(QString::fromStdString(candidate.characters)).arg(candidate.overall_confidence, 0, 'f', 4));
+            }
+        }
+
+        Stats_t stats;
+        {
+            QMutexLocker locker(&_mutex);
+            _stats.framesRecognized++;
+            _smooth(_stats.recognizeMsecs, recognizeMsecs, _stats.framesRecognized);
+            stats = _stats;
+        }
+        qCDebug(VideoReceiverLog) << "Plate recognition" << "capture(ms)" << stats.captureMsecs << "crop(ms)" << stats.cropMsecs
+                                  << "recognize(ms)" << recognizeMsecs << "dropped" << stats.framesDropped;
+
+        emit plateRecognized(result);
+    }
+}
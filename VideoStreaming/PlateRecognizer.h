@@ -0,0 +1,93 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief License plate recognition worker
+ */
+
+#ifndef PLATE_RECOGNIZER_H
+#define PLATE_RECOGNIZER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QString>
+
+#include "VideoFrameTap.h"
+
+/// Runs OpenALPR on its own thread against a recognizer which is loaded once and kept for the
+/// lifetime of the worker.
+///
+/// Frames come in through the VideoFrameTap::Client interface (or submitFrame for still images).
+/// Only the region of interest is copied out of the frame, on the caller's thread. Cropped frames
+/// wait in a small bounded queue, when the recognizer falls behind the oldest waiting frame is dropped.
+class PlateRecognizer : public QThread, public VideoFrameTap::Client
+{
+    Q_OBJECT
+
+public:
+    PlateRecognizer(const QString& country = "eu", const QString& configFile = "openalpr.conf", QObject* parent = NULL);
+    ~PlateRecognizer();
+
+    typedef struct {
+        quint64 framesSubmitted;
+        quint64 framesDropped;      ///< Dropped because the queue was full
+        quint64 framesRecognized;
+        double  captureMsecs;       ///< Request to frame arrival, smoothed
+        double  cropMsecs;          ///< Region of interest copy, smoothed
+        double  recognizeMsecs;     ///< OpenALPR recognize call, smoothed
+    } Stats_t;
+
+    /// Sets the region of interest in frame pixel coordinates, an empty rect uses the whole frame. Thread safe.
+    void setRoi(const cv::Rect& roi);
+
+    /// Queues a frame for recognition, cropped to the current region of interest. Thread safe.
+    ///     @param frame BGR frame, only needs to be valid for the duration of the call
+    ///     @param requestUsecs VideoFrameTap::monotonicUsecs time the frame was asked for
+    void submitFrame(const cv::Mat& frame, qint64 requestUsecs);
+
+    Stats_t stats(void) const;
+
+    /// Stops the worker thread and waits for the recognition in progress to finish
+    void stopWorker(void);
+
+    // Overrides from VideoFrameTap::Client
+    void frameCaptured(const cv::Mat& frame, qint64 requestUsecs) final { submitFrame(frame, requestUsecs); }
+
+    static const int maxQueuedFrames = 2;
+
+signals:
+    /// Emitted from the worker thread with the formatted candidate list for each recognized frame
+    void plateRecognized(QString result);
+
+protected:
+    void run(void) final;
+
+private:
+    typedef struct {
+        cv::Mat image;
+    } Frame_t;
+
+    static void _smooth(double& average, double sample, quint64 count);
+
+    QString             _country;
+    QString             _configFile;
+
+    mutable QMutex      _mutex;
+    QWaitCondition      _frameAvailable;
+    QQueue<Frame_t>     _frames;
+    cv::Rect            _roi;
+    bool                _quit;
+    Stats_t             _stats;
+};
+
+#endif // PLATE_RECOGNIZER_H
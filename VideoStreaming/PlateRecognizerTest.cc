@@ -0,0 +1,71 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "PlateRecognizerTest.h"
+#include "PlateRecognizer.h"
+#include "VideoReceiver.h"
+
+PlateRecognizerTest::PlateRecognizerTest(void)
+{
+
+}
+
+cv::Mat PlateRecognizerTest::_testFrame(int width, int height)
+{
+    return cv::Mat(height, width, CV_8UC3, cv::Scalar(40, 80, 120));
+}
+
+void PlateRecognizerTest::_testFullQueueDropsFrames(void)
+{
+    // Worker not started, so nothing leaves the queue
+    PlateRecognizer recognizer;
+    recognizer.setRoi(cv::Rect(100, 100, 200, 80));
+
+    const int cFrames = PlateRecognizer::maxQueuedFrames + 3;
+    const qint64 requestDelayUsecs = 20000;
+    for (int i = 0; i < cFrames; i++) {
+        recognizer.submitFrame(_testFrame(640, 480), VideoFrameTap::monotonicUsecs() - requestDelayUsecs);
+    }
+
+    PlateRecognizer::Stats_t stats = recognizer.stats();
+    QCOMPARE(stats.framesSubmitted, (quint64)cFrames);
+    QCOMPARE(stats.framesDropped, (quint64)(cFrames - PlateRecognizer::maxQueuedFrames));
+    QCOMPARE(stats.framesRecognized, (quint64)0);
+    QVERIFY(stats.captureMsecs >= requestDelayUsecs / 1000.0);
+    QVERIFY(stats.cropMsecs >= 0);
+
+    // A region of interest outside the frame falls back to the whole frame
+    recognizer.setRoi(cv::Rect(1000, 1000, 50, 50));
+    recognizer.submitFrame(_testFrame(640, 480), VideoFrameTap::monotonicUsecs());
+    stats = recognizer.stats();
+    QCOMPARE(stats.framesSubmitted, (quint64)cFrames + 1);
+    QCOMPARE(stats.framesDropped, (quint64)(cFrames + 1 - PlateRecognizer::maxQueuedFrames));
+}
+
+void PlateRecognizerTest::_testReceiverCreatesOnlyWhenEnabled(void)
+{
+    VideoReceiver receiver;
+    QSignalSpy spyChanged(&receiver, SIGNAL(plateRecognitionChanged()));
+    QVERIFY(spyChanged.isValid());
+
+    // No worker until asked for, and asking for a plate without one is harmless
+    QVERIFY(!receiver.plateRecognition());
+    receiver.saveImg();
+
+    receiver.setPlateRecognition(true);
+    QVERIFY(receiver.plateRecognition());
+    receiver.setPlateRecognition(true);
+    QCOMPARE(spyChanged.count(), 1);
+
+    receiver.setPlateRecognition(false);
+    QVERIFY(!receiver.plateRecognition());
+    QCOMPARE(spyChanged.count(), 2);
+    receiver.saveImg();
+}
@@ -0,0 +1,34 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef PlateRecognizerTest_H
+#define PlateRecognizerTest_H
+
+#include "UnitTest.h"
+
+#include "opencv2/core/core.hpp"
+
+/// Unit test for PlateRecognizer queueing and VideoReceiver plate recognition switching
+class PlateRecognizerTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    PlateRecognizerTest(void);
+
+private slots:
+    void _testFullQueueDropsFrames(void);
+    void _testReceiverCreatesOnlyWhenEnabled(void);
+
+private:
+    cv::Mat _testFrame(int width, int height);
+};
+
+#endif
@@ -0,0 +1,346 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Segmented video recording branch
+ */
+
+#include "SegmentedRecorder.h"
+#include "VideoSegmentStore.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+
+SegmentedRecorder::SegmentedRecorder(VideoSegmentStore* store, QObject* parent)
+    : QObject(parent)
+    , _store(store)
+    , _state(StateIdle)
+    , _maxSegmentSecs(300)
+    , _maxSegmentBytes(0)
+    , _filePrefix("XH")
+    , _segmentsWritten(0)
+#if defined(QGC_GST_STREAMING)
+    , _pipeline(NULL)
+    , _tee(NULL)
+    , _teePad(NULL)
+    , _queue(NULL)
+    , _parse(NULL)
+    , _splitmux(NULL)
+    , _pipelineStop(NULL)
+    , _removing(FALSE)
+#endif
+{
+}
+
+SegmentedRecorder::~SegmentedRecorder()
+{
+#if defined(QGC_GST_STREAMING)
+    // A branch still in the main pipeline must have been dropped with pipelineShutdown() already
+    if (_pipelineStop) {
+        _finishStop();
+    }
+#endif
+}
+
+#if defined(QGC_GST_STREAMING)
+bool SegmentedRecorder::start(GstElement* pipeline, GstElement* tee)
+{
+    if (_state != StateIdle) {
+        qWarning() << "SegmentedRecorder::start() already recording";
+        return false;
+    }
+    if (!pipeline || !tee) {
+        qCritical() << "SegmentedRecorder::start() called without a pipeline";
+        return false;
+    }
+
+    _sessionDirectory = _store->directory();
+    QDir dir(_sessionDirectory);
+    if (_sessionDirectory.isEmpty() || (!dir.exists() && !dir.mkpath("."))) {
+        qCritical() << "SegmentedRecorder::start() unable to create" << _sessionDirectory;
+        return false;
+    }
+    _sessionName = _filePrefix + QDateTime::currentDateTime().toString("yyyyMMddhhmmsszzz");
+
+    GstElement* mux = gst_element_factory_make("matroskamux", NULL);
+    _queue      = gst_element_factory_make("queue", NULL);
+    _parse      = gst_element_factory_make("h264parse", NULL);
+    _splitmux   = gst_element_factory_make("splitmuxsink", NULL);
+
+    if (!mux || !_queue || !_parse || !_splitmux) {
+        qCritical() << "SegmentedRecorder::start() failed to make elements";
+        // Not in a bin yet, we still own the floating references
+        GstElement* rgElements[] = { mux, _queue, _parse, _splitmux };
+        for (size_t i = 0; i < sizeof(rgElements) / sizeof(rgElements[0]); i++) {
+            if (rgElements[i]) {
+                gst_object_unref(rgElements[i]);
+            }
+        }
+        _queue = _parse = _splitmux = NULL;
+        return false;
+    }
+
+    // splitmuxsink only cuts at keyframes, so a segment can run slightly over either limit
+    g_object_set(G_OBJECT(_splitmux),
+                 "muxer",           mux,
+                 "max-size-time",   (guint64)_maxSegmentSecs * GST_SECOND,
+                 "max-size-bytes",  (guint64)_maxSegmentBytes,
+                 NULL);
+    g_signal_connect(_splitmux, "format-location", G_CALLBACK(_formatLocation), this);
+
+    // Keep our own references, the branch moves to another pipeline when stopping
+    gst_object_ref(_queue);
+    gst_object_ref(_parse);
+    gst_object_ref(_splitmux);
+
+    gst_bin_add_many(GST_BIN(pipeline), _queue, _parse, _splitmux, NULL);
+    if (!gst_element_link_many(_queue, _parse, _splitmux, NULL)) {
+        qCritical() << "SegmentedRecorder::start() failed to link elements";
+        gst_bin_remove_many(GST_BIN(pipeline), _queue, _parse, _splitmux, NULL);
+        _releaseElements();
+        return false;
+    }
+
+    gst_element_sync_state_with_parent(_queue);
+    gst_element_sync_state_with_parent(_parse);
+    gst_element_sync_state_with_parent(_splitmux);
+
+    _teePad = gst_element_get_request_pad(tee, "src_%u");
+    GstPad* sinkPad = gst_element_get_static_pad(_queue, "sink");
+    GstPadLinkReturn linked = _teePad ? gst_pad_link(_teePad, sinkPad) : GST_PAD_LINK_REFUSED;
+    gst_object_unref(sinkPad);
+
+    if (linked != GST_PAD_LINK_OK) {
+        qCritical() << "SegmentedRecorder::start() failed to link to tee";
+        if (_teePad) {
+            gst_element_release_request_pad(tee, _teePad);
+            gst_object_unref(_teePad);
+            _teePad = NULL;
+        }
+        gst_element_set_state(_splitmux, GST_STATE_NULL);
+        gst_element_set_state(_parse, GST_STATE_NULL);
+        gst_element_set_state(_queue, GST_STATE_NULL);
+        gst_bin_remove_many(GST_BIN(pipeline), _queue, _parse, _splitmux, NULL);
+        _releaseElements();
+        return false;
+    }
+
+    _pipeline = pipeline;
+    _tee = tee;
+    _removing = FALSE;
+    _state = StateRecording;
+    emit recordingChanged();
+
+    // Make room for the new recording up front
+    _store->enforceQuota();
+    return true;
+}
+#endif
+
+void SegmentedRecorder::stop(void)
+{
+#if defined(QGC_GST_STREAMING)
+    if (_state != StateRecording) {
+        return;
+    }
+    _state = StateStopping;
+    // Wait for data block before unlinking
+    gst_pad_add_probe(_teePad, GST_PAD_PROBE_TYPE_IDLE, _unlinkCallBack, this, NULL);
+#endif
+}
+
+void SegmentedRecorder::pipelineShutdown(void)
+{
+#if defined(QGC_GST_STREAMING)
+    if (_state == StateIdle) {
+        return;
+    }
+    // If the branch was already detached it is draining in its own pipeline and _finishStop() completes it
+    if (!g_atomic_int_compare_and_exchange(&_removing, FALSE, TRUE)) {
+        return;
+    }
+    if (_teePad) {
+        gst_element_release_request_pad(_tee, _teePad);
+        gst_object_unref(_teePad);
+        _teePad = NULL;
+    }
+    // The elements stay in the pipeline and go with it
+    _releaseElements();
+    _closeSegment();
+    _pipeline = NULL;
+    _tee = NULL;
+    _state = StateIdle;
+    emit recordingChanged();
+    emit stopped();
+#endif
+}
+
+void SegmentedRecorder::_segmentStarted(QString fileName)
+{
+    if (_state == StateIdle) {
+        // Late notification from a branch which is already gone
+        return;
+    }
+    // splitmuxsink has finalized the previous segment before asking for the next location
+    _closeSegment();
+
+    _currentSegment = fileName;
+    _segmentStartTime = QDateTime::currentDateTime();
+    _segmentTimer.start();
+    _store->setActiveSegment(fileName);
+    emit segmentOpened(fileName);
+    _store->enforceQuota();
+}
+
+void SegmentedRecorder::_closeSegment(void)
+{
+    if (_currentSegment.isEmpty()) {
+        return;
+    }
+
+    VideoSegmentStore::Segment_t segment;
+    segment.fileName = _currentSegment;
+    segment.started = _segmentStartTime;
+    segment.durationMsecs = _segmentTimer.elapsed();
+    segment.bytes = QFileInfo(QDir(_sessionDirectory).filePath(_currentSegment)).size();
+
+    _store->setActiveSegment(QString());
+    _store->addSegment(segment);
+    _segmentsWritten++;
+
+    QString fileName = _currentSegment;
+    _currentSegment.clear();
+    emit segmentClosed(fileName);
+}
+
+void SegmentedRecorder::_finishStop(void)
+{
+#if defined(QGC_GST_STREAMING)
+    if (!_pipelineStop) {
+        // Both EOS and an error made it here
+        return;
+    }
+
+    GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(_pipelineStop));
+    gst_bus_disable_sync_message_emission(bus);
+    gst_object_unref(bus);
+
+    gst_element_set_state(_pipelineStop, GST_STATE_NULL);
+    gst_object_unref(_pipelineStop);
+    _pipelineStop = NULL;
+
+    _releaseElements();
+    _closeSegment();
+    _pipeline = NULL;
+    _tee = NULL;
+    _state = StateIdle;
+
+    emit recordingChanged();
+    emit stopped();
+#endif
+}
+
+#if defined(QGC_GST_STREAMING)
+void SegmentedRecorder::_releaseElements(void)
+{
+    GstElement** rgElements[] = { &_splitmux, &_parse, &_queue };
+    for (size_t i = 0; i < sizeof(rgElements) / sizeof(rgElements[0]); i++) {
+        if (*rgElements[i]) {
+            gst_element_set_state(*rgElements[i], GST_STATE_NULL);
+            gst_object_unref(*rgElements[i]);
+            *rgElements[i] = NULL;
+        }
+    }
+}
+
+// Called on the streaming thread each time splitmuxsink opens a new file
+gchar* SegmentedRecorder::_formatLocation(GstElement* splitmux, guint fragmentId, gpointer user_data)
+{
+    Q_UNUSED(splitmux);
+    SegmentedRecorder* pThis = (SegmentedRecorder*)user_data;
+
+    QString fileName = QString("%1_%2.mkv").arg(pThis->_sessionName).arg(fragmentId, 4, 10, QChar('0'));
+    QMetaObject::invokeMethod(pThis, "_segmentStarted", Qt::QueuedConnection, Q_ARG(QString, fileName));
+
+    return g_strdup(QDir(pThis->_sessionDirectory).filePath(fileName).toUtf8().constData());
+}
+
+GstPadProbeReturn SegmentedRecorder::_unlinkCallBack(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    Q_UNUSED(pad);
+    if(info != NULL && user_data != NULL) {
+        SegmentedRecorder* pThis = (SegmentedRecorder*)user_data;
+        // We will only act once
+        if(g_atomic_int_compare_and_exchange(&pThis->_removing, FALSE, TRUE)) {
+            pThis->_detach();
+        }
+    }
+    return GST_PAD_PROBE_REMOVE;
+}
+
+//-----------------------------------------------------------------------------
+// -Unlink the recording branch from the tee in the main pipeline
+// -Move the branch into a temporary pipeline and send EOS into it
+// -The EOS handler on the temporary pipeline's bus finishes the stop
+void SegmentedRecorder::_detach(void)
+{
+    GstPad* sinkPad = gst_element_get_static_pad(_queue, "sink");
+    gst_pad_unlink(_teePad, sinkPad);
+    gst_object_unref(sinkPad);
+
+    // Give tee its pad back
+    gst_element_release_request_pad(_tee, _teePad);
+    gst_object_unref(_teePad);
+    _teePad = NULL;
+
+    gst_bin_remove_many(GST_BIN(_pipeline), _queue, _parse, _splitmux, NULL);
+
+    _pipelineStop = gst_pipeline_new("pipeStopSegments");
+    gst_bin_add_many(GST_BIN(_pipelineStop), _queue, _parse, _splitmux, NULL);
+    gst_element_link_many(_queue, _parse, _splitmux, NULL);
+
+    GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(_pipelineStop));
+    gst_bus_enable_sync_message_emission(bus);
+    g_signal_connect(bus, "sync-message", G_CALLBACK(_onBusMessage), this);
+    gst_object_unref(bus);
+
+    if(gst_element_set_state(_pipelineStop, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        qWarning() << "SegmentedRecorder: problem starting _pipelineStop";
+    }
+
+    // Send EOS at the beginning of the pipeline
+    sinkPad = gst_element_get_static_pad(_queue, "sink");
+    gst_pad_send_event(sinkPad, gst_event_new_eos());
+    gst_object_unref(sinkPad);
+}
+
+gboolean SegmentedRecorder::_onBusMessage(GstBus* bus, GstMessage* msg, gpointer data)
+{
+    Q_UNUSED(bus)
+    Q_ASSERT(msg != NULL && data != NULL);
+    SegmentedRecorder* pThis = (SegmentedRecorder*)data;
+
+    switch(GST_MESSAGE_TYPE(msg)) {
+    case GST_MESSAGE_ERROR:
+        qWarning() << "SegmentedRecorder: error while finalizing the last segment";
+        QMetaObject::invokeMethod(pThis, "_finishStop", Qt::QueuedConnection);
+        break;
+    case GST_MESSAGE_EOS:
+        QMetaObject::invokeMethod(pThis, "_finishStop", Qt::QueuedConnection);
+        break;
+    default:
+        break;
+    }
+
+    return TRUE;
+}
+#endif
@@ -0,0 +1,133 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Segmented video recording branch
+ */
+
+#ifndef SEGMENTED_RECORDER_H
+#define SEGMENTED_RECORDER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QString>
+
+#if defined(QGC_GST_STREAMING)
+#include <gst/gst.h>
+#endif
+
+class VideoSegmentStore;
+
+/// Records the encoded stream of a tee into a series of Matroska segments.
+///
+///     tee-->queue-->h264parse-->splitmuxsink(matroskamux)
+///
+/// splitmuxsink starts a new file once the current one reaches the duration or size limit, always at the
+/// next keyframe, so every segment plays on its own. Finished segments are added to the VideoSegmentStore,
+/// which keeps the recording directory within its quota.
+///
+/// Stopping unlinks the branch from the tee once the pad is idle and moves it into a temporary pipeline which
+/// is drained with EOS, so the last segment is finalized without stalling the main pipeline.
+class SegmentedRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// @param store Receives finished segments, the recording directory is taken from it
+    SegmentedRecorder(VideoSegmentStore* store, QObject* parent = NULL);
+    ~SegmentedRecorder();
+
+    /// @param seconds Maximum segment duration, 0 for no limit. Applies from the next start.
+    void setMaxSegmentDuration(int seconds) { _maxSegmentSecs = qMax(0, seconds); }
+
+    /// @param bytes Maximum segment size, 0 for no limit. Applies from the next start.
+    void setMaxSegmentBytes(qint64 bytes) { _maxSegmentBytes = qMax((qint64)0, bytes); }
+
+    /// Prefix of the segment file names, followed by the start time and the segment number
+    void setFilePrefix(const QString& prefix) { _filePrefix = prefix; }
+
+    /// @return true from start() until the last segment is finalized
+    bool recording(void) const { return _state != StateIdle; }
+
+    /// @return File name of the segment being written, empty for none
+    QString currentSegment(void) const { return _currentSegment; }
+
+    /// @return Number of segments finished since construction
+    int segmentsWritten(void) const { return _segmentsWritten; }
+
+#if defined(QGC_GST_STREAMING)
+    /// Adds the recording branch to a running pipeline
+    ///     @param tee Tee carrying parsed H.264
+    bool start(GstElement* pipeline, GstElement* tee);
+#endif
+
+    /// Finalizes the current segment and removes the branch. stopped() is emitted once the file is complete.
+    void stop(void);
+
+    /// The pipeline is being destroyed. Drops the branch without finalizing the current segment. Call
+    /// after the pipeline has been set to the NULL state.
+    void pipelineShutdown(void);
+
+signals:
+    void recordingChanged(void);
+    void segmentOpened(QString fileName);
+    void segmentClosed(QString fileName);
+    void stopped(void);
+
+private slots:
+    void _segmentStarted(QString fileName);
+    void _finishStop(void);
+
+private:
+#if defined(QGC_GST_STREAMING)
+    static gchar*               _formatLocation (GstElement* splitmux, guint fragmentId, gpointer user_data);
+    static GstPadProbeReturn    _unlinkCallBack (GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+    static gboolean             _onBusMessage   (GstBus* bus, GstMessage* message, gpointer user_data);
+    void                        _detach         (void);
+    void                        _releaseElements(void);
+#endif
+    void                        _closeSegment   (void);
+
+    typedef enum {
+        StateIdle,
+        StateRecording,
+        StateStopping
+    } State_t;
+
+    VideoSegmentStore*  _store;
+    State_t             _state;
+    int                 _maxSegmentSecs;
+    qint64              _maxSegmentBytes;
+    QString             _filePrefix;
+
+    // Written on start() before the branch is linked, read only on the streaming thread afterwards
+    QString             _sessionDirectory;
+    QString             _sessionName;
+
+    QString             _currentSegment;
+    QDateTime           _segmentStartTime;
+    QElapsedTimer       _segmentTimer;
+    int                 _segmentsWritten;
+
+#if defined(QGC_GST_STREAMING)
+    GstElement*         _pipeline;
+    GstElement*         _tee;
+    GstPad*             _teePad;
+    GstElement*         _queue;
+    GstElement*         _parse;
+    GstElement*         _splitmux;
+    GstElement*         _pipelineStop;      ///< Temporary pipeline draining the detached branch
+    gint                _removing;
+#endif
+};
+
+#endif // SEGMENTED_RECORDER_H
@@ -0,0 +1,181 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "SegmentedRecorderTest.h"
+#include "SegmentedRecorder.h"
+#include "VideoSegmentStore.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+SegmentedRecorderTest::SegmentedRecorderTest(void)
+{
+
+}
+
+void SegmentedRecorderTest::_writeFile(const QString& path, int bytes)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(bytes, 'x'));
+}
+
+/// Live 320x240 test pattern with a keyframe every 10 frames:
+///     videotestsrc-->x264enc-->h264parse-->tee-->queue-->fakesink
+GstElement* SegmentedRecorderTest::_makeSourcePipeline(GstElement** tee)
+{
+    GError* error = NULL;
+    GstElement* pipeline = gst_parse_launch(
+                "videotestsrc is-live=true pattern=ball ! video/x-raw,width=320,height=240,framerate=30/1 ! "
+                "x264enc tune=zerolatency speed-preset=ultrafast key-int-max=10 bitrate=2000 ! h264parse ! "
+                "tee name=recordTee ! queue ! fakesink sync=false", &error);
+    if (error) {
+        g_error_free(error);
+        if (pipeline) {
+            gst_object_unref(pipeline);
+        }
+        return NULL;
+    }
+    *tee = gst_bin_get_by_name(GST_BIN(pipeline), "recordTee");
+    return pipeline;
+}
+
+void SegmentedRecorderTest::_testQuotaRemovesOldest(void)
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Three old segments from a previous run which are not in any index yet
+    QStringList rgOld;
+    rgOld << "XH_old_1.mkv" << "XH_old_2.mkv" << "XH_old_3.mkv";
+    for (int i = 0; i < rgOld.count(); i++) {
+        _writeFile(QDir(dir.path()).filePath(rgOld[i]), 40 * 1024);
+    }
+
+    VideoSegmentStore store;
+    QSignalSpy spyEnforced(&store, SIGNAL(quotaEnforced(qint64)));
+    store.start();
+    store.setDirectory(dir.path());
+    QVERIFY(spyEnforced.wait(5000));
+    QCOMPARE(store.segments().count(), 3);
+
+    // Newer segments in the index, the active one must survive no matter what
+    for (int i = 0; i < 3; i++) {
+        QString fileName = QString("XH_new_%1.mkv").arg(i);
+        _writeFile(QDir(dir.path()).filePath(fileName), 40 * 1024);
+        VideoSegmentStore::Segment_t segment;
+        segment.fileName = fileName;
+        segment.started = QDateTime::currentDateTime().addSecs(60 + i);
+        segment.durationMsecs = 1000;
+        segment.bytes = 40 * 1024;
+        store.addSegment(segment);
+    }
+    _writeFile(QDir(dir.path()).filePath("XH_active.mkv"), 40 * 1024);
+    store.setActiveSegment("XH_active.mkv");
+
+    spyEnforced.clear();
+    store.setQuota(130 * 1024);
+    store.enforceQuota();
+    while (spyEnforced.count() == 0 || spyEnforced.last()[0].toLongLong() > 130 * 1024) {
+        QVERIFY(spyEnforced.wait(5000));
+    }
+
+    // Old files went first, then the oldest new ones, the active segment stays
+    QVERIFY(QFileInfo(QDir(dir.path()).filePath("XH_active.mkv")).exists());
+    QVERIFY(QFileInfo(QDir(dir.path()).filePath("XH_new_2.mkv")).exists());
+    QVERIFY(QFileInfo(QDir(dir.path()).filePath("XH_new_1.mkv")).exists());
+    QVERIFY(!QFileInfo(QDir(dir.path()).filePath("XH_new_0.mkv")).exists());
+    foreach (const QString& fileName, rgOld) {
+        QVERIFY(!QFileInfo(QDir(dir.path()).filePath(fileName)).exists());
+    }
+    QCOMPARE(store.removedCount(), (quint64)4);
+
+    // The index on disk matches what is left
+    QFile index(QDir(dir.path()).filePath(VideoSegmentStore::indexFileName));
+    QVERIFY(index.open(QIODevice::ReadOnly | QIODevice::Text));
+    QStringList lines = QString(index.readAll()).split('\n', QString::SkipEmptyParts);
+    QCOMPARE(lines.count(), 2);
+    QVERIFY(lines[0].startsWith("XH_new_1.mkv\t"));
+    QVERIFY(lines[1].startsWith("XH_new_2.mkv\t"));
+
+    store.stopWorker();
+}
+
+void SegmentedRecorderTest::_testRecordingRollsOver(void)
+{
+    gst_init(NULL, NULL);
+
+    GstElement* tee = NULL;
+    GstElement* pipeline = _makeSourcePipeline(&tee);
+    if (!pipeline) {
+        QSKIP("x264enc not available");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const qint64 quota = 300 * 1024;
+
+    VideoSegmentStore store;
+    store.start();
+    store.setDirectory(dir.path());
+    store.setQuota(quota);
+
+    QSignalSpy spyEnforced(&store, SIGNAL(quotaEnforced(qint64)));
+
+    SegmentedRecorder recorder(&store);
+    recorder.setMaxSegmentDuration(1);
+    QSignalSpy spyClosed(&recorder, SIGNAL(segmentClosed(QString)));
+    QSignalSpy spyStopped(&recorder, SIGNAL(stopped()));
+
+    QVERIFY(gst_element_set_state(pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+    QVERIFY(recorder.start(pipeline, tee));
+    QVERIFY(recorder.recording());
+
+    QTest::qWait(6000);
+    recorder.stop();
+    QVERIFY(spyStopped.wait(5000));
+    QVERIFY(!recorder.recording());
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(tee);
+    gst_object_unref(pipeline);
+
+    // One second segments over six seconds, each starting on a keyframe
+    QVERIFY(spyClosed.count() >= 4);
+    QCOMPARE(recorder.segmentsWritten(), spyClosed.count());
+
+    // Let the last quota pass run, then the directory is within quota and the index matches the files on disk
+    spyEnforced.clear();
+    store.enforceQuota();
+    while (spyEnforced.count() == 0 || spyEnforced.last()[0].toLongLong() > quota) {
+        QVERIFY(spyEnforced.wait(5000));
+    }
+
+    QStringList filters;
+    filters << "*.mkv";
+    qint64 totalBytes = 0;
+    QFileInfoList files = QDir(dir.path()).entryInfoList(filters, QDir::Files);
+    foreach (const QFileInfo& info, files) {
+        totalBytes += info.size();
+    }
+    QVERIFY(totalBytes <= quota);
+    QCOMPARE(store.segments().count(), files.count());
+    QVERIFY(store.removedCount() > 0);
+    foreach (const VideoSegmentStore::Segment_t& segment, store.segments()) {
+        QVERIFY(QFileInfo(QDir(dir.path()).filePath(segment.fileName)).exists());
+        QVERIFY(segment.bytes > 0);
+    }
+
+    store.stopWorker();
+}
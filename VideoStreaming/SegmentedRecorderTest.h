@@ -0,0 +1,38 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef SegmentedRecorderTest_H
+#define SegmentedRecorderTest_H
+
+#include "UnitTest.h"
+
+#include <gst/gst.h>
+
+/// Unit test for SegmentedRecorder and VideoSegmentStore
+///
+/// Records a live videotestsrc stream encoded with x264enc, so the test is skipped if the x264 plugin
+/// is not installed.
+class SegmentedRecorderTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    SegmentedRecorderTest(void);
+
+private slots:
+    void _testQuotaRemovesOldest(void);
+    void _testRecordingRollsOver(void);
+
+private:
+    GstElement* _makeSourcePipeline(GstElement** tee);
+    void        _writeFile(const QString& path, int bytes);
+};
+
+#endif
@@ -0,0 +1,235 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Still image capture worker
+ */
+
+#include "StillImageCapture.h"
+
+#include "opencv2/highgui/highgui.hpp"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+
+#include <string.h>
+
+StillImageCapture::StillImageCapture(int ringSize, QObject* parent)
+    : QThread(parent)
+    , _filePrefix("XH")
+    , _quality(90)
+    , _quit(false)
+    , _burstRemaining(0)
+    , _burstCount(0)
+    , _burstWritten(0)
+    , _burstStartUsecs(0)
+    , _sameStemCount(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+
+    _slots.resize(qMax(1, ringSize));
+    for (int i = 0; i < _slots.count(); i++) {
+        _freeSlots.enqueue(i);
+    }
+}
+
+StillImageCapture::~StillImageCapture()
+{
+    stopWorker();
+}
+
+void StillImageCapture::setDirectory(const QString& directory)
+{
+    QMutexLocker locker(&_mutex);
+    _directory = directory;
+}
+
+void StillImageCapture::setQuality(int quality)
+{
+    QMutexLocker locker(&_mutex);
+    _quality = qBound(0, quality, 100);
+}
+
+void StillImageCapture::setFilePrefix(const QString& prefix)
+{
+    QMutexLocker locker(&_mutex);
+    _filePrefix = prefix;
+}
+
+void StillImageCapture::beginBurst(int count)
+{
+    QMutexLocker locker(&_mutex);
+    _burstCount = _burstRemaining = qMax(0, count);
+    _burstWritten = 0;
+    _burstStartUsecs = VideoFrameTap::monotonicUsecs();
+}
+
+void StillImageCapture::cancelBurst(void)
+{
+    QMutexLocker locker(&_mutex);
+    _burstCount = _burstRemaining = 0;
+    _burstWritten = 0;
+}
+
+/// Counts one frame of the burst in progress against it. Must be called with _mutex held.
+///     @return Burst size if that was the last frame of the burst, 0 otherwise
+int StillImageCapture::_burstShotDone(bool written, qint64 doneUsecs, double& shotsPerSecond)
+{
+    if (_burstRemaining <= 0) {
+        return 0;
+    }
+    if (written) {
+        _burstWritten++;
+    }
+    if (--_burstRemaining > 0) {
+        return 0;
+    }
+    shotsPerSecond = _burstWritten * 1000000.0 / qMax((qint64)1, doneUsecs - _burstStartUsecs);
+    _stats.burstShotsPerSecond = shotsPerSecond;
+    return _burstCount;
+}
+
+void StillImageCapture::_smooth(double& average, double sample, quint64 count)
+{
+    average = count <= 1 ? sample : (0.8 * average) + (0.2 * sample);
+}
+
+void StillImageCapture::submitFrame(const cv::Mat& frame, qint64 requestUsecs)
+{
+    qint64 arrivalUsecs = VideoFrameTap::monotonicUsecs();
+
+    int index = -1;
+    int burstCount = 0;
+    double burstRate = 0;
+    {
+        QMutexLocker locker(&_mutex);
+        if (_freeSlots.isEmpty()) {
+            // A dropped frame still counts toward the burst, it is never coming
+            _stats.framesDropped++;
+            burstCount = _burstShotDone(false, arrivalUsecs, burstRate);
+        } else {
+            index = _freeSlots.dequeue();
+        }
+    }
+    if (index < 0) {
+        if (burstCount) {
+            emit burstFinished(burstCount, burstRate);
+        }
+        return;
+    }
+
+    // The slot belongs to this thread until it is queued, and its buffer is reused when the size stays the same
+    Slot_t& slot = _slots[index];
+    frame.copyTo(slot.image);
+    slot.requestUsecs = requestUsecs;
+
+    QMutexLocker locker(&_mutex);
+    _stats.framesCaptured++;
+    _smooth(_stats.captureMsecs, (arrivalUsecs - requestUsecs) / 1000.0, _stats.framesCaptured);
+    _filledSlots.enqueue(index);
+    _frameAvailable.wakeOne();
+}
+
+StillImageCapture::Stats_t StillImageCapture::stats(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _stats;
+}
+
+void StillImageCapture::stopWorker(void)
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _quit = true;
+        _frameAvailable.wakeAll();
+    }
+    wait();
+}
+
+/// Capture time to the millisecond, with a counter appended if that is not unique
+QString StillImageCapture::_nextFileName(void)
+{
+    QString stem = QDateTime::currentDateTime().toString("yyyyMMddhhmmsszzz");
+    if (stem == _lastFileStem) {
+        _sameStemCount++;
+        return QString("%1_%2.jpeg").arg(stem).arg(_sameStemCount);
+    }
+    _lastFileStem = stem;
+    _sameStemCount = 0;
+    return stem + ".jpeg";
+}
+
+void StillImageCapture::run(void)
+{
+    forever {
+        int index;
+        QString directory, prefix;
+        int quality;
+        {
+            QMutexLocker locker(&_mutex);
+            // Captured frames are still written when quitting
+            while (!_quit && _filledSlots.isEmpty()) {
+                _frameAvailable.wait(&_mutex);
+            }
+            if (_filledSlots.isEmpty()) {
+                break;
+            }
+            index = _filledSlots.dequeue();
+            directory = _directory;
+            prefix = _filePrefix;
+            quality = _quality;
+        }
+
+        qint64 startUsecs = VideoFrameTap::monotonicUsecs();
+
+        std::vector<int> params;
+        params.push_back(cv::IMWRITE_JPEG_QUALITY);
+        params.push_back(quality);
+        bool encoded = cv::imencode(".jpg", _slots[index].image, _encoded, params);
+
+        QString path = QDir(directory).filePath(prefix + _nextFileName());
+        bool written = false;
+        if (encoded) {
+            QFile file(path);
+            written = file.open(QIODevice::WriteOnly) && file.write((const char*)_encoded.data(), _encoded.size()) == (qint64)_encoded.size();
+            if (!written) {
+                qWarning() << "StillImageCapture: unable to write" << path << file.errorString();
+            }
+        } else {
+            qWarning() << "StillImageCapture: JPEG encode failed";
+        }
+
+        qint64 doneUsecs = VideoFrameTap::monotonicUsecs();
+
+        int burstCount = 0;
+        double burstRate = 0;
+        {
+            QMutexLocker locker(&_mutex);
+            _freeSlots.enqueue(index);
+            if (written) {
+                _stats.imagesWritten++;
+                _smooth(_stats.encodeMsecs, (doneUsecs - startUsecs) / 1000.0, _stats.imagesWritten);
+            } else {
+                _stats.writeFailures++;
+            }
+            burstCount = _burstShotDone(written, doneUsecs, burstRate);
+        }
+
+        if (written) {
+            emit imageSaved(path);
+        }
+        if (burstCount) {
+            emit burstFinished(burstCount, burstRate);
+        }
+    }
+}
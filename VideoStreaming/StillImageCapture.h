@@ -0,0 +1,126 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Still image capture worker
+ */
+
+#ifndef STILL_IMAGE_CAPTURE_H
+#define STILL_IMAGE_CAPTURE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+#include "VideoFrameTap.h"
+
+/// Saves decoded frames as JPEG files on its own thread.
+///
+/// Frames come in through the VideoFrameTap::Client interface on the streaming thread, where they are
+/// only copied into a ring of pre-allocated slots. Encoding and writing happen on the worker, so a burst
+/// never stalls the pipeline. When all slots are waiting to be written further frames are dropped and
+/// counted.
+class StillImageCapture : public QThread, public VideoFrameTap::Client
+{
+    Q_OBJECT
+
+public:
+    StillImageCapture(int ringSize = 8, QObject* parent = NULL);
+    ~StillImageCapture();
+
+    typedef struct {
+        quint64 framesCaptured;     ///< Frames copied into the ring
+        quint64 framesDropped;      ///< Dropped because all slots were busy
+        quint64 imagesWritten;
+        quint64 writeFailures;
+        double  captureMsecs;       ///< Request to frame arrival, smoothed
+        double  encodeMsecs;        ///< JPEG encode and file write, smoothed
+        double  burstShotsPerSecond;///< Images written per second in the last completed burst, request to last shot
+    } Stats_t;
+
+    /// Directory the images are written to. Thread safe.
+    void setDirectory(const QString& directory);
+
+    /// @param quality JPEG quality, 0-100. Thread safe.
+    void setQuality(int quality);
+
+    /// Prefix of the image file names, followed by the capture time. Thread safe.
+    void setFilePrefix(const QString& prefix);
+
+    /// Starts timing a burst, the rate is available from stats() and burstFinished once count frames are
+    /// written or dropped
+    void beginBurst(int count);
+
+    /// Forgets the burst in progress without emitting burstFinished. Thread safe.
+    void cancelBurst(void);
+
+    /// Copies the frame into a free slot and wakes the worker. Thread safe.
+    ///     @param frame BGR or grayscale frame, only needs to be valid for the duration of the call
+    ///     @param requestUsecs VideoFrameTap::monotonicUsecs time the frame was asked for
+    void submitFrame(const cv::Mat& frame, qint64 requestUsecs);
+
+    Stats_t stats(void) const;
+
+    /// Stops the worker thread after the images already captured are written
+    void stopWorker(void);
+
+    // Overrides from VideoFrameTap::Client
+    void frameCaptured(const cv::Mat& frame, qint64 requestUsecs) final { submitFrame(frame, requestUsecs); }
+
+signals:
+    /// Emitted from the worker thread for each image written
+    void imageSaved(QString fileName);
+
+    /// Emitted once every frame of a burst has been written or dropped, from the worker thread or, if the
+    /// last frame was dropped, the thread which submitted it
+    void burstFinished(int count, double shotsPerSecond);
+
+protected:
+    void run(void) final;
+
+private:
+    typedef struct {
+        cv::Mat image;
+        qint64  requestUsecs;
+    } Slot_t;
+
+    static void _smooth(double& average, double sample, quint64 count);
+    int _burstShotDone(bool written, qint64 doneUsecs, double& shotsPerSecond);
+    QString _nextFileName(void);
+
+    mutable QMutex      _mutex;
+    QWaitCondition      _frameAvailable;
+    QVector<Slot_t>     _slots;
+    QQueue<int>         _freeSlots;
+    QQueue<int>         _filledSlots;       ///< In capture order
+    QString             _directory;
+    QString             _filePrefix;
+    int                 _quality;
+    bool                _quit;
+    Stats_t             _stats;
+
+    int                 _burstRemaining;
+    int                 _burstCount;
+    int                 _burstWritten;
+    qint64              _burstStartUsecs;
+
+    // Only touched by the worker
+    std::vector<uchar>  _encoded;
+    QString             _lastFileStem;
+    int                 _sameStemCount;
+};
+
+#endif // STILL_IMAGE_CAPTURE_H
@@ -0,0 +1,131 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "StillImageCaptureTest.h"
+#include "StillImageCapture.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/highgui/highgui.hpp"
+
+#include <QDir>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+StillImageCaptureTest::StillImageCaptureTest(void)
+{
+
+}
+
+cv::Mat StillImageCaptureTest::_testFrame(int width, int height, int index)
+{
+    cv::Mat frame(height, width, CV_8UC3, cv::Scalar(40, 80, 120));
+    cv::rectangle(frame, cv::Rect((index * 16) % (width - 64), height / 4, 64, height / 2), cv::Scalar(255, 255, 255), CV_FILLED);
+    return frame;
+}
+
+void StillImageCaptureTest::_testWritesImages(void)
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    StillImageCapture capture;
+    capture.setDirectory(dir.path());
+    QSignalSpy spySaved(&capture, SIGNAL(imageSaved(QString)));
+    capture.start();
+
+    const int cImages = 3;
+    for (int i = 0; i < cImages; i++) {
+        capture.submitFrame(_testFrame(320, 240, i), VideoFrameTap::monotonicUsecs());
+    }
+    while (spySaved.count() < cImages) {
+        QVERIFY(spySaved.wait(5000));
+    }
+
+    // Unique names even within the same millisecond, and every file decodes to the frame size
+    QStringList files = QDir(dir.path()).entryList(QStringList() << "XH*.jpeg", QDir::Files);
+    QCOMPARE(files.count(), cImages);
+    foreach (const QString& fileName, files) {
+        cv::Mat image = cv::imread(QDir(dir.path()).filePath(fileName).toStdString());
+        QCOMPARE(image.cols, 320);
+        QCOMPARE(image.rows, 240);
+    }
+
+    StillImageCapture::Stats_t stats = capture.stats();
+    QCOMPARE(stats.framesCaptured, (quint64)cImages);
+    QCOMPARE(stats.imagesWritten, (quint64)cImages);
+    QCOMPARE(stats.framesDropped, (quint64)0);
+    capture.stopWorker();
+}
+
+void StillImageCaptureTest::_testFullRingDropsFrames(void)
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Worker not started, so nothing leaves the ring
+    StillImageCapture capture(2);
+    capture.setDirectory(dir.path());
+    QSignalSpy spyBurst(&capture, SIGNAL(burstFinished(int, double)));
+    capture.beginBurst(5);
+    for (int i = 0; i < 5; i++) {
+        capture.submitFrame(_testFrame(320, 240, i), VideoFrameTap::monotonicUsecs());
+    }
+
+    StillImageCapture::Stats_t stats = capture.stats();
+    QCOMPARE(stats.framesCaptured, (quint64)2);
+    QCOMPARE(stats.framesDropped, (quint64)3);
+
+    QCOMPARE(spyBurst.count(), 0);
+
+    // The frames already captured are still written on the way out, which completes the burst
+    capture.start();
+    capture.stopWorker();
+    QCOMPARE(capture.stats().imagesWritten, (quint64)2);
+    QCOMPARE(spyBurst.count(), 1);
+    QCOMPARE(spyBurst[0][0].toInt(), 5);
+
+    // A cancelled burst never finishes
+    capture.beginBurst(3);
+    capture.cancelBurst();
+    for (int i = 0; i < 3; i++) {
+        capture.submitFrame(_testFrame(320, 240, i), VideoFrameTap::monotonicUsecs());
+    }
+    QCOMPARE(capture.stats().framesDropped, (quint64)4);
+    QCOMPARE(spyBurst.count(), 1);
+}
+
+void StillImageCaptureTest::_benchmarkBurst(void)
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const int cBurst = 30;
+    cv::Mat frame = _testFrame(1920, 1080, 0);
+
+    StillImageCapture capture;
+    capture.setDirectory(dir.path());
+    QSignalSpy spyBurst(&capture, SIGNAL(burstFinished(int, double)));
+    capture.start();
+
+    // Frames arrive at 30 fps like a live stream would deliver them
+    capture.beginBurst(cBurst);
+    for (int i = 0; i < cBurst; i++) {
+        capture.submitFrame(frame, VideoFrameTap::monotonicUsecs());
+        QTest::qWait(33);
+    }
+
+    // Dropped frames count toward the burst too, so it always finishes
+    QVERIFY(spyBurst.count() == 1 || spyBurst.wait(10000));
+    QCOMPARE(spyBurst.count(), 1);
+    QCOMPARE(spyBurst[0][0].toInt(), cBurst);
+    StillImageCapture::Stats_t stats = capture.stats();
+    QCOMPARE(stats.framesCaptured + stats.framesDropped, (quint64)cBurst);
+    capture.stopWorker();
+}
@@ -0,0 +1,35 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef StillImageCaptureTest_H
+#define StillImageCaptureTest_H
+
+#include "UnitTest.h"
+
+#include "opencv2/core/core.hpp"
+
+/// Unit test and burst benchmark for StillImageCapture
+class StillImageCaptureTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    StillImageCaptureTest(void);
+
+private slots:
+    void _testWritesImages(void);
+    void _testFullRingDropsFrames(void);
+    void _benchmarkBurst(void);
+
+private:
+    cv::Mat _testFrame(int width, int height, int index);
+};
+
+#endif
@@ -0,0 +1,236 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Raw frame tap on a decoded video tee
+ */
+
+#include "VideoFrameTap.h"
+
+#include <QDebug>
+
+#if defined(QGC_GST_STREAMING)
+#include <gst/video/video.h>
+#endif
+
+#include <chrono>
+#include <string.h>
+
+VideoFrameTap::VideoFrameTap(Client* client, const char* format)
+    : _pipeline(NULL)
+#if defined(QGC_GST_STREAMING)
+    , _tee(NULL)
+    , _teePad(NULL)
+    , _queue(NULL)
+    , _valve(NULL)
+    , _convert(NULL)
+    , _appSink(NULL)
+#endif
+    , _client(client)
+    , _format(format)
+    , _continuous(false)
+    , _pendingFrames(0)
+    , _requestUsecs(0)
+    , _framesCaptured(0)
+{
+}
+
+VideoFrameTap::~VideoFrameTap()
+{
+    detach();
+}
+
+#if defined(QGC_GST_STREAMING)
+bool VideoFrameTap::attach(GstElement* pipeline, GstElement* tee)
+{
+    if (_pipeline) {
+        return true;
+    }
+    if (!pipeline || !tee) {
+        qCritical() << "VideoFrameTap::attach() called without a pipeline";
+        return false;
+    }
+
+    _queue      = gst_element_factory_make("queue", NULL);
+    _valve      = gst_element_factory_make("valve", NULL);
+    _convert    = gst_element_factory_make("videoconvert", NULL);
+    _appSink    = gst_element_factory_make("appsink", NULL);
+
+    if (!_queue || !_valve || !_convert || !_appSink) {
+        qCritical() << "VideoFrameTap::attach() failed to make tap elements";
+        GstElement* rgElements[] = { _queue, _valve, _convert, _appSink };
+        for (size_t i = 0; i < sizeof(rgElements) / sizeof(rgElements[0]); i++) {
+            if (rgElements[i]) {
+                gst_object_unref(rgElements[i]);
+            }
+        }
+        _queue = _valve = _convert = _appSink = NULL;
+        return false;
+    }
+
+    // Never hold up the display branch, only the newest frame is of any interest
+    g_object_set(G_OBJECT(_queue), "leaky", 2 /* downstream */, "max-size-buffers", 1, "max-size-bytes", 0, "max-size-time", (guint64)0, NULL);
+    g_object_set(G_OBJECT(_valve), "drop", (gboolean)!_continuous.load(), NULL);
+
+    GstCaps* caps = gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, _format, NULL);
+    g_object_set(G_OBJECT(_appSink), "caps", caps, "max-buffers", 1, "drop", TRUE, "sync", FALSE, NULL);
+    gst_caps_unref(caps);
+
+    GstAppSinkCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.new_sample = _newSample;
+    gst_app_sink_set_callbacks(GST_APP_SINK(_appSink), &callbacks, this, NULL);
+
+    gst_bin_add_many(GST_BIN(pipeline), _queue, _valve, _convert, _appSink, NULL);
+    if (!gst_element_link_many(_queue, _valve, _convert, _appSink, NULL)) {
+        qCritical() << "VideoFrameTap::attach() failed to link tap elements";
+        // Removing from the bin releases the only reference
+        gst_bin_remove_many(GST_BIN(pipeline), _queue, _valve, _convert, _appSink, NULL);
+        _queue = _valve = _convert = _appSink = NULL;
+        return false;
+    }
+
+    gst_element_sync_state_with_parent(_queue);
+    gst_element_sync_state_with_parent(_valve);
+    gst_element_sync_state_with_parent(_convert);
+    gst_element_sync_state_with_parent(_appSink);
+
+    _teePad = gst_element_get_request_pad(tee, "src_%u");
+    GstPad* sinkpad = gst_element_get_static_pad(_queue, "sink");
+    gst_pad_link(_teePad, sinkpad);
+    gst_object_unref(sinkpad);
+
+    _pipeline = pipeline;
+    _tee = tee;
+    return true;
+}
+#endif
+
+void VideoFrameTap::detach(void)
+{
+#if defined(QGC_GST_STREAMING)
+    if (!_pipeline) {
+        return;
+    }
+
+    gst_element_release_request_pad(_tee, _teePad);
+    gst_object_unref(_teePad);
+
+    gst_element_set_state(_appSink, GST_STATE_NULL);
+    gst_element_set_state(_convert, GST_STATE_NULL);
+    gst_element_set_state(_valve,   GST_STATE_NULL);
+    gst_element_set_state(_queue,   GST_STATE_NULL);
+    gst_bin_remove_many(GST_BIN(_pipeline), _queue, _valve, _convert, _appSink, NULL);
+
+    _pipeline = NULL;
+    _tee = NULL;
+    _teePad = NULL;
+    _queue = _valve = _convert = _appSink = NULL;
+    _pendingFrames = 0;
+#endif
+}
+
+qint64 VideoFrameTap::monotonicUsecs(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void VideoFrameTap::requestFrames(int count)
+{
+    if (count <= 0) {
+        return;
+    }
+    _requestUsecs = monotonicUsecs();
+    _pendingFrames.fetch_add(count);
+#if defined(QGC_GST_STREAMING)
+    _setValveOpen(true);
+#endif
+}
+
+void VideoFrameTap::cancelRequests(void)
+{
+    _pendingFrames = 0;
+#if defined(QGC_GST_STREAMING)
+    _setValveOpen(_continuous);
+#endif
+}
+
+void VideoFrameTap::setContinuous(bool continuous)
+{
+    _continuous = continuous;
+#if defined(QGC_GST_STREAMING)
+    _setValveOpen(continuous || _pendingFrames > 0);
+#endif
+}
+
+#if defined(QGC_GST_STREAMING)
+void VideoFrameTap::_setValveOpen(bool open)
+{
+    if (_valve) {
+        g_object_set(G_OBJECT(_valve), "drop", (gboolean)!open, NULL);
+    }
+}
+
+GstFlowReturn VideoFrameTap::_newSample(GstAppSink* sink, gpointer user_data)
+{
+    VideoFrameTap* pThis = (VideoFrameTap*)user_data;
+
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    if (!sample) {
+        return GST_FLOW_OK;
+    }
+
+    if (pThis->_continuous) {
+        pThis->_deliverSample(sample, monotonicUsecs());
+    } else {
+        int pending = pThis->_pendingFrames.load();
+        while (pending > 0 && !pThis->_pendingFrames.compare_exchange_weak(pending, pending - 1)) {
+        }
+        if (pending > 0) {
+            if (pending == 1) {
+                // Last requested frame, close the valve behind it unless a new request raced in
+                pThis->_setValveOpen(false);
+                if (pThis->_pendingFrames > 0) {
+                    pThis->_setValveOpen(true);
+                }
+            }
+            pThis->_deliverSample(sample, pThis->_requestUsecs);
+        }
+    }
+
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+void VideoFrameTap::_deliverSample(GstSample* sample, qint64 requestUsecs)
+{
+    GstVideoInfo info;
+    if (!gst_video_info_from_caps(&info, gst_sample_get_caps(sample))) {
+        qWarning() << "VideoFrameTap: sample without video caps";
+        return;
+    }
+
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    GstMapInfo map;
+    if (!buffer || !gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        return;
+    }
+
+    // Wrap the mapped buffer, the client copies whatever it needs to keep
+    int type = GST_VIDEO_INFO_N_COMPONENTS(&info) == 1 ? CV_8UC1 : CV_8UC3;
+    cv::Mat frame(GST_VIDEO_INFO_HEIGHT(&info), GST_VIDEO_INFO_WIDTH(&info), type, map.data, GST_VIDEO_INFO_PLANE_STRIDE(&info, 0));
+
+    _framesCaptured.fetch_add(1, std::memory_order_relaxed);
+    _client->frameCaptured(frame, requestUsecs);
+
+    gst_buffer_unmap(buffer, &map);
+}
+#endif
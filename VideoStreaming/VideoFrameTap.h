@@ -0,0 +1,113 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Raw frame tap on a decoded video tee
+ */
+
+#ifndef VIDEO_FRAME_TAP_H
+#define VIDEO_FRAME_TAP_H
+
+#include <QtGlobal>
+
+#include <atomic>
+
+#include "opencv2/core/core.hpp"
+
+#if defined(QGC_GST_STREAMING)
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#endif
+
+/// Hands decoded frames to a client in memory, without any encode or disk round trip.
+///
+/// The tap is a branch hung off a tee carrying raw video:
+///
+///     tee-->queue(leaky, 1 buffer)-->valve-->videoconvert-->appsink(format)
+///
+/// The valve stays closed until a frame is requested, so an idle tap costs nothing per frame. In
+/// continuous mode the valve is left open and the client sees every frame the appsink can keep up
+/// with, older frames are dropped rather than queued.
+class VideoFrameTap
+{
+public:
+    class Client
+    {
+    public:
+        virtual ~Client() {}
+
+        /// Called on the GStreamer streaming thread. The frame references the mapped buffer and is only
+        /// valid for the duration of the call.
+        ///     @param frame Frame in the tap format (CV_8UC3 for BGR, CV_8UC1 for GRAY8)
+        ///     @param requestUsecs Monotonic time the frame was requested at, arrival time in continuous mode
+        virtual void frameCaptured(const cv::Mat& frame, qint64 requestUsecs) = 0;
+    };
+
+    /// @param client Receives captured frames
+    /// @param format Raw video format to convert frames to, "BGR" or "GRAY8"
+    VideoFrameTap(Client* client, const char* format = "BGR");
+    ~VideoFrameTap();
+
+#if defined(QGC_GST_STREAMING)
+    /// Adds the tap branch to a running pipeline. Does nothing if already attached.
+    ///     @param tee Tee carrying decoded video
+    bool attach(GstElement* pipeline, GstElement* tee);
+#endif
+
+    /// Removes the tap branch from the pipeline. Must be called before the pipeline is destroyed.
+    void detach(void);
+
+    bool attached(void) const { return _pipeline != NULL; }
+
+    /// Requests the next frame to be handed to the client. Thread safe.
+    void requestFrame(void) { requestFrames(1); }
+
+    /// Requests the next count frames, for burst captures. Adds to any request still outstanding. Thread safe.
+    void requestFrames(int count);
+
+    /// Drops any outstanding request and closes the valve again. Thread safe.
+    void cancelRequests(void);
+
+    /// Continuous mode passes every frame to the client until switched off again
+    void setContinuous(bool continuous);
+
+    /// Clock used for request times, microseconds from an arbitrary monotonic epoch
+    static qint64 monotonicUsecs(void);
+
+    /// @return Number of frames handed to the client
+    quint64 framesCaptured(void) const { return _framesCaptured.load(std::memory_order_relaxed); }
+
+private:
+#if defined(QGC_GST_STREAMING)
+    static GstFlowReturn _newSample(GstAppSink* sink, gpointer user_data);
+    void _deliverSample(GstSample* sample, qint64 requestUsecs);
+    void _setValveOpen(bool open);
+
+    GstElement*             _pipeline;
+    GstElement*             _tee;
+    GstPad*                 _teePad;
+    GstElement*             _queue;
+    GstElement*             _valve;
+    GstElement*             _convert;
+    GstElement*             _appSink;
+#else
+    void*                   _pipeline;
+#endif
+
+    Client*                 _client;
+    const char*             _format;
+    std::atomic<bool>       _continuous;
+    std::atomic<int>        _pendingFrames;     ///< Frames requested and not yet delivered
+    std::atomic<qint64>     _requestUsecs;
+    std::atomic<quint64>    _framesCaptured;
+};
+
+#endif // VIDEO_FRAME_TAP_H
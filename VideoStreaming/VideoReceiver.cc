@@ -15,6 +15,12 @@
  */
 
 #include "VideoReceiver.h"
+#include "VideoFrameTap.h"
+#include "PlateRecognizer.h"
+#include "MotionDetector.h"
+#include "SegmentedRecorder.h"
+#include "VideoSegmentStore.h"
+#include "StillImageCapture.h"
 //#include "SettingsManager.h"
 #include "QGCApplication.h"
 #include "VideoManager.h"
@@ -25,8 +31,7 @@
 #include <QDir>
 #include <QDateTime>
 #include <QSysInfo>
-
-#include <alpr.h>
+#include <QSettings>
 
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
@@ -36,18 +41,9 @@
 #include <iostream>
 #include <iterator>
 #include<QLibrary>
-using namespace alpr;
 QGC_LOGGING_CATEGORY(VideoReceiverLog, "VideoReceiverLog")
 
 #if defined(QGC_GST_STREAMING)
-static GstPadProbeReturn event_probe_cb(GstPad * pad, GstPadProbeInfo * info, gpointer user_data) {
-    Q_UNUSED(pad);
-    Q_UNUSED(info);
-    VideoReceiver* pipeline = (VideoReceiver*)user_data;
-    pipeline->screeneCallback();
-    return GST_PAD_PROBE_OK;
-}
-
 static const char* kVideoExtensions[] =
 {
     "mkv",
@@ -64,6 +60,10 @@ static const char* kVideoMuxes[] =
 
 #define NUM_MUXES (sizeof(kVideoMuxes) / sizeof(char*))
 
+static const char* kVideoSegmentSecsKey     = "VideoRecordSegmentSecs";
+static const char* kVideoSegmentMBKey       = "VideoRecordSegmentMB";
+static const char* kVideoStorageQuotaMBKey  = "VideoRecordQuotaMB";
+
 #endif
 
 VideoReceiver::VideoReceiver(QObject* parent)
@@ -74,20 +74,40 @@ VideoReceiver::VideoReceiver(QObject* parent)
     , _streaming(false)
     , _starting(false)
     , _stopping(false)
-    , _sink(NULL)
     , _tee(NULL)
     , _pipeline(NULL)
-    , _pipelineStopRec(NULL)
     , _videoSink(NULL)
+    , _displayProbeId(0)
+    , tee1(NULL)
     , _socket(NULL)
     , _serverPresent(false)
 #endif
     , _videoSurface(NULL)
     , _videoRunning(false)
     , _showFullScreen(false)
+    , _displayedFrameUsecs(0)
+    , _plateTap(NULL)
+    , _plateRecognizer(NULL)
+    , _motionTap(NULL)
+    , _motionDetector(NULL)
+    , _segmentStore(NULL)
+    , _recorder(NULL)
+    , _stillTap(NULL)
+    , _stillCapture(NULL)
 {
     _videoSurface  = new VideoSurface;
+    _motionDetector = new MotionDetector();
+    _motionTap = new VideoFrameTap(_motionDetector, "GRAY8");
+    _motionTap->setContinuous(true);
+    _motionDetector->start();
+    _segmentStore = new VideoSegmentStore();
+    _segmentStore->start();
+    _recorder = new SegmentedRecorder(_segmentStore);
+    _stillCapture = new StillImageCapture();
+    _stillTap = new VideoFrameTap(_stillCapture, "BGR");
+    _stillCapture->start();
 #if defined(QGC_GST_STREAMING)
+    connect(_recorder, &SegmentedRecorder::recordingChanged, this, &VideoReceiver::_recorderStateChanged);
     //_setVideoSink(_videoSurface->videoSink());
     _timer.setSingleShot(true);
     file=new QFile("info.txt");
@@ -114,6 +134,14 @@ VideoReceiver::~VideoReceiver()
         gst_object_unref(_videoSink);
     }
 #endif
+    delete _plateTap;
+    delete _plateRecognizer;
+    delete _motionTap;
+    delete _motionDetector;
+    delete _recorder;
+    delete _segmentStore;
+    delete _stillTap;
+    delete _stillCapture;
     if(_videoSurface)
         delete _videoSurface;
 }
@@ -123,14 +151,40 @@ void
 VideoReceiver::_setVideoSink(GstElement* sink)
 {
     if (_videoSink) {
+        if (_displayProbeId) {
+            GstPad* pad = gst_element_get_static_pad(_videoSink, "sink");
+            if (pad) {
+                gst_pad_remove_probe(pad, _displayProbeId);
+                gst_object_unref(pad);
+            }
+            _displayProbeId = 0;
+        }
         gst_object_unref(_videoSink);
         _videoSink = NULL;
     }
     if (sink) {
         _videoSink = sink;
         gst_object_ref_sink(_videoSink);
+        // The sink is reused by every pipeline, so the probe stays on its pad
+        GstPad* pad = gst_element_get_static_pad(_videoSink, "sink");
+        if (pad) {
+            _displayProbeId = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, _onDisplayBuffer, this, NULL);
+            gst_object_unref(pad);
+        }
     }
 }
+
+//-----------------------------------------------------------------------------
+// Called on the streaming thread for each frame handed to the video sink
+GstPadProbeReturn
+VideoReceiver::_onDisplayBuffer(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    Q_UNUSED(pad);
+    Q_UNUSED(info);
+    VideoReceiver* pThis = (VideoReceiver*)user_data;
+    pThis->_displayedFrameUsecs.store(VideoFrameTap::monotonicUsecs(), std::memory_order_relaxed);
+    return GST_PAD_PROBE_OK;
+}
 #endif
 
 //-----------------------------------------------------------------------------
@@ -494,11 +548,17 @@ VideoReceiver::_shutdownPipeline() {
         bus = NULL;
     }
     gst_element_set_state(_pipeline, GST_STATE_NULL);
+    _recorder->pipelineShutdown();
+    if(_plateTap) {
+        _plateTap->detach();
+    }
+    _motionTap->detach();
+    _stillTap->detach();
+    _motionDetector->reset();
+    _displayedFrameUsecs.store(0, std::memory_order_relaxed);
     gst_bin_remove(GST_BIN(_pipeline), _videoSink);
     gst_object_unref(_pipeline);
     _pipeline = NULL;
-    delete _sink;
-    _sink = NULL;
     _serverPresent = false;
     _streaming = false;
     _recording = false;
@@ -524,8 +584,6 @@ VideoReceiver::_handleEOS() {
     if(_stopping) {
         _shutdownPipeline();
         qCDebug(VideoReceiverLog) << "Stopped";
-    } else if(_recording && _sink->removing) {
-        _shutdownRecordingBranch();
     } else {
         qWarning() << "VideoReceiver: Unexpected EOS!";
         _shutdownPipeline();
@@ -583,7 +641,24 @@ VideoReceiver::_onBusMessage(GstBus* bus, GstMessage* msg, gpointer data)
 void
 VideoReceiver::_cleanupOldVideos()
 {
-    //-- Only perform cleanup if storage limit is enabled
+    //-- Only perform cleanup if storage limit is enabled, deleting happens on the store's thread
+    QSettings settings;
+    qint64 quotaMB = settings.value(kVideoStorageQuotaMBKey, 4096).toLongLong();
+    _segmentStore->setDirectory(_recordVideoDir);
+    _segmentStore->setQuota(quotaMB * 1024 * 1024);
+    if (quotaMB > 0) {
+        _segmentStore->enforceQuota();
+    }
+}
+#endif
+
+//-----------------------------------------------------------------------------
+#if defined(QGC_GST_STREAMING)
+void
+VideoReceiver::_recorderStateChanged()
+{
+    _recording = _recorder->recording();
+    emit recordingChanged();
 }
 #endif
 
@@ -594,120 +669,57 @@ VideoReceiver::_cleanupOldVideos()
 //                                   |
 //    datasource-->demux-->parser-->tee
 //                                   |
-//                                   |    +--------------_sink-------------------+
-//                                   |    |                                      |
-//   we are adding these elements->  +->teepad-->queue-->matroskamux-->_filesink |
-//                                        |                                      |
-//                                        +--------------------------------------+
+//                                   |    +-----------------_recorder-------------------------+
+//                                   |    |                                                   |
+//   we are adding these elements->  +->teepad-->queue-->h264parse-->splitmuxsink(matroskamux) |
+//                                        |                                                   |
+//                                        +---------------------------------------------------+
+//
+// splitmuxsink rolls over to a new segment at the first keyframe past the duration or size
+// limit. Finished segments are indexed by _segmentStore, which deletes the oldest ones once
+// the recording directory goes over its quota.
 void
 VideoReceiver::startRecording(void)
 {
-}
+#if defined(QGC_GST_STREAMING)
+    qCDebug(VideoReceiverLog) << "startRecording()";
+    if(_pipeline == NULL || _tee == NULL) {
+        qCDebug(VideoReceiverLog) << "No pipeline";
+        return;
+    }
+    if(_recorder->recording()) {
+        qCDebug(VideoReceiverLog) << "Already recording!";
+        return;
+    }
 
-//-----------------------------------------------------------------------------
-void
-VideoReceiver::stopRecording(void)
-{
+    QSettings settings;
+    _cleanupOldVideos();
+    _recorder->setMaxSegmentDuration(settings.value(kVideoSegmentSecsKey, 300).toInt());
+    _recorder->setMaxSegmentBytes(settings.value(kVideoSegmentMBKey, 1024).toLongLong() * 1024 * 1024);
 
+    if(!_recorder->start(_pipeline, _tee)) {
+        qCritical() << "VideoReceiver::startRecording() failed";
+        return;
+    }
+    qCDebug(VideoReceiverLog) << "Recording started";
+#endif
 }
 
 //-----------------------------------------------------------------------------
-// This is only installed on the transient _pipelineStopRec in order
-// to finalize a video file. It is not used for the main _pipeline.
-// -EOS has appeared on the bus of the temporary pipeline
-// -At this point all of the recoring elements have been flushed, and the video file has been finalized
-// -Now we can remove the temporary pipeline and its elements
-#if defined(QGC_GST_STREAMING)
 void
-VideoReceiver::_shutdownRecordingBranch()
+VideoReceiver::stopRecording(void)
 {
-    gst_bin_remove(GST_BIN(_pipelineStopRec), _sink->queue);
-    gst_bin_remove(GST_BIN(_pipelineStopRec), _sink->parse);
-    gst_bin_remove(GST_BIN(_pipelineStopRec), _sink->mux);
-    gst_bin_remove(GST_BIN(_pipelineStopRec), _sink->filesink);
-
-    gst_element_set_state(_pipelineStopRec, GST_STATE_NULL);
-    gst_object_unref(_pipelineStopRec);
-    _pipelineStopRec = NULL;
-
-    gst_element_set_state(_sink->filesink,  GST_STATE_NULL);
-    gst_element_set_state(_sink->parse,     GST_STATE_NULL);
-    gst_element_set_state(_sink->mux,       GST_STATE_NULL);
-    gst_element_set_state(_sink->queue,     GST_STATE_NULL);
-
-    gst_object_unref(_sink->queue);
-    gst_object_unref(_sink->parse);
-    gst_object_unref(_sink->mux);
-    gst_object_unref(_sink->filesink);
-
-    delete _sink;
-    _sink = NULL;
-    _recording = false;
-
-    emit recordingChanged();
-    qCDebug(VideoReceiverLog) << "Recording Stopped";
-}
-#endif
-
-//-----------------------------------------------------------------------------
-// -Unlink the recording branch from the tee in the main _pipeline
-// -Create a second temporary pipeline, and place the recording branch elements into that pipeline
-// -Setup watch and handler for EOS event on the temporary pipeline's bus
-// -Send an EOS event at the beginning of that pipeline
 #if defined(QGC_GST_STREAMING)
-void
-VideoReceiver::_detachRecordingBranch(GstPadProbeInfo* info)
-{
-    Q_UNUSED(info)
-
-    // Also unlinks and unrefs
-    gst_bin_remove_many(GST_BIN(_pipeline), _sink->queue, _sink->parse, _sink->mux, _sink->filesink, NULL);
-
-    // Give tee its pad back
-    gst_element_release_request_pad(_tee, _sink->teepad);
-    gst_object_unref(_sink->teepad);
-
-    // Create temporary pipeline
-    _pipelineStopRec = gst_pipeline_new("pipeStopRec");
-
-    // Put our elements from the recording branch into the temporary pipeline
-    gst_bin_add_many(GST_BIN(_pipelineStopRec), _sink->queue, _sink->parse, _sink->mux, _sink->filesink, NULL);
-    gst_element_link_many(_sink->queue, _sink->parse, _sink->mux, _sink->filesink, NULL);
-
-    // Add handler for EOS event
-    GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(_pipelineStopRec));
-    gst_bus_enable_sync_message_emission(bus);
-    g_signal_connect(bus, "sync-message", G_CALLBACK(_onBusMessage), this);
-    gst_object_unref(bus);
-
-    if(gst_element_set_state(_pipelineStopRec, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
-        qCDebug(VideoReceiverLog) << "problem starting _pipelineStopRec";
+    qCDebug(VideoReceiverLog) << "stopRecording()";
+    // exit immediately if we are not recording
+    if(_pipeline == NULL || !_recorder->recording()) {
+        qCDebug(VideoReceiverLog) << "Not recording!";
+        return;
     }
-
-    // Send EOS at the beginning of the pipeline
-    GstPad* sinkpad = gst_element_get_static_pad(_sink->queue, "sink");
-    gst_pad_send_event(sinkpad, gst_event_new_eos());
-    gst_object_unref(sinkpad);
-    qCDebug(VideoReceiverLog) << "Recording branch unlinked";
-}
+    // recordingChanged follows once the last segment is finalized
+    _recorder->stop();
 #endif
-
-//-----------------------------------------------------------------------------
-#if defined(QGC_GST_STREAMING)
-GstPadProbeReturn
-VideoReceiver::_unlinkCallBack(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
-{
-    Q_UNUSED(pad);
-    if(info != NULL && user_data != NULL) {
-        VideoReceiver* pThis = (VideoReceiver*)user_data;
-        // We will only act once
-        if(g_atomic_int_compare_and_exchange(&pThis->_sink->removing, FALSE, TRUE)) {
-            pThis->_detachRecordingBranch(info);
-        }
-    }
-    return GST_PAD_PROBE_REMOVE;
 }
-#endif
 
 //-----------------------------------------------------------------------------
 void
@@ -761,180 +773,87 @@ VideoReceiver::_updateTimer()
 
 //===========================================================================
 void VideoReceiver::stoprecording (){
-#if defined(QGC_GST_STREAMING)
-    qCDebug(VideoReceiverLog) << "stopRecording()";
-    // exit immediately if we are not recording
-    if(_pipeline == NULL || !_recording) {
-        qCDebug(VideoReceiverLog) << "Not recording!";
-        return;
-    }
-    // Wait for data block before unlinking
-    gst_pad_add_probe(_sink->teepad, GST_PAD_PROBE_TYPE_IDLE, _unlinkCallBack, this, NULL);
-#endif
+    stopRecording();
 }
 void VideoReceiver::startrecording (){
-#if defined(QGC_GST_STREAMING)
-        QString recordVideoName = (_recordVideoDir + "/XH" + (QDateTime::currentDateTime()).toString("yyyyMMddhhmmsszzz") + ".mkv");
-        QDir tempDir(_recordVideoDir);
-        if(!tempDir.exists ()){
-            tempDir.mkdir(_recordVideoDir);
-        }
-        int times = 0;
-        do {
-            static const char rgDigits[] = "0123456789";
-            QString uniqueStr;
-            for (int i = 0; i < 6; i++) {
-                uniqueStr += rgDigits[qrand() % 10];
-            }
-            recordVideoName = (_recordVideoDir + "/XH" + (QDateTime::currentDateTime()).toString("yyyyMMddhhmmsszzz") + uniqueStr + ".mkv");
-            times++;
-        } while (tempDir.exists(recordVideoName) && times < 10);
-        _sink           = new Sink();
-        _sink->teepad   = gst_element_get_request_pad(_tee, "src_%u");
-        _sink->queue    = gst_element_factory_make("queue", NULL);
-        _sink->parse    = gst_element_factory_make("h264parse", NULL);
-        _sink->mux      = gst_element_factory_make("matroskamux", NULL);
-        _sink->filesink = gst_element_factory_make("filesink", NULL);
-        _sink->removing = false;
-
-        if(!_sink->teepad || !_sink->queue || !_sink->mux || !_sink->filesink || !_sink->parse) {
-            qCritical() << "VideoReceiver::startRecording() failed to make _sink elements";
-            return;
-        }
-        g_object_set(G_OBJECT(_sink->filesink), "location", recordVideoName.toStdString ().c_str (), NULL);
-        gst_object_ref(_sink->queue);
-        gst_object_ref(_sink->parse);
-        gst_object_ref(_sink->mux);
-        gst_object_ref(_sink->filesink);
-
-        gst_bin_add_many(GST_BIN(_pipeline), _sink->queue, _sink->parse, _sink->mux, _sink->filesink, NULL);
-        gst_element_link_many(_sink->queue, _sink->parse, _sink->mux, _sink->filesink, NULL);
-
-        gst_element_sync_state_with_parent(_sink->queue);
-        gst_element_sync_state_with_parent(_sink->parse);
-        gst_element_sync_state_with_parent(_sink->mux);
-        gst_element_sync_state_with_parent(_sink->filesink);
-
-        GstPad* sinkpad = gst_element_get_static_pad(_sink->queue, "sink");
-        gst_pad_link(_sink->teepad, sinkpad);
-        gst_object_unref(sinkpad);
-
-        _recording = true;
-
-   // }
-#endif
+    startRecording();
 }
+//-----------------------------------------------------------------------------
+// Takes a single picture of the next decoded frame.
 void VideoReceiver::startimagerecording (){
-    _sink1           = new Sink1();
-    _sink1->teepad   = gst_element_get_request_pad(tee1, "src_%u");
-    _sink1->queue    = gst_element_factory_make("queue", NULL);
-    _sink1->mux      = gst_element_factory_make("jpegenc", NULL);
-    _sink1->videorate = gst_element_factory_make("valve", NULL);
-    _sink1->filesink = gst_element_factory_make("filesink", NULL);
-    _sink1->removing = false;
-    if( !_sink1->queue || !_sink1->mux || !_sink1->filesink || !_sink1->videorate) {
-        qCritical() << "VideoReceiver::startRecording() failed to make _sink elements";
+    captureImages(1);
+}
+//-----------------------------------------------------------------------------
+// When we finish our pipeline will look like this:
+//
+//    ...-->decoder-->tee1-->queue1-->_videosink
+//                     |
+//                     +-->queue(leaky)-->valve-->videoconvert-->appsink-->_stillCapture ring
+//
+// The branch is added on the first capture and left in place with the valve
+// closed, so later shots only open the valve for as many frames as requested.
+void VideoReceiver::captureImages (int count){
+#if defined(QGC_GST_STREAMING)
+    if(_pipeline == NULL) {
+        qCDebug(VideoReceiverLog) << "captureImages: no pipeline";
         return;
     }
-    g_object_set(G_OBJECT(_sink1->filesink), "location",(_recordPictureDir+"/XH" + (QDateTime::currentDateTime()).toString("yyyyMMddhhmmsszzz") + ".jpeg").toStdString ().c_str (), NULL);
-    gst_bin_add_many(GST_BIN(_pipeline), _sink1->queue, _sink1->mux, _sink1->filesink,_sink1->videorate, NULL);
-    gst_element_link_many(_sink1->queue ,_sink1->mux, _sink1->videorate,_sink1->filesink, NULL);
-    gst_element_set_state(_sink1->filesink, GST_STATE_PLAYING);
-    gst_element_set_state(_sink1->queue, GST_STATE_PLAYING);
-    gst_element_set_state(_sink1->videorate, GST_STATE_PLAYING);
-    gst_element_set_state(_sink1->mux, GST_STATE_PLAYING);
-    imageRecord=false;
-    GstPad* sinkpad = gst_element_get_static_pad(_sink1->queue, "sink");
-    gst_pad_link(_sink1->teepad, sinkpad);
-
-    GstPad * pad = gst_element_get_static_pad(_sink1->videorate, "src");
-    imageBufferProbeId = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, event_probe_cb, this, NULL);
-
-    g_object_set(G_OBJECT(_sink1->videorate), "drop", (gboolean) FALSE, NULL);
-    gst_object_unref(sinkpad);
-    _recording = true;
-
-}
-void VideoReceiver::startroirecording (){
-    _sink1           = new Sink1();
-    _sink1->teepad   = gst_element_get_request_pad(tee1, "src_%u");
-    _sink1->queue    = gst_element_factory_make("queue", NULL);
-    _sink1->mux      = gst_element_factory_make("jpegenc", NULL);
-    _sink1->videorate = gst_element_factory_make("valve", NULL);
-    _sink1->filesink = gst_element_factory_make("filesink", NULL);
-    _sink1->removing = false;
-    if( !_sink1->queue || !_sink1->mux || !_sink1->filesink || !_sink1->videorate) {
-        qCritical() << "VideoReceiver::startRecording() failed to make _sink elements";
+    if(!_stillTap->attached() && !_stillTap->attach(_pipeline, tee1)) {
         return;
     }
-    qDebug()<<"wwwwwwwwwwwwwwwww!!!!!!1";
-    g_object_set(G_OBJECT(_sink1->filesink), "location", "roi.jpeg", NULL);
-    gst_bin_add_many(GST_BIN(_pipeline), _sink1->queue, _sink1->mux, _sink1->filesink,_sink1->videorate, NULL);
-    gst_element_link_many(_sink1->queue ,_sink1->mux, _sink1->videorate,_sink1->filesink, NULL);
-    gst_element_set_state(_sink1->filesink, GST_STATE_PLAYING);
-    gst_element_set_state(_sink1->queue, GST_STATE_PLAYING);
-    gst_element_set_state(_sink1->videorate, GST_STATE_PLAYING);
-    gst_element_set_state(_sink1->mux, GST_STATE_PLAYING);
-    imageRecord=false;
-    GstPad* sinkpad = gst_element_get_static_pad(_sink1->queue, "sink");
-    gst_pad_link(_sink1->teepad, sinkpad);
-
-    GstPad * pad = gst_element_get_static_pad(_sink1->videorate, "src");
-    imageBufferProbeId = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, event_probe_cb, this, NULL);
-
-    g_object_set(G_OBJECT(_sink1->videorate), "drop", (gboolean) FALSE, NULL);
-    gst_object_unref(sinkpad);
-    _recording = true;
-
+    _stillCapture->setDirectory(_recordPictureDir);
+    _stillCapture->beginBurst(count);
+    _stillTap->requestFrames(count);
+#else
+    Q_UNUSED(count);
+#endif
 }
-void VideoReceiver::stopimagerecording (){
-#if defined(QGC_GST_STREAMING)
-    if(imageRecord){
-        GstPad * blockpadd = gst_element_get_static_pad(_sink1->queue, "src");
-        gst_pad_push_event(blockpadd, gst_event_new_eos());
-    }else{
-        GstPad * pad = gst_element_get_static_pad(_sink1->videorate, "src");
-        gst_pad_remove_probe(pad, imageBufferProbeId);
-    }
-    gst_element_set_state(_sink1->filesink, GST_STATE_NULL);
-    gst_element_set_state(_sink1->mux, GST_STATE_NULL);
-    gst_element_set_state(_sink1->queue, GST_STATE_NULL);
-    gst_element_set_state(_sink1->videorate, GST_STATE_NULL);
-    gst_bin_remove(GST_BIN(_pipeline), _sink1->mux);
-    gst_bin_remove(GST_BIN(_pipeline), _sink1->filesink);
-    gst_bin_remove(GST_BIN(_pipeline), _sink1->queue);
-    gst_bin_remove(GST_BIN(_pipeline), _sink1->videorate);
-    gst_element_release_request_pad(tee1, _sink1->teepad);
-    gst_object_unref(_sink1->teepad);
-    _sink1->queue = NULL;
-    if (_sink1->queue!= NULL) {
-        gst_object_unref(_sink1->queue);
-        _sink1->queue = NULL;
-    }
-    _sink1->filesink;
-    if (_sink1->filesink != NULL) {
-        gst_object_unref(_sink1->filesink);
-        _sink1->filesink = NULL;
+//-----------------------------------------------------------------------------
+// The recognizer loads the OpenALPR model on its worker thread, so it is only
+// created while plate recognition is wanted and torn down again when it is not.
+void VideoReceiver::setPlateRecognition(bool enabled){
+    if(enabled == plateRecognition()) {
+        return;
     }
-    _sink1->mux = NULL;
-    if (_sink1->mux != NULL) {
-        gst_object_unref(_sink1->mux);
-        _sink1->mux = NULL;
+    if(enabled) {
+        _plateRecognizer = new PlateRecognizer();
+        _plateTap = new VideoFrameTap(_plateRecognizer, "BGR");
+#if defined(QGC_GST_STREAMING)
+        connect(_plateRecognizer, &PlateRecognizer::plateRecognized, this, &VideoReceiver::carinfChanged);
+#endif
+        _plateRecognizer->start();
+    } else {
+        // Tap first, it hands frames to the recognizer
+        _plateTap->detach();
+        delete _plateTap;
+        delete _plateRecognizer;
+        _plateTap = NULL;
+        _plateRecognizer = NULL;
     }
-    _sink1->convert = NULL;
-    if (_sink1->convert != NULL) {
-        gst_object_unref(_sink1->convert);
-        _sink1->convert= NULL;
+    emit plateRecognitionChanged();
+}
+//-----------------------------------------------------------------------------
+// Hangs the plate recognition tap off the decoded video tee. It stays in the
+// pipeline until the pipeline is shut down, frames only flow through it when
+// saveImg() asks for one.
+void VideoReceiver::startroirecording (){
+#if defined(QGC_GST_STREAMING)
+    if(_plateTap == NULL) {
+        qCDebug(VideoReceiverLog) << "startroirecording: plate recognition disabled";
+        return;
     }
-    _sink1->videorate = NULL;
-    if (_sink1->videorate != NULL) {
-        gst_object_unref(_sink1->videorate);
-        _sink1->videorate= NULL;
+    if(_pipeline == NULL) {
+        qCDebug(VideoReceiverLog) << "startroirecording: no pipeline";
+        return;
     }
-    delete _sink1;
-    _sink1 = NULL;
+    _plateTap->attach(_pipeline, tee1);
 #endif
-
+}
+//-----------------------------------------------------------------------------
+// Drops any shot not taken yet. The capture branch itself stays in the pipeline.
+void VideoReceiver::stopimagerecording (){
+    _stillTap->cancelRequests();
+    _stillCapture->cancelBurst();
 }
 
 void VideoReceiver::setRecordVideo (bool recordVideo){
@@ -945,16 +864,6 @@ void VideoReceiver::setRecordVideoDir(QString recordVideoDir){
     _recordVideoDir = recordVideoDir;
 }
 
-void VideoReceiver::screeneCallback(){
-#if defined(QGC_GST_STREAMING)
-    g_object_set(G_OBJECT(_sink1->videorate), "drop", (gboolean) TRUE, NULL);
-    GstPad * pad = gst_element_get_static_pad(_sink1->videorate, "src");
-    //stopimagerecording();
-    gst_pad_remove_probe(pad, imageBufferProbeId);
-    imageRecord=true;
-   qDebug()<<"int==="<<imageBufferProbeId;
-#endif
-}
 void VideoReceiver::setRtsp(bool change){
     if(change){
         _shutdownPipeline();
@@ -966,179 +875,36 @@ void VideoReceiver::setRtsp(bool change){
         start();
     }
 }
+//-----------------------------------------------------------------------------
+// Grabs the next decoded frame and hands the region of interest to the plate
+// recognizer. The result comes back through carinfChanged.
 void VideoReceiver::saveImg(){
-//    GstMapInfo map;
-//    GstSample *sample = gst_app_sink_pull_sample((GstAppSink*)_sink1->filesink);
-//    GstBuffer *buffer = gst_sample_get_buffer(sample);
-//    int size = gst_buffer_get_size(buffer);
-//    qDebug()<<"size=="<<size;
-//    gst_buffer_map(buffer,&map,GST_MAP_READ);
-//    QString str = (_recordPictureDir+"/XH" + (QDateTime::currentDateTime()).toString("yyyyMMddhhmmsszzz") + ".jpg");
-
-//    QByteArray ba = str.toLatin1();
-//     char *mm = ba.data();
-//     QImage iim((uchar*)map.data,240,160,QImage::Format_RGB32);
-//     iim.save(str);
-//    FILE *fp = fopen(mm, "wb");
-//   // fwrite(&map.data, 1, size, fp);
-//      //    fclose(fp);
-////          gst_buffer_unref (buffer);
-       //================================================
-    //======================================================
-
-//    OPENALPR* alpr_obj;
-//QLibrary lib("../libopenalpr.dll");
-//if(lib.load()){
-// qDebug()<<"cccccccccccccccccc";
-// alpr_obj = openalpr_init("us","", "","");
-
-// if (openalpr_is_loaded(alpr_obj))
-// {
-//     // We don't want to restrict the size of the recognition area, so we set this to an extremely large pixel size
-//     // rather than decode and find the actual image width/height.
-//     struct AlprCRegionOfInterest roi;
-//     roi.x = 0;
-//     roi.y = 0;
-//     roi.width = 10000;
-//     roi.height = 10000;
-
-//     // Read the image file
-//     unsigned char* buffer;
-//     long long length = read_file("eu-1.jpg", &buffer);
-
-//     printf("file size (bytes): %d\n", length);
-
-//     if (length > 0)
-//     {
-//         char* plate_response = openalpr_recognize_encodedimage(alpr_obj, buffer, length, roi);
-//         printf("Alpr response:\n%s\n", plate_response);
-//         openalpr_free_response_string(plate_response);
-//     }
-
-//     free(buffer);
-
-
-// }
-
-// openalpr_cleanup(alpr_obj);
-
-//}
-
-        // Leave the config and runtime directory blank to look for these in the current directory.
-
-    //=======================================================
-    qDebug()<<"this is alpr";
-    Mat img = imread("roi.jpeg",1);
-    Mat imageROI;
-    int x=_roi[0].toInt();
-    int y=_roi[1].toInt();
-    int width = _roi[2].toInt()-x;
-    int height = _roi[3].toInt()-y;
-    imageROI = img(Rect(x, y, width, height));
-    imwrite("carimg.jpeg",imageROI);
-    Alpr alpr("eu", "openalpr.conf");
-    alpr.setTopN(10);
-    alpr.setDefaultRegion("");
-    QString mm;
-    if (alpr.isLoaded() == false)
-    {
-        //std::cerr << "Error loading OpenALPR" << std::endl;
-        //return 1;
+    if(_plateRecognizer == NULL) {
+        qCDebug(VideoReceiverLog) << "saveImg: plate recognition disabled";
+        return;
     }
-   // ================================================================
-    alpr::AlprResults results = alpr.recognize("carimg.jpeg");
- //file->open(QIODevice::WriteOnly);
-    for (int i = 0; i < results.plates.size(); i++)
-    {
-      alpr::AlprPlateResult plate = results.plates[i];
-      mm.append("plate").append(QString::number(i, 10)).append(": ").append(QString::number(plate.topNPlates.size(), 10)).append(" results").append("\n");
-      std::cout << "plate" << i << ": " << plate.topNPlates.size() << " results" << std::endl;
-     // QTextStream out(file);
-            // out <<endl << "plate" << i << ": " << plate.topNPlates.size() << " results" <<endl ;
-        for (int k = 0; k < plate.topNPlates.size(); k++)
-        {
-          alpr::AlprPlate candidate = plate.topNPlates[k];
-
-          std::cout << "    - " << candidate.characters << "\t confidence: " << candidate.overall_confidence;
-          mm.append( "    - ").append(QString::fromStdString(candidate.characters)).append(" confidence: ").append(QString::number( candidate.overall_confidence, 'f', 4 )).append("\n");
-          // QTextStream out1(file);
-          // out1 <<endl<< "    - " << QString::fromStdString(candidate.characters) << "\t confidence: " << QString::number( candidate.overall_confidence, 'f', 4 )<<endl;
-          std::cout << "\t pattern_match: " << candidate.matches_template << std::endl;
-        }
+    if(_roi.count() >= 4) {
+        int x = _roi[0].toInt();
+        int y = _roi[1].toInt();
+        _plateRecognizer->setRoi(cv::Rect(x, y, _roi[2].toInt() - x, _roi[3].toInt() - y));
+    } else {
+        _plateRecognizer->setRoi(cv::Rect());
+    }
+#if defined(QGC_GST_STREAMING)
+    startroirecording();
+    if(_plateTap->attached()) {
+        _plateTap->requestFrame();
     }
-    qDebug()<<"mm=="<<mm;
-    // file->close();
-    //======================================================================
-//    cv::Mat frame = cv::imread("eu-2.jpg");
-//    std::vector<AlprRegionOfInterest> regionsOfInterest;
-//    qDebug()<<"frame=="<<frame.rows;
-//    cv::Rect rectan = getInterestRect(&frame);
-//    qDebug()<<"width=="<<rectan.width;
-//    if (rectan.width>0) regionsOfInterest.push_back(AlprRegionOfInterest(rectan.x, rectan.y, rectan.width, rectan.height));
-
-
-//     AlprResults results;
-//     if (regionsOfInterest.size()>0) results = alpr.recognize(frame.data, frame.elemSize(), frame.cols, frame.rows, regionsOfInterest);
-//         for (int i = 0; i < results.plates.size(); i++)
-//         {
-//           alpr::AlprPlateResult plate = results.plates[i];
-//           std::cout << "plate" << i << ": " << plate.topNPlates.size() << " results" << std::endl;
-
-//             for (int k = 0; k < plate.topNPlates.size(); k++)
-//             {
-//               alpr::AlprPlate candidate = plate.topNPlates[k];
-//               std::cout << "    - " << candidate.characters << "\t confidence: " << candidate.overall_confidence;
-//               std::cout << "\t pattern_match: " << candidate.matches_template << std::endl;
-//             }
-//         }
-    emit carinfChanged(mm);
+#endif
 }
-cv::Rect VideoReceiver::getInterestRect(cv::Mat* frame){
-    std::vector<std::vector<cv::Point> > contours;
-        std::vector<cv::Vec4i> hierarchy;
-        cv::Rect bounding_rect;
-        std::vector<cv::Rect> rects;
-        cv::Rect largest_rect, rect_temp;
-        qDebug()<<"frame=="<<frame->rows;
-        qDebug()<<"111111111111111111";
-        pMOG2->apply(*frame, fgMaskMOG2);
-        qDebug()<<"222222222222222222";
-
-        //Remove noise
-        cv::erode(fgMaskMOG2, fgMaskMOG2, getStructuringElement(cv::MORPH_RECT, cv::Size(6, 6)));
-        // Find the contours of motion areas in the image
-        findContours(fgMaskMOG2, contours, hierarchy, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
-        // Find the bounding rectangles of the areas of motion
-        if (contours.size() > 0)
-        {
-            for (int i = 0; i < contours.size(); i++)
-            {
-                bounding_rect = boundingRect(contours[i]);
-                rects.push_back(bounding_rect);
-            }
-            // Determine the overall area with motion.
-            largest_rect = rects[0];
-            for (int i = 1; i < rects.size(); i++)
-            {
-                rect_temp.x = min(largest_rect.x,rects[i].x);
-                rect_temp.y = min(largest_rect.y,rects[i].y);
-                rect_temp.width = max(largest_rect.x + largest_rect.width, rects[i].x + rects[i].width)-rect_temp.x;
-                rect_temp.height = max(largest_rect.y + largest_rect.height, rects[i].y + rects[i].height) - rect_temp.y;
-                largest_rect = rect_temp;
-            }
-            rectangle(*frame, rect_temp, cv::Scalar(0, 255, 0), 1, 8, 0);
-        }
-        else
-            {
-              largest_rect.x = 0;
-              largest_rect.y = 0;
-              largest_rect.width = 0;
-              largest_rect.height = 0;
-            }
-
-    //	imshow("Motion detect", fgMaskMOG2);
-        return expandRect(largest_rect, 0, 0, frame->cols, frame->rows);
+#if defined(QGC_GST_STREAMING)
+cv::Rect VideoReceiver::getInterestRect(){
+    if(_pipeline != NULL && !_motionTap->attached()) {
+        _motionTap->attach(_pipeline, tee1);
+    }
+    return _motionDetector->interestRect();
 }
+#endif
 Rect VideoReceiver::expandRect(Rect original, int expandXPixels, int expandYPixels, int maxX, int maxY)
   {
     Rect expandedRegion = Rect(original);
@@ -28,6 +28,8 @@
 #include "opencv2/video/background_segm.hpp"
 #include "VideoSurface.h"
 #include "QFile"
+
+#include <atomic>
 #if defined(QGC_GST_STREAMING)
 #include <gst/gst.h>
 #include <gst/app/gstappsink.h>
@@ -35,6 +37,12 @@
 
 Q_DECLARE_LOGGING_CATEGORY(VideoReceiverLog)
 using namespace cv;
+class VideoFrameTap;
+class PlateRecognizer;
+class MotionDetector;
+class SegmentedRecorder;
+class StillImageCapture;
+class VideoSegmentStore;
 class VideoReceiver : public QObject
 {
     Q_OBJECT
@@ -47,6 +55,7 @@ public:
     Q_PROPERTY(bool             videoRunning        READ    videoRunning        NOTIFY videoRunningChanged)
     Q_PROPERTY(QString          imageFile           READ    imageFile           NOTIFY imageFileChanged)
     Q_PROPERTY(bool             showFullScreen      READ    showFullScreen      WRITE setShowFullScreen     NOTIFY showFullScreenChanged)
+    Q_PROPERTY(bool             plateRecognition    READ    plateRecognition    WRITE setPlateRecognition   NOTIFY plateRecognitionChanged)
 
     explicit VideoReceiver(QObject* parent = 0);
     ~VideoReceiver();
@@ -63,26 +72,41 @@ public:
     bool            videoRunning    () { return _videoRunning; }
     QString         imageFile       () { return _imageFile; }
     bool            showFullScreen  () { return _showFullScreen; }
+    bool            plateRecognition() { return _plateRecognizer != NULL; }
     void            grabImage       (QString imageFile);
+    /// VideoFrameTap::monotonicUsecs time the frame now on screen reached the video sink, 0 before the
+    /// first frame. Thread safe.
+    qint64          displayedFrameUsecs() const { return _displayedFrameUsecs.load(std::memory_order_relaxed); }
     void                        _setVideoSink           (GstElement* sink);
 
     void        setShowFullScreen   (bool show) { _showFullScreen = show; emit showFullScreenChanged(); }
+    /// Starts or stops the plate recognition worker. saveImg() does nothing while it is off.
+    void        setPlateRecognition (bool enabled);
     //==========================================
 
     VideoSurface* getvideoRec(){return  _videoSurface;}
     void stoprecording();
     void startrecording();
+    /// Cancels the still image burst in progress, plate recognition is not affected
     void stopimagerecording();
 
     void startimagerecording();
+    /// Saves the next count decoded frames to the picture directory. The capture branch is added on first
+    /// use and stays in the pipeline, the images are encoded and written in the background.
+    void captureImages(int count);
     void startroirecording();
-    void screeneCallback();
     void setRoi(QVariantList roi);
+#if defined(QGC_GST_STREAMING)
+    /// Latest area of motion in frame coordinates, analyzed in the background. The first call starts
+    /// the motion detector, an empty rect is returned until it has seen enough frames.
+    cv::Rect getInterestRect();
+#endif
     //===================================================
 signals:
     void videoRunningChanged        ();
     void imageFileChanged           ();
     void showFullScreenChanged      ();
+    void plateRecognitionChanged    ();
 #if defined(QGC_GST_STREAMING)
     void recordingChanged           ();
     void runningChanged             ();
@@ -102,6 +126,8 @@ public slots:
     void setRecordVideo (bool recordVideo);
     void setRecordVideoDir(QString recordVideoDir);
     void setRtsp(bool change);
+    /// Runs plate recognition on the next frame. Call on the receiver's thread only, the recognizer is
+    /// deleted there when plate recognition is turned off.
     void saveImg();
 //=====================================================
 private slots:
@@ -113,50 +139,26 @@ private slots:
     void _handleError               ();
     void _handleEOS                 ();
     void _handleStateChanged        ();
+    void _recorderStateChanged      ();
 #endif
 
 private:
 #if defined(QGC_GST_STREAMING)
-cv::Rect getInterestRect(cv::Mat* frame);
-    typedef struct
-    {
-        GstPad*         teepad;
-        GstElement*     queue;
-        GstElement*     mux;
-        GstElement*     filesink;
-        GstElement*     parse;
-        gboolean        removing;
-    } Sink;
-    typedef struct
-    {
-        GstPad*         teepad;
-        GstElement*     queue;
-        GstElement*     mux;
-        GstElement*     filesink;
-        GstElement*     convert;
-        GstElement*     videorate;
-        gboolean        removing;
-    } Sink1;
     bool                _running;
     bool                _recording;
     bool                _streaming;
     bool                _starting;
     bool                _stopping;
-    bool                imageRecord=false;
-    Sink*               _sink;
-    Sink1*               _sink1;
     GstElement*         _tee;
     GstCaps* cap;
     static gboolean             _onBusMessage           (GstBus* bus, GstMessage* message, gpointer user_data);
-    static GstPadProbeReturn    _unlinkCallBack         (GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
-    void                        _detachRecordingBranch  (GstPadProbeInfo* info);
-    void                        _shutdownRecordingBranch();
+    static GstPadProbeReturn    _onDisplayBuffer        (GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
     void                        _shutdownPipeline       ();
     void                        _cleanupOldVideos       ();
 
     GstElement*     _pipeline;
-    GstElement*     _pipelineStopRec;
     GstElement*     _videoSink;
+    gulong          _displayProbeId;    ///< Buffer probe on the video sink pad stamping _displayedFrameUsecs
     GstElement*     tee1;
 
     //-- Wait for Video Server to show up before starting
@@ -173,16 +175,22 @@ cv::Rect getInterestRect(cv::Mat* frame);
     bool            _videoRunning;
     bool            _showFullScreen;
     QString         _videoLantency;
+    std::atomic<qint64> _displayedFrameUsecs;
     //===================================
     bool        _recordVideo;
     QString     _recordVideoDir;
     QString     _recordPictureDir;
-    long imageBufferProbeId=-1;
      QFile *file;
      QVariantList _roi;
+    VideoFrameTap*      _plateTap;          ///< Raw frame tap feeding _plateRecognizer
+    PlateRecognizer*    _plateRecognizer;   ///< ALPR worker, only exists while plate recognition is enabled
+    VideoFrameTap*      _motionTap;         ///< Continuous grayscale tap feeding _motionDetector
+    MotionDetector*     _motionDetector;
+    VideoSegmentStore*  _segmentStore;      ///< Index and quota of the recording directory
+    SegmentedRecorder*  _recorder;
+    VideoFrameTap*      _stillTap;          ///< Persistent still image branch feeding _stillCapture
+    StillImageCapture*  _stillCapture;
     //====================================
-    cv::Mat fgMaskMOG2;
-     cv::Ptr<cv::BackgroundSubtractor> pMOG2 = createBackgroundSubtractorMOG2();
      long read_file(const char* file_path, unsigned char** buffer);
       Rect expandRect(Rect original, int expandXPixels, int expandYPixels, int maxX, int maxY);
 };
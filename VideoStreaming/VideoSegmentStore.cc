@@ -0,0 +1,303 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Index and storage quota of recorded video segments
+ */
+
+#include "VideoSegmentStore.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QStringList>
+#include <QTextStream>
+
+#include <algorithm>
+
+const char* VideoSegmentStore::indexFileName = "segments.idx";
+
+VideoSegmentStore::VideoSegmentStore(QObject* parent)
+    : QThread(parent)
+    , _quota(0)
+    , _removedCount(0)
+    , _reloadRequested(false)
+    , _indexDirty(false)
+    , _enforceRequested(false)
+    , _quit(false)
+{
+}
+
+VideoSegmentStore::~VideoSegmentStore()
+{
+    stopWorker();
+}
+
+void VideoSegmentStore::setDirectory(const QString& directory)
+{
+    QMutexLocker locker(&_mutex);
+    if (directory != _directory) {
+        _directory = directory;
+        _segments.clear();
+        _reloadRequested = true;
+        _workAvailable.wakeOne();
+    }
+}
+
+QString VideoSegmentStore::directory(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _directory;
+}
+
+void VideoSegmentStore::setQuota(qint64 bytes)
+{
+    QMutexLocker locker(&_mutex);
+    _quota = qMax((qint64)0, bytes);
+}
+
+qint64 VideoSegmentStore::quota(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _quota;
+}
+
+void VideoSegmentStore::setActiveSegment(const QString& fileName)
+{
+    QMutexLocker locker(&_mutex);
+    _activeSegment = fileName;
+}
+
+void VideoSegmentStore::addSegment(const Segment_t& segment)
+{
+    QMutexLocker locker(&_mutex);
+    for (int i = 0; i < _segments.count(); i++) {
+        if (_segments[i].fileName == segment.fileName) {
+            _segments.removeAt(i);
+            break;
+        }
+    }
+    _segments.append(segment);
+    _indexDirty = true;
+    _enforceRequested = true;
+    _workAvailable.wakeOne();
+}
+
+void VideoSegmentStore::enforceQuota(void)
+{
+    QMutexLocker locker(&_mutex);
+    _enforceRequested = true;
+    _workAvailable.wakeOne();
+}
+
+QList<VideoSegmentStore::Segment_t> VideoSegmentStore::segments(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _segments;
+}
+
+quint64 VideoSegmentStore::removedCount(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _removedCount;
+}
+
+void VideoSegmentStore::stopWorker(void)
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _quit = true;
+        _workAvailable.wakeAll();
+    }
+    wait();
+}
+
+bool VideoSegmentStore::_startedBefore(const Segment_t& a, const Segment_t& b)
+{
+    return a.started < b.started;
+}
+
+QList<VideoSegmentStore::Segment_t> VideoSegmentStore::_loadIndex(const QString& directory)
+{
+    QList<Segment_t> segments;
+    QSet<QString> indexed;
+    QDir dir(directory);
+
+    QFile file(dir.filePath(indexFileName));
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream stream(&file);
+        while (!stream.atEnd()) {
+            QStringList fields = stream.readLine().split('\t');
+            if (fields.count() != 4 || indexed.contains(fields[0])) {
+                continue;
+            }
+            // Files deleted behind our back simply drop out of the index
+            QFileInfo info(dir.filePath(fields[0]));
+            if (!info.exists()) {
+                continue;
+            }
+            Segment_t segment;
+            segment.fileName = fields[0];
+            segment.started = QDateTime::fromMSecsSinceEpoch(fields[1].toLongLong());
+            segment.durationMsecs = fields[2].toLongLong();
+            segment.bytes = info.size();
+            segments.append(segment);
+            indexed.insert(segment.fileName);
+        }
+    }
+
+    QStringList filters;
+    filters << "*.mkv" << "*.mov" << "*.mp4";
+    foreach (const QFileInfo& info, dir.entryInfoList(filters, QDir::Files)) {
+        if (indexed.contains(info.fileName())) {
+            continue;
+        }
+        Segment_t segment;
+        segment.fileName = info.fileName();
+        segment.started = info.lastModified();
+        segment.durationMsecs = 0;
+        segment.bytes = info.size();
+        segments.append(segment);
+    }
+
+    std::stable_sort(segments.begin(), segments.end(), _startedBefore);
+    return segments;
+}
+
+bool VideoSegmentStore::_writeIndex(const QString& directory, const QList<Segment_t>& segments)
+{
+    QDir dir(directory);
+    if (!dir.exists()) {
+        return false;
+    }
+
+    QSaveFile file(dir.filePath(indexFileName));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "VideoSegmentStore: unable to write index" << file.fileName() << file.errorString();
+        return false;
+    }
+    QTextStream stream(&file);
+    foreach (const Segment_t& segment, segments) {
+        stream << segment.fileName << '\t' << segment.started.toMSecsSinceEpoch() << '\t'
+               << segment.durationMsecs << '\t' << segment.bytes << '\n';
+    }
+    stream.flush();
+    return file.commit();
+}
+
+void VideoSegmentStore::run(void)
+{
+    forever {
+        QString directory;
+        QString activeSegment;
+        qint64 quota;
+        bool reload, writeIndex, enforce;
+        {
+            QMutexLocker locker(&_mutex);
+            while (!_quit && !_reloadRequested && !_indexDirty && !_enforceRequested) {
+                _workAvailable.wait(&_mutex);
+            }
+            if (_quit) {
+                break;
+            }
+            directory = _directory;
+            activeSegment = _activeSegment;
+            quota = _quota;
+            reload = _reloadRequested;
+            writeIndex = _indexDirty;
+            enforce = _enforceRequested;
+            _reloadRequested = _indexDirty = _enforceRequested = false;
+        }
+        if (directory.isEmpty()) {
+            continue;
+        }
+
+        if (reload) {
+            QList<Segment_t> loaded = _loadIndex(directory);
+            QMutexLocker locker(&_mutex);
+            if (directory != _directory) {
+                // Switched again while we were scanning, the next pass handles it
+                continue;
+            }
+            // Keep segments added while we were scanning, and leave the segment being written alone
+            QSet<QString> names;
+            for (int i = loaded.count() - 1; i >= 0; i--) {
+                if (loaded[i].fileName == _activeSegment) {
+                    loaded.removeAt(i);
+                } else {
+                    names.insert(loaded[i].fileName);
+                }
+            }
+            foreach (const Segment_t& segment, _segments) {
+                if (!names.contains(segment.fileName)) {
+                    loaded.append(segment);
+                }
+            }
+            std::stable_sort(loaded.begin(), loaded.end(), _startedBefore);
+            _segments = loaded;
+            activeSegment = _activeSegment;
+            writeIndex = true;
+            enforce = true;
+        }
+
+        qint64 totalBytes = 0;
+        if (enforce) {
+            QDir dir(directory);
+            QList<Segment_t> segments = this->segments();
+
+            if (!activeSegment.isEmpty()) {
+                totalBytes += QFileInfo(dir.filePath(activeSegment)).size();
+            }
+            foreach (const Segment_t& segment, segments) {
+                totalBytes += segment.bytes;
+            }
+
+            QStringList removed;
+            for (int i = 0; quota > 0 && totalBytes > quota && i < segments.count(); i++) {
+                const Segment_t& segment = segments[i];
+                if (segment.fileName == activeSegment) {
+                    continue;
+                }
+                QString path = dir.filePath(segment.fileName);
+                if (QFile::remove(path) || !QFile::exists(path)) {
+                    totalBytes -= segment.bytes;
+                    removed.append(segment.fileName);
+                } else {
+                    qWarning() << "VideoSegmentStore: unable to remove" << path;
+                }
+            }
+
+            if (!removed.isEmpty()) {
+                QMutexLocker locker(&_mutex);
+                for (int i = _segments.count() - 1; i >= 0; i--) {
+                    if (removed.contains(_segments[i].fileName)) {
+                        _segments.removeAt(i);
+                    }
+                }
+                _removedCount += removed.count();
+                writeIndex = true;
+            }
+            foreach (const QString& fileName, removed) {
+                emit segmentRemoved(fileName);
+            }
+        }
+
+        if (writeIndex) {
+            _writeIndex(directory, segments());
+        }
+        if (enforce) {
+            emit quotaEnforced(totalBytes);
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Index and storage quota of recorded video segments
+ */
+
+#ifndef VIDEO_SEGMENT_STORE_H
+#define VIDEO_SEGMENT_STORE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+
+/// Keeps the index of recorded video segments in a directory and holds the directory to a storage quota.
+///
+/// All file system work (scanning, deleting, rewriting the index) is done on the store's own thread, the
+/// public methods only update in memory state and wake the worker. Once over quota the oldest segments are
+/// deleted first. The segment currently being written is never deleted, but its size counts towards the quota.
+///
+/// The index is a tab separated text file in the directory, one segment per line:
+///     file name, start time (msecs since epoch), duration in msecs, size in bytes
+/// Video files found in the directory which are not in the index, for example from older versions, are
+/// adopted into it using their modification time.
+class VideoSegmentStore : public QThread
+{
+    Q_OBJECT
+
+public:
+    typedef struct {
+        QString     fileName;       ///< Relative to the store directory
+        QDateTime   started;
+        qint64      durationMsecs;
+        qint64      bytes;
+    } Segment_t;
+
+    VideoSegmentStore(QObject* parent = NULL);
+    ~VideoSegmentStore();
+
+    /// Switches to a new directory, the index is (re)loaded on the worker thread
+    void setDirectory(const QString& directory);
+    QString directory(void) const;
+
+    /// @param bytes Maximum size of all segments together, 0 to disable the quota
+    void setQuota(qint64 bytes);
+    qint64 quota(void) const;
+
+    /// Segment which is currently being written, empty for none
+    void setActiveSegment(const QString& fileName);
+
+    /// Adds a finished segment to the index and checks the quota
+    void addSegment(const Segment_t& segment);
+
+    /// Schedules a quota check on the worker thread
+    void enforceQuota(void);
+
+    /// @return Snapshot of the index, oldest segment first
+    QList<Segment_t> segments(void) const;
+
+    /// @return Number of segments deleted to keep within the quota
+    quint64 removedCount(void) const;
+
+    void stopWorker(void);
+
+    static const char* indexFileName;
+
+signals:
+    void segmentRemoved(QString fileName);
+
+    /// Emitted after every quota pass
+    ///     @param totalBytes Size of all segments after cleanup, including the active one
+    void quotaEnforced(qint64 totalBytes);
+
+protected:
+    void run(void);
+
+private:
+    QList<Segment_t> _loadIndex(const QString& directory);
+    bool _writeIndex(const QString& directory, const QList<Segment_t>& segments);
+    static bool _startedBefore(const Segment_t& a, const Segment_t& b);
+
+    mutable QMutex      _mutex;
+    QWaitCondition      _workAvailable;
+    QString             _directory;
+    QString             _activeSegment;
+    QList<Segment_t>    _segments;
+    qint64              _quota;
+    quint64             _removedCount;
+    bool                _reloadRequested;
+    bool                _indexDirty;
+    bool                _enforceRequested;
+    bool                _quit;
+};
+
+#endif // VIDEO_SEGMENT_STORE_H
@@ -27,7 +27,7 @@
 LinuxBuild {
     CONFIG += link_pkgconfig
     packagesExist(gstreamer-1.0) {
-        PKGCONFIG   += gstreamer-1.0  gstreamer-video-1.0
+        PKGCONFIG   += gstreamer-1.0  gstreamer-video-1.0 gstreamer-app-1.0
         CONFIG      += VideoEnabled
     }
 } else:MacBuild {
@@ -162,6 +162,7 @@ VideoEnabled {
         $$PWD/gstqtvideosink/painters/openglsurfacepainter.h \
         $$PWD/gstqtvideosink/painters/videomaterial.h \
         $$PWD/gstqtvideosink/painters/videonode.h \
+        $$PWD/gstqtvideosink/painters/yuvconverter.h \
         $$PWD/gstqtvideosink/utils/bufferformat.h \
         $$PWD/gstqtvideosink/utils/utils.h \
         $$PWD/gstqtvideosink/utils/glutils.h \
@@ -183,6 +184,7 @@ VideoEnabled {
         $$PWD/gstqtvideosink/painters/openglsurfacepainter.cpp \
         $$PWD/gstqtvideosink/painters/videomaterial.cpp \
         $$PWD/gstqtvideosink/painters/videonode.cpp \
+        $$PWD/gstqtvideosink/painters/yuvconverter.cpp \
         $$PWD/gstqtvideosink/utils/bufferformat.cpp \
         $$PWD/gstqtvideosink/utils/utils.cpp \
 
@@ -0,0 +1,218 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "YuvConverterTest.h"
+#include "yuvconverter.h"
+
+#include <QElapsedTimer>
+#include <QPainter>
+
+YuvConverterTest::YuvConverterTest(void)
+{
+
+}
+
+/// Gradients in all three planes plus some noise so every kernel lane sees different values
+QByteArray YuvConverterTest::_syntheticI420(int width, int height)
+{
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    QByteArray frame(width * height + 2 * chromaWidth * chromaHeight, 0);
+    quint8* y = (quint8*)frame.data();
+    quint8* u = y + width * height;
+    quint8* v = u + chromaWidth * chromaHeight;
+
+    quint32 seed = 1;
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            seed = seed * 1103515245 + 12345;
+            y[row * width + col] = (quint8)(((col * 255) / qMax(1, width - 1) + (seed >> 28)) & 0xff);
+        }
+    }
+    for (int row = 0; row < chromaHeight; row++) {
+        for (int col = 0; col < chromaWidth; col++) {
+            u[row * chromaWidth + col] = (quint8)((row * 255) / qMax(1, chromaHeight - 1));
+            v[row * chromaWidth + col] = (quint8)(255 - (col * 255) / qMax(1, chromaWidth - 1));
+        }
+    }
+
+    return frame;
+}
+
+QByteArray YuvConverterTest::_toNV12(const QByteArray& i420, int width, int height)
+{
+    int chromaSize = ((width + 1) / 2) * ((height + 1) / 2);
+    QByteArray frame(i420.left(width * height));
+    const char* u = i420.constData() + width * height;
+    const char* v = u + chromaSize;
+    for (int i = 0; i < chromaSize; i++) {
+        frame.append(u[i]);
+        frame.append(v[i]);
+    }
+    return frame;
+}
+
+static YuvConverter::Planes _i420Planes(const QByteArray& frame, int width, int height)
+{
+    int chromaWidth = (width + 1) / 2;
+    YuvConverter::Planes planes;
+    planes.y = (const quint8*)frame.constData();
+    planes.u = planes.y + width * height;
+    planes.v = planes.u + chromaWidth * ((height + 1) / 2);
+    planes.yStride = width;
+    planes.uvStride = chromaWidth;
+    planes.uvPixelStride = 1;
+    planes.width = width;
+    planes.height = height;
+    return planes;
+}
+
+void YuvConverterTest::_testKernelsMatchScalar(void)
+{
+    // Odd sizes exercise the scalar tail of the SIMD kernels
+    const int width = 333;
+    const int height = 123;
+    QByteArray frame = _syntheticI420(width, height);
+    YuvConverter::Planes planes = _i420Planes(frame, width, height);
+
+    QSize rgTargets[] = { QSize(width, height), QSize(160, 90), QSize(701, 257) };
+    YuvConverter::ScaleMode rgModes[] = { YuvConverter::ScaleNearest, YuvConverter::ScaleBilinear };
+
+    for (size_t t = 0; t < sizeof(rgTargets) / sizeof(rgTargets[0]); t++) {
+        for (size_t m = 0; m < sizeof(rgModes) / sizeof(rgModes[0]); m++) {
+            YuvConverter reference;
+            reference.setKernel(YuvConverter::KernelScalar);
+            reference.setScaleMode(rgModes[m]);
+            QImage expected(rgTargets[t], QImage::Format_RGB32);
+            reference.convert(planes, QRect(0, 0, width, height), expected);
+
+            for (int k = YuvConverter::KernelSSE2; k < YuvConverter::KernelCount; k++) {
+                YuvConverter::Kernel kernel = (YuvConverter::Kernel)k;
+                if (!YuvConverter::kernelAvailable(kernel)) {
+                    continue;
+                }
+                YuvConverter converter;
+                converter.setKernel(kernel);
+                converter.setScaleMode(rgModes[m]);
+                QImage image(rgTargets[t], QImage::Format_RGB32);
+                converter.convert(planes, QRect(0, 0, width, height), image);
+                QVERIFY2(image == expected, YuvConverter::kernelName(kernel));
+            }
+        }
+    }
+}
+
+void YuvConverterTest::_testKnownColors(void)
+{
+    struct Color_t {
+        quint8  y, u, v;
+        QRgb    rgb;
+    };
+    const Color_t rgColors[] = {
+        { 16,  128, 128, qRgb(0, 0, 0) },
+        { 235, 128, 128, qRgb(255, 255, 255) },
+        { 81,  90,  240, qRgb(255, 0, 0) },
+        { 145, 54,  34,  qRgb(0, 255, 0) },
+        { 41,  240, 110, qRgb(0, 0, 255) },
+    };
+
+    for (size_t i = 0; i < sizeof(rgColors) / sizeof(rgColors[0]); i++) {
+        const Color_t& color = rgColors[i];
+
+        // Wide enough to go through the SIMD loop as well as the tail
+        const int width = 40;
+        const int height = 2;
+        QByteArray frame(width * height, (char)color.y);
+        frame.append(QByteArray(width / 2, (char)color.u));
+        frame.append(QByteArray(width / 2, (char)color.v));
+
+        YuvConverter converter;
+        QImage image(width, height, QImage::Format_RGB32);
+        converter.convert(_i420Planes(frame, width, height), QRect(0, 0, width, height), image);
+
+        for (int x = 0; x < width; x++) {
+            QRgb pixel = image.pixel(x, 1);
+            QVERIFY(qAbs(qRed(pixel) - qRed(color.rgb)) <= 2);
+            QVERIFY(qAbs(qGreen(pixel) - qGreen(color.rgb)) <= 2);
+            QVERIFY(qAbs(qBlue(pixel) - qBlue(color.rgb)) <= 2);
+        }
+    }
+}
+
+void YuvConverterTest::_testNV12MatchesI420(void)
+{
+    const int width = 64;
+    const int height = 48;
+    QByteArray i420 = _syntheticI420(width, height);
+    QByteArray nv12 = _toNV12(i420, width, height);
+
+    YuvConverter::Planes planes = _i420Planes(nv12, width, height);
+    planes.u = (const quint8*)nv12.constData() + width * height;
+    planes.v = planes.u + 1;
+    planes.uvStride = width;
+    planes.uvPixelStride = 2;
+
+    YuvConverter converter;
+    QImage expected(100, 75, QImage::Format_RGB32);
+    converter.convert(_i420Planes(i420, width, height), QRect(8, 8, 40, 30), expected);
+    QImage image(100, 75, QImage::Format_RGB32);
+    converter.convert(planes, QRect(8, 8, 40, 30), image);
+
+    QVERIFY(image == expected);
+}
+
+void YuvConverterTest::_benchmarkPaintPath(void)
+{
+    const int width = 1920;
+    const int height = 1080;
+    const QSize target(1280, 720);
+    const int cFrames = 30;
+
+    QByteArray frame = _syntheticI420(width, height);
+    YuvConverter::Planes planes = _i420Planes(frame, width, height);
+    QImage surface(target, QImage::Format_RGB32);
+
+    // Previous path: upstream converter produces full size RGB, QPainter scales it to the surface
+    qint64 previousMsecs;
+    {
+        YuvConverter converter;
+        converter.setKernel(YuvConverter::KernelScalar);
+        converter.setScaleMode(YuvConverter::ScaleNearest);
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < cFrames; i++) {
+            QImage full(width, height, QImage::Format_RGB32);
+            converter.convert(planes, QRect(0, 0, width, height), full);
+            QPainter painter(&surface);
+            painter.drawImage(QRectF(QPointF(0, 0), target), full, QRectF(0, 0, width, height));
+        }
+        previousMsecs = timer.elapsed();
+    }
+
+    for (int k = YuvConverter::KernelScalar; k < YuvConverter::KernelCount; k++) {
+        YuvConverter::Kernel kernel = (YuvConverter::Kernel)k;
+        if (!YuvConverter::kernelAvailable(kernel)) {
+            continue;
+        }
+        YuvConverter converter;
+        converter.setKernel(kernel);
+        QImage scaled(target, QImage::Format_RGB32);
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < cFrames; i++) {
+            converter.convert(planes, QRect(0, 0, width, height), scaled);
+            QPainter painter(&surface);
+            painter.drawImage(QPointF(0, 0), scaled);
+        }
+
+        // Converting straight to the surface size never costs more than converting and scaling the full frame
+        QVERIFY(timer.elapsed() <= previousMsecs);
+    }
+}
@@ -0,0 +1,40 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef YuvConverterTest_H
+#define YuvConverterTest_H
+
+#include "UnitTest.h"
+
+#include <QByteArray>
+
+/// Unit test and benchmark for the YuvConverter used by GenericSurfacePainter
+///
+/// The benchmark compares the previous painting path (full resolution conversion to RGB32, then
+/// QPainter scaling) with the fused convert and scale of every kernel available on this machine.
+class YuvConverterTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    YuvConverterTest(void);
+
+private slots:
+    void _testKernelsMatchScalar(void);
+    void _testKnownColors(void);
+    void _testNV12MatchesI420(void);
+    void _benchmarkPaintPath(void);
+
+private:
+    QByteArray  _syntheticI420(int width, int height);
+    QByteArray  _toNV12(const QByteArray& i420, int width, int height);
+};
+
+#endif
@@ -28,9 +28,9 @@
 #include <QCoreApplication>
 
 #if Q_BYTE_ORDER == Q_BIG_ENDIAN
-# define CAPS_FORMATS "{ ARGB, xRGB, RGB, RGB16 }"
+# define CAPS_FORMATS "{ ARGB, xRGB, RGB, RGB16, I420, YV12, NV12 }"
 #else
-# define CAPS_FORMATS "{ BGRA, BGRx, RGB, RGB16 }"
+# define CAPS_FORMATS "{ BGRA, BGRx, RGB, RGB16, I420, YV12, NV12 }"
 #endif
 
 GstVideoSinkClass *GstQtVideoSinkBase::s_parent_class = NULL;
@@ -26,6 +26,7 @@
 
 GenericSurfacePainter::GenericSurfacePainter()
     : m_imageFormat(QImage::Format_Invalid)
+    , m_yuv(false)
 {
 }
 
@@ -42,11 +43,15 @@ QSet<GstVideoFormat> GenericSurfacePainter::supportedPixelFormats()
 #endif
         << GST_VIDEO_FORMAT_RGB
         << GST_VIDEO_FORMAT_RGB16
+        << GST_VIDEO_FORMAT_I420
+        << GST_VIDEO_FORMAT_YV12
+        << GST_VIDEO_FORMAT_NV12
         ;
 }
 
 void GenericSurfacePainter::init(const BufferFormat &format)
 {
+    m_yuv = false;
     switch (format.videoFormat()) {
     // QImage is shitty and reads integers instead of bytes,
     // thus it is affected by the host's endianness
@@ -73,6 +78,13 @@ void GenericSurfacePainter::init(const BufferFormat &format)
     case GST_VIDEO_FORMAT_RGB:
         m_imageFormat = QImage::Format_RGB888;
         break;
+    //Converted by YuvConverter straight into m_target
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_YV12:
+    case GST_VIDEO_FORMAT_NV12:
+        m_imageFormat = QImage::Format_RGB32;
+        m_yuv = true;
+        break;
     default:
         throw QString("Unsupported format");
     }
@@ -81,6 +93,8 @@ void GenericSurfacePainter::init(const BufferFormat &format)
 void GenericSurfacePainter::cleanup()
 {
     m_imageFormat = QImage::Format_Invalid;
+    m_yuv = false;
+    m_target = QImage();
 }
 
 void GenericSurfacePainter::paint(quint8 *data,
@@ -90,6 +104,11 @@ void GenericSurfacePainter::paint(quint8 *data,
 {
     Q_ASSERT(m_imageFormat != QImage::Format_Invalid);
 
+    if (m_yuv) {
+        paintYuv(data, frameFormat, painter, areas);
+        return;
+    }
+
     QImage image(
         data,
         frameFormat.frameSize().width(),
@@ -108,6 +127,45 @@ void GenericSurfacePainter::paint(quint8 *data,
     painter->fillRect(areas.blackArea2, Qt::black);
 }
 
+void GenericSurfacePainter::paintYuv(quint8 *data,
+        const BufferFormat & frameFormat,
+        QPainter *painter,
+        const PaintAreas & areas)
+{
+    GstVideoInfo info = frameFormat.videoInfo();
+    const QSize frameSize = frameFormat.frameSize();
+
+    YuvConverter::Planes planes;
+    planes.y = data + GST_VIDEO_INFO_COMP_OFFSET(&info, 0);
+    planes.u = data + GST_VIDEO_INFO_COMP_OFFSET(&info, 1);
+    planes.v = data + GST_VIDEO_INFO_COMP_OFFSET(&info, 2);
+    planes.yStride = GST_VIDEO_INFO_COMP_STRIDE(&info, 0);
+    planes.uvStride = GST_VIDEO_INFO_COMP_STRIDE(&info, 1);
+    planes.uvPixelStride = GST_VIDEO_INFO_COMP_PSTRIDE(&info, 1);
+    planes.width = frameSize.width();
+    planes.height = frameSize.height();
+
+    QRect sourceRect(
+        qRound(areas.sourceRect.x() * frameSize.width()),
+        qRound(areas.sourceRect.y() * frameSize.height()),
+        qRound(areas.sourceRect.width() * frameSize.width()),
+        qRound(areas.sourceRect.height() * frameSize.height()));
+
+    // Convert at the painted size so the painter only has to blit
+    QRect targetRect = areas.videoArea.toAlignedRect();
+    if (targetRect.isEmpty()) {
+        return;
+    }
+    if (m_target.size() != targetRect.size()) {
+        m_target = QImage(targetRect.size(), QImage::Format_RGB32);
+    }
+    m_converter.convert(planes, sourceRect, m_target);
+
+    painter->fillRect(areas.blackArea1, Qt::black);
+    painter->drawImage(targetRect.topLeft(), m_target);
+    painter->fillRect(areas.blackArea2, Qt::black);
+}
+
 void GenericSurfacePainter::updateColors(int, int, int, int)
 {
 }
@@ -25,12 +25,15 @@
 #define GENERICSURFACEPAINTER_H
 
 #include "abstractsurfacepainter.h"
+#include "yuvconverter.h"
 #include <QSet>
 #include <QImage>
 
 /**
  * Generic painter that paints using the QPainter API.
- * No colorspace conversion is done and no colors adjustment either.
+ * RGB frames are painted as they are. 4:2:0 YUV frames are converted and
+ * scaled to the video area in one pass by YuvConverter.
+ * No colors adjustment is done.
  */
 class GenericSurfacePainter : public AbstractSurfacePainter
 {
@@ -52,7 +55,13 @@ public:
     virtual void updateColors(int brightness, int contrast, int hue, int saturation);
 
 private:
+    void paintYuv(quint8 *data, const BufferFormat & frameFormat,
+                  QPainter *painter, const PaintAreas & areas);
+
     QImage::Format m_imageFormat;
+    bool m_yuv;
+    YuvConverter m_converter;
+    QImage m_target;    ///< Reused between frames, reallocated only when the video area is resized
 };
 
 #endif // GENERICSURFACEPAINTER_H
@@ -0,0 +1,384 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+/**
+ * @file
+ *   @brief Software planar YUV to RGB conversion with fused scaling
+ */
+
+#include "yuvconverter.h"
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+# if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define YUV_HAVE_SSE2
+#  include <emmintrin.h>
+# endif
+# if defined(__AVX2__)
+#  define YUV_HAVE_AVX2
+#  define YUV_AVX2_TARGET
+# elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   // Built without -mavx2, compile the AVX2 kernel anyway and pick it at runtime
+#  define YUV_HAVE_AVX2
+#  define YUV_AVX2_TARGET __attribute__((target("avx2")))
+#  define YUV_AVX2_RUNTIME_CHECK
+# endif
+# if defined(YUV_HAVE_AVX2)
+#  include <immintrin.h>
+# endif
+# if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define YUV_HAVE_NEON
+#  include <arm_neon.h>
+# endif
+#endif
+
+// BT.601 limited range in Q6 fixed point:
+//   R = 1.164(Y-16) + 1.596(V-128)
+//   G = 1.164(Y-16) - 0.391(U-128) - 0.813(V-128)
+//   B = 1.164(Y-16) + 2.018(U-128)
+// The luma gain is 74.5/64, the extra half comes from a shift so white still maps to 255.
+// Intermediate sums saturate at 16 bits exactly like the SIMD kernels do.
+static const int cY  = 74;
+static const int cRV = 102;
+static const int cGU = 25;
+static const int cGV = 52;
+static const int cBU = 129;
+
+static inline int sat16(int value)
+{
+    return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+}
+
+static inline quint32 clampByte(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static void convertRowScalar(const quint8 *y, const quint8 *u, const quint8 *v, quint32 *dst, int count)
+{
+    for (int i = 0; i < count; i++) {
+        int luma = y[i] - 16;
+        int yy = luma * cY + (luma >> 1);
+        int uu = u[i] - 128;
+        int vv = v[i] - 128;
+
+        int r = sat16(sat16(yy + vv * cRV) + 32) >> 6;
+        int g = sat16(sat16(sat16(yy - uu * cGU) - vv * cGV) + 32) >> 6;
+        int b = sat16(sat16(yy + uu * cBU) + 32) >> 6;
+
+        dst[i] = 0xff000000u | (clampByte(r) << 16) | (clampByte(g) << 8) | clampByte(b);
+    }
+}
+
+#if defined(YUV_HAVE_SSE2)
+static void convertRowSSE2(const quint8 *y, const quint8 *u, const quint8 *v, quint32 *dst, int count)
+{
+    const __m128i zero   = _mm_setzero_si128();
+    const __m128i c16    = _mm_set1_epi16(16);
+    const __m128i c128   = _mm_set1_epi16(128);
+    const __m128i round  = _mm_set1_epi16(32);
+    const __m128i kY     = _mm_set1_epi16(cY);
+    const __m128i kRV    = _mm_set1_epi16(cRV);
+    const __m128i kGU    = _mm_set1_epi16(cGU);
+    const __m128i kGV    = _mm_set1_epi16(cGV);
+    const __m128i kBU    = _mm_set1_epi16(cBU);
+    const __m128i alpha  = _mm_set1_epi8((char)0xff);
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m128i yy = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(y + x)), zero);
+        __m128i uu = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(u + x)), zero);
+        __m128i vv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(v + x)), zero);
+        yy = _mm_sub_epi16(yy, c16);
+        yy = _mm_add_epi16(_mm_mullo_epi16(yy, kY), _mm_srai_epi16(yy, 1));
+        uu = _mm_sub_epi16(uu, c128);
+        vv = _mm_sub_epi16(vv, c128);
+
+        __m128i r = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(vv, kRV)), round), 6);
+        __m128i g = _mm_srai_epi16(_mm_adds_epi16(_mm_subs_epi16(_mm_subs_epi16(yy, _mm_mullo_epi16(uu, kGU)), _mm_mullo_epi16(vv, kGV)), round), 6);
+        __m128i b = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(uu, kBU)), round), 6);
+
+        // Interleave to B G R A bytes, which is 0xAARRGGBB in a little endian quint32
+        __m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+        __m128i ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), alpha);
+        _mm_storeu_si128((__m128i *)(dst + x),     _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *)(dst + x + 4), _mm_unpackhi_epi16(bg, ra));
+    }
+
+    convertRowScalar(y + x, u + x, v + x, dst + x, count - x);
+}
+#endif
+
+#if defined(YUV_HAVE_AVX2)
+YUV_AVX2_TARGET
+static void convertRowAVX2(const quint8 *y, const quint8 *u, const quint8 *v, quint32 *dst, int count)
+{
+    const __m256i c16    = _mm256_set1_epi16(16);
+    const __m256i c128   = _mm256_set1_epi16(128);
+    const __m256i round  = _mm256_set1_epi16(32);
+    const __m256i kY     = _mm256_set1_epi16(cY);
+    const __m256i kRV    = _mm256_set1_epi16(cRV);
+    const __m256i kGU    = _mm256_set1_epi16(cGU);
+    const __m256i kGV    = _mm256_set1_epi16(cGV);
+    const __m256i kBU    = _mm256_set1_epi16(cBU);
+    const __m256i alpha  = _mm256_set1_epi8((char)0xff);
+
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m256i yy = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(y + x)));
+        __m256i uu = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(u + x)));
+        __m256i vv = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(v + x)));
+        yy = _mm256_sub_epi16(yy, c16);
+        yy = _mm256_add_epi16(_mm256_mullo_epi16(yy, kY), _mm256_srai_epi16(yy, 1));
+        uu = _mm256_sub_epi16(uu, c128);
+        vv = _mm256_sub_epi16(vv, c128);
+
+        __m256i r = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(yy, _mm256_mullo_epi16(vv, kRV)), round), 6);
+        __m256i g = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_subs_epi16(_mm256_subs_epi16(yy, _mm256_mullo_epi16(uu, kGU)), _mm256_mullo_epi16(vv, kGV)), round), 6);
+        __m256i b = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(yy, _mm256_mullo_epi16(uu, kBU)), round), 6);
+
+        // Packing and unpacking work per 128 bit lane: lane 0 ends up with pixels 0-3/4-7,
+        // lane 1 with pixels 8-11/12-15, the final permutes put them back in order
+        __m256i bg = _mm256_unpacklo_epi8(_mm256_packus_epi16(b, b), _mm256_packus_epi16(g, g));
+        __m256i ra = _mm256_unpacklo_epi8(_mm256_packus_epi16(r, r), alpha);
+        __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+        __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+        _mm256_storeu_si256((__m256i *)(dst + x),     _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + x + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+
+    convertRowScalar(y + x, u + x, v + x, dst + x, count - x);
+}
+#endif
+
+#if defined(YUV_HAVE_NEON)
+static void convertRowNEON(const quint8 *y, const quint8 *u, const quint8 *v, quint32 *dst, int count)
+{
+    const int16x8_t c16    = vdupq_n_s16(16);
+    const int16x8_t c128   = vdupq_n_s16(128);
+    const int16x8_t round  = vdupq_n_s16(32);
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        int16x8_t yy = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + x)));
+        int16x8_t uu = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + x))), c128);
+        int16x8_t vv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + x))), c128);
+        yy = vsubq_s16(yy, c16);
+        yy = vaddq_s16(vmulq_n_s16(yy, cY), vshrq_n_s16(yy, 1));
+
+        int16x8_t r = vshrq_n_s16(vqaddq_s16(vqaddq_s16(yy, vmulq_n_s16(vv, cRV)), round), 6);
+        int16x8_t g = vshrq_n_s16(vqaddq_s16(vqsubq_s16(vqsubq_s16(yy, vmulq_n_s16(uu, cGU)), vmulq_n_s16(vv, cGV)), round), 6);
+        int16x8_t b = vshrq_n_s16(vqaddq_s16(vqaddq_s16(yy, vmulq_n_s16(uu, cBU)), round), 6);
+
+        uint8x8x4_t pixels;
+        pixels.val[0] = vqmovun_s16(b);
+        pixels.val[1] = vqmovun_s16(g);
+        pixels.val[2] = vqmovun_s16(r);
+        pixels.val[3] = vdup_n_u8(0xff);
+        vst4_u8((uint8_t *)(dst + x), pixels);
+    }
+
+    convertRowScalar(y + x, u + x, v + x, dst + x, count - x);
+}
+#endif
+
+YuvConverter::YuvConverter()
+    : m_scaleMode(ScaleAuto)
+    , m_kernel(KernelScalar)
+    , m_rowKernel(convertRowScalar)
+    , m_tableUvPixelStride(0)
+    , m_tableBilinear(false)
+{
+    setKernel(bestKernel());
+}
+
+//static
+bool YuvConverter::kernelAvailable(Kernel kernel)
+{
+    switch (kernel) {
+    case KernelScalar:
+        return true;
+#if defined(YUV_HAVE_SSE2)
+    case KernelSSE2:
+        return true;
+#endif
+#if defined(YUV_HAVE_AVX2)
+    case KernelAVX2:
+# if defined(YUV_AVX2_RUNTIME_CHECK)
+        return __builtin_cpu_supports("avx2");
+# else
+        return true;
+# endif
+#endif
+#if defined(YUV_HAVE_NEON)
+    case KernelNEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+//static
+YuvConverter::Kernel YuvConverter::bestKernel()
+{
+    const Kernel preferred[] = { KernelAVX2, KernelSSE2, KernelNEON };
+    for (size_t i = 0; i < sizeof(preferred) / sizeof(preferred[0]); i++) {
+        if (kernelAvailable(preferred[i])) {
+            return preferred[i];
+        }
+    }
+    return KernelScalar;
+}
+
+//static
+const char* YuvConverter::kernelName(Kernel kernel)
+{
+    switch (kernel) {
+    case KernelSSE2:    return "SSE2";
+    case KernelAVX2:    return "AVX2";
+    case KernelNEON:    return "NEON";
+    default:            return "scalar";
+    }
+}
+
+void YuvConverter::setKernel(Kernel kernel)
+{
+    if (!kernelAvailable(kernel)) {
+        kernel = KernelScalar;
+    }
+    m_kernel = kernel;
+
+    switch (kernel) {
+#if defined(YUV_HAVE_SSE2)
+    case KernelSSE2:
+        m_rowKernel = convertRowSSE2;
+        break;
+#endif
+#if defined(YUV_HAVE_AVX2)
+    case KernelAVX2:
+        m_rowKernel = convertRowAVX2;
+        break;
+#endif
+#if defined(YUV_HAVE_NEON)
+    case KernelNEON:
+        m_rowKernel = convertRowNEON;
+        break;
+#endif
+    default:
+        m_rowKernel = convertRowScalar;
+        break;
+    }
+}
+
+void YuvConverter::updateTables(const Planes & frame, const QRect & source, const QSize & targetSize, bool bilinear)
+{
+    if (source == m_tableSource && targetSize == m_tableTarget
+            && bilinear == m_tableBilinear && frame.uvPixelStride == m_tableUvPixelStride) {
+        return;
+    }
+    m_tableSource = source;
+    m_tableTarget = targetSize;
+    m_tableBilinear = bilinear;
+    m_tableUvPixelStride = frame.uvPixelStride;
+
+    const int width = targetSize.width();
+    const int sourceWidth = source.width();
+
+    m_lumaX0.resize(width);
+    m_lumaX1.resize(width);
+    m_lumaXFrac.resize(width);
+    m_chromaX.resize(width);
+    m_yRow.resize(width);
+    m_uRow.resize(width);
+    m_vRow.resize(width);
+
+    for (int i = 0; i < width; i++) {
+        // Sample at the centre of each target pixel
+        int nearest = (int)(((qint64)(2 * i + 1) * sourceWidth) / (2 * width));
+        m_chromaX[i] = ((source.x() + nearest) >> 1) * frame.uvPixelStride;
+
+        if (bilinear) {
+            int position = (int)(((qint64)(2 * i + 1) * sourceWidth * 256) / (2 * width)) - 128;
+            position = qMax(0, position);
+            int x0 = qMin(position >> 8, sourceWidth - 1);
+            m_lumaX0[i] = source.x() + x0;
+            m_lumaX1[i] = source.x() + qMin(x0 + 1, sourceWidth - 1);
+            m_lumaXFrac[i] = position & 0xff;
+        } else {
+            m_lumaX0[i] = source.x() + nearest;
+            m_lumaX1[i] = m_lumaX0[i];
+            m_lumaXFrac[i] = 0;
+        }
+    }
+}
+
+void YuvConverter::convert(const Planes & frame, const QRect & sourceRect, QImage & target)
+{
+    Q_ASSERT(target.format() == QImage::Format_RGB32);
+
+    QRect source = sourceRect & QRect(0, 0, frame.width, frame.height);
+    if (source.isEmpty() || target.isNull()) {
+        return;
+    }
+
+    const int width = target.width();
+    const int height = target.height();
+    const int sourceHeight = source.height();
+
+    bool bilinear = m_scaleMode == ScaleBilinear
+            || (m_scaleMode == ScaleAuto && (width > source.width() || height > sourceHeight));
+    updateTables(frame, source, target.size(), bilinear);
+
+    quint8 *yRow = m_yRow.data();
+    quint8 *uRow = m_uRow.data();
+    quint8 *vRow = m_vRow.data();
+    const int *lumaX0 = m_lumaX0.constData();
+    const int *lumaX1 = m_lumaX1.constData();
+    const int *lumaXFrac = m_lumaXFrac.constData();
+    const int *chromaX = m_chromaX.constData();
+
+    // bits() detaches once up front, scanLine() would check on every row
+    quint8 *targetBits = target.bits();
+    const int targetStride = target.bytesPerLine();
+
+    for (int row = 0; row < height; row++) {
+        int nearest = source.y() + (int)(((qint64)(2 * row + 1) * sourceHeight) / (2 * height));
+
+        // Chroma is always point sampled, it is already at half resolution
+        const quint8 *uSource = frame.u + (nearest >> 1) * frame.uvStride;
+        const quint8 *vSource = frame.v + (nearest >> 1) * frame.uvStride;
+        for (int i = 0; i < width; i++) {
+            uRow[i] = uSource[chromaX[i]];
+            vRow[i] = vSource[chromaX[i]];
+        }
+
+        if (bilinear) {
+            int position = qMax(0, (int)(((qint64)(2 * row + 1) * sourceHeight * 256) / (2 * height)) - 128);
+            int y0 = qMin(position >> 8, sourceHeight - 1);
+            int y1 = qMin(y0 + 1, sourceHeight - 1);
+            int fy = position & 0xff;
+
+            const quint8 *row0 = frame.y + (source.y() + y0) * frame.yStride;
+            const quint8 *row1 = frame.y + (source.y() + y1) * frame.yStride;
+            for (int i = 0; i < width; i++) {
+                int fx = lumaXFrac[i];
+                int top    = row0[lumaX0[i]] * (256 - fx) + row0[lumaX1[i]] * fx;
+                int bottom = row1[lumaX0[i]] * (256 - fx) + row1[lumaX1[i]] * fx;
+                yRow[i] = (quint8)((top * (256 - fy) + bottom * fy + 32768) >> 16);
+            }
+        } else {
+            const quint8 *ySource = frame.y + nearest * frame.yStride;
+            for (int i = 0; i < width; i++) {
+                yRow[i] = ySource[lumaX0[i]];
+            }
+        }
+
+        m_rowKernel(yRow, uRow, vRow, (quint32 *)(targetBits + row * targetStride), width);
+    }
+}
@@ -0,0 +1,106 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+/**
+ * @file
+ *   @brief Software planar YUV to RGB conversion with fused scaling
+ */
+
+#ifndef YUVCONVERTER_H
+#define YUVCONVERTER_H
+
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+/**
+ * Converts 4:2:0 YUV frames (I420, YV12, NV12) straight into a scaled
+ * RGB32 image, one output row at a time.
+ *
+ * For each output row the source luma and chroma samples are picked (or
+ * blended) into small row buffers, which are then converted to RGB with the
+ * widest SIMD kernel the CPU supports. No full resolution RGB copy of the frame
+ * is ever made and all buffers are reused between frames.
+ *
+ * Conversion uses BT.601 limited range coefficients in 16 bit fixed point. All
+ * kernels produce bit identical output.
+ */
+class YuvConverter
+{
+public:
+    enum ScaleMode {
+        ScaleAuto,      ///< Bilinear when enlarging, nearest when shrinking
+        ScaleNearest,
+        ScaleBilinear
+    };
+
+    enum Kernel {
+        KernelScalar,
+        KernelSSE2,
+        KernelAVX2,
+        KernelNEON,
+        KernelCount
+    };
+
+    /// Pointers and strides of a 4:2:0 frame. For NV12 u and v point into the same
+    /// plane and uvPixelStride is 2.
+    struct Planes {
+        const quint8*   y;
+        const quint8*   u;
+        const quint8*   v;
+        int             yStride;
+        int             uvStride;
+        int             uvPixelStride;
+        int             width;
+        int             height;
+    };
+
+    YuvConverter();
+
+    void setScaleMode(ScaleMode mode) { m_scaleMode = mode; }
+
+    /// Forces a specific kernel, used by tests and benchmarks. Falls back to the scalar kernel
+    /// if the requested one is not available.
+    void setKernel(Kernel kernel);
+    Kernel kernel() const { return m_kernel; }
+
+    static Kernel bestKernel();
+    static bool kernelAvailable(Kernel kernel);
+    static const char* kernelName(Kernel kernel);
+
+    /// Converts sourceRect of the frame into target, scaled to the full size of target.
+    /// target must be QImage::Format_RGB32.
+    void convert(const Planes & frame, const QRect & sourceRect, QImage & target);
+
+private:
+    typedef void (*RowKernel)(const quint8 *y, const quint8 *u, const quint8 *v, quint32 *dst, int count);
+
+    void updateTables(const Planes & frame, const QRect & source, const QSize & targetSize, bool bilinear);
+
+    ScaleMode       m_scaleMode;
+    Kernel          m_kernel;
+    RowKernel       m_rowKernel;
+
+    // Scaling tables, rebuilt only when the geometry changes
+    QRect           m_tableSource;
+    QSize           m_tableTarget;
+    int             m_tableUvPixelStride;
+    bool            m_tableBilinear;
+    QVector<int>    m_lumaX0;       ///< Source luma column for each target column
+    QVector<int>    m_lumaX1;       ///< Second column for bilinear blending
+    QVector<int>    m_lumaXFrac;    ///< Weight of the second column, 0-256
+    QVector<int>    m_chromaX;      ///< Source chroma byte offset for each target column
+
+    // Row buffers handed to the kernels
+    QVector<quint8> m_yRow;
+    QVector<quint8> m_uRow;
+    QVector<quint8> m_vRow;
+};
+
+#endif // YUVCONVERTER_H
@@ -37,6 +37,7 @@ LinkConfiguration::LinkConfiguration(const QString& name)
     , _name(name)
     , _dynamic(false)
     , _autoConnect(false)
+    , _txBandwidthLimit(0)
 {
     _name = name;
     if (_name.isEmpty()) {
@@ -50,6 +51,7 @@ LinkConfiguration::LinkConfiguration(LinkConfiguration* copy)
     _name       = copy->name();
     _dynamic    = copy->isDynamic();
     _autoConnect= copy->isAutoConnect();
+    _txBandwidthLimit = copy->txBandwidthLimit();
     Q_ASSERT(!_name.isEmpty());
 }
 
@@ -60,6 +62,7 @@ void LinkConfiguration::copyFrom(LinkConfiguration* source)
     _name       = source->name();
     _dynamic    = source->isDynamic();
     _autoConnect= source->isAutoConnect();
+    _txBandwidthLimit = source->txBandwidthLimit();
 }
 
 /*!
@@ -33,6 +33,7 @@ public:
     Q_PROPERTY(bool             dynamic             READ isDynamic      WRITE setDynamic        NOTIFY dynamicChanged)
     Q_PROPERTY(bool             autoConnect         READ isAutoConnect  WRITE setAutoConnect    NOTIFY autoConnectChanged)
     Q_PROPERTY(bool             autoConnectAllowed  READ isAutoConnectAllowed                   CONSTANT)
+    Q_PROPERTY(int              txBandwidthLimit    READ txBandwidthLimit   WRITE setTxBandwidthLimit   NOTIFY txBandwidthLimitChanged)
     Q_PROPERTY(QString          settingsURL         READ settingsURL                            CONSTANT)
 
     // Property accessors
@@ -93,6 +94,18 @@ public:
     */
     void setAutoConnect(bool autoc = true) { _autoConnect = autoc; emit autoConnectChanged(); }
 
+    /*!
+     *
+     * Maximum number of bytes per second of MAVLink traffic to send on this link.
+     * @return The limit in bytes per second, 0 for no limit.
+     */
+    int txBandwidthLimit() { return _txBandwidthLimit; }
+
+    /*!
+     * Set the maximum number of bytes per second of MAVLink traffic to send on this link, 0 for no limit.
+    */
+    void setTxBandwidthLimit(int bytesPerSecond) { _txBandwidthLimit = bytesPerSecond; emit txBandwidthLimitChanged(); }
+
     /// Virtual Methods
 
     /*!
@@ -180,6 +193,7 @@ signals:
     void nameChanged        (const QString& name);
     void dynamicChanged     ();
     void autoConnectChanged ();
+    void txBandwidthLimitChanged();
     void linkChanged        (LinkInterface* link);
 
 protected:
@@ -188,6 +202,7 @@ private:
     QString _name;
     bool    _dynamic;       ///< A connection added automatically and not persistent (unless it's edited).
     bool    _autoConnect;   ///< This connection is started automatically at boot
+    int     _txBandwidthLimit;  ///< Maximum bytes per second to send, 0 for no limit
 };
 
 #endif // LINKCONFIGURATION_H
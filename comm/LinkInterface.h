@@ -16,9 +16,12 @@
 #include <QMutexLocker>
 #include <QMetaType>
 #include <QSharedPointer>
+#include <QTimer>
 #include <QDebug>
 
 #include "QGCMAVLink.h"
+#include "LinkConfiguration.h"
+#include "LinkTxScheduler.h"
 
 class LinkManager;
 class LinkConfiguration;
@@ -147,13 +150,60 @@ public slots:
         emit _invokeWriteBytes(QByteArray(bytes, length));
     }
 
+    /**
+     * @brief Queue a complete MAVLink frame for sending.
+     *
+     * Frames are queued per priority class and written from the link thread, coalesced into as few
+     * writes as possible and held back if the link configuration has a transmit bandwidth limit.
+     * Control frames are always sent ahead of RTCM corrections, then commands, then bulk transfers.
+     * Thread safe.
+     *
+     * @param bytes The pointer to the byte array containing the frame
+     * @param length The length of the frame
+     * @param priority Priority class of the frame, see LinkTxScheduler::priorityForMessage
+     **/
+    void writeMessageSafe(const char *bytes, int length, LinkTxScheduler::Priority_t priority)
+    {
+        if (_txScheduler.enqueue(bytes, length, priority)) {
+            emit _invokeFlushTx();
+        }
+    }
+
+    /// @return Number of frames of the specified priority class dropped because the transmit queue was full
+    quint32 txDroppedCount(LinkTxScheduler::Priority_t priority) const { return _txScheduler.droppedCount(priority); }
+
+    /// @return Number of bytes of the specified priority class waiting in the transmit queue
+    int txQueuedBytes(LinkTxScheduler::Priority_t priority) const { return _txScheduler.queuedBytes(priority); }
+
 private slots:
     virtual void _writeBytes(const QByteArray) = 0;
-    
+
+    /// Writes out queued frames, runs on the link thread
+    void _flushTx(void)
+    {
+        LinkConfiguration* config = getLinkConfiguration();
+        _txScheduler.setBandwidthLimit(config ? config->txBandwidthLimit() : 0);
+
+        QByteArray  batch;
+        int         retryMsecs;
+        qint64      now = QDateTime::currentMSecsSinceEpoch();
+
+        while (_txScheduler.takeBatch(batch, now, retryMsecs)) {
+            _writeBytes(batch);
+            if (retryMsecs != 0) {
+                break;
+            }
+        }
+        if (retryMsecs > 0) {
+            QTimer::singleShot(retryMsecs, this, &LinkInterface::_flushTx);
+        }
+    }
+
 signals:
     void autoconnectChanged(bool autoconnect);
     void activeChanged(bool active);
     void _invokeWriteBytes(QByteArray);
+    void _invokeFlushTx(void);
 
     /// Signalled when a link suddenly goes away due to it being removed by for example pulling the cable to the connection.
     void connectionRemoved(LinkInterface* link);
@@ -223,6 +273,7 @@ protected:
         memset(_outDataWriteTimes,  0, sizeof(_outDataWriteTimes));
         
         QObject::connect(this, &LinkInterface::_invokeWriteBytes, this, &LinkInterface::_writeBytes);
+        QObject::connect(this, &LinkInterface::_invokeFlushTx, this, &LinkInterface::_flushTx, Qt::QueuedConnection);
         qRegisterMetaType<LinkInterface*>("LinkInterface*");
     }
 
@@ -367,6 +418,8 @@ private:
 
     bool _active;       ///< true: link is actively receiving mavlink messages
     bool _enableRateCollection;
+
+    LinkTxScheduler _txScheduler;   ///< Outgoing MAVLink frames waiting to be written
 };
 
 typedef QSharedPointer<LinkInterface> SharedLinkInterface;
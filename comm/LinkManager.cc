@@ -342,6 +342,7 @@ void LinkManager::saveLinkConfigurationList()
                 settings.setValue(root + "/name", linkConfig->name());
                 settings.setValue(root + "/type", linkConfig->type());
                 settings.setValue(root + "/auto", linkConfig->isAutoConnect());
+                settings.setValue(root + "/txBandwidth", linkConfig->txBandwidthLimit());
                 // Have the instance save its own values
                 linkConfig->saveSettings(settings, root);
             }
@@ -376,6 +377,7 @@ void LinkManager::loadLinkConfigurationList()
                         if(!name.isEmpty()) {
                             LinkConfiguration* pLink = NULL;
                             bool autoConnect = settings.value(root + "/auto").toBool();
+                            int txBandwidthLimit = settings.value(root + "/txBandwidth", 0).toInt();
                             switch((LinkConfiguration::LinkType)type) {
 #ifndef __ios__
                                 case LinkConfiguration::TypeSerial:
@@ -411,6 +413,7 @@ void LinkManager::loadLinkConfigurationList()
                             if(pLink) {
                                 //-- Have the instance load its own values
                                 pLink->setAutoConnect(autoConnect);
+                                pLink->setTxBandwidthLimit(txBandwidthLimit);
                                 pLink->loadSettings(settings, root);
                                 _linkConfigurations.append(pLink);
                                 linksChanged = true;
@@ -0,0 +1,177 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "LinkTxScheduler.h"
+#include "QGCMAVLink.h"
+
+#include <QtMath>
+
+// Control frames go stale quickly so only a few are kept. RTCM has no retry so corrections are never
+// dropped here, RTCMMavlink skips whole corrections instead while the queue is backed up. Bulk transfers
+// all have their own retry protocols so dropping the oldest frames under backpressure is safe. 0 is no limit.
+const int LinkTxScheduler::_maxQueuedFrames[PriorityCount] = { 8, 0, 256, 512 };
+
+LinkTxScheduler::LinkTxScheduler(void)
+    : _flushPending(false)
+    , _bandwidthLimit(0)
+    , _maxBatchBytes(defaultMaxBatchBytes)
+    , _tokens(0)
+    , _lastRefillMsecs(0)
+{
+    for (int i=0; i<PriorityCount; i++) {
+        _droppedCounts[i] = 0;
+        _queuedBytes[i] = 0;
+    }
+}
+
+LinkTxScheduler::Priority_t LinkTxScheduler::priorityForMessage(uint32_t msgid)
+{
+    switch (msgid) {
+    case MAVLINK_MSG_ID_MANUAL_CONTROL:
+    case MAVLINK_MSG_ID_RC_CHANNELS_OVERRIDE:
+    case MAVLINK_MSG_ID_SET_ATTITUDE_TARGET:
+    case MAVLINK_MSG_ID_SET_POSITION_TARGET_LOCAL_NED:
+    case MAVLINK_MSG_ID_SET_POSITION_TARGET_GLOBAL_INT:
+        return PriorityControl;
+    case MAVLINK_MSG_ID_PARAM_SET:
+    case MAVLINK_MSG_ID_PARAM_REQUEST_READ:
+    case MAVLINK_MSG_ID_PARAM_REQUEST_LIST:
+    case MAVLINK_MSG_ID_MISSION_ITEM:
+    case MAVLINK_MSG_ID_MISSION_ITEM_INT:
+    case MAVLINK_MSG_ID_MISSION_REQUEST:
+    case MAVLINK_MSG_ID_MISSION_REQUEST_INT:
+    case MAVLINK_MSG_ID_MISSION_REQUEST_LIST:
+    case MAVLINK_MSG_ID_MISSION_COUNT:
+    case MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL:
+    case MAVLINK_MSG_ID_LOG_REQUEST_DATA:
+    case MAVLINK_MSG_ID_LOGGING_ACK:
+        return PriorityBulk;
+    case MAVLINK_MSG_ID_GPS_RTCM_DATA:
+    case MAVLINK_MSG_ID_GPS_INJECT_DATA:
+        return PriorityCorrection;
+    default:
+        return PriorityCommand;
+    }
+}
+
+bool LinkTxScheduler::enqueue(const char* bytes, int length, Priority_t priority)
+{
+    QMutexLocker locker(&_mutex);
+
+    QQueue<QByteArray>& queue = _queues[priority];
+    if (_maxQueuedFrames[priority] > 0 && queue.count() >= _maxQueuedFrames[priority]) {
+        _queuedBytes[priority] -= queue.dequeue().length();
+        _droppedCounts[priority]++;
+    }
+    queue.enqueue(QByteArray(bytes, length));
+    _queuedBytes[priority] += length;
+
+    if (_flushPending) {
+        return false;
+    }
+    _flushPending = true;
+    return true;
+}
+
+void LinkTxScheduler::_refillTokens(qint64 nowMsecs)
+{
+    if (_lastRefillMsecs == 0) {
+        _tokens = _maxBatchBytes;
+    } else if (nowMsecs > _lastRefillMsecs) {
+        _tokens += (double)_bandwidthLimit * (nowMsecs - _lastRefillMsecs) / 1000.0;
+    }
+    _lastRefillMsecs = nowMsecs;
+
+    // Allow a burst of a tenth of a second, but never less than a single batch
+    _tokens = qMin(_tokens, (double)qMax(_bandwidthLimit / 10, _maxBatchBytes));
+}
+
+bool LinkTxScheduler::takeBatch(QByteArray& batch, qint64 nowMsecs, int& retryMsecs)
+{
+    QMutexLocker locker(&_mutex);
+
+    batch.clear();
+    retryMsecs = -1;
+
+    if (_bandwidthLimit > 0) {
+        _refillTokens(nowMsecs);
+    }
+
+    for (int priority=0; priority<PriorityCount; priority++) {
+        QQueue<QByteArray>& queue = _queues[priority];
+
+        while (!queue.isEmpty()) {
+            int frameLength = queue.head().length();
+
+            if (!batch.isEmpty() && batch.length() + frameLength > _maxBatchBytes) {
+                // Batch is full, the caller comes back for the rest
+                retryMsecs = 0;
+                return true;
+            }
+            if (_bandwidthLimit > 0 && _tokens < frameLength) {
+                // Over the bandwidth limit, hold everything back until there is room for this frame
+                retryMsecs = qMax(1, qCeil((frameLength - _tokens) * 1000.0 / _bandwidthLimit));
+                return !batch.isEmpty();
+            }
+
+            if (batch.isEmpty()) {
+                batch.reserve(qMax(_maxBatchBytes, frameLength));
+            }
+            batch.append(queue.dequeue());
+            _queuedBytes[priority] -= frameLength;
+            if (_bandwidthLimit > 0) {
+                _tokens -= frameLength;
+            }
+        }
+    }
+
+    // Everything has been drained, the next enqueue needs to request a new flush
+    _flushPending = false;
+    return !batch.isEmpty();
+}
+
+void LinkTxScheduler::setBandwidthLimit(int bytesPerSecond)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (bytesPerSecond != _bandwidthLimit) {
+        _bandwidthLimit = qMax(0, bytesPerSecond);
+        _lastRefillMsecs = 0;
+    }
+}
+
+void LinkTxScheduler::setMaxBatchBytes(int maxBatchBytes)
+{
+    QMutexLocker locker(&_mutex);
+    _maxBatchBytes = qMax(1, maxBatchBytes);
+}
+
+quint32 LinkTxScheduler::droppedCount(Priority_t priority) const
+{
+    QMutexLocker locker(&_mutex);
+    return _droppedCounts[priority];
+}
+
+int LinkTxScheduler::queuedCount(void) const
+{
+    QMutexLocker locker(&_mutex);
+
+    int count = 0;
+    for (int i=0; i<PriorityCount; i++) {
+        count += _queues[i].count();
+    }
+    return count;
+}
+
+int LinkTxScheduler::queuedBytes(Priority_t priority) const
+{
+    QMutexLocker locker(&_mutex);
+    return _queuedBytes[priority];
+}
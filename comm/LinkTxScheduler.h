@@ -0,0 +1,88 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef LinkTxScheduler_H
+#define LinkTxScheduler_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QQueue>
+
+/// Per link transmit queue for outgoing MAVLink frames.
+///
+/// Frames are queued by priority class from any thread. The link thread then drains the queues with
+/// takeBatch, which coalesces queued frames into a single write, highest priority first, and holds
+/// frames back when the configured bandwidth limit has been used up.
+///
+/// Frames only keep their order within a priority class. A command can go out ahead of PARAM_SET or
+/// MISSION_* frames queued before it on the same link, so the MAVLink sequence numbers on the wire are
+/// not always in order and the receiver counts the reordering as packet loss.
+class LinkTxScheduler
+{
+public:
+    LinkTxScheduler(void);
+
+    typedef enum {
+        PriorityControl,    ///< Manual control and setpoints, only the freshest frames matter
+        PriorityCorrection, ///< RTCM corrections, late is bad and lost is worse, never dropped
+        PriorityCommand,    ///< Commands and everything else
+        PriorityBulk,       ///< Parameter, mission and FTP traffic
+        PriorityCount
+    } Priority_t;
+
+    /// Returns the priority class for the specified MAVLink message id
+    static Priority_t priorityForMessage(uint32_t msgid);
+
+    /// Queues a frame for sending. Can be called from any thread.
+    ///     @return true: the queue was idle, caller must schedule a flush on the link thread
+    bool enqueue(const char* bytes, int length, Priority_t priority);
+
+    /// Collects the next batch of frames to write. Called from the link thread only.
+    ///     @param batch Filled in with the coalesced frames to write
+    ///     @param nowMsecs Current time in msecs
+    ///     @param retryMsecs Returned: -1 nothing more to send, >0 frames are held back by the bandwidth limit for this long
+    /// @return true: batch contains data to write
+    bool takeBatch(QByteArray& batch, qint64 nowMsecs, int& retryMsecs);
+
+    /// Sets the maximum number of bytes per second to send, 0 for no limit
+    void setBandwidthLimit(int bytesPerSecond);
+
+    /// Sets the maximum size of a coalesced write
+    void setMaxBatchBytes(int maxBatchBytes);
+
+    /// @return Number of frames dropped from the specified priority class because its queue was full. Always
+    ///         0 for PriorityCorrection.
+    quint32 droppedCount(Priority_t priority) const;
+
+    /// @return Number of frames currently queued
+    int queuedCount(void) const;
+
+    /// @return Number of bytes currently queued in the specified priority class
+    int queuedBytes(Priority_t priority) const;
+
+    static const int defaultMaxBatchBytes = 1024;
+
+private:
+    void _refillTokens(qint64 nowMsecs);
+
+    mutable QMutex      _mutex;
+    QQueue<QByteArray>  _queues[PriorityCount];
+    quint32             _droppedCounts[PriorityCount];
+    int                 _queuedBytes[PriorityCount];
+    bool                _flushPending;      ///< A flush has been requested and not yet drained the queues
+    int                 _bandwidthLimit;    ///< Bytes per second, 0 for no limit
+    int                 _maxBatchBytes;
+    double              _tokens;            ///< Bytes which can be sent right now
+    qint64              _lastRefillMsecs;
+
+    static const int    _maxQueuedFrames[PriorityCount];
+};
+
+#endif
@@ -0,0 +1,132 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "MAVLinkMessageStats.h"
+
+#include <string.h>
+
+const float MAVLinkMessageStats::cRateLowpass = 0.2f;
+
+MAVLinkMessageStats::MAVLinkMessageStats(void)
+    : _overflowCount(0)
+{
+    for (int i=0; i<cMaxSlots; i++) {
+        _rgSlots[i].used.store(false, std::memory_order_relaxed);
+        _rgSlots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+    _elapsed.start();
+}
+
+MAVLinkMessageStats::Slot_t* MAVLinkMessageStats::_findSlot(const mavlink_message_t& message)
+{
+    quint32 hash = (message.msgid * 2654435761U) ^ (message.sysid << 8) ^ message.compid;
+
+    for (int probe=0; probe<cMaxSlots; probe++) {
+        Slot_t* slot = &_rgSlots[(hash + probe) & (cMaxSlots - 1)];
+
+        // Only the writer claims slots, so ids can be read without synchronization here
+        if (!slot->used.load(std::memory_order_relaxed)) {
+            slot->sysid = message.sysid;
+            slot->compid = message.compid;
+            slot->msgid = message.msgid;
+            slot->count = 0;
+            slot->lastReceiveUsecs = 0;
+            slot->intervalUsecs = 0;
+            slot->used.store(true, std::memory_order_release);
+            return slot;
+        }
+        if (slot->msgid == message.msgid && slot->sysid == message.sysid && slot->compid == message.compid) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+void MAVLinkMessageStats::messageReceived(const mavlink_message_t& message)
+{
+    Slot_t* slot = _findSlot(message);
+    if (!slot) {
+        _overflowCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    quint64 now = _elapsed.nsecsElapsed() / 1000;
+
+    quint32 sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (slot->count != 0) {
+        float interval = (float)(now - slot->lastReceiveUsecs);
+        if (slot->count == 1) {
+            slot->intervalUsecs = interval;
+        } else {
+            slot->intervalUsecs = ((1.0f - cRateLowpass) * slot->intervalUsecs) + (cRateLowpass * interval);
+        }
+    }
+    slot->count++;
+    slot->lastReceiveUsecs = now;
+
+    // Only the header and used payload bytes need to be kept
+    memcpy(&slot->lastMessage, &message, offsetof(mavlink_message_t, payload64));
+    memcpy(slot->lastMessage.payload64, message.payload64, message.len);
+    memset((uint8_t*)slot->lastMessage.payload64 + message.len, 0, MAVLINK_MAX_PAYLOAD_LEN - message.len);
+
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+QList<MAVLinkMessageStats::MessageStats_t> MAVLinkMessageStats::snapshot(int sysid, int compid) const
+{
+    QList<MessageStats_t> statsList;
+    quint64 now = _elapsed.nsecsElapsed() / 1000;
+
+    for (int i=0; i<cMaxSlots; i++) {
+        const Slot_t& slot = _rgSlots[i];
+
+        if (!slot.used.load(std::memory_order_acquire)) {
+            continue;
+        }
+        if ((sysid != 0 && slot.sysid != sysid) || (compid != 0 && slot.compid != compid)) {
+            continue;
+        }
+
+        MessageStats_t  stats;
+        quint64         lastReceiveUsecs;
+        float           intervalUsecs;
+        quint32         sequence;
+
+        do {
+            // Spin while the writer is in the middle of updating this slot
+            sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence & 1) {
+                continue;
+            }
+            stats.count = slot.count;
+            lastReceiveUsecs = slot.lastReceiveUsecs;
+            intervalUsecs = slot.intervalUsecs;
+            memcpy(&stats.lastMessage, &slot.lastMessage, sizeof(stats.lastMessage));
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) || slot.sequence.load(std::memory_order_relaxed) != sequence);
+
+        stats.sysid = slot.sysid;
+        stats.compid = slot.compid;
+        stats.msgid = slot.msgid;
+        stats.ageMsecs = (now - lastReceiveUsecs) / 1000;
+
+        // Once a message stops arriving the time since the last one dominates the rate
+        float effectiveInterval = qMax(intervalUsecs, (float)(now - lastReceiveUsecs));
+        stats.rateHz = (stats.count > 1 && effectiveInterval > 0) ? 1000000.0f / effectiveInterval : 0.0f;
+
+        statsList.append(stats);
+    }
+
+    return statsList;
+}
@@ -0,0 +1,75 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef MAVLinkMessageStats_H
+#define MAVLinkMessageStats_H
+
+#include <QElapsedTimer>
+#include <QList>
+
+#include <atomic>
+
+#include "QGCMAVLink.h"
+
+/// Per (sysid, compid, msgid) receive statistics, collected by MAVLinkProtocol as messages are parsed.
+///
+/// Recording a message is lock free and does not allocate: slots live in a fixed size open addressing
+/// table and each slot is guarded by a sequence counter. There must only be a single writer (the thread
+/// which runs MAVLinkProtocol::receiveBytes), any number of threads can call snapshot concurrently.
+class MAVLinkMessageStats
+{
+public:
+    MAVLinkMessageStats(void);
+
+    typedef struct {
+        uint8_t             sysid;
+        uint8_t             compid;
+        uint32_t            msgid;
+        quint32             count;          ///< Total number of messages received
+        float               rateHz;         ///< Exponentially weighted receive rate
+        quint64             ageMsecs;       ///< Time since the last message was received
+        mavlink_message_t   lastMessage;    ///< Copy of the last message received
+    } MessageStats_t;
+
+    /// Records a received message. Must always be called from the same thread.
+    void messageReceived(const mavlink_message_t& message);
+
+    /// Returns the current statistics for all messages matching the specified filter
+    ///     @param sysid System id to return stats for, 0 for all
+    ///     @param compid Component id to return stats for, 0 for all
+    QList<MessageStats_t> snapshot(int sysid = 0, int compid = 0) const;
+
+    /// Number of messages which could not be tracked because the table is full
+    quint32 overflowCount(void) const { return _overflowCount.load(std::memory_order_relaxed); }
+
+    static const int    cMaxSlots = 2048;   ///< Must be a power of two
+    static const float  cRateLowpass;       ///< Weight of the newest interval in the rate estimate
+
+private:
+    typedef struct {
+        std::atomic<bool>       used;           ///< Slot has been claimed by the writer, ids are valid
+        std::atomic<quint32>    sequence;       ///< Odd while the writer is updating the slot
+        uint8_t                 sysid;
+        uint8_t                 compid;
+        uint32_t                msgid;
+        quint32                 count;
+        quint64                 lastReceiveUsecs;
+        float                   intervalUsecs;  ///< Exponentially weighted interval between messages
+        mavlink_message_t       lastMessage;
+    } Slot_t;
+
+    Slot_t* _findSlot(const mavlink_message_t& message);
+
+    QElapsedTimer           _elapsed;
+    std::atomic<quint32>    _overflowCount;
+    Slot_t                  _rgSlots[cMaxSlots];
+};
+
+#endif
@@ -472,6 +472,8 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
                 emit receiveLossTotalChanged(message.sysid, totalLossCounter[mavlinkChannel]);
             }
 
+            _messageStats.messageReceived(message);
+
             // The packet is emitted as a whole, as it is only 255 - 261 bytes short
             // kind of inefficient, but no issue for a groundstation pc.
             // It buys as reentrancy for the whole code over all threads
@@ -640,6 +642,8 @@ void MAVLinkProtocol::receiveMavMessasge(LinkInterface* link, mavlink_message_t
                 emit receiveLossTotalChanged(message.sysid, totalLossCounter[mavlinkChannel]);
             }
 
+            _messageStats.messageReceived(message);
+
             // The packet is emitted as a whole, as it is only 255 - 261 bytes short
             // kind of inefficient, but no issue for a groundstation pc.
             // It buys as reentrancy for the whole code over all threads
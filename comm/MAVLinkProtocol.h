@@ -31,6 +31,7 @@
 #include "QGC.h"
 #include "QGCTemporaryFile.h"
 #include "QGCToolbox.h"
+#include "MAVLinkMessageStats.h"
 
 class LinkManager;
 class MultiVehicleManager;
@@ -94,6 +95,9 @@ public:
      */
     virtual void resetMetadataForLink(const LinkInterface *link);
     
+    /// Per message receive statistics, used by the MAVLink inspector
+    const MAVLinkMessageStats* messageStats(void) const { return &_messageStats; }
+
     /// Suspend/Restart logging during replay.
     void suspendLogForReplay(bool suspend);
 
@@ -193,6 +197,7 @@ private:
 
     LinkManager*            _linkMgr;
     MultiVehicleManager*    _multiVehicleManager;
+    MAVLinkMessageStats     _messageStats;
 };
 
 #endif // MAVLINKPROTOCOL_H_
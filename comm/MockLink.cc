@@ -64,7 +64,10 @@ MockLink::MockLink(MockConfiguration* config)
     , _currentParamRequestListParamIndex(-1)
     , _logDownloadCurrentOffset(0)
     , _logDownloadBytesRemaining(0)
+    , _manualControlCount(0)
 {
+    memset(&_lastManualControl, 0, sizeof(_lastManualControl));
+
     _config = config;
     if (_config) {
         _firmwareType = config->firmwareType();
@@ -179,6 +182,7 @@ void MockLink::_run500HzTasks(void)
     if (_mavlinkStarted && _connected) {
         _paramRequestListWorker();
         _logDownloadWorker();
+        _missionItemHandler.run500HzTasks();
     }
 }
 
@@ -425,7 +429,19 @@ void MockLink::_handleManualControl(const mavlink_message_t& msg)
     mavlink_manual_control_t manualControl;
     mavlink_msg_manual_control_decode(&msg, &manualControl);
 
-    qDebug() << "MANUAL_CONTROL" << manualControl.x << manualControl.y << manualControl.z << manualControl.r;
+    qCDebug(MockLinkVerboseLog) << "MANUAL_CONTROL" << manualControl.x << manualControl.y << manualControl.z << manualControl.r;
+
+    _manualControlMutex.lock();
+    _lastManualControl = manualControl;
+    _manualControlMutex.unlock();
+    _manualControlCount++;
+}
+
+mavlink_manual_control_t MockLink::lastManualControl(void)
+{
+    QMutexLocker lock(&_manualControlMutex);
+
+    return _lastManualControl;
 }
 
 void MockLink::_setParamFloatUnionIntoMap(int componentId, const QString& paramName, float paramFloat)
@@ -839,7 +855,7 @@ void MockLink::_respondWithAutopilotVersion(void)
                                             _vehicleComponentId,
                                             mavlinkChannel(),
                                             &msg,
-                                            0,                               // capabilities,
+                                            _missionItemHandler.missionItemIntSupport() ? MAV_PROTOCOL_CAPABILITY_MISSION_INT : 0, // capabilities,
                                             flightVersion,                   // flight_sw_version,
                                             0,                               // middleware_sw_version,
                                             0,                               // os_sw_version,
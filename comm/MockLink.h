@@ -12,8 +12,11 @@
 #define MOCKLINK_H
 
 #include <QMap>
+#include <QMutex>
 #include <QLoggingCategory>
 
+#include <atomic>
+
 #include "MockLinkMissionItemHandler.h"
 #include "MockLinkFileServer.h"
 #include "LinkManager.h"
@@ -144,6 +147,22 @@ public:
     /// Reset the state of the MissionItemHandler to no items, no transactions in progress.
     void resetMissionItemHandler(void) { _missionItemHandler.reset(); }
 
+    /// Simulates link latency, loss and windowed write requests for mission transfers, see MockLinkMissionItemHandler::setTransferFaults
+    void setMissionTransferFaults(int writeWindow, int latencyMsecs, int dropInterval) { _missionItemHandler.setTransferFaults(writeWindow, latencyMsecs, dropInterval); }
+
+    /// Sets whether mission writes are requested with MISSION_REQUEST_INT
+    void setMissionItemIntSupport(bool supported) { _missionItemHandler.setMissionItemIntSupport(supported); }
+
+    /// Number of mission protocol messages received from QGC, see MockLinkMissionItemHandler::missionMessageCount
+    int missionMessageCount(void) const { return _missionItemHandler.missionMessageCount(); }
+    void resetMissionMessageCount(void) { _missionItemHandler.resetMissionMessageCount(); }
+
+    /// Number of MANUAL_CONTROL messages received from QGC. Thread safe.
+    int manualControlCount(void) const { return _manualControlCount; }
+
+    /// Last MANUAL_CONTROL message received from QGC. Thread safe.
+    mavlink_manual_control_t lastManualControl(void);
+
     /// Returns the filename for the simulated log file. Onyl available after a download is requested.
     QString logDownloadFile(void) { return _logDownloadFilename; }
 
@@ -239,6 +258,10 @@ private:
     uint32_t    _logDownloadCurrentOffset;  ///< Current offset we are sending from
     uint32_t    _logDownloadBytesRemaining; ///< Number of bytes still to send, 0 = send inactive
 
+    std::atomic<int>            _manualControlCount;
+    QMutex                      _manualControlMutex;
+    mavlink_manual_control_t    _lastManualControl;
+
     static float        _vehicleLatitude;
     static float        _vehicleLongitude;
     static float        _vehicleAltitude;
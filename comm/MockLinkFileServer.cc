@@ -10,6 +10,9 @@
 
 #include "MockLinkFileServer.h"
 #include "MockLink.h"
+#include "QGC.h"
+
+#include <QTimer>
 
 const MockLinkFileServer::ErrorMode_t MockLinkFileServer::rgFailureModes[] = {
     MockLinkFileServer::errModeNoResponse,
@@ -27,6 +30,8 @@ const MockLinkFileServer::FileTestCase MockLinkFileServer::rgFileTestCases[MockL
     { "exact.qgc",      sizeof(((FileManager::Request*)0)->data),         1,    true },
     // File is larger than a single Read Ack packets, requires multiple Reads
     { "multi.qgc",      sizeof(((FileManager::Request*)0)->data) + 1,     2,    false },
+    // File spans a long burst, used to test loss and reordering
+    { "large.qgc",      32768,                                              138,  false },
 };
 
 // We only support a single fixed session
@@ -34,6 +39,13 @@ const uint8_t MockLinkFileServer::_sessionId = 1;
 
 MockLinkFileServer::MockLinkFileServer(uint8_t systemIdServer, uint8_t componentIdServer, MockLink* mockLink) :
     _errMode(errModeNone),
+    _burstDropInterval(0),
+    _burstReorderInterval(0),
+    _burstStallAfter(0),
+    _burstPacketCount(0),
+    _responseDelayMsecs(0),
+    _writeDropInterval(0),
+    _writeRequestCount(0),
     _systemIdServer(systemIdServer),
     _componentIdServer(componentIdServer),
     _mockLink(mockLink)
@@ -41,6 +53,14 @@ MockLinkFileServer::MockLinkFileServer(uint8_t systemIdServer, uint8_t component
 
 }
 
+void MockLinkFileServer::setBurstFaults(int dropInterval, int reorderInterval, int stallAfter)
+{
+    _burstDropInterval = dropInterval;
+    _burstReorderInterval = reorderInterval;
+    _burstStallAfter = stallAfter;
+    _burstPacketCount = 0;
+}
+
 /// @brief Handles List command requests. Only supports root folder paths.
 ///         File list returned is set using the setFileList method.
 void MockLinkFileServer::_listCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber)
@@ -145,7 +165,7 @@ void MockLinkFileServer::_readCommand(uint8_t senderSystemId, uint8_t senderComp
     }
     
     uint32_t readOffset = request->hdr.offset;  // offset into file for reading
-    uint8_t cDataBytes = 0;                     // current number of data bytes used
+    uint32_t cDataBytes = 0;                    // current number of data bytes used
     
     if (readOffset != 0) {
         // If we get here it means the client is requesting additional data past the first request
@@ -177,6 +197,7 @@ void MockLinkFileServer::_readCommand(uint8_t senderSystemId, uint8_t senderComp
     response.hdr.offset = request->hdr.offset;
     response.hdr.opcode = FileManager::kRspAck;
 	response.hdr.req_opcode = FileManager::kCmdReadFile;
+    response.hdr.burstComplete = 0;
 
     _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
 }
@@ -191,9 +212,15 @@ void MockLinkFileServer::_streamCommand(uint8_t senderSystemId, uint8_t senderCo
         return;
     }
     
-    uint32_t readOffset = 0;	// offset into file for reading
-    uint32_t ackOffset = 0;     // offset for ack
-    uint8_t cDataAck;           // number of bytes in ack
+    uint32_t readOffset = request->hdr.offset;  // offset into file for reading, bursts can resume part way through
+    uint32_t ackOffset = readOffset;            // offset for ack
+    uint8_t cDataAck;                           // number of bytes in ack
+    int cBurstPackets = 0;                      // packets generated by this burst
+    
+    // Packet held back to simulate reordering
+    FileManager::Request    heldResponse;
+    uint16_t                heldSeqNumber = 0;
+    bool                    held = false;
     
     while (readOffset < _readFileLength) {
         cDataAck = 0;
@@ -223,16 +250,114 @@ void MockLinkFileServer::_streamCommand(uint8_t senderSystemId, uint8_t senderCo
         response.hdr.offset = ackOffset;
         response.hdr.opcode = FileManager::kRspAck;
         response.hdr.req_opcode = FileManager::kCmdBurstReadFile;
+        response.hdr.burstComplete = 0;
         
-        _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
+        _burstPacketCount++;
+        cBurstPackets++;
+        
+        if (_burstDropInterval && _burstPacketCount % _burstDropInterval == 0) {
+            // Lost on the way, the sequence number is used up all the same
+        } else if (_burstReorderInterval && _burstPacketCount % _burstReorderInterval == 0 && !held) {
+            heldResponse = response;
+            heldSeqNumber = outgoingSeqNumber;
+            held = true;
+        } else {
+            _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
+            if (held) {
+                _sendResponse(senderSystemId, senderComponentId, &heldResponse, heldSeqNumber);
+                held = false;
+            }
+        }
         
         outgoingSeqNumber = _nextSeqNumber(outgoingSeqNumber);
         ackOffset += cDataAck;
+        
+        if (_burstStallAfter && cBurstPackets >= _burstStallAfter) {
+            // Link goes quiet part way through, only once
+            _burstStallAfter = 0;
+            return;
+        }
+    }
+    
+    if (held) {
+        _sendResponse(senderSystemId, senderComponentId, &heldResponse, heldSeqNumber);
     }
 	
     _sendNak(senderSystemId, senderComponentId, FileManager::kErrEOF, outgoingSeqNumber, FileManager::kCmdBurstReadFile);
 }
 
+/// @brief Handles Create command requests. Any path is accepted, the file is kept in memory.
+void MockLinkFileServer::_createCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber)
+{
+    FileManager::Request    response;
+    uint16_t                outgoingSeqNumber = _nextSeqNumber(seqNumber);
+    
+    _writePath = QString::fromLatin1((char *)request->data, strnlen((char *)request->data, request->hdr.size));
+    _writeFile.clear();
+    
+    response.hdr.opcode = FileManager::kRspAck;
+    response.hdr.req_opcode = FileManager::kCmdCreateFile;
+    response.hdr.session = _sessionId;
+    response.hdr.offset = 0;
+    response.hdr.size = 0;
+    
+    _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
+}
+
+/// @brief Handles Write command requests. Writes may arrive in any order.
+void MockLinkFileServer::_writeCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber)
+{
+    FileManager::Request    response;
+    uint16_t                outgoingSeqNumber = _nextSeqNumber(seqNumber);
+    
+    if (request->hdr.session != _sessionId) {
+        _sendNak(senderSystemId, senderComponentId, FileManager::kErrInvalidSession, outgoingSeqNumber, FileManager::kCmdWriteFile);
+        return;
+    }
+    
+    if (_writeDropInterval && ++_writeRequestCount % _writeDropInterval == 0) {
+        // Lost on the way
+        return;
+    }
+    
+    int end = request->hdr.offset + request->hdr.size;
+    if (end > _writeFile.size()) {
+        _writeFile.resize(end);
+    }
+    memcpy(_writeFile.data() + request->hdr.offset, request->data, request->hdr.size);
+    
+    response.hdr.opcode = FileManager::kRspAck;
+    response.hdr.req_opcode = FileManager::kCmdWriteFile;
+    response.hdr.session = _sessionId;
+    response.hdr.offset = request->hdr.offset;
+    response.hdr.size = sizeof(uint32_t);
+    response.writeFileLength = request->hdr.size;
+    
+    _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
+}
+
+/// @brief Handles CalcFileCRC32 command requests. Only the last file written is known.
+void MockLinkFileServer::_calcCRCCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber)
+{
+    FileManager::Request    response;
+    uint16_t                outgoingSeqNumber = _nextSeqNumber(seqNumber);
+    
+    QString path = QString::fromLatin1((char *)request->data, strnlen((char *)request->data, request->hdr.size));
+    if (path.isEmpty() || path != _writePath) {
+        _sendNak(senderSystemId, senderComponentId, FileManager::kErrFail, outgoingSeqNumber, FileManager::kCmdCalcFileCRC32);
+        return;
+    }
+    
+    response.hdr.opcode = FileManager::kRspAck;
+    response.hdr.req_opcode = FileManager::kCmdCalcFileCRC32;
+    response.hdr.session = 0;
+    response.hdr.offset = 0;
+    response.hdr.size = sizeof(uint32_t);
+    response.crc32 = QGC::crc32((const quint8*)_writeFile.constData(), _writeFile.size(), 0);
+    
+    _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
+}
+
 void MockLinkFileServer::_terminateCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber)
 {
     uint16_t outgoingSeqNumber = _nextSeqNumber(seqNumber);
@@ -316,6 +441,18 @@ void MockLinkFileServer::handleFTPMessage(const mavlink_message_t& message)
             _streamCommand(message.sysid, message.compid, request, incomingSeqNumber);
             break;
 
+        case FileManager::kCmdCreateFile:
+            _createCommand(message.sysid, message.compid, request, incomingSeqNumber);
+            break;
+            
+        case FileManager::kCmdWriteFile:
+            _writeCommand(message.sysid, message.compid, request, incomingSeqNumber);
+            break;
+            
+        case FileManager::kCmdCalcFileCRC32:
+            _calcCRCCommand(message.sysid, message.compid, request, incomingSeqNumber);
+            break;
+
         case FileManager::kCmdTerminateSession:
             _terminateCommand(message.sysid, message.compid, request, incomingSeqNumber);
             break;
@@ -374,7 +511,14 @@ void MockLinkFileServer::_sendResponse(uint8_t targetSystemId, uint8_t targetCom
                                                  targetComponentId,
                                                  (uint8_t*)request); // Payload
     
-    _mockLink->respondWithMavlinkMessage(mavlinkMessage);
+    if (_responseDelayMsecs) {
+        MockLink* mockLink = _mockLink;
+        QTimer::singleShot(_responseDelayMsecs, _mockLink, [mockLink, mavlinkMessage]() {
+            mockLink->respondWithMavlinkMessage(mavlinkMessage);
+        });
+    } else {
+        _mockLink->respondWithMavlinkMessage(mavlinkMessage);
+    }
 }
 
 /// @brief Generates the next sequence number given an incoming sequence number. Handles generating
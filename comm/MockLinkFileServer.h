@@ -45,6 +45,24 @@ public:
     /// @brief Sets the error mode for command responses. This allows you to simulate various server errors.
     void setErrorMode(ErrorMode_t errMode) { _errMode = errMode; };
     
+    /// @brief Simulates a lossy link for burst read responses. Pass 0 to disable a fault.
+    ///     @param dropInterval Every dropInterval'th data packet is dropped
+    ///     @param reorderInterval Every reorderInterval'th data packet is held back and sent after the next one
+    ///     @param stallAfter The next burst stops after this many data packets without sending EOF, as if the link went down
+    void setBurstFaults(int dropInterval, int reorderInterval, int stallAfter = 0);
+    
+    /// @brief Simulates link latency by holding back every response for the specified time. Pass 0 to respond immediately.
+    void setResponseDelay(int msecs) { _responseDelayMsecs = msecs; }
+    
+    /// @brief Simulates a lossy link for uploads by ignoring every dropInterval'th write request. Pass 0 to disable.
+    void setWriteLoss(int dropInterval) { _writeDropInterval = dropInterval; _writeRequestCount = 0; }
+    
+    /// @return Path of the last file created through the Create command
+    QString writtenPath(void) const { return _writePath; }
+    
+    /// @return Contents written to the last file created through the Create command
+    QByteArray writtenFile(void) const { return _writeFile; }
+    
     /// @brief Array of failure modes you can cycle through for testing. By looping through this array you can avoid
     /// hardcoding the specific error modes in your unit test. This way when new error modes are added your unit test
     /// code may not need to be modified.
@@ -59,13 +77,13 @@ public:
     /// @brief Used to represent a single test case for download testing.
     struct FileTestCase {
         const char* filename;               ///< Filename to download
-        uint8_t     length;                 ///< Length of file in bytes
+        uint32_t    length;                 ///< Length of file in bytes
 		int			packetCount;			///< Number of packets required for data
         bool        exactFit;				///< true: last packet is exact fit, false: last packet is partially filled
     };
     
     /// @brief The numbers of test cases in the rgFileTestCases array.
-    static const size_t cFileTestCases = 3;
+    static const size_t cFileTestCases = 4;
     
     /// @brief The set of files supported by the mock server for testing purposes. Each one represents a different edge case for testing.
     static const FileTestCase rgFileTestCases[cFileTestCases];
@@ -85,6 +103,9 @@ private:
     void _openCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
     void _readCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
 	void _streamCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
+    void _createCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
+    void _writeCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
+    void _calcCRCCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
     void _terminateCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
     void _resetCommand(uint8_t senderSystemId, uint8_t senderComponentId, uint16_t seqNumber);
     uint16_t _nextSeqNumber(uint16_t seqNumber);
@@ -92,8 +113,17 @@ private:
     QStringList _fileList;  ///< List of files returned by List command
     
     static const uint8_t    _sessionId;
-    uint8_t                 _readFileLength;    ///< Length of active file being read
+    uint32_t                _readFileLength;    ///< Length of active file being read
     ErrorMode_t             _errMode;           ///< Currently set error mode, as specified by setErrorMode
+    int                     _burstDropInterval;     ///< Drop every n'th burst packet, 0 for none
+    int                     _burstReorderInterval;  ///< Swap every n'th burst packet with the next one, 0 for none
+    int                     _burstStallAfter;       ///< Stop the next burst after n packets, 0 for none
+    int                     _burstPacketCount;      ///< Burst data packets generated, drives the fault intervals
+    int                     _responseDelayMsecs;    ///< Delay for all responses, 0 for none
+    int                     _writeDropInterval;     ///< Ignore every n'th write request, 0 for none
+    int                     _writeRequestCount;     ///< Write requests received, drives the drop interval
+    QString                 _writePath;         ///< Path of file being written
+    QByteArray              _writeFile;         ///< Contents of file being written
     const uint8_t           _systemIdServer;    ///< System ID for server
     const uint8_t           _componentIdServer; ///< Component ID for server
     MockLink*               _mockLink;          ///< MockLink to communicate through
@@ -24,8 +24,21 @@ MockLinkMissionItemHandler::MockLinkMissionItemHandler(MockLink* mockLink, MAVLi
     , _failReadRequestListFirstResponse(true)
     , _failReadRequest1FirstResponse(true)
     , _failWriteMissionCountFirstResponse(true)
+    , _missionItemIntSupport(true)
+    , _readNextSequence(0)
+    , _writeWindow(0)
+    , _latencyMsecs(0)
+    , _dropInterval(0)
+    , _dropCount(0)
+    , _writeReceivedCount(0)
+    , _writeNextRequest(0)
+    , _writeRequestsInFlight(0)
+    , _windowedWriteActive(false)
+    , _writeProgressTime(0)
+    , _missionMessageCount(0)
 {
     Q_ASSERT(mockLink);
+    _clock.start();
 }
 
 MockLinkMissionItemHandler::~MockLinkMissionItemHandler()
@@ -42,6 +55,50 @@ void MockLinkMissionItemHandler::_startMissionItemResponseTimer(void)
     _missionItemResponseTimer->start(500);
 }
 
+void MockLinkMissionItemHandler::setTransferFaults(int writeWindow, int latencyMsecs, int dropInterval)
+{
+    _writeWindow = writeWindow;
+    _latencyMsecs = latencyMsecs;
+    _dropInterval = dropInterval;
+    _dropCount = 0;
+}
+
+/// Sends the message to QGC after the simulated link latency
+void MockLinkMissionItemHandler::_respond(const mavlink_message_t& msg)
+{
+    if (_latencyMsecs == 0) {
+        _mockLink->respondWithMavlinkMessage(msg);
+    } else {
+        DelayedMessage_t delayed;
+        delayed.sendTime = _clock.elapsed() + _latencyMsecs;
+        delayed.message = msg;
+        _delayedMessages.append(delayed);
+    }
+}
+
+/// @return true: drop this message from QGC to simulate a lossy link
+bool MockLinkMissionItemHandler::_dropMessage(void)
+{
+    return _dropInterval && (++_dropCount % _dropInterval) == 0;
+}
+
+void MockLinkMissionItemHandler::run500HzTasks(void)
+{
+    qint64 now = _clock.elapsed();
+
+    while (_delayedMessages.count() && _delayedMessages.first().sendTime <= now) {
+        _mockLink->respondWithMavlinkMessage(_delayedMessages.takeFirst().message);
+    }
+
+    if (_windowedWriteActive && now - _writeProgressTime > _writeRetryMsecs) {
+        // Request everything still missing again
+        qCDebug(MockLinkMissionItemHandlerLog) << "run500HzTasks write stalled, requesting missing items again" << _writeSequenceCount - _writeReceivedCount;
+        _writeNextRequest = 0;
+        _writeRequestsInFlight = 0;
+        _requestWriteWindow();
+    }
+}
+
 bool MockLinkMissionItemHandler::handleMessage(const mavlink_message_t& msg)
 {
     switch (msg.msgid) {
@@ -50,17 +107,31 @@ bool MockLinkMissionItemHandler::handleMessage(const mavlink_message_t& msg)
             break;
             
         case MAVLINK_MSG_ID_MISSION_REQUEST:
-            _handleMissionRequest(msg);
+        case MAVLINK_MSG_ID_MISSION_REQUEST_INT:
+            if (_dropMessage()) {
+                qCDebug(MockLinkMissionItemHandlerLog) << "handleMessage dropping mission request";
+            } else {
+                _handleMissionRequest(msg);
+            }
             break;
             
         case MAVLINK_MSG_ID_MISSION_ITEM:
-            _handleMissionItem(msg);
+        case MAVLINK_MSG_ID_MISSION_ITEM_INT:
+            if (_dropMessage()) {
+                qCDebug(MockLinkMissionItemHandlerLog) << "handleMessage dropping mission item";
+            } else {
+                _handleMissionItem(msg);
+            }
             break;
             
         case MAVLINK_MSG_ID_MISSION_COUNT:
             _handleMissionCount(msg);
             break;
             
+        case MAVLINK_MSG_ID_MISSION_WRITE_PARTIAL_LIST:
+            _handleMissionWritePartialList(msg);
+            break;
+            
         case MAVLINK_MSG_ID_MISSION_ACK:
             // Acks are received back for each MISSION_ITEM message
             break;
@@ -78,6 +149,7 @@ bool MockLinkMissionItemHandler::handleMessage(const mavlink_message_t& msg)
             return false;
     }
     
+    _missionMessageCount++;
     return true;
 }
 
@@ -96,6 +168,7 @@ void MockLinkMissionItemHandler::_handleMissionRequestList(const mavlink_message
         mavlink_mission_request_list_t request;
         
         _failReadRequestListFirstResponse = true;
+        _readNextSequence = 0;
         mavlink_msg_mission_request_list_decode(&msg, &request);
         
         Q_ASSERT(request.target_system == _mockLink->vehicleId());
@@ -114,7 +187,7 @@ void MockLinkMissionItemHandler::_handleMissionRequestList(const mavlink_message
                                             msg.sysid,               // Target is original sender
                                             msg.compid,              // Target is original sender
                                             itemCount);              // Number of mission items
-        _mockLink->respondWithMavlinkMessage(responseMsg);
+        _respond(responseMsg);
     }
 }
 
@@ -122,14 +195,27 @@ void MockLinkMissionItemHandler::_handleMissionRequest(const mavlink_message_t&
 {
     qCDebug(MockLinkMissionItemHandlerLog) << "_handleMissionRequest read sequence";
     
+    // MISSION_REQUEST_INT has the same fields and is answered with MISSION_ITEM_INT
+    bool missionItemInt = msg.msgid == MAVLINK_MSG_ID_MISSION_REQUEST_INT;
     mavlink_mission_request_t request;
     
-    mavlink_msg_mission_request_decode(&msg, &request);
+    if (missionItemInt) {
+        mavlink_mission_request_int_t requestInt;
+        
+        mavlink_msg_mission_request_int_decode(&msg, &requestInt);
+        request.target_system = requestInt.target_system;
+        request.seq = requestInt.seq;
+    } else {
+        mavlink_msg_mission_request_decode(&msg, &request);
+    }
     
     Q_ASSERT(request.target_system == _mockLink->vehicleId());
     Q_ASSERT(request.seq < _missionItems.count());
     
-    if (_failureMode == FailReadRequest0NoResponse && request.seq == 0) {
+    if (!_readRequestInSequence(request.seq)) {
+        qCDebug(MockLinkMissionItemHandlerLog) << "_handleMissionRequest rejecting out of sequence request" << request.seq;
+        _sendAck(MAV_MISSION_ERROR);
+    } else if (_failureMode == FailReadRequest0NoResponse && request.seq == 0) {
         qCDebug(MockLinkMissionItemHandlerLog) << "_handleMissionRequest not responding due to failure mode FailReadRequest0NoResponse";
     } else if (_failureMode == FailReadRequest1NoResponse && request.seq == 1) {
         qCDebug(MockLinkMissionItemHandlerLog) << "_handleMissionRequest not responding due to failure mode FailReadRequest1NoResponse";
@@ -152,31 +238,53 @@ void MockLinkMissionItemHandler::_handleMissionRequest(const mavlink_message_t&
         } else {
             mavlink_message_t   responseMsg;
             
-            mavlink_mission_item_t item;
+            mavlink_mission_item_int_t item;
             if (_missionItems.count() == 0 && _sendHomePositionOnEmptyList) {
                 item.frame = MAV_FRAME_GLOBAL_RELATIVE_ALT;
                 item.command = MAV_CMD_NAV_WAYPOINT;
                 item.current = false;
                 item.autocontinue = true;
-                item.param1 = item.param2 = item.param3 = item.param4 = item.x = item.y = item.z = 0;
+                item.param1 = item.param2 = item.param3 = item.param4 = item.z = 0;
+                item.x = item.y = 0;
             } else {
                 item = _missionItems[request.seq];
             }
             
-            mavlink_msg_mission_item_pack_chan(_mockLink->vehicleId(),
-                                               MAV_COMP_ID_MISSIONPLANNER,
-                                               _mockLink->mavlinkChannel(),
-                                               &responseMsg,            // Outgoing message
-                                               msg.sysid,               // Target is original sender
-                                               msg.compid,              // Target is original sender
-                                               request.seq,             // Index of mission item being sent
-                                               item.frame,
-                                               item.command,
-                                               item.current,
-                                               item.autocontinue,
-                                               item.param1, item.param2, item.param3, item.param4,
-                                               item.x, item.y, item.z);
-            _mockLink->respondWithMavlinkMessage(responseMsg);
+            if (missionItemInt) {
+                mavlink_msg_mission_item_int_pack_chan(_mockLink->vehicleId(),
+                                                       MAV_COMP_ID_MISSIONPLANNER,
+                                                       _mockLink->mavlinkChannel(),
+                                                       &responseMsg,            // Outgoing message
+                                                       msg.sysid,               // Target is original sender
+                                                       msg.compid,              // Target is original sender
+                                                       request.seq,             // Index of mission item being sent
+                                                       item.frame,
+                                                       item.command,
+                                                       item.current,
+                                                       item.autocontinue,
+                                                       item.param1, item.param2, item.param3, item.param4,
+                                                       item.x, item.y, item.z);
+            } else {
+                // QGC packs the integer coordinates into the float fields of MISSION_ITEM, so the bits are carried over as is
+                float x, y;
+                memcpy(&x, &item.x, sizeof(x));
+                memcpy(&y, &item.y, sizeof(y));
+                
+                mavlink_msg_mission_item_pack_chan(_mockLink->vehicleId(),
+                                                   MAV_COMP_ID_MISSIONPLANNER,
+                                                   _mockLink->mavlinkChannel(),
+                                                   &responseMsg,            // Outgoing message
+                                                   msg.sysid,               // Target is original sender
+                                                   msg.compid,              // Target is original sender
+                                                   request.seq,             // Index of mission item being sent
+                                                   item.frame,
+                                                   item.command,
+                                                   item.current,
+                                                   item.autocontinue,
+                                                   item.param1, item.param2, item.param3, item.param4,
+                                                   x, y, item.z);
+            }
+            _respond(responseMsg);
         }
     }
 }
@@ -208,11 +316,101 @@ void MockLinkMissionItemHandler::_handleMissionCount(const mavlink_message_t& ms
             return;
         }
         _failWriteMissionCountFirstResponse = true;
-        _writeSequenceIndex = 0;
+        if (_writeWindow > 0) {
+            _writeReceived.fill(false, _writeSequenceCount);
+            _writeReceivedCount = 0;
+            _writeNextRequest = 0;
+            _writeRequestsInFlight = 0;
+            _windowedWriteActive = true;
+            _requestWriteWindow();
+        } else {
+            _writeSequenceIndex = 0;
+            _requestNextMissionItem(_writeSequenceIndex);
+        }
+    }
+}
+
+/// Replaces the items from start_index to end_index, the rest of the mission is kept
+void MockLinkMissionItemHandler::_handleMissionWritePartialList(const mavlink_message_t& msg)
+{
+    mavlink_mission_write_partial_list_t partialList;
+    
+    mavlink_msg_mission_write_partial_list_decode(&msg, &partialList);
+    Q_ASSERT(partialList.target_system == _mockLink->vehicleId());
+    
+    int startIndex = partialList.start_index;
+    int endIndex = partialList.end_index == -1 ? _missionItems.count() - 1 : partialList.end_index;
+    
+    qCDebug(MockLinkMissionItemHandlerLog) << "_handleMissionWritePartialList write sequence start:end" << startIndex << endIndex;
+    
+    if (startIndex < 0 || startIndex > endIndex || endIndex >= _missionItems.count()) {
+        qCWarning(MockLinkMissionItemHandlerLog) << "_handleMissionWritePartialList invalid range start:end:count" << startIndex << endIndex << _missionItems.count();
+        _sendAck(MAV_MISSION_ERROR);
+        return;
+    }
+    
+    _writeSequenceCount = endIndex + 1;
+    if (_writeWindow > 0) {
+        _writeReceived.fill(true, _writeSequenceCount);
+        for (int i=startIndex; i<=endIndex; i++) {
+            _writeReceived.clearBit(i);
+        }
+        _writeReceivedCount = startIndex;
+        _writeNextRequest = startIndex;
+        _writeRequestsInFlight = 0;
+        _windowedWriteActive = true;
+        _requestWriteWindow();
+    } else {
+        _writeSequenceIndex = startIndex;
         _requestNextMissionItem(_writeSequenceIndex);
     }
 }
 
+/// Fills the write window with requests for the lowest sequence numbers not received yet
+void MockLinkMissionItemHandler::_requestWriteWindow(void)
+{
+    while (_writeRequestsInFlight < _writeWindow && _writeNextRequest < _writeSequenceCount) {
+        if (!_writeReceived.testBit(_writeNextRequest)) {
+            _sendMissionRequest(_writeNextRequest);
+            _writeRequestsInFlight++;
+        }
+        _writeNextRequest++;
+    }
+    _writeProgressTime = _clock.elapsed();
+}
+
+void MockLinkMissionItemHandler::_sendMissionRequest(int sequenceNumber)
+{
+    mavlink_message_t message;
+    
+    if (_missionItemIntSupport) {
+        mavlink_mission_request_int_t missionRequest;
+        
+        missionRequest.target_system =      _mavlinkProtocol->getSystemId();
+        missionRequest.target_component =   _mavlinkProtocol->getComponentId();
+        missionRequest.seq =                sequenceNumber;
+        
+        mavlink_msg_mission_request_int_encode_chan(_mockLink->vehicleId(),
+                                                    MAV_COMP_ID_MISSIONPLANNER,
+                                                    _mockLink->mavlinkChannel(),
+                                                    &message,
+                                                    &missionRequest);
+    } else {
+        mavlink_mission_request_t missionRequest;
+        
+        missionRequest.target_system =      _mavlinkProtocol->getSystemId();
+        missionRequest.target_component =   _mavlinkProtocol->getComponentId();
+        missionRequest.seq =                sequenceNumber;
+        
+        mavlink_msg_mission_request_encode_chan(_mockLink->vehicleId(),
+                                                MAV_COMP_ID_MISSIONPLANNER,
+                                                _mockLink->mavlinkChannel(),
+                                                &message,
+                                                &missionRequest);
+    }
+    _respond(message);
+}
+
 void MockLinkMissionItemHandler::_requestNextMissionItem(int sequenceNumber)
 {
     qCDebug(MockLinkMissionItemHandlerLog) << "_requestNextMissionItem write sequence sequenceNumber:" << sequenceNumber << "_failureMode:" << _failureMode;
@@ -235,19 +433,7 @@ void MockLinkMissionItemHandler::_requestNextMissionItem(int sequenceNumber)
             qCDebug(MockLinkMissionItemHandlerLog) << "_requestNextMissionItem sending ack error due to failure mode";
             _sendAck(MAV_MISSION_ERROR);
         } else {
-            mavlink_message_t           message;
-            mavlink_mission_request_t   missionRequest;
-            
-            missionRequest.target_system =      _mavlinkProtocol->getSystemId();
-            missionRequest.target_component =   _mavlinkProtocol->getComponentId();
-            missionRequest.seq =                sequenceNumber;
-            
-            mavlink_msg_mission_request_encode_chan(_mockLink->vehicleId(),
-                                                    MAV_COMP_ID_MISSIONPLANNER,
-                                                    _mockLink->mavlinkChannel(),
-                                                    &message,
-                                                    &missionRequest);
-            _mockLink->respondWithMavlinkMessage(message);
+            _sendMissionRequest(sequenceNumber);
 
             // If response with Mission Item doesn't come before timer fires it's an error
             _startMissionItemResponseTimer();
@@ -255,6 +441,24 @@ void MockLinkMissionItemHandler::_requestNextMissionItem(int sequenceNumber)
     }
 }
 
+/// PX4 only answers a read request for the next item or a repeat of the last one. Anything else is answered
+/// with MAV_MISSION_ERROR and ends the transfer, every later request fails until the next MISSION_REQUEST_LIST.
+/// A request counts as answered even if a failure mode then loses the item.
+bool MockLinkMissionItemHandler::_readRequestInSequence(int sequenceNumber)
+{
+    if (_mockLink->getFirmwareType() != MAV_AUTOPILOT_PX4) {
+        return true;
+    }
+
+    if (_readNextSequence < 0 || (sequenceNumber != _readNextSequence && sequenceNumber != _readNextSequence - 1)) {
+        _readNextSequence = -1;
+        return false;
+    }
+
+    _readNextSequence = sequenceNumber + 1;
+    return true;
+}
+
 void MockLinkMissionItemHandler::_sendAck(MAV_MISSION_RESULT ackType)
 {
     qCDebug(MockLinkMissionItemHandlerLog) << "_sendAck write sequence complete ackType:" << ackType;
@@ -271,21 +475,61 @@ void MockLinkMissionItemHandler::_sendAck(MAV_MISSION_RESULT ackType)
                                         _mockLink->mavlinkChannel(),
                                         &message,
                                         &missionAck);
-    _mockLink->respondWithMavlinkMessage(message);
+    _respond(message);
 }
 
 void MockLinkMissionItemHandler::_handleMissionItem(const mavlink_message_t& msg)
 {
     qCDebug(MockLinkMissionItemHandlerLog) << "_handleMissionItem write sequence";
     
-    _missionItemResponseTimer->stop();
+    if (_missionItemResponseTimer) {
+        _missionItemResponseTimer->stop();
+    }
     
-    mavlink_mission_item_t missionItem;
+    // Items are stored as MISSION_ITEM_INT
+    mavlink_mission_item_int_t missionItem;
     
-    mavlink_msg_mission_item_decode(&msg, &missionItem);
+    if (msg.msgid == MAVLINK_MSG_ID_MISSION_ITEM_INT) {
+        mavlink_msg_mission_item_int_decode(&msg, &missionItem);
+    } else {
+        mavlink_mission_item_t missionItemFloat;
+        
+        mavlink_msg_mission_item_decode(&msg, &missionItemFloat);
+        missionItem.target_system =     missionItemFloat.target_system;
+        missionItem.target_component =  missionItemFloat.target_component;
+        missionItem.seq =               missionItemFloat.seq;
+        missionItem.frame =             missionItemFloat.frame;
+        missionItem.command =           missionItemFloat.command;
+        missionItem.current =           missionItemFloat.current;
+        missionItem.autocontinue =      missionItemFloat.autocontinue;
+        missionItem.param1 =            missionItemFloat.param1;
+        missionItem.param2 =            missionItemFloat.param2;
+        missionItem.param3 =            missionItemFloat.param3;
+        missionItem.param4 =            missionItemFloat.param4;
+        missionItem.z =                 missionItemFloat.z;
+        memcpy(&missionItem.x, &missionItemFloat.x, sizeof(missionItem.x));
+        memcpy(&missionItem.y, &missionItemFloat.y, sizeof(missionItem.y));
+    }
     
     Q_ASSERT(missionItem.target_system == _mockLink->vehicleId());
     
+    if (_writeWindow > 0) {
+        // Duplicates and items arriving after the write completed are ignored
+        if (_windowedWriteActive && missionItem.seq < _writeSequenceCount && !_writeReceived.testBit(missionItem.seq)) {
+            _missionItems[missionItem.seq] = missionItem;
+            _writeReceived.setBit(missionItem.seq);
+            _writeReceivedCount++;
+            _writeRequestsInFlight = qMax(0, _writeRequestsInFlight - 1);
+            if (_writeReceivedCount == _writeSequenceCount) {
+                _windowedWriteActive = false;
+                _sendAck(MAV_MISSION_ACCEPTED);
+            } else {
+                _requestWriteWindow();
+            }
+        }
+        return;
+    }
+    
     _missionItems[missionItem.seq] = missionItem;
     
     _writeSequenceIndex++;
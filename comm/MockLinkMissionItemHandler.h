@@ -14,6 +14,11 @@
 #include <QObject>
 #include <QMap>
 #include <QTimer>
+#include <QList>
+#include <QBitArray>
+#include <QElapsedTimer>
+
+#include <atomic>
 
 #include "QGCMAVLink.h"
 #include "QGCLoggingCategory.h"
@@ -76,10 +81,28 @@ public:
     void sendUnexpectedMissionRequest(void);
     
     /// Reset the state of the MissionItemHandler to no items, no transactions in progress.
-    void reset(void) { _missionItems.clear(); }
+    void reset(void) { _missionItems.clear(); _windowedWriteActive = false; }
 
     void setSendHomePositionOnEmptyList(bool sendHomePositionOnEmptyList) { _sendHomePositionOnEmptyList = sendHomePositionOnEmptyList; }
 
+    /// Simulates a slow lossy link and a vehicle which keeps several MISSION_REQUESTs in flight while QGC writes.
+    /// Missing items are requested again after _writeRetryMsecs. Failure modes do not apply to these writes.
+    ///     @param writeWindow Requests kept in flight during a write, 0 for the original one at a time sequence
+    ///     @param latencyMsecs Delay before each mission message is sent to QGC
+    ///     @param dropInterval Every dropInterval'th MISSION_REQUEST or MISSION_ITEM from QGC is dropped, 0 for none
+    void setTransferFaults(int writeWindow, int latencyMsecs, int dropInterval);
+
+    /// Sets whether writes are requested with MISSION_REQUEST_INT, also reported as MAV_PROTOCOL_CAPABILITY_MISSION_INT
+    void setMissionItemIntSupport(bool supported) { _missionItemIntSupport = supported; }
+    bool missionItemIntSupport(void) const { return _missionItemIntSupport; }
+
+    /// Sends delayed messages and repeats missing write requests. Called from the MockLink thread.
+    void run500HzTasks(void);
+
+    /// @return Number of mission protocol messages received from QGC since the last reset. Thread safe.
+    int missionMessageCount(void) const { return _missionMessageCount; }
+    void resetMissionMessageCount(void) { _missionMessageCount = 0; }
+
 private slots:
     void _missionItemResponseTimeout(void);
 
@@ -88,9 +111,15 @@ private:
     void _handleMissionRequest(const mavlink_message_t& msg);
     void _handleMissionItem(const mavlink_message_t& msg);
     void _handleMissionCount(const mavlink_message_t& msg);
+    void _handleMissionWritePartialList(const mavlink_message_t& msg);
     void _requestNextMissionItem(int sequenceNumber);
+    void _requestWriteWindow(void);
+    void _sendMissionRequest(int sequenceNumber);
     void _sendAck(MAV_MISSION_RESULT ackType);
     void _startMissionItemResponseTimer(void);
+    void _respond(const mavlink_message_t& msg);
+    bool _dropMessage(void);
+    bool _readRequestInSequence(int sequenceNumber);
 
 private:
     MockLink* _mockLink;
@@ -98,8 +127,13 @@ private:
     int _writeSequenceCount;    ///< Numbers of items about to be written
     int _writeSequenceIndex;    ///< Current index being reqested
     
-    typedef QMap<uint16_t, mavlink_mission_item_t>   MissionList_t;
+    typedef QMap<uint16_t, mavlink_mission_item_int_t>   MissionList_t;
     MissionList_t   _missionItems;
+
+    typedef struct {
+        qint64              sendTime;
+        mavlink_message_t   message;
+    } DelayedMessage_t;
     
     QTimer*             _missionItemResponseTimer;
     FailureMode_t       _failureMode;
@@ -108,6 +142,24 @@ private:
     bool                _failReadRequestListFirstResponse;
     bool                _failReadRequest1FirstResponse;
     bool                _failWriteMissionCountFirstResponse;
+    bool                _missionItemIntSupport;
+    int                 _readNextSequence;      ///< PX4: next item the read may request, -1 after a rejected request
+
+    int                     _writeWindow;           ///< 0: one request at a time with failure modes
+    int                     _latencyMsecs;
+    int                     _dropInterval;
+    int                     _dropCount;             ///< Messages from QGC seen by the drop interval
+    QList<DelayedMessage_t> _delayedMessages;
+    QElapsedTimer           _clock;
+    QBitArray               _writeReceived;         ///< Items received during a windowed write
+    int                     _writeReceivedCount;
+    int                     _writeNextRequest;      ///< Lowest sequence number not yet requested in this window pass
+    int                     _writeRequestsInFlight;
+    bool                    _windowedWriteActive;
+    qint64                  _writeProgressTime;     ///< _clock time of the last request or received item
+    std::atomic<int>        _missionMessageCount;
+
+    static const int _writeRetryMsecs = 250;
 };
 
 #endif
@@ -28,6 +28,13 @@
 #include "QGC.h"
 #include <QHostInfo>
 
+#if defined(QGC_UDP_MMSG)
+#include <arpa/inet.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
 #define REMOVE_GONE_HOSTS 0
 #define USE_SHIFT_ALG
 static const char* kZeroconfRegistration = "_qgroundcontrol._udp";
@@ -72,6 +79,16 @@ UDPLink::UDPLink(UDPConfiguration* config)
     , _dnssServiceRef(NULL)
     #endif
     , _running(false)
+    , _targetsGeneration(-1)
+    , _rateTimer(NULL)
+    , _rxPacketCount(0)
+    , _txPacketCount(0)
+    , _rxPacketsPerSecond(0)
+    , _txPacketsPerSecond(0)
+#if defined(QGC_UDP_MMSG)
+    , _mmsgFd(-1)
+    , _mmsgNotifier(NULL)
+#endif
 {
     Q_ASSERT(config != NULL);
     _config = config;
@@ -108,6 +125,15 @@ void UDPLink::run()
         _deregisterZeroconf();
         _socket->close();
     }
+#if defined(QGC_UDP_MMSG)
+    if (_mmsgNotifier) {
+        _deregisterZeroconf();
+        delete _mmsgNotifier;
+        _mmsgNotifier = NULL;
+    }
+#endif
+    delete _rateTimer;
+    _rateTimer = NULL;
 }
 
 void UDPLink::_restartConnection()
@@ -136,49 +162,53 @@ void UDPLink::removeHost(const QString& host)
 
 void UDPLink::_writeBytes(const QByteArray data)
 {
+#if defined(QGC_UDP_MMSG)
+    if (!_socket && _mmsgFd == -1)
+#else
     if (!_socket)
+#endif
         return;
 
-    QStringList goneHosts;
-    // Send to all connected systems
-    QString host;
-    int port;
-    if(_config->firstHost(host, port)) {
-        do {
-            QHostAddress currentHost(host);
+    _updateTargets();
+    if (_targets.isEmpty()) {
+        return;
+    }
+
 #ifdef USE_SHIFT_ALG
-            QByteArray send;
-            for(int position = 0; position < data.size();position++)
-                send[position] = ((data[position]<<4)&0xF0)|((data[position]>>4)&0x0F);
-            if(_socket->writeDatagram(send, currentHost, (quint16)port) < 0) {
-                // This host is gone. Add to list to be removed
-                // We should keep track of hosts that were manually added (static) and
-                // hosts that were added because we heard from them (dynamic). Only
-                // dynamic hosts should be removed and even then, after a few tries, not
-                // the first failure. In the mean time, we don't remove anything.
-                if(REMOVE_GONE_HOSTS) {
-                    goneHosts.append(host);
-                }
-            } else {
-                // Only log rate if data actually got sent. Not sure about this as
-                // "host not there" takes time too regardless of size of data. In fact,
-                // 1 byte or "UDP frame size" bytes are the same as that's the data
-                // unit sent by UDP.
-                _logOutputDataRate(data.size(), QDateTime::currentMSecsSinceEpoch());
-            }
+    _txBuffer.resize(data.size());
+    const char* src = data.constData();
+    char* dst = _txBuffer.data();
+    for(int position = 0; position < data.size();position++)
+        dst[position] = ((src[position]<<4)&0xF0)|((src[position]>>4)&0x0F);
+    const QByteArray& send = _txBuffer;
 #else
-            if(_socket->writeDatagram(data, currentHost, (quint16)port) < 0) {
-                if(REMOVE_GONE_HOSTS) {
-                    goneHosts.append(host);
-                }
-            } else {
-                _logOutputDataRate(data.size(), QDateTime::currentMSecsSinceEpoch());
-            }
+    const QByteArray& send = data;
+#endif
+
+#if defined(QGC_UDP_MMSG)
+    if (_mmsgFd != -1) {
+        _mmsgWriteBytes(send);
+        return;
+    }
+#endif
+
+    // Send to all connected systems
+    foreach (const Target_t& target, _targets) {
+        if(_socket->writeDatagram(send, target.address, target.port) < 0) {
+            // This host is gone. We should keep track of hosts that were manually added (static) and
+            // hosts that were added because we heard from them (dynamic). Only dynamic hosts should be
+            // removed and even then, after a few tries, not the first failure. In the mean time, we
+            // don't remove anything.
+#if REMOVE_GONE_HOSTS
+            _config->removeHost(target.address.toString());
 #endif
-        } while (_config->nextHost(host, port));
-        //-- Remove hosts that are no longer there
-        foreach (const QString& ghost, goneHosts) {
-            _config->removeHost(ghost);
+        } else {
+            // Only log rate if data actually got sent. Not sure about this as
+            // "host not there" takes time too regardless of size of data. In fact,
+            // 1 byte or "UDP frame size" bytes are the same as that's the data
+            // unit sent by UDP.
+            _txPacketCount++;
+            _logOutputDataRate(data.size(), QDateTime::currentMSecsSinceEpoch());
         }
     }
 }
@@ -188,26 +218,38 @@ void UDPLink::_writeBytes(const QByteArray data)
  **/
 void UDPLink::readBytes()
 {
+#if defined(QGC_UDP_MMSG)
+    if (_mmsgFd != -1) {
+        _mmsgReadBytes();
+        return;
+    }
+#endif
+
     QByteArray databuffer;
     while (_socket->hasPendingDatagrams())
     {
-        QByteArray datagram;
-        datagram.resize(_socket->pendingDatagramSize());
+        qint64 datagramSize = _socket->pendingDatagramSize();
+        if (datagramSize > _rxBuffer.size()) {
+            _rxBuffer.resize(qMax((int)datagramSize, _maxDatagramSize));
+        }
         QHostAddress sender;
         quint16 senderPort;
-        _socket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
-        databuffer.append(datagram);
+        qint64 length = _socket->readDatagram(_rxBuffer.data(), _rxBuffer.size(), &sender, &senderPort);
+        if (length < 0) {
+            break;
+        }
+        if (databuffer.isEmpty()) {
+            databuffer.reserve(_emitThreshold + _rxBuffer.size());
+        }
+        databuffer.append(_rxBuffer.constData(), length);
         //-- Wait a bit before sending it over
-        if(databuffer.size() > 10 * 1024) {
+        if(databuffer.size() > _emitThreshold) {
             emit bytesReceived(this, databuffer);
             databuffer.clear();
         }
-        _logInputDataRate(datagram.length(), QDateTime::currentMSecsSinceEpoch());
-        // TODO This doesn't validade the sender. Anything sending UDP packets to this port gets
-        // added to the list and will start receiving datagrams from here. Even a port scanner
-        // would trigger this.
-        // Add host to broadcast list if not yet present, or update its port
-        _config->addHost(sender.toString(), (int)senderPort);
+        _rxPacketCount++;
+        _logInputDataRate(length, QDateTime::currentMSecsSinceEpoch());
+        _senderSeen(sender, senderPort);
     }
     //-- Send whatever is left
     if(databuffer.size()) {
@@ -215,6 +257,258 @@ void UDPLink::readBytes()
     }
 }
 
+/// Adds a sender to the host list the first time it is heard from. Known IPv4 senders are tracked by
+/// address so the host list string handling only happens once per sender.
+void UDPLink::_senderSeen(const QHostAddress& sender, quint16 senderPort)
+{
+    bool ipv4;
+    quint32 address = sender.toIPv4Address(&ipv4);
+    if (!ipv4) {
+        // Adding a known host again is not a change
+        _config->addHost(sender.toString(), (int)senderPort);
+        return;
+    }
+
+    quint64 key = ((quint64)address << 16) | senderPort;
+    if (_knownSenders.contains(key)) {
+        return;
+    }
+    _knownSenders.insert(key);
+
+    // TODO This doesn't validade the sender. Anything sending UDP packets to this port gets
+    // added to the list and will start receiving datagrams from here. Even a port scanner
+    // would trigger this.
+    // Add host to broadcast list if not yet present, or update its port
+    _config->addHost(sender.toString(), (int)senderPort);
+}
+
+/// Rebuilds the resolved target list if the configuration host list changed since it was last built
+void UDPLink::_updateTargets()
+{
+    int generation = _config->hostsGeneration();
+    if (generation == _targetsGeneration) {
+        return;
+    }
+    _targetsGeneration = generation;
+
+    _targets.clear();
+
+    QMap<QString, int> hosts = _config->hosts();
+    QMap<QString, int>::const_iterator it = hosts.constBegin();
+    while (it != hosts.constEnd()) {
+        Target_t target;
+        target.address = QHostAddress(it.key());
+        target.port = (quint16)it.value();
+        if (target.address.isNull()) {
+            qWarning() << "UDP:" << "Skipping invalid host address:" << it.key();
+            it++;
+            continue;
+        }
+#if defined(QGC_UDP_MMSG)
+        memset(&target.sockAddr, 0, sizeof(target.sockAddr));
+        target.sockAddr.sin6_family = AF_INET6;
+        target.sockAddr.sin6_port = htons(target.port);
+        bool ipv4;
+        quint32 ipv4Address = htonl(target.address.toIPv4Address(&ipv4));
+        if (ipv4) {
+            // ::ffff:a.b.c.d
+            target.sockAddr.sin6_addr.s6_addr[10] = 0xff;
+            target.sockAddr.sin6_addr.s6_addr[11] = 0xff;
+            memcpy(&target.sockAddr.sin6_addr.s6_addr[12], &ipv4Address, sizeof(ipv4Address));
+        } else {
+            Q_IPV6ADDR ipv6Address = target.address.toIPv6Address();
+            memcpy(target.sockAddr.sin6_addr.s6_addr, ipv6Address.c, sizeof(ipv6Address.c));
+        }
+#endif
+        _targets.append(target);
+        it++;
+    }
+
+    // Forget only senders whose host was removed, so they are added again when next heard from. Senders
+    // on a local interface are in the host list as the loopback alias.
+    QSet<quint64>::iterator sender = _knownSenders.begin();
+    while (sender != _knownSenders.end()) {
+        quint32 address = (quint32)(*sender >> 16);
+        quint16 port = (quint16)(*sender & 0xFFFF);
+        bool found = false;
+        foreach (const Target_t& target, _targets) {
+            if (target.port == port && (target.address.toIPv4Address() == address || target.address == QHostAddress(QHostAddress::LocalHost))) {
+                found = true;
+                break;
+            }
+        }
+        if (found) {
+            sender++;
+        } else {
+            sender = _knownSenders.erase(sender);
+        }
+    }
+}
+
+void UDPLink::_updatePacketRates()
+{
+    _rxPacketsPerSecond = _rxPacketCount;
+    _txPacketsPerSecond = _txPacketCount;
+    _rxPacketCount = 0;
+    _txPacketCount = 0;
+}
+
+#if defined(QGC_UDP_MMSG)
+/// Opens a dual stack socket so IPv4 and IPv6 hosts share one sendmmsg batch
+bool UDPLink::_mmsgConnect()
+{
+    _mmsgFd = ::socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_mmsgFd < 0) {
+        return false;
+    }
+
+    int v6Only = 0;
+    if (::setsockopt(_mmsgFd, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, sizeof(v6Only)) < 0) {
+        ::close(_mmsgFd);
+        _mmsgFd = -1;
+        return false;
+    }
+
+    int reuse = 1;
+    int sendBufferSize = 256 * 1024;
+    int receiveBufferSize = 512 * 1024;
+    ::setsockopt(_mmsgFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    ::setsockopt(_mmsgFd, SOL_SOCKET, SO_SNDBUF, &sendBufferSize, sizeof(sendBufferSize));
+    ::setsockopt(_mmsgFd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+
+    sockaddr_in6 localAddr;
+    memset(&localAddr, 0, sizeof(localAddr));
+    localAddr.sin6_family = AF_INET6;
+    localAddr.sin6_addr = in6addr_any;
+    localAddr.sin6_port = htons(_config->localPort());
+    if (::bind(_mmsgFd, (sockaddr*)&localAddr, sizeof(localAddr)) < 0) {
+        ::close(_mmsgFd);
+        _mmsgFd = -1;
+        return false;
+    }
+
+    // Receive buffers are allocated once and reused for every batch
+    _rxBuffer.resize(_mmsgBatchSize * _maxDatagramSize);
+    for (int i=0; i<_mmsgBatchSize; i++) {
+        _rxIovecs[i].iov_base = _rxBuffer.data() + (i * _maxDatagramSize);
+        _rxIovecs[i].iov_len = _maxDatagramSize;
+        memset(&_rxMsgs[i], 0, sizeof(_rxMsgs[i]));
+        _rxMsgs[i].msg_hdr.msg_iov = &_rxIovecs[i];
+        _rxMsgs[i].msg_hdr.msg_iovlen = 1;
+        _rxMsgs[i].msg_hdr.msg_name = &_rxAddrs[i];
+    }
+
+    _mmsgNotifier = new QSocketNotifier(_mmsgFd, QSocketNotifier::Read);
+    QObject::connect(_mmsgNotifier, &QSocketNotifier::activated, this, &UDPLink::readBytes);
+
+    return true;
+}
+
+void UDPLink::_mmsgDisconnect()
+{
+    if (_mmsgFd != -1) {
+        ::close(_mmsgFd);
+        _mmsgFd = -1;
+    }
+}
+
+void UDPLink::_mmsgReadBytes()
+{
+    QByteArray databuffer;
+
+    while (true) {
+        for (int i=0; i<_mmsgBatchSize; i++) {
+            _rxMsgs[i].msg_hdr.msg_namelen = sizeof(_rxAddrs[i]);
+        }
+
+        int count = ::recvmmsg(_mmsgFd, _rxMsgs, _mmsgBatchSize, MSG_DONTWAIT, NULL);
+        if (count <= 0) {
+            if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                qWarning() << "UDP:" << "recvmmsg failed:" << strerror(errno);
+            }
+            break;
+        }
+
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (int i=0; i<count; i++) {
+            int length = _rxMsgs[i].msg_len;
+            if (_rxMsgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                qWarning() << "UDP:" << "Dropping oversized datagram";
+                continue;
+            }
+            if (databuffer.isEmpty()) {
+                databuffer.reserve(_emitThreshold + length);
+            }
+            databuffer.append((const char*)_rxIovecs[i].iov_base, length);
+            _rxPacketCount++;
+            _logInputDataRate(length, now);
+
+            const sockaddr_in6& sender = _rxAddrs[i];
+            quint16 senderPort = ntohs(sender.sin6_port);
+            if (IN6_IS_ADDR_V4MAPPED(&sender.sin6_addr)) {
+                quint32 address;
+                memcpy(&address, &sender.sin6_addr.s6_addr[12], sizeof(address));
+                address = ntohl(address);
+                if (!_knownSenders.contains(((quint64)address << 16) | senderPort)) {
+                    _senderSeen(QHostAddress(address), senderPort);
+                }
+            } else {
+                _senderSeen(QHostAddress((const quint8*)sender.sin6_addr.s6_addr), senderPort);
+            }
+        }
+
+        //-- Wait a bit before sending it over
+        if (databuffer.size() > _emitThreshold) {
+            emit bytesReceived(this, databuffer);
+            databuffer.clear();
+        }
+
+        if (count < _mmsgBatchSize) {
+            // Socket has been drained
+            break;
+        }
+    }
+
+    //-- Send whatever is left
+    if (databuffer.size()) {
+        emit bytesReceived(this, databuffer);
+    }
+}
+
+void UDPLink::_mmsgWriteBytes(const QByteArray& data)
+{
+    // All targets share the same payload, only the destination differs
+    _txIovec.iov_base = const_cast<char*>(data.constData());
+    _txIovec.iov_len = data.size();
+
+    int targetCount = _targets.count();
+    int sentCount = 0;
+    while (sentCount < targetCount) {
+        int batchCount = qMin(targetCount - sentCount, _mmsgBatchSize);
+        for (int i=0; i<batchCount; i++) {
+            memset(&_txMsgs[i], 0, sizeof(_txMsgs[i]));
+            _txMsgs[i].msg_hdr.msg_name = const_cast<sockaddr_in6*>(&_targets[sentCount + i].sockAddr);
+            _txMsgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in6);
+            _txMsgs[i].msg_hdr.msg_iov = &_txIovec;
+            _txMsgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int sent = ::sendmmsg(_mmsgFd, _txMsgs, batchCount, MSG_DONTWAIT);
+        if (sent <= 0) {
+            // Socket buffer is full or the remaining hosts are unreachable, drop the rest of this write
+            break;
+        }
+
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (int i=0; i<sent; i++) {
+            _logOutputDataRate(data.size(), now);
+        }
+        _txPacketCount += sent;
+        sentCount += sent;
+    }
+}
+#endif
+
 /**
  * @brief Disconnect the connection.
  *
@@ -231,6 +525,12 @@ void UDPLink::_disconnect(void)
         _socket = NULL;
         emit disconnected();
     }
+#if defined(QGC_UDP_MMSG)
+    if (_mmsgFd != -1) {
+        _mmsgDisconnect();
+        emit disconnected();
+    }
+#endif
     _connectState = false;
 }
 
@@ -258,6 +558,23 @@ bool UDPLink::_hardwareConnect()
         delete _socket;
         _socket = NULL;
     }
+
+    _rateTimer = new QTimer();
+    _rateTimer->setInterval(1000);
+    QObject::connect(_rateTimer, &QTimer::timeout, this, &UDPLink::_updatePacketRates);
+    _rateTimer->start();
+
+#if defined(QGC_UDP_MMSG)
+    _mmsgDisconnect();
+    if (_mmsgConnect()) {
+        _connectState = true;
+        _registerZeroconf(_config->localPort(), kZeroconfRegistration);
+        emit connected();
+        return _connectState;
+    }
+    // No dual stack socket, IPv6 may be disabled. QUdpSocket still works.
+    qWarning() << "UDP:" << "Batched socket unavailable, using QUdpSocket";
+#endif
     QHostAddress host = QHostAddress::AnyIPv4;
     _socket = new QUdpSocket();
     _socket->setProxy(QNetworkProxy::NoProxy);
@@ -345,12 +662,16 @@ void UDPLink::_deregisterZeroconf()
 //--------------------------------------------------------------------------
 //-- UDPConfiguration
 
-UDPConfiguration::UDPConfiguration(const QString& name) : LinkConfiguration(name)
+UDPConfiguration::UDPConfiguration(const QString& name)
+    : LinkConfiguration(name)
+    , _hostsGeneration(0)
 {
     _localPort = QGC_UDP_LOCAL_PORT;
 }
 
-UDPConfiguration::UDPConfiguration(UDPConfiguration* source) : LinkConfiguration(source)
+UDPConfiguration::UDPConfiguration(UDPConfiguration* source)
+    : LinkConfiguration(source)
+    , _hostsGeneration(0)
 {
     _localPort = source->localPort();
     QString host;
@@ -377,6 +698,7 @@ void UDPConfiguration::copyFrom(LinkConfiguration *source)
             addHost(host, port);
         } while(usource->nextHost(host, port));
     }
+    _updateHostList();
 }
 
 /**
@@ -429,15 +751,13 @@ void UDPConfiguration::addHost(const QString& host, int port)
                     }
                 }
             }
-            if (not_local) {
-                // This is a normal remote host, add it using its IPv4 address
-                _hosts[ipAdd] = port;
-                //qDebug() << "UDP:" << "Adding Host:" << ipAdd << ":" << port;
-            } else {
-                // It is localhost, so talk to it through the IPv4 loopback interface
-                _hosts["127.0.0.1"] = port;
+            // A normal remote host is added using its IPv4 address, localhost is talked to through the
+            // IPv4 loopback interface. Adding the same address and port again is not a change.
+            QString hostKey = not_local ? ipAdd : QString("127.0.0.1");
+            if(!_hosts.contains(hostKey) || _hosts[hostKey] != port) {
+                _hosts[hostKey] = port;
+                changed = true;
             }
-            changed = true;
         }
     }
     if(changed) {
@@ -463,6 +783,12 @@ void UDPConfiguration::removeHost(const QString host)
     _updateHostList();
 }
 
+QMap<QString, int> UDPConfiguration::hosts()
+{
+    QMutexLocker locker(&_confMutex);
+    return _hosts;
+}
+
 bool UDPConfiguration::firstHost(QString& host, int& port)
 {
     _confMutex.lock();
@@ -543,6 +869,7 @@ void UDPConfiguration::updateSettings()
 
 void UDPConfiguration::_updateHostList()
 {
+    _hostsGeneration++;
     _hostList.clear();
     QMap<QString, int>::const_iterator it = _hosts.begin();
     while(it != _hosts.end()) {
@@ -26,6 +26,12 @@
 #include <QMutexLocker>
 #include <QQueue>
 #include <QByteArray>
+#include <QHostAddress>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <atomic>
 
 #if defined(QGC_ZEROCONF_ENABLED)
 #include <dns_sd.h>
@@ -37,6 +43,14 @@
 #define QGC_UDP_LOCAL_PORT  14550
 #define QGC_UDP_TARGET_PORT 14555
 
+// Linux desktop builds read and write datagrams in batches through recvmmsg/sendmmsg on a dual stack
+// socket. If that socket can't be opened the link falls back to QUdpSocket.
+#if defined(Q_OS_LINUX) && !defined(__android__)
+#define QGC_UDP_MMSG
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
 class UDPConfiguration : public LinkConfiguration
 {
     Q_OBJECT
@@ -130,6 +144,19 @@ public:
      */
     QStringList hostList    () { return _hostList; }
 
+    /*!
+     * @brief Get a copy of the target host list
+     *
+     * @return Map of host address to port number
+     */
+    QMap<QString, int> hosts ();
+
+    /*!
+     * @brief Host list generation, which changes every time the host list is modified.
+     * Used by the link to know when its resolved target list has to be rebuilt.
+     */
+    int hostsGeneration     () const { return _hostsGeneration.load(); }
+
     /// From LinkConfiguration
     LinkType    type            () { return LinkConfiguration::TypeUdp; }
     void        copyFrom        (LinkConfiguration* source);
@@ -151,6 +178,7 @@ private:
     QMap<QString, int> _hosts;  ///< ("host", port)
     QStringList _hostList;      ///< Exposed to QML
     quint16 _localPort;
+    std::atomic<int> _hostsGeneration;
 };
 
 class UDPLink : public LinkInterface
@@ -170,6 +198,11 @@ public:
     qint64 getCurrentInDataRate() const;
     qint64 getCurrentOutDataRate() const;
 
+    /// Datagrams received during the last second
+    quint32 receivedPacketsPerSecond() const { return _rxPacketsPerSecond.load(); }
+    /// Datagrams sent during the last second, counting each target host separately
+    quint32 sentPacketsPerSecond() const { return _txPacketsPerSecond.load(); }
+
     void run();
 
     // These are left unimplemented in order to cause linker errors which indicate incorrect usage of
@@ -189,6 +222,8 @@ public slots:
     void readBytes();
 
 private slots:
+    void _updatePacketRates();
+
     /*!
      * @brief Write a number of bytes to the interface.
      *
@@ -218,11 +253,57 @@ private:
     void _registerZeroconf(uint16_t port, const std::string& regType);
     void _deregisterZeroconf();
 
+    void _updateTargets();
+    void _senderSeen(const QHostAddress& sender, quint16 senderPort);
+
+#if defined(QGC_UDP_MMSG)
+    bool _mmsgConnect();
+    void _mmsgDisconnect();
+    void _mmsgReadBytes();
+    void _mmsgWriteBytes(const QByteArray& data);
+#endif
+
 #if defined(QGC_ZEROCONF_ENABLED)
     DNSServiceRef  _dnssServiceRef;
 #endif
 
     bool                _running;
+
+    /// Resolved target host, rebuilt only when the configuration host list changes
+    typedef struct {
+        QHostAddress    address;
+        quint16         port;
+#if defined(QGC_UDP_MMSG)
+        sockaddr_in6    sockAddr;       ///< IPv4 hosts are IPv4 mapped
+#endif
+    } Target_t;
+
+    QList<Target_t>     _targets;
+    int                 _targetsGeneration;     ///< UDPConfiguration::hostsGeneration the targets were built from
+    QSet<quint64>       _knownSenders;          ///< IPv4 address << 16 | port of senders already added to the host list, IPv6 senders are not cached
+    QByteArray          _rxBuffer;              ///< Reused buffer for incoming datagrams
+    QByteArray          _txBuffer;              ///< Reused buffer for outgoing datagrams
+
+    QTimer*             _rateTimer;
+    quint32             _rxPacketCount;         ///< Datagrams received since the last rate update
+    quint32             _txPacketCount;         ///< Datagrams sent since the last rate update
+    std::atomic<quint32> _rxPacketsPerSecond;
+    std::atomic<quint32> _txPacketsPerSecond;
+
+    static const int    _maxDatagramSize = 64 * 1024;  ///< Largest UDP payload, smaller receive buffers truncate
+    static const int    _emitThreshold = 10 * 1024;    ///< Received data is passed on once this many bytes are collected
+
+#if defined(QGC_UDP_MMSG)
+    static const int    _mmsgBatchSize = 32;            ///< Datagrams per recvmmsg/sendmmsg call
+
+    int                 _mmsgFd;
+    QSocketNotifier*    _mmsgNotifier;
+    mmsghdr             _rxMsgs[_mmsgBatchSize];
+    iovec               _rxIovecs[_mmsgBatchSize];
+    sockaddr_in6        _rxAddrs[_mmsgBatchSize];
+    mmsghdr             _txMsgs[_mmsgBatchSize];
+    iovec               _txIovec;
+#endif
 };
 
 #endif // UDPLINK_H
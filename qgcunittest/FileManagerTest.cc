@@ -41,6 +41,9 @@ void FileManagerTest::init(void)
     
     // Reset any internal state back to normal
     _fileServer->setErrorMode(MockLinkFileServer::errModeNone);
+    _fileServer->setBurstFaults(0, 0);
+    _fileServer->setResponseDelay(0);
+    _fileServer->setWriteLoss(0);
     _fileListReceived.clear();
 
     connect(_fileManager, &FileManager::listEntry, this, &FileManagerTest::listEntry);
@@ -194,6 +197,167 @@ void FileManagerTest::_listTest(void)
     }
 }
 
+void FileManagerTest::_validateFileContents(const QString& filePath, uint32_t length)
+{
+	QFile file(filePath);
+	
+	// Make sure file size is correct
+	QCOMPARE(file.size(), (qint64)length);
+	
+	// Read data
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	QByteArray bytes = file.readAll();
+	file.close();
+	
+	// Validate file contents:
+	//      Repeating 0x00, 0x01 .. 0xFF until file is full
+	for (int i=0; i<bytes.length(); i++) {
+		QCOMPARE((uint8_t)bytes[i], (uint8_t)(i & 0xFF));
+	}
+}
+
+/// @brief Burst downloads the specified test file and validates the result
+void FileManagerTest::_burstDownload(const MockLinkFileServer::FileTestCase* testCase, int msecsTimeout)
+{
+    QString filePath = QDir::temp().absoluteFilePath(testCase->filename);
+    if (QFile::exists(filePath)) {
+        QVERIFY(QFile::remove(filePath));
+    }
+    
+    _fileManager->streamPath(testCase->filename, QDir::temp());
+    QVERIFY(_multiSpy->waitForSignalByIndex(commandCompleteSignalIndex, msecsTimeout));
+    QCOMPARE(_multiSpy->checkNoSignalByMask(commandErrorSignalMask), true);
+    _validateFileContents(filePath, testCase->length);
+    
+    // Packets still in flight after completion must be ignored quietly
+    QTest::qWait(200);
+    QCOMPARE(_multiSpy->checkNoSignalByMask(commandErrorSignalMask), true);
+}
+
+void FileManagerTest::_burstDownloadTest(void)
+{
+    Q_ASSERT(_fileManager);
+    Q_ASSERT(_multiSpy);
+    Q_ASSERT(_multiSpy->checkNoSignals() == true);
+    
+    QSignalSpy throughputSpy(_fileManager, SIGNAL(downloadThroughput(double, int)));
+    
+    for (size_t i=0; i<MockLinkFileServer::cFileTestCases; i++) {
+        _burstDownload(&MockLinkFileServer::rgFileTestCases[i], _ackTimerTimeoutMsecs);
+        _multiSpy->clearAllSignals();
+        
+        // Clean link, so no repairs should have been needed
+        QCOMPARE(throughputSpy.count(), 1);
+        QVERIFY(throughputSpy[0][0].toDouble() > 0);
+        QCOMPARE(throughputSpy[0][1].toInt(), 0);
+        throughputSpy.clear();
+    }
+}
+
+void FileManagerTest::_burstDownloadLossTest(void)
+{
+    Q_ASSERT(_fileManager);
+    Q_ASSERT(_multiSpy);
+    Q_ASSERT(_multiSpy->checkNoSignals() == true);
+    
+    const MockLinkFileServer::FileTestCase* testCase = &MockLinkFileServer::rgFileTestCases[MockLinkFileServer::cFileTestCases - 1];
+    QSignalSpy throughputSpy(_fileManager, SIGNAL(downloadThroughput(double, int)));
+    
+    // Drop every 7th packet and swap every 5th with its successor. Only the dropped packets should be read again.
+    _fileServer->setBurstFaults(7, 5);
+    _burstDownload(testCase, _ackTimerTimeoutMsecs);
+    
+    QCOMPARE(throughputSpy.count(), 1);
+    QCOMPARE(throughputSpy[0][1].toInt(), testCase->packetCount / 7);
+}
+
+void FileManagerTest::_burstDownloadResumeTest(void)
+{
+    Q_ASSERT(_fileManager);
+    Q_ASSERT(_multiSpy);
+    Q_ASSERT(_multiSpy->checkNoSignals() == true);
+    
+    const MockLinkFileServer::FileTestCase* testCase = &MockLinkFileServer::rgFileTestCases[MockLinkFileServer::cFileTestCases - 1];
+    QSignalSpy throughputSpy(_fileManager, SIGNAL(downloadThroughput(double, int)));
+    
+    // The link goes quiet part way through the burst. After the ack timeout the download must pick up
+    // where it stopped instead of starting over.
+    QSignalSpy resetSpy(_fileServer, SIGNAL(resetCommandReceived()));
+    _fileServer->setBurstFaults(0, 0, testCase->packetCount / 2);
+    _burstDownload(testCase, _ackTimerTimeoutMsecs * 2);
+    
+    QCOMPARE(throughputSpy.count(), 1);
+    QCOMPARE(throughputSpy[0][1].toInt(), 0);
+    QCOMPARE(resetSpy.count(), 1);
+}
+
+/// @brief Creates a local file to upload, filled with a repeating 0x00, 0x01 .. 0xFF sequence
+QFileInfo FileManagerTest::_createUploadFile(int length)
+{
+    QByteArray bytes(length, 0);
+    for (int i=0; i<length; i++) {
+        bytes[i] = (char)(i & 0xFF);
+    }
+    
+    QString filePath = QDir::temp().absoluteFilePath("upload.qgc");
+    QFile file(filePath);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file.write(bytes);
+        file.close();
+    }
+    return QFileInfo(filePath);
+}
+
+/// @brief Uploads the specified file and validates what the server received
+void FileManagerTest::_upload(const QFileInfo& uploadFile, int msecsTimeout)
+{
+    _fileManager->uploadPath("/fs/microsd", uploadFile);
+    QVERIFY(_multiSpy->waitForSignalByIndex(commandCompleteSignalIndex, msecsTimeout));
+    QCOMPARE(_multiSpy->checkNoSignalByMask(commandErrorSignalMask), true);
+    
+    QFile file(uploadFile.absoluteFilePath());
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(_fileServer->writtenPath(), QString("/fs/microsd/%1").arg(uploadFile.fileName()));
+    QVERIFY(_fileServer->writtenFile() == file.readAll());
+}
+
+void FileManagerTest::_pipelinedUploadTest(void)
+{
+    Q_ASSERT(_fileManager);
+    Q_ASSERT(_multiSpy);
+    Q_ASSERT(_multiSpy->checkNoSignals() == true);
+    
+    const int cResponseDelayMsecs = 20;
+    const int cChunkBytes = sizeof(((mavlink_file_transfer_protocol_t*)0)->payload) - 12;
+    
+    QSignalSpy throughputSpy(_fileManager, SIGNAL(uploadThroughput(double, int)));
+    _fileServer->setResponseDelay(cResponseDelayMsecs);
+    _upload(_createUploadFile(100 * cChunkBytes + 17), _ackTimerTimeoutMsecs * 2);
+    
+    // With one write in flight throughput is capped at one chunk per round trip. The window should do a lot better.
+    double stopAndWaitBytesPerSecond = cChunkBytes * 1000.0 / cResponseDelayMsecs;
+    QCOMPARE(throughputSpy.count(), 1);
+    QVERIFY(throughputSpy[0][0].toDouble() > stopAndWaitBytesPerSecond * 2);
+    QCOMPARE(throughputSpy[0][1].toInt(), 0);
+}
+
+void FileManagerTest::_pipelinedUploadLossTest(void)
+{
+    Q_ASSERT(_fileManager);
+    Q_ASSERT(_multiSpy);
+    Q_ASSERT(_multiSpy->checkNoSignals() == true);
+    
+    QSignalSpy throughputSpy(_fileManager, SIGNAL(uploadThroughput(double, int)));
+    
+    // Lost writes are sent again and the file still verifies
+    _fileServer->setResponseDelay(10);
+    _fileServer->setWriteLoss(10);
+    _upload(_createUploadFile(20000), _ackTimerTimeoutMsecs * 4);
+    
+    QCOMPARE(throughputSpy.count(), 1);
+    QVERIFY(throughputSpy[0][1].toInt() > 0);
+}
+
 #if 0
 // Trying to write test code for read and burst mode download as well as implement support in MockLineFileServer reached a point
 // of diminishing returns where the test code and mock server were generating more bugs in themselves than finding problems.
@@ -369,22 +533,4 @@ void FileManagerTest::_streamDownloadTest(void)
     }
 }
 
-void FileManagerTest::_validateFileContents(const QString& filePath, uint8_t length)
-{
-	QFile file(filePath);
-	
-	// Make sure file size is correct
-	QCOMPARE(file.size(), (qint64)length);
-	
-	// Read data
-	QVERIFY(file.open(QIODevice::ReadOnly));
-	QByteArray bytes = file.readAll();
-	file.close();
-	
-	// Validate file contents:
-	//      Repeating 0x00, 0x01 .. 0xFF until file is full
-	for (uint8_t i=0; i<bytes.length(); i++) {
-		QCOMPARE((uint8_t)bytes[i], (uint8_t)(i & 0xFF));
-	}
-}
 #endif
@@ -40,12 +40,20 @@ private slots:
     void _ackTest(void);
     void _noAckTest(void);
     void _listTest(void);
+    void _burstDownloadTest(void);
+    void _burstDownloadLossTest(void);
+    void _burstDownloadResumeTest(void);
+    void _pipelinedUploadTest(void);
+    void _pipelinedUploadLossTest(void);
 	
     // Connected to FileManager listEntry signal
     void listEntry(const QString& entry);
     
 private:
-    void _validateFileContents(const QString& filePath, uint8_t length);
+    void _validateFileContents(const QString& filePath, uint32_t length);
+    void _burstDownload(const MockLinkFileServer::FileTestCase* testCase, int msecsTimeout);
+    QFileInfo _createUploadFile(int length);
+    void _upload(const QFileInfo& uploadFile, int msecsTimeout);
 
     enum {
         listEntrySignalIndex = 0,
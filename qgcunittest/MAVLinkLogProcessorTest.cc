@@ -0,0 +1,252 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#include "MAVLinkLogProcessorTest.h"
+#include "MAVLinkLogManager.h"
+#include "QGCApplication.h"
+
+
+MAVLinkLogProcessorTest::MAVLinkLogProcessorTest(void)
+{
+    
+}
+
+static void _appendMessage(QByteArray& log, char type, const QByteArray& payload)
+{
+    log.append((char)(payload.size() & 0xff));
+    log.append((char)(payload.size() >> 8));
+    log.append(type);
+    log.append(payload);
+}
+
+static QByteArray _uint64(quint64 value)
+{
+    return QByteArray((const char*)&value, sizeof(value));
+}
+
+/// Header, format and subscription followed by data messages 10 ms apart. Every 50th message is large enough to
+/// span several packets, every 20th is a logging message.
+QByteArray MAVLinkLogProcessorTest::_syntheticLog(int cDataMessages)
+{
+    QByteArray log("ULog\x01\x12\x35\x01", 8);
+    log.append(_uint64(0));
+    
+    _appendMessage(log, 'F', QByteArray("sensor:uint64_t timestamp;uint8_t[600] values;"));
+    _appendMessage(log, 'A', QByteArray("\x00\x00\x00sensor", 9));
+    
+    quint64 timestamp = 1000000;
+    for (int i = 0; i < cDataMessages; i++) {
+        timestamp += 10000;
+        
+        if (i % 20 == 10) {
+            _appendMessage(log, 'L', QByteArray(1, '6') + _uint64(timestamp) + QByteArray("status"));
+            continue;
+        }
+        
+        int cValues = i % 50 == 25 ? 600 : 8 + (i % 5) * 7;
+        QByteArray payload("\x00\x00", 2);
+        payload.append(_uint64(timestamp));
+        for (int j = 0; j < cValues; j++) {
+            payload.append((char)(i + j));
+        }
+        _appendMessage(log, 'D', payload);
+    }
+    
+    return log;
+}
+
+QByteArray MAVLinkLogProcessorTest::_loadLog(void)
+{
+    QByteArray replayPath = qgetenv("QGC_ULOG_REPLAY_FILE");
+    if (!replayPath.isEmpty()) {
+        QFile file(QString::fromLocal8Bit(replayPath));
+        if (file.open(QIODevice::ReadOnly)) {
+            return file.readAll();
+        }
+        qWarning() << "Unable to open ULog replay file" << replayPath;
+    }
+    return _syntheticLog(2000);
+}
+
+/// Start offsets of the header and every message
+QList<int> MAVLinkLogProcessorTest::_messageOffsets(const QByteArray& log)
+{
+    QList<int> offsets;
+    offsets << 0;
+    
+    const uint8_t* ptr = (const uint8_t*)log.constData();
+    int offset = 16;
+    while (offset + 3 <= log.size()) {
+        offsets << offset;
+        offset += ptr[offset] + (ptr[offset + 1] * 256) + 3;
+    }
+    
+    return offsets;
+}
+
+/// Splits the log into LOGGING_DATA packets, each with the offset of the first message starting in it
+QList<MAVLinkLogProcessorTest::Packet_t> MAVLinkLogProcessorTest::_packetize(const QByteArray& log)
+{
+    QList<Packet_t> packets;
+    QList<int> offsets = _messageOffsets(log);
+    
+    int nextOffset = 0;
+    for (int start = 0; start < log.size(); start += _cPacketBytes) {
+        Packet_t packet;
+        packet.sequence = (uint16_t)packets.count();
+        packet.data = log.mid(start, _cPacketBytes);
+        packet.firstMessage = 255;
+        while (nextOffset < offsets.count() && offsets[nextOffset] < start) {
+            nextOffset++;
+        }
+        if (nextOffset < offsets.count() && offsets[nextOffset] < start + _cPacketBytes) {
+            packet.firstMessage = offsets[nextOffset] - start;
+        }
+        packets.append(packet);
+    }
+    
+    return packets;
+}
+
+/// Feeds the packets through a processor and returns the file written
+///     @param dropped Indices of packets lost on the way
+///     @param duplicate Index of a packet delivered twice, -1 for none
+QByteArray MAVLinkLogProcessorTest::_replay(const QList<Packet_t>& packets, const QSet<int>& dropped, int duplicate)
+{
+    MAVLinkLogProcessor processor;
+    if (!processor.create(qgcApp()->toolbox()->mavlinkLogManager(), QDir::tempPath(), 1)) {
+        qWarning() << "Unable to create log file in" << QDir::tempPath();
+        return QByteArray();
+    }
+    
+    for (int i = 0; i < packets.count(); i++) {
+        if (dropped.contains(i)) {
+            continue;
+        }
+        processor.processStreamData(packets[i].sequence, packets[i].firstMessage, packets[i].data);
+        if (i == duplicate) {
+            processor.processStreamData(packets[i].sequence, packets[i].firstMessage, packets[i].data);
+        }
+    }
+    processor.close();
+    
+    QFile file(processor.fileName());
+    file.open(QIODevice::ReadOnly);
+    QByteArray bytes = file.readAll();
+    file.close();
+    file.remove();
+    delete processor.record();
+    
+    return bytes;
+}
+
+void MAVLinkLogProcessorTest::_testCleanStream(void)
+{
+    QByteArray log = _loadLog();
+    QList<Packet_t> packets = _packetize(log);
+    
+    // Without loss the file must come out byte for byte, duplicates are ignored
+    QByteArray written = _replay(packets, QSet<int>(), packets.count() / 2);
+    QCOMPARE(written.size(), log.size());
+    QVERIFY(written == log);
+}
+
+void MAVLinkLogProcessorTest::_testDropoutRecords(void)
+{
+    QByteArray log = _loadLog();
+    QList<Packet_t> packets = _packetize(log);
+    QList<int> offsets = _messageOffsets(log);
+    QVERIFY(packets.count() > 200);
+    
+    // Three gaps of different lengths
+    QSet<int> dropped;
+    dropped << 20 << 60 << 61 << 62 << 150 << 151 << 152 << 153 << 154 << 155 << 156;
+    const int cGaps = 3;
+    
+    QByteArray written = _replay(packets, dropped);
+    
+    // Messages expected in the output are the ones with none of their packets lost
+    QList<QByteArray> expected;
+    for (int i = 1; i < offsets.count(); i++) {
+        int start = offsets[i];
+        int end = i + 1 < offsets.count() ? offsets[i + 1] : log.size();
+        bool complete = true;
+        for (int packet = start / _cPacketBytes; packet <= (end - 1) / _cPacketBytes; packet++) {
+            complete &= !dropped.contains(packet);
+        }
+        if (complete) {
+            expected.append(log.mid(start, end - start));
+        }
+    }
+    
+    // Walk the output framing. It has to be intact to the last byte.
+    QCOMPARE(written.left(16), log.left(16));
+    const uint8_t* ptr = (const uint8_t*)written.constData();
+    QList<QByteArray> messages;
+    QList<int> dropouts;            // Index into messages of the message following each dropout
+    QList<int> dropoutMsecs;
+    int offset = 16;
+    while (offset < written.size()) {
+        QVERIFY(offset + 3 <= written.size());
+        int length = ptr[offset] + (ptr[offset + 1] * 256) + 3;
+        QVERIFY(offset + length <= written.size());
+        if (ptr[offset + 2] == 'O') {
+            QCOMPARE(length, 5);
+            dropouts.append(messages.count());
+            dropoutMsecs.append(ptr[offset + 3] + (ptr[offset + 4] * 256));
+        } else {
+            messages.append(written.mid(offset, length));
+        }
+        offset += length;
+    }
+    
+    QCOMPARE(messages.count(), expected.count());
+    QVERIFY(messages == expected);
+    
+    // Each dropout spans the time between the timestamps on either side of it
+    QCOMPARE(dropouts.count(), cGaps);
+    for (int i = 0; i < dropouts.count(); i++) {
+        quint64 before = 0, after = 0;
+        for (int j = dropouts[i] - 1; j >= 0 && !before; j--) {
+            const QByteArray& message = messages[j];
+            if (message[2] == 'D' || message[2] == 'L') {
+                memcpy(&before, message.constData() + (message[2] == 'D' ? 5 : 4), sizeof(before));
+            }
+        }
+        for (int j = dropouts[i]; j < messages.count() && !after; j++) {
+            const QByteArray& message = messages[j];
+            if (message[2] == 'D' || message[2] == 'L') {
+                memcpy(&after, message.constData() + (message[2] == 'D' ? 5 : 4), sizeof(after));
+            }
+        }
+        QVERIFY(before && after > before);
+        QCOMPARE(dropoutMsecs[i], (int)((after - before) / 1000));
+        QVERIFY(dropoutMsecs[i] > 0);
+    }
+}
+
+void MAVLinkLogProcessorTest::_benchmarkStream(void)
+{
+    QByteArray log = _syntheticLog(200000);
+    QList<Packet_t> packets = _packetize(log);
+    
+    MAVLinkLogProcessor processor;
+    QVERIFY(processor.create(qgcApp()->toolbox()->mavlinkLogManager(), QDir::tempPath(), 1));
+    
+    foreach (const Packet_t& packet, packets) {
+        QVERIFY(processor.processStreamData(packet.sequence, packet.firstMessage, packet.data));
+    }
+    processor.close();
+    
+    QFile file(processor.fileName());
+    QCOMPARE(file.size(), (qint64)log.size());
+    file.remove();
+    delete processor.record();
+}
@@ -0,0 +1,50 @@
+/****************************************************************************
+ *
+ *   (c) 2009-2016 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+#ifndef MAVLinkLogProcessorTest_H
+#define MAVLinkLogProcessorTest_H
+
+#include "UnitTest.h"
+
+#include <QSet>
+
+/// Replays a ULog file through MAVLinkLogProcessor the way it arrives in LOGGING_DATA messages.
+///
+/// The log replayed is the one named by the QGC_ULOG_REPLAY_FILE environment variable if it is set,
+/// otherwise a generated one with data messages 10 ms apart and a few messages spanning several packets.
+class MAVLinkLogProcessorTest : public UnitTest
+{
+    Q_OBJECT
+    
+public:
+    MAVLinkLogProcessorTest(void);
+    
+private slots:
+    void _testCleanStream(void);
+    void _testDropoutRecords(void);
+    void _benchmarkStream(void);
+    
+private:
+    typedef struct {
+        uint16_t    sequence;
+        uint8_t     firstMessage;
+        QByteArray  data;
+    } Packet_t;
+    
+    QByteArray      _syntheticLog(int cDataMessages);
+    QByteArray      _loadLog(void);
+    QList<int>      _messageOffsets(const QByteArray& log);
+    QList<Packet_t> _packetize(const QByteArray& log);
+    QByteArray      _replay(const QList<Packet_t>& packets, const QSet<int>& dropped, int duplicate = -1);
+    
+    static const int _cPacketBytes = 249;   ///< Size of LOGGING_DATA data
+};
+
+#endif
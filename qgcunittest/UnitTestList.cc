@@ -22,7 +22,15 @@
 #include "SimpleMissionItemTest.h"
 #include "ComplexMissionItemTest.h"
 #include "MissionControllerTest.h"
+#include "ExcelMissionImporterTest.h"
+#include "MissionFileLoaderTest.h"
 #include "MissionManagerTest.h"
+#include "BootloaderTest.h"
+#include "FirmwareImageTest.h"
+#include "FlashStationTest.h"
+#include "JoystickTest.h"
+#include "Tx1TargetOverlayTest.h"
+#include "GPSFramerTest.h"
 #include "RadioConfigTest.h"
 #include "MavlinkLogTest.h"
 #include "MainWindowTest.h"
@@ -31,6 +39,14 @@
 #include "ParameterManagerTest.h"
 #include "MissionCommandTreeTest.h"
 #include "LogDownloadTest.h"
+#include "MAVLinkLogProcessorTest.h"
+#include "MotionDetectorTest.h"
+#include "StillImageCaptureTest.h"
+#include "PlateRecognizerTest.h"
+#if defined(QGC_GST_STREAMING)
+#include "YuvConverterTest.h"
+#include "SegmentedRecorderTest.h"
+#endif
 
 UT_REGISTER_TEST(FactSystemTestGeneric)
 UT_REGISTER_TEST(FactSystemTestPX4)
@@ -44,12 +60,28 @@ UT_REGISTER_TEST(MissionItemTest)
 UT_REGISTER_TEST(SimpleMissionItemTest)
 UT_REGISTER_TEST(ComplexMissionItemTest)
 UT_REGISTER_TEST(MissionControllerTest)
+UT_REGISTER_TEST(ExcelMissionImporterTest)
+UT_REGISTER_TEST(MissionFileLoaderTest)
 UT_REGISTER_TEST(MissionManagerTest)
+UT_REGISTER_TEST(BootloaderTest)
+UT_REGISTER_TEST(FirmwareImageTest)
+UT_REGISTER_TEST(FlashStationTest)
+UT_REGISTER_TEST(JoystickTest)
+UT_REGISTER_TEST(Tx1TargetOverlayTest)
+UT_REGISTER_TEST(GPSFramerTest)
 UT_REGISTER_TEST(RadioConfigTest)
 UT_REGISTER_TEST(TCPLinkTest)
 UT_REGISTER_TEST(ParameterManagerTest)
 UT_REGISTER_TEST(MissionCommandTreeTest)
 UT_REGISTER_TEST(LogDownloadTest)
+UT_REGISTER_TEST(MAVLinkLogProcessorTest)
+UT_REGISTER_TEST(MotionDetectorTest)
+UT_REGISTER_TEST(StillImageCaptureTest)
+UT_REGISTER_TEST(PlateRecognizerTest)
+#if defined(QGC_GST_STREAMING)
+UT_REGISTER_TEST(YuvConverterTest)
+UT_REGISTER_TEST(SegmentedRecorderTest)
+#endif
 
 // List of unit test which are currently disabled.
 // If disabling a new test, include reason in comment.
@@ -21,6 +21,7 @@
 #include <QFile>
 #include <QDir>
 #include <string>
+#include <algorithm>
 
 QGC_LOGGING_CATEGORY(FileManagerLog, "FileManagerLog")
 
@@ -32,6 +33,10 @@ FileManager::FileManager(QObject* parent, Vehicle* vehicle)
     , _dedicatedLink(NULL)
     , _lastOutgoingSeqNumber(0)
     , _activeSession(0)
+    , _downloadBytesReceived(0)
+    , _downloadBurstDone(false)
+    , _downloadSizeConfirmed(false)
+    , _downloadRepairRequests(0)
     //, _systemIdQGC(0)
     , _systemIdQGC(qgcApp()->toolbox()->mavlinkProtocol()->getSystemId())
     , _resetStatus(false)
@@ -62,21 +67,133 @@ void FileManager::_openAckResponse(Request* openAck)
     Q_ASSERT(openAck->hdr.size == sizeof(uint32_t));
     _downloadFileSize = openAck->openFileLength;
     
-    // Start the sequence of read commands
+    // Start the sequence of read commands. Data is placed by offset so the buffer is sized up front.
+
+    _downloadOffset = 0;
+    _readFileAccumulator.fill(0, _downloadFileSize);
+    _downloadRanges.clear();
+    _downloadBytesReceived = 0;
+    _downloadBurstDone = false;
+    _downloadSizeConfirmed = false;
+    _downloadRepairRequests = 0;
+    _downloadTimer.start();
+
+    _requestNextDownloadBlock();
+}
+
+/// Records a received [start, end) range, merging it with any adjacent or overlapping ranges.
+///     @return Number of bytes in the range which had not been received before
+uint32_t FileManager::_addDownloadRange(uint32_t start, uint32_t end)
+{
+    uint32_t newBytes = end - start;
+
+    // Merge with the range starting at or before us if it reaches us
+    QMap<uint32_t, uint32_t>::iterator it = _downloadRanges.upperBound(start);
+    if (it != _downloadRanges.begin()) {
+        --it;
+        if (it.value() >= start) {
+            if (it.value() >= end) {
+                // Duplicate
+                return 0;
+            }
+            newBytes -= it.value() - start;
+            start = it.key();
+            it = _downloadRanges.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Swallow all following ranges we reach
+    while (it != _downloadRanges.end() && it.key() <= end) {
+        newBytes -= qMin(it.value(), end) - it.key();
+        end = qMax(end, it.value());
+        it = _downloadRanges.erase(it);
+    }
+
+    _downloadRanges.insert(start, end);
+
+    return newBytes;
+}
+
+/// @return Offset just past the highest byte received so far
+uint32_t FileManager::_downloadHighWater(void) const
+{
+    return _downloadRanges.isEmpty() ? 0 : _downloadRanges.last();
+}
+
+/// Determines where the file being downloaded ends.
+///     @param[out] end Length of the file
+/// @return false: end of file is not known yet
+bool FileManager::_downloadEnd(uint32_t* end) const
+{
+    if (_downloadSizeConfirmed) {
+        *end = _downloadHighWater();
+        return true;
+    }
+    if (_downloadFileSize != 0) {
+        *end = qMax(_downloadFileSize, _downloadHighWater());
+        return true;
+    }
+    return false;
+}
+
+/// Requests the first range of the file which has not been received yet, or closes the session if there is none.
+/// In burst mode the tail of the file is streamed, holes behind it are read one packet at a time.
+void FileManager::_requestNextDownloadBlock(void)
+{
+    Q_ASSERT(_currentOperation == kCORead || _currentOperation == kCOBurst);
 
-    _downloadOffset = 0;            // Start reading at beginning of file
-    _readFileAccumulator.clear();   // Start with an empty file
+    // Ranges are merged, so the first gap starts where the range at offset 0 ends
+    uint32_t gapStart = 0;
+    if (!_downloadRanges.isEmpty() && _downloadRanges.firstKey() == 0) {
+        gapStart = _downloadRanges.first();
+    }
+
+    uint32_t end;
+    if (_downloadEnd(&end) && gapStart >= end) {
+        _readFileAccumulator.resize(end);
+        _closeDownloadSession(true /* success */);
+        return;
+    }
 
     Request request;
     request.hdr.session = _activeSession;
-	Q_ASSERT(_currentOperation == kCORead || _currentOperation == kCOBurst);
-	request.hdr.opcode = _currentOperation == kCORead ? kCmdReadFile : kCmdBurstReadFile;
-    request.hdr.offset = _downloadOffset;
+    request.hdr.offset = gapStart;
     request.hdr.size = sizeof(request.data);
+    if (_currentOperation == kCOBurst && !_downloadBurstDone && gapStart >= _downloadHighWater()) {
+        request.hdr.opcode = kCmdBurstReadFile;
+    } else {
+        request.hdr.opcode = kCmdReadFile;
+        if (_currentOperation == kCOBurst) {
+            _downloadRepairRequests++;
+        }
+    }
 
+    qCDebug(FileManagerLog) << QString("_requestNextDownloadBlock: opcode(%1) offset(%2)").arg(request.hdr.opcode).arg(gapStart);
+
+    _downloadOffset = gapStart;
     _sendRequest(&request);
 }
 
+/// Handles the EOF Nak which ends a burst or answers a read past the end of the file.
+///     @param burst true: Nak for a burst read, false: Nak for a read
+void FileManager::_downloadEndOfFile(bool burst)
+{
+    if (burst) {
+        // Anything lost on the way is now read individually
+        _downloadBurstDone = true;
+    } else if (_downloadOffset >= _downloadHighWater()) {
+        _downloadSizeConfirmed = true;
+    } else {
+        _closeDownloadSession(false /* failure */);
+        _emitErrorMessage(tr("Download: Unexpected end of file at offset (%1)").arg(_downloadOffset));
+        return;
+    }
+
+    _requestNextDownloadBlock();
+}
+
 /// Closes out a download session by writing the file and doing cleanup.
 ///     @param success true: successful download completion, false: error during download
 void FileManager::_closeDownloadSession(bool success)
@@ -86,6 +203,11 @@ void FileManager::_closeDownloadSession(bool success)
     _currentOperation = kCOIdle;
     
     if (success) {
+        qint64 elapsed = qMax((qint64)1, _downloadTimer.elapsed());
+        double bytesPerSecond = _readFileAccumulator.length() * 1000.0 / elapsed;
+        qCDebug(FileManagerLog) << QString("_closeDownloadSession: %1 bytes in %2 msecs, %3 bytes/sec, %4 repair requests")
+                                   .arg(_readFileAccumulator.length()).arg(elapsed).arg(bytesPerSecond, 0, 'f', 0).arg(_downloadRepairRequests);
+
         QString downloadFilePath = _readFileDownloadDir.absoluteFilePath(_readFileDownloadFilename);
 
         QFile file(downloadFilePath);
@@ -102,10 +224,12 @@ void FileManager::_closeDownloadSession(bool success)
         }
         file.close();
 
+        emit downloadThroughput(bytesPerSecond, _downloadRepairRequests);
         emit commandComplete();
     }
     
     _readFileAccumulator.clear();
+    _downloadRanges.clear();
     
     // Close the open session
     _sendResetCommand();
@@ -135,7 +259,8 @@ void FileManager::_closeUploadSession(bool success)
     _sendResetCommand();
 }
 
-/// Respond to the Ack associated with the Read or Stream commands.
+/// Respond to the Ack associated with the Read or Stream commands. Acks may arrive out of order or not at
+/// all, the data is placed by offset and whatever is still missing is requested again later.
 ///		@param readFile: true: read file, false: stream file
 void FileManager::_downloadAckResponse(Request* readAck, bool readFile)
 {
@@ -145,33 +270,34 @@ void FileManager::_downloadAckResponse(Request* readAck, bool readFile)
         return;
     }
 
-    if (readAck->hdr.offset != _downloadOffset) {
-        _closeDownloadSession(false /* failure */);
-        _emitErrorMessage(tr("Download: Offset returned (%1) differs from offset requested/expected (%2)").arg(readAck->hdr.offset).arg(_downloadOffset));
-        return;
-    }
-    
     qCDebug(FileManagerLog) << QString("_downloadAckResponse: offset(%1) size(%2) burstComplete(%3)").arg(readAck->hdr.offset).arg(readAck->hdr.size).arg(readAck->hdr.burstComplete);
 
-	_downloadOffset += readAck->hdr.size;
-    _readFileAccumulator.append((const char*)readAck->data, readAck->hdr.size);
-    
-    if (_downloadFileSize != 0) {
-        emit commandProgress(100 * ((float)_readFileAccumulator.length() / (float)_downloadFileSize));
+    uint32_t newBytes = 0;
+    if (readAck->hdr.size != 0) {
+        uint32_t end = readAck->hdr.offset + readAck->hdr.size;
+        if (_downloadFileSize != 0 && end > _downloadFileSize) {
+            _closeDownloadSession(false /* failure */);
+            _emitErrorMessage(tr("Download: Data returned at offset (%1) is past the end of the file (%2)").arg(readAck->hdr.offset).arg(_downloadFileSize));
+            return;
+        }
+        if (end >(uint32_t)_readFileAccumulator.length()) {
+            _readFileAccumulator.resize(end);
+        }
+        memcpy(_readFileAccumulator.data() + readAck->hdr.offset, readAck->data, readAck->hdr.size);
+        newBytes = _addDownloadRange(readAck->hdr.offset, end);
+        _downloadBytesReceived += newBytes;
     }
 
-    if (readFile || readAck->hdr.burstComplete) {
-        // Possibly still more data to read, send next read request
-
-        Request request;
-        request.hdr.session = _activeSession;
-        request.hdr.opcode = readFile ? kCmdReadFile : kCmdBurstReadFile;
-        request.hdr.offset = _downloadOffset;
-        request.hdr.size = 0;
+    if (_downloadFileSize != 0) {
+        emit commandProgress(100 * ((float)_downloadBytesReceived / (float)_downloadFileSize));
+    }
 
-        _sendRequest(&request);
-    } else if (!readFile) {
-        // Streaming, so next ack should come automatically
+    if ((readFile && newBytes != 0) || readAck->hdr.burstComplete) {
+        // Possibly still more data to read, send next request
+        _requestNextDownloadBlock();
+    } else {
+        // Streaming, so next ack should come automatically. A duplicated read ack also ends up here, the
+        // ack for the outstanding request is still on its way.
         _setupAckTimeout();
     }
 }
@@ -245,34 +371,41 @@ void FileManager::_createAckResponse(Request* createAck)
 
     // Start the sequence of write commands from the beginning of the file
 
-    _writeOffset = 0;
-    _writeSize = 0;
+    _writeOutstanding.clear();
+    _writeResend.clear();
+    _writeNextOffset = 0;
+    _writeAckedBytes = 0;
+    _writeSendIndex = 0;
+    _writeWindow = _writeWindowInitial;
+    _writeSlowStart = true;
+    _writeBaseRttMsecs = -1;
+    _writeSmoothedRttMsecs = 0;
+    _writeRetransmits = 0;
+    _uploadTimer.start();
     
-    _writeFileDatablock();
+    _fillWriteWindow();
 }
 
-/// @brief Respond to the Ack associated with the write command.
+/// @brief Respond to the Ack associated with the write command. Acks may come back in any order.
 void FileManager::_writeAckResponse(Request* writeAck)
 {
-    if (_writeFileSize != 0) {
-        emit commandProgress(100 * ((float)(_writeOffset+_writeSize) / (float)_writeFileSize));
-        emit uploadProgram((qint64)(_writeOffset+_writeSize), (qint64)_writeFileSize);
-    }
-    if(_writeOffset + _writeSize >= _writeFileSize){
-        _closeUploadSession(true /* success */);
-    }
-
     if (writeAck->hdr.session != _activeSession) {
         _closeUploadSession(false /* failure */);
         _emitErrorMessage(tr("Write: Incorrect session returned"));
         return;
     }
 
-    if (writeAck->hdr.offset != _writeOffset) {
-        _closeUploadSession(false /* failure */);
-        _emitErrorMessage(tr("Write: Offset returned (%1) differs from offset requested (%2)").arg(writeAck->hdr.offset).arg(_writeOffset));
+    uint32_t offset = writeAck->hdr.offset;
+    bool inFlight = _writeOutstanding.contains(offset);
+    WriteChunk chunk;
+    if (inFlight) {
+        chunk = _writeOutstanding.take(offset);
+    } else if (!_writeResend.removeOne(offset)) {
+        // Ack for a write which was sent again needlessly, the first ack was already counted
+        _fillWriteWindow();
         return;
     }
+    // else: presumed lost but only late, no need to send it again
 
     if (writeAck->hdr.size != sizeof(uint32_t)) {
         _closeUploadSession(false /* failure */);
@@ -280,43 +413,164 @@ void FileManager::_writeAckResponse(Request* writeAck)
         return;
     }
 
-
-    if( writeAck->writeFileLength !=_writeSize) {
+    if (writeAck->writeFileLength != _writeChunkSize(offset)) {
         _closeUploadSession(false /* failure */);
-        _emitErrorMessage(tr("Write: Size returned (%1) differs from size requested (%2)").arg(writeAck->writeFileLength).arg(_writeSize));
+        _emitErrorMessage(tr("Write: Size returned (%1) differs from size requested (%2)").arg(writeAck->writeFileLength).arg(_writeChunkSize(offset)));
         return;
     }
 
-    _writeFileDatablock();
+    _writeAckedBytes += writeAck->writeFileLength;
+
+    bool lost = false;
+    if (inFlight) {
+        if (!chunk.retransmitted) {
+            _updateWriteWindow(_uploadTimer.elapsed() - chunk.sentMsecs);
+        }
+
+        // Writes sent well before this one which are still waiting for an ack were most likely lost
+        QMap<uint32_t, WriteChunk>::iterator it = _writeOutstanding.begin();
+        while (it != _writeOutstanding.end()) {
+            if (chunk.sendIndex >= it.value().sendIndex + _writeLostAfter) {
+                _writeResend.append(it.key());
+                it = _writeOutstanding.erase(it);
+                lost = true;
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (lost) {
+        std::sort(_writeResend.begin(), _writeResend.end());
+        _writeWindow = qMax(1.0, _writeWindow * 0.75);
+        _writeSlowStart = false;
+    }
+
+    if (_writeFileSize != 0) {
+        emit commandProgress(100 * ((float)_writeAckedBytes / (float)_writeFileSize));
+        emit uploadProgram((qint64)_writeAckedBytes, (qint64)_writeFileSize);
+    }
+
+    _fillWriteWindow();
 }
 
-/// @brief Send next write file data block.
-void FileManager::_writeFileDatablock(void)
+/// @brief Size of the write chunk starting at the specified offset
+uint32_t FileManager::_writeChunkSize(uint32_t offset) const
 {
-    if (_writeOffset + _writeSize >= _writeFileSize){
-        _closeUploadSession(true /* success */);
+    return qMin((uint32_t)sizeof(((Request*)0)->data), _writeFileSize - offset);
+}
+
+/// @brief Sends writes until the window is full. Lost writes go first. Once everything is acked the uploaded
+/// file is verified.
+void FileManager::_fillWriteWindow(void)
+{
+    while (_writeOutstanding.count() < (int)_writeWindow) {
+        if (!_writeResend.isEmpty()) {
+            _writeRetransmits++;
+            _sendWriteChunk(_writeResend.takeFirst(), true /* retransmit */);
+        } else if (_writeNextOffset < _writeFileSize) {
+            uint32_t offset = _writeNextOffset;
+            _writeNextOffset += _writeChunkSize(offset);
+            _sendWriteChunk(offset, false /* retransmit */);
+        } else {
+            break;
+        }
+    }
+
+    if (_writeOutstanding.isEmpty()) {
+        _writeElapsedMsecs = _uploadTimer.elapsed();
+        _sendCalcCRCCommand();
         return;
     }
 
-    _writeOffset += _writeSize;
+    if (!_ackTimer.isActive() && !_setupAckTimeout()) {
+        _closeUploadSession(false /* failure */);
+    }
+}
 
+/// @brief Sends the write for the chunk at the specified offset without waiting for its ack.
+///     @param retransmit true: chunk was sent before
+void FileManager::_sendWriteChunk(uint32_t offset, bool retransmit)
+{
     Request request;
     request.hdr.session = _activeSession;
     request.hdr.opcode = kCmdWriteFile;
-    request.hdr.offset = _writeOffset;
+    request.hdr.offset = offset;
+    request.hdr.size = _writeChunkSize(offset);
 
-    if(_writeFileSize -_writeOffset > sizeof(request.data) )
-        _writeSize = sizeof(request.data);
-    else
-        _writeSize = _writeFileSize - _writeOffset;
+    memcpy(request.data, &_writeFileAccumulator.data()[offset], request.hdr.size);
+
+    WriteChunk chunk;
+    chunk.sentMsecs = _uploadTimer.elapsed();
+    chunk.sendIndex = _writeSendIndex++;
+    chunk.retransmitted = retransmit;
+    _writeOutstanding[offset] = chunk;
 
-    request.hdr.size = _writeSize;
+    _sendRequestMessage(&request);
+}
 
-    memcpy(request.data, &_writeFileAccumulator.data()[_writeOffset], _writeSize);
+/// @brief Adapts the number of writes in flight to the ack latency. Writes queued up in the link show up as latency
+/// above the lowest one seen, the window grows while that queue is short and backs off once it builds.
+///     @param rttMsecs Latency of the write just acked
+void FileManager::_updateWriteWindow(qint64 rttMsecs)
+{
+    double rtt = qMax((qint64)1, rttMsecs);
+    if (_writeBaseRttMsecs < 0 || rtt < _writeBaseRttMsecs) {
+        _writeBaseRttMsecs = rtt;
+    }
+    _writeSmoothedRttMsecs = _writeSmoothedRttMsecs == 0 ? rtt : _writeSmoothedRttMsecs * 0.875 + rtt * 0.125;
 
+    // Estimated number of writes waiting in queues rather than on the wire
+    double queued = _writeWindow * (1.0 - _writeBaseRttMsecs / _writeSmoothedRttMsecs);
+
+    if (queued < 1.0) {
+        _writeWindow += _writeSlowStart ? 1.0 : 1.0 / _writeWindow;
+    } else {
+        _writeSlowStart = false;
+        if (queued > 3.0) {
+            _writeWindow -= 1.0 / _writeWindow;
+        }
+    }
+    _writeWindow = qBound(1.0, _writeWindow, (double)_writeWindowMax);
+}
+
+/// @brief Asks the server for the CRC32 of the uploaded file
+void FileManager::_sendCalcCRCCommand(void)
+{
+    _currentOperation = kCOCalcCRC;
+
+    Request request;
+    request.hdr.session = 0;
+    request.hdr.opcode = kCmdCalcFileCRC32;
+    request.hdr.offset = 0;
+    request.hdr.size = 0;
+    _fillRequestWithString(&request, _toPath + "/" + _uploadFile.fileName());
     _sendRequest(&request);
 }
 
+/// @brief Respond to the Ack associated with the CalcFileCRC32 command by comparing against the local file.
+void FileManager::_calcCRCAckResponse(Request* crcAck)
+{
+    if (crcAck->hdr.size != sizeof(uint32_t)) {
+        _closeUploadSession(false /* failure */);
+        _emitErrorMessage(tr("Upload: Returned invalid size of CRC32 data"));
+        return;
+    }
+
+    uint32_t localCRC = QGC::crc32((const quint8*)_writeFileAccumulator.constData(), _writeFileSize, 0);
+    if (crcAck->crc32 != localCRC) {
+        _closeUploadSession(false /* failure */);
+        _emitErrorMessage(tr("Upload: CRC32 of uploaded file (%1) differs from local file (%2)").arg(crcAck->crc32, 8, 16, QChar('0')).arg(localCRC, 8, 16, QChar('0')));
+        return;
+    }
+
+    double bytesPerSecond = _writeFileSize * 1000.0 / qMax((qint64)1, _writeElapsedMsecs);
+    qCDebug(FileManagerLog) << QString("_calcCRCAckResponse: %1 bytes verified, %2 bytes/sec, %3 retransmits")
+                               .arg(_writeFileSize).arg(bytesPerSecond, 0, 'f', 0).arg(_writeRetransmits);
+
+    emit uploadThroughput(bytesPerSecond, _writeRetransmits);
+    _closeUploadSession(true /* success */);
+}
+
 void FileManager::receiveMessage(mavlink_message_t message)
 {
     // receiveMessage is signalled will all mavlink messages so we need to filter everything else out but ours.
@@ -336,6 +590,21 @@ void FileManager::receiveMessage(mavlink_message_t message)
     }
     
     Request* request = (Request*)&data.payload[0];
+
+    bool downloading = _currentOperation == kCORead || _currentOperation == kCOBurst;
+    bool downloadResponse = request->hdr.req_opcode == kCmdReadFile || request->hdr.req_opcode == kCmdBurstReadFile;
+    if (downloadResponse && !downloading) {
+        // Late or duplicated packet from a download which has already finished
+        qCDebug(FileManagerLog) << "Ignoring stale download response offset:" << request->hdr.offset;
+        return;
+    }
+    bool writeResponse = request->hdr.req_opcode == kCmdWriteFile;
+    if (writeResponse && _currentOperation != kCOWrite) {
+        // Ack for a write sent again needlessly, arriving after all writes were acked
+        qCDebug(FileManagerLog) << "Ignoring stale write response offset:" << request->hdr.offset;
+        return;
+    }
+    bool unorderedResponse = downloadResponse || writeResponse;
     
     _clearAckTimeout();
     
@@ -343,9 +612,10 @@ void FileManager::receiveMessage(mavlink_message_t message)
 	
     uint16_t incomingSeqNumber = request->hdr.seqNumber;
     
-    // Make sure we have a good sequence number
+    // Make sure we have a good sequence number. Download and write responses are matched by offset instead, so
+    // lost or reordered packets and several writes in flight don't fail the transfer.
     uint16_t expectedSeqNumber = _lastOutgoingSeqNumber + 1;
-    if (incomingSeqNumber != expectedSeqNumber) {
+    if (incomingSeqNumber != expectedSeqNumber && !unorderedResponse) {
         switch (_currentOperation) {
             case kCOBurst:
             case kCORead:
@@ -353,6 +623,7 @@ void FileManager::receiveMessage(mavlink_message_t message)
                 break;
             
             case kCOWrite:
+            case kCOCalcCRC:
                 _closeUploadSession(false /* failure */);
                 break;
                 
@@ -374,8 +645,10 @@ void FileManager::receiveMessage(mavlink_message_t message)
         return;
     }
     
-    // Move past the incoming sequence number for next request
-    _lastOutgoingSeqNumber = incomingSeqNumber;
+    // Move past the incoming sequence number for next request, never backwards for a reordered packet
+    if (!unorderedResponse || (int16_t)(incomingSeqNumber - _lastOutgoingSeqNumber) > 0) {
+        _lastOutgoingSeqNumber = incomingSeqNumber;
+    }
 
     if (request->hdr.opcode == kRspAck) {
         switch (request->hdr.req_opcode) {
@@ -403,6 +676,10 @@ void FileManager::receiveMessage(mavlink_message_t message)
             case kCmdWriteFile:
                 _writeAckResponse(request);
                 break;
+
+            case kCmdCalcFileCRC32:
+                _calcCRCAckResponse(request);
+                break;
                 
         case kCmdSearchVersion:
             _currentOperation = kCOIdle;
@@ -456,6 +733,20 @@ void FileManager::receiveMessage(mavlink_message_t message)
 
         // Nak's normally have 1 byte of data for error code, except for kErrFailErrno which has additional byte for errno
         Q_ASSERT((errorCode == kErrFailErrno && request->hdr.size == 2) || request->hdr.size == 1);
+
+        if (downloadResponse && errorCode == kErrEOF) {
+            // This is not an error, just the end of the download loop. There may still be gaps to fill.
+            _downloadEndOfFile(request->hdr.req_opcode == kCmdBurstReadFile);
+            return;
+        }
+
+        if (request->hdr.req_opcode == kCmdCalcFileCRC32 && _currentOperation == kCOCalcCRC && errorCode == kErrUnknownCommand) {
+            // Older servers can't calculate checksums, every write was acked so take it as is
+            qCDebug(FileManagerLog) << "Server does not support CRC32, upload not verified";
+            emit uploadThroughput(_writeFileSize * 1000.0 / qMax((qint64)1, _writeElapsedMsecs), _writeRetransmits);
+            _closeUploadSession(true /* success */);
+            return;
+        }
         
         _currentOperation = kCOIdle;
 
@@ -463,10 +754,6 @@ void FileManager::receiveMessage(mavlink_message_t message)
             // This is not an error, just the end of the list loop
             emit commandComplete();
             return;
-        } else if ((request->hdr.req_opcode == kCmdReadFile || request->hdr.req_opcode == kCmdBurstReadFile) && errorCode == kErrEOF) {
-            // This is not an error, just the end of the download loop
-            _closeDownloadSession(true /* success */);
-            return;
         } else if (request->hdr.req_opcode == kCmdCreateFile) {
             _currentOperation = kCOCreate;
             _sendResetCommand();
@@ -477,8 +764,8 @@ void FileManager::receiveMessage(mavlink_message_t message)
             if (request->hdr.req_opcode == kCmdReadFile || request->hdr.req_opcode == kCmdBurstReadFile) {
                 // Nak error during download loop, download failed
                 _closeDownloadSession(false /* failure */);
-            } else if (request->hdr.req_opcode == kCmdWriteFile) {
-                // Nak error during upload loop, upload failed
+            } else if (request->hdr.req_opcode == kCmdWriteFile || request->hdr.req_opcode == kCmdCalcFileCRC32) {
+                // Nak error during upload loop or verification, upload failed
                 _closeUploadSession(false /* failure */);
             }
             if(kErrUnknownCommand == request->data[0]){
@@ -764,7 +1051,6 @@ void FileManager::_ackTimeout(void)
     // to error message signal by sending another command, which will fail if state is not back
     // to idle. FileView UI works this way with the List command.
     _ackTimes++;
-    Request requestRead, requestWrite;
     qDebug() << "_currentOperation: " << _currentOperation << " : "<< _resetStatus;
     if(_resetStatus) {
         qDebug() << "_sendResetCommand timeout, now send it again";
@@ -777,12 +1063,9 @@ void FileManager::_ackTimeout(void)
         // _closeDownloadSession(false /* failure */);
         // _emitErrorMessage(tr("Timeout waiting for ack: Download failed"));
 
-        qDebug() << "FileManager::_ackTimeout sendRequest excuted";
-        requestRead.hdr.session = _activeSession;
-        requestRead.hdr.opcode = kCmdReadFile;
-        requestRead.hdr.offset = _downloadOffset;
-        requestRead.hdr.size = 0;
-        _sendRequest(&requestRead);
+        // Resume from the first range still missing, everything received so far is kept
+        qDebug() << "FileManager::_ackTimeout resuming download," << _downloadBytesReceived << "bytes received";
+        _requestNextDownloadBlock();
         break;
     case kCOList:
         qDebug() << "_acktimeout,now send listcommand again";
@@ -813,13 +1096,21 @@ void FileManager::_ackTimeout(void)
     case kCOWrite:
         //_closeUploadSession(false /* failure */);
         //_emitErrorMessage(tr("Timeout waiting for ack: Upload failed"));
-        qDebug() << "FileManager::_writeFileDatablock excuted _writeoffset: " << _writeOffset;
-        requestWrite.hdr.session = _activeSession;
-        requestWrite.hdr.opcode = kCmdWriteFile;
-        requestWrite.hdr.offset = _writeOffset;
-        requestWrite.hdr.size = _writeSize;
-        memcpy(requestWrite.data, &_writeFileAccumulator.data()[_writeOffset], _writeSize);
-        _sendRequest(&requestWrite);
+
+        // Everything in flight is presumed lost, back off and send it again
+        qDebug() << "FileManager::_ackTimeout resending" << _writeOutstanding.count() << "writes";
+        foreach (uint32_t offset, _writeOutstanding.keys()) {
+            _writeResend.append(offset);
+        }
+        _writeOutstanding.clear();
+        std::sort(_writeResend.begin(), _writeResend.end());
+        _writeWindow = qMax(1.0, _writeWindow / 2);
+        _writeSlowStart = false;
+        _fillWriteWindow();
+        break;
+
+    case kCOCalcCRC:
+        _sendCalcCRCCommand();
         break;
 
     default:
@@ -922,6 +1213,13 @@ void FileManager::_sendRequest(Request* request)
        return ;
    }
 
+    _sendRequestMessage(request);
+}
+
+/// @brief Sends the specified Request out to the UAS without touching the ack timer. Used to put several
+/// requests in flight at once.
+void FileManager::_sendRequestMessage(Request* request)
+{
     mavlink_message_t message;
 
     
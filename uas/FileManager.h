@@ -14,6 +14,8 @@
 #include <QObject>
 #include <QDir>
 #include <QTimer>
+#include <QMap>
+#include <QElapsedTimer>
 
 #include "UASInterface.h"
 #include "QGCLoggingCategory.h"
@@ -46,7 +48,8 @@ public:
 	///     @param downloadDir Local directory to download file to
 	void downloadPath(const QString& from, const QDir& downloadDir);
 	
-	/// Stream downloads the specified file.
+	/// Stream downloads the specified file. Packets lost or reordered during the burst are tolerated, the
+	/// missing ranges are read again individually once the burst is over.
 	///     @param from File to download from UAS, fully qualified path
 	///     @param downloadDir Local directory to download file to
 	void streamPath(const QString& from, const QDir& downloadDir);
@@ -55,7 +58,8 @@ public:
 	///		@param dirPath Fully qualified path to list
 	void listDirectory(const QString& dirPath);
 	
-    /// Upload the specified file to the specified location
+    /// Upload the specified file to the specified location. Several writes are kept in flight, the number
+    /// adapts to the ack latency seen. The result is verified against the CRC32 the server calculates.
     void uploadPath(const QString& toPath, const QFileInfo& uploadFile);
 
     /// overload Upload the specified file to the specified location
@@ -86,6 +90,16 @@ signals:
     ///     @param value Amount of progress: 0.0 = none, 1.0 = complete
     void commandProgress(int value);
 
+    /// Signalled after a download completed successfully, before commandComplete
+    ///     @param bytesPerSecond Effective throughput from open to the last byte received
+    ///     @param repairRequests Number of reads issued to fill gaps left by a burst
+    void downloadThroughput(double bytesPerSecond, int repairRequests);
+
+    /// Signalled after an upload was verified, before commandComplete
+    ///     @param bytesPerSecond Effective throughput from create to the last write acked
+    ///     @param retransmits Number of writes sent again because they were presumed lost
+    void uploadThroughput(double bytesPerSecond, int retransmits);
+
     /// Signalled after get firmware version has completed
     ///     @param version string of veriosn, get from device
     ///     @param board true or false
@@ -143,6 +157,9 @@ private:
 
             // Length of file chunk written by write command
             uint32_t writeFileLength;
+
+            // Checksum returned by CalcFileCRC32 command
+            uint32_t crc32;
         };
     };
 
@@ -202,6 +219,7 @@ private:
             kCOCreate,      // waiting for Create response
             kCOSearchVersion,     // waiting for search version response
             kCOReboot,            // ready to reboot
+            kCOCalcCRC,     // waiting for CRC32 of uploaded file
         };
     
     bool _sendOpcodeOnlyCmd(uint8_t opcode, OperationState newOpState);
@@ -210,13 +228,24 @@ private:
     void _emitErrorMessage(const QString& msg);
     void _emitListEntry(const QString& entry);
     void _sendRequest(Request* request);
+    void _sendRequestMessage(Request* request);
     void _fillRequestWithString(Request* request, const QString& str);
     void _openAckResponse(Request* openAck);
     void _downloadAckResponse(Request* readAck, bool readFile);
+    void _downloadEndOfFile(bool burst);
+    void _requestNextDownloadBlock(void);
+    uint32_t _addDownloadRange(uint32_t start, uint32_t end);
+    uint32_t _downloadHighWater(void) const;
+    bool _downloadEnd(uint32_t* end) const;
     void _listAckResponse(Request* listAck);
     void _createAckResponse(Request* createAck);
     void _writeAckResponse(Request* writeAck);
-    void _writeFileDatablock(void);
+    void _calcCRCAckResponse(Request* crcAck);
+    void _fillWriteWindow(void);
+    void _sendWriteChunk(uint32_t offset, bool retransmit);
+    uint32_t _writeChunkSize(uint32_t offset) const;
+    void _updateWriteWindow(qint64 rttMsecs);
+    void _sendCalcCRCCommand(void);
     void _sendListCommand(void);
     void _sendResetCommand(void);
     void _closeDownloadSession(bool success);
@@ -242,16 +271,43 @@ private:
     
     uint32_t    _readOffset;                ///< current read offset
     
-    uint32_t    _writeOffset;               ///< current write offset
-    uint32_t    _writeSize;                 ///< current write data size
+    /// A write which has been sent and not acked yet
+    struct WriteChunk {
+        qint64      sentMsecs;      ///< Time sent, from _uploadTimer
+        uint32_t    sendIndex;      ///< Order sent in, later acks overtaking a chunk mark it as lost
+        bool        retransmitted;  ///< Retransmitted chunks give ambiguous latency samples
+    };
+
     uint32_t    _writeFileSize;             ///< Size of file being uploaded
     QByteArray  _writeFileAccumulator;      ///< Holds file being uploaded
+    QMap<uint32_t, WriteChunk> _writeOutstanding;   ///< Writes in flight, keyed by offset
+    QList<uint32_t> _writeResend;           ///< Offsets of writes presumed lost, in ascending order
+    uint32_t    _writeNextOffset;           ///< First offset not sent yet
+    uint32_t    _writeAckedBytes;           ///< Bytes acked so far
+    uint32_t    _writeSendIndex;            ///< Number of writes sent
+    double      _writeWindow;               ///< Number of writes allowed in flight
+    bool        _writeSlowStart;            ///< Window grows by one per ack until the first sign of queueing or loss
+    qint64      _writeBaseRttMsecs;         ///< Lowest ack latency seen, -1 for none yet
+    double      _writeSmoothedRttMsecs;     ///< Smoothed ack latency, 0 for none yet
+    int         _writeRetransmits;          ///< Writes sent again
+    qint64      _writeElapsedMsecs;         ///< Time taken until the last write was acked
+    QElapsedTimer _uploadTimer;             ///< Measures ack latency and effective throughput
+
+    static const int _writeWindowInitial = 4;   ///< Writes in flight at the start of an upload
+    static const int _writeWindowMax = 16;      ///< Upper bound for writes in flight
+    static const uint32_t _writeLostAfter = 3;  ///< A write is presumed lost once this many later writes were acked
     
-    uint32_t    _downloadOffset;            ///< current download offset
+    uint32_t    _downloadOffset;            ///< offset of the last read or burst request
     QByteArray  _readFileAccumulator;       ///< Holds file being downloaded
     QDir        _readFileDownloadDir;       ///< Directory to download file to
     QString     _readFileDownloadFilename;  ///< Filename (no path) for download file
     uint32_t    _downloadFileSize;          ///< Size of file being downloaded
+    QMap<uint32_t, uint32_t> _downloadRanges;   ///< Received [start, end) byte ranges, merged, keyed by start
+    uint32_t    _downloadBytesReceived;     ///< Unique bytes received so far
+    bool        _downloadBurstDone;         ///< Server has reached the end of file in burst mode
+    bool        _downloadSizeConfirmed;     ///< EOF returned for a read past the last byte received
+    int         _downloadRepairRequests;    ///< Reads issued to fill gaps left by the burst
+    QElapsedTimer _downloadTimer;           ///< Measures effective download throughput
 
     uint8_t     _systemIdQGC;               ///< System ID for QGC
     uint8_t     _systemIdServer;            ///< System ID for server
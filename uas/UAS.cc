@@ -46,6 +46,7 @@
 #include "QGCApplication.h"
 
 QGC_LOGGING_CATEGORY(UASLog, "UASLog")
+QGC_LOGGING_CATEGORY(UASManualControlLog, "UASManualControlLog")
 
 /**
 * Gets the settings from the previous UAS (name, airframe, autopilot, battery specs)
@@ -76,6 +77,13 @@ UAS::UAS(MAVLinkProtocol* protocol, Vehicle* vehicle, FirmwarePluginManager * fi
     manualPitchAngle(0),
     manualYawAngle(0),
     manualThrust(0),
+    manualPositionX(0),
+    manualPositionY(0),
+    manualPositionZ(0),
+    manualVelocityX(0),
+    manualVelocityY(0),
+    manualVelocityZ(0),
+    manualYawRate(0),
 
     isGlobalPositionKnown(false),
 
@@ -1430,144 +1438,140 @@ void UAS::setExternalControlSetpoint(float roll, float pitch, float yaw, float t
         manualThrust = thrust;
         manualButtons = buttons;
 
-        mavlink_message_t message;
+        sendManualControl(roll, pitch, yaw, thrust, buttons, joystickMode);
+    }
+}
 
-        if (joystickMode == Vehicle::JoystickModeAttitude) {
-            // send an external attitude setpoint command (rate control disabled)
-            float attitudeQuaternion[4];
-            mavlink_euler_to_quaternion(roll, pitch, yaw, attitudeQuaternion);
-            uint8_t typeMask = 0x7; // disable rate control
-            mavlink_msg_set_attitude_target_pack_chan(mavlink->getSystemId(),
-                                                      mavlink->getComponentId(),
-                                                      _vehicle->priorityLink()->mavlinkChannel(),
-                                                      &message,
-                                                      QGC::groundTimeUsecs(),
-                                                      this->uasId,
-                                                      0,
-                                                      typeMask,
-                                                      attitudeQuaternion,
-                                                      0,
-                                                      0,
-                                                      0,
-                                                      thrust);
-        } else if (joystickMode == Vehicle::JoystickModePosition) {
-            // Send the the local position setpoint (local pos sp external message)
-            static float px = 0;
-            static float py = 0;
-            static float pz = 0;
-            //XXX: find decent scaling
-            px -= pitch;
-            py += roll;
-            pz -= 2.0f*(thrust-0.5);
-            uint16_t typeMask = (1<<11)|(7<<6)|(7<<3); // select only POSITION control
-            mavlink_msg_set_position_target_local_ned_pack_chan(mavlink->getSystemId(),
-                                                                mavlink->getComponentId(),
-                                                                _vehicle->priorityLink()->mavlinkChannel(),
-                                                                &message,
-                                                                QGC::groundTimeUsecs(),
-                                                                this->uasId,
-                                                                0,
-                                                                MAV_FRAME_LOCAL_NED,
-                                                                typeMask,
-                                                                px,
-                                                                py,
-                                                                pz,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                yaw,
-                                                                0);
-        qDebug()<<"roll"<<py<<"pitch"<<px<<"yaw"<<yaw<<"thrust"<<pz<<"buttons: "<<buttons;
-        } else if (joystickMode == Vehicle::JoystickModeForce) {
-            // Send the the force setpoint (local pos sp external message)
-            float dcm[3][3];
-            mavlink_euler_to_dcm(roll, pitch, yaw, dcm);
-            const float fx = -dcm[0][2] * thrust;
-            const float fy = -dcm[1][2] * thrust;
-            const float fz = -dcm[2][2] * thrust;
-            uint16_t typeMask = (3<<10)|(7<<3)|(7<<0)|(1<<9); // select only FORCE control (disable everything else)
-            mavlink_msg_set_position_target_local_ned_pack_chan(mavlink->getSystemId(),
-                                                                mavlink->getComponentId(),
-                                                                _vehicle->priorityLink()->mavlinkChannel(),
-                                                                &message,
-                                                                QGC::groundTimeUsecs(),
-                                                                this->uasId,
-                                                                0,
-                                                                MAV_FRAME_LOCAL_NED,
-                                                                typeMask,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                fx,
-                                                                fy,
-                                                                fz,
-                                                                0,
-                                                                0);
-        } else if (joystickMode == Vehicle::JoystickModeVelocity) {
-            // Send the the local velocity setpoint (local pos sp external message)
-            static float vx = 0;
-            static float vy = 0;
-            static float vz = 0;
-            static float yawrate = 0;
-            //XXX: find decent scaling
-            vx -= pitch;
-            vy += roll;
-            vz -= 2.0f*(thrust-0.5);
-            yawrate += yaw; //XXX: not sure what scale to apply here
-            uint16_t typeMask = (1<<10)|(7<<6)|(7<<0); // select only VELOCITY control
-            mavlink_msg_set_position_target_local_ned_pack_chan(mavlink->getSystemId(),
-                                                                mavlink->getComponentId(),
-                                                                _vehicle->priorityLink()->mavlinkChannel(),
-                                                                &message,
-                                                                QGC::groundTimeUsecs(),
-                                                                this->uasId,
-                                                                0,
-                                                                MAV_FRAME_LOCAL_NED,
-                                                                typeMask,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                vx,
-                                                                vy,
-                                                                vz,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                0,
-                                                                yawrate);
-        } else if (joystickMode == Vehicle::JoystickModeRC) {
-
-            // Save the new manual control inputs
-            manualRollAngle = roll;
-            manualPitchAngle = pitch;
-            manualYawAngle = yaw;
-            manualThrust = thrust;
-            manualButtons = buttons;
-
-            // Store scaling values for all 3 axes
-            const float axesScaling = 1.0 * 1000.0;
-
-            // Calculate the new commands for roll, pitch, yaw, and thrust
-            const float newRollCommand = roll * axesScaling;
-            // negate pitch value because pitch is negative for pitching forward but mavlink message argument is positive for forward
-            const float newPitchCommand = -pitch * axesScaling ;
-            const float newYawCommand = yaw * axesScaling;
-            const float newThrustCommand = thrust * axesScaling;
-
-
-            // Send the MANUAL_COMMAND message
-            mavlink_msg_manual_control_pack_chan(mavlink->getSystemId(),
-                                                 mavlink->getComponentId(),
-                                                 _vehicle->priorityLink()->mavlinkChannel(),
-                                                 &message,
-                                                 this->uasId,
-                                                 newPitchCommand, newRollCommand, newThrustCommand, newYawCommand, buttons);
+void UAS::sendManualControl(float roll, float pitch, float yaw, float thrust, quint16 buttons, int joystickMode)
+{
+    if (!_vehicle || !_vehicle->priorityLink()) {
+        return;
+    }
+
+    mavlink_message_t message;
+
+    if (joystickMode == Vehicle::JoystickModeAttitude) {
+        // send an external attitude setpoint command (rate control disabled)
+        float attitudeQuaternion[4];
+        mavlink_euler_to_quaternion(roll, pitch, yaw, attitudeQuaternion);
+        uint8_t typeMask = 0x7; // disable rate control
+        mavlink_msg_set_attitude_target_pack_chan(mavlink->getSystemId(),
+                                                  mavlink->getComponentId(),
+                                                  _vehicle->priorityLink()->mavlinkChannel(),
+                                                  &message,
+                                                  QGC::groundTimeUsecs(),
+                                                  this->uasId,
+                                                  0,
+                                                  typeMask,
+                                                  attitudeQuaternion,
+                                                  0,
+                                                  0,
+                                                  0,
+                                                  thrust);
+    } else if (joystickMode == Vehicle::JoystickModePosition) {
+        // Send the the local position setpoint (local pos sp external message)
+        //XXX: find decent scaling
+        manualPositionX -= pitch;
+        manualPositionY += roll;
+        manualPositionZ -= 2.0f*(thrust-0.5);
+        uint16_t typeMask = (1<<11)|(7<<6)|(7<<3); // select only POSITION control
+        mavlink_msg_set_position_target_local_ned_pack_chan(mavlink->getSystemId(),
+                                                            mavlink->getComponentId(),
+                                                            _vehicle->priorityLink()->mavlinkChannel(),
+                                                            &message,
+                                                            QGC::groundTimeUsecs(),
+                                                            this->uasId,
+                                                            0,
+                                                            MAV_FRAME_LOCAL_NED,
+                                                            typeMask,
+                                                            manualPositionX,
+                                                            manualPositionY,
+                                                            manualPositionZ,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            yaw,
+                                                            0);
+        qCDebug(UASManualControlLog) << "roll" << manualPositionY << "pitch" << manualPositionX << "yaw" << yaw << "thrust" << manualPositionZ << "buttons:" << buttons;
+    } else if (joystickMode == Vehicle::JoystickModeForce) {
+        // Send the the force setpoint (local pos sp external message)
+        float dcm[3][3];
+        mavlink_euler_to_dcm(roll, pitch, yaw, dcm);
+        const float fx = -dcm[0][2] * thrust;
+        const float fy = -dcm[1][2] * thrust;
+        const float fz = -dcm[2][2] * thrust;
+        uint16_t typeMask = (3<<10)|(7<<3)|(7<<0)|(1<<9); // select only FORCE control (disable everything else)
+        mavlink_msg_set_position_target_local_ned_pack_chan(mavlink->getSystemId(),
+                                                            mavlink->getComponentId(),
+                                                            _vehicle->priorityLink()->mavlinkChannel(),
+                                                            &message,
+                                                            QGC::groundTimeUsecs(),
+                                                            this->uasId,
+                                                            0,
+                                                            MAV_FRAME_LOCAL_NED,
+                                                            typeMask,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            fx,
+                                                            fy,
+                                                            fz,
+                                                            0,
+                                                            0);
+    } else if (joystickMode == Vehicle::JoystickModeVelocity) {
+        // Send the the local velocity setpoint (local pos sp external message)
+        //XXX: find decent scaling
+        manualVelocityX -= pitch;
+        manualVelocityY += roll;
+        manualVelocityZ -= 2.0f*(thrust-0.5);
+        manualYawRate += yaw; //XXX: not sure what scale to apply here
+        uint16_t typeMask = (1<<10)|(7<<6)|(7<<0); // select only VELOCITY control
+        mavlink_msg_set_position_target_local_ned_pack_chan(mavlink->getSystemId(),
+                                                            mavlink->getComponentId(),
+                                                            _vehicle->priorityLink()->mavlinkChannel(),
+                                                            &message,
+                                                            QGC::groundTimeUsecs(),
+                                                            this->uasId,
+                                                            0,
+                                                            MAV_FRAME_LOCAL_NED,
+                                                            typeMask,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            manualVelocityX,
+                                                            manualVelocityY,
+                                                            manualVelocityZ,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            0,
+                                                            manualYawRate);
+    } else if (joystickMode == Vehicle::JoystickModeRC) {
+
+        // Store scaling values for all 3 axes
+        const float axesScaling = 1.0 * 1000.0;
+
+        // Calculate the new commands for roll, pitch, yaw, and thrust
+        const float newRollCommand = roll * axesScaling;
+        // negate pitch value because pitch is negative for pitching forward but mavlink message argument is positive for forward
+        const float newPitchCommand = -pitch * axesScaling ;
+        const float newYawCommand = yaw * axesScaling;
+        const float newThrustCommand = thrust * axesScaling;
+
+
+        // Send the MANUAL_COMMAND message
+        mavlink_msg_manual_control_pack_chan(mavlink->getSystemId(),
+                                             mavlink->getComponentId(),
+                                             _vehicle->priorityLink()->mavlinkChannel(),
+                                             &message,
+                                             this->uasId,
+                                             newPitchCommand, newRollCommand, newThrustCommand, newYawCommand, buttons);
 //            mavlink_msg_rc_channels_pack_chan (mavlink->getSystemId()
 //                                               ,mavlink->getComponentId()
 //                                               ,0
@@ -1584,13 +1588,12 @@ void UAS::setExternalControlSetpoint(float roll, float pitch, float yaw, float t
 //                                               ,65535
 //                                               ,65535
 //                                               ,100);
-            qDebug()<<"roll"<<newRollCommand<<"pitch"<<newPitchCommand<<"yaw"<<newYawCommand<<"thrust"<<newThrustCommand<<"buttons: "<<buttons;
-        }
-
-        _vehicle->sendMessageOnLink(_vehicle->priorityLink(), message);
-        // Emit an update in control values to other UI elements, like the HSI display
-        emit attitudeThrustSetPointChanged(this, roll, pitch, yaw, thrust, QGC::groundTimeMilliseconds());
+        qCDebug(UASManualControlLog) << "roll" << newRollCommand << "pitch" << newPitchCommand << "yaw" << newYawCommand << "thrust" << newThrustCommand << "buttons:" << buttons;
     }
+
+    _vehicle->sendMessageOnLink(_vehicle->priorityLink(), message);
+    // Emit an update in control values to other UI elements, like the HSI display
+    emit attitudeThrustSetPointChanged(this, roll, pitch, yaw, thrust, QGC::groundTimeMilliseconds());
 }
 
 #ifndef __mobile__
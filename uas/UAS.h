@@ -36,6 +36,7 @@
 #endif
 
 Q_DECLARE_LOGGING_CATEGORY(UASLog)
+Q_DECLARE_LOGGING_CATEGORY(UASManualControlLog)
 
 class Vehicle;
 
@@ -375,6 +376,14 @@ protected: //COMMENTS FOR TEST UNIT
     double manualYawAngle;      ///< Yaw angle set by human pilot (radians)
     double manualThrust;        ///< Thrust set by human pilot (radians)
 
+    float manualPositionX;      ///< Local position setpoint accumulated from manual control in JoystickModePosition
+    float manualPositionY;
+    float manualPositionZ;
+    float manualVelocityX;      ///< Local velocity setpoint accumulated from manual control in JoystickModeVelocity
+    float manualVelocityY;
+    float manualVelocityZ;
+    float manualYawRate;
+
     /// POSITION
     bool isGlobalPositionKnown; ///< If the global position has been received for this MAV
 
@@ -528,6 +537,9 @@ public slots:
 
     /** @brief Set the values for the manual control of the vehicle */
     void setExternalControlSetpoint(float roll, float pitch, float yaw, float thrust, quint16 buttons, int joystickMode);
+
+    /** @brief Send the manual control values to the vehicle now, without the change and rate check of setExternalControlSetpoint */
+    void sendManualControl(float roll, float pitch, float yaw, float thrust, quint16 buttons, int joystickMode);
 //    void setVirtualControlSetpoint(float roll, float pitch, float yaw,float threst,float channel10);
 
     /** @brief Set the values for the 6dof manual control of the vehicle */
@@ -2,6 +2,7 @@
 #include "MAVLinkDecoder.h"
 
 #include <QDebug>
+#include <QMetaMethod>
 
 MAVLinkDecoder::MAVLinkDecoder(MAVLinkProtocol* protocol, QObject *parent) :
     QThread()
@@ -11,7 +12,6 @@ MAVLinkDecoder::MAVLinkDecoder(MAVLinkProtocol* protocol, QObject *parent) :
     // http://blog.qt.digia.com/blog/2010/06/17/youre-doing-it-wrong/
     moveToThread(this);
 
-    memset(receivedMessages, 0, sizeof(mavlink_message_t)*256);
     for (unsigned int i = 0; i<255;++i)
     {
         componentID[i] = -1;
@@ -73,14 +73,13 @@ void MAVLinkDecoder::receiveMessage(LinkInterface* link,mavlink_message_t messag
     }
 
     Q_UNUSED(link);
-    memcpy(receivedMessages+message.msgid, &message, sizeof(mavlink_message_t));
 
-    uint8_t msgid = message.msgid;
-    const mavlink_message_info_t* msgInfo = mavlink_get_message_info(&message);
+    const MessageDescriptor_t& descriptor = _messageDescriptor(&message);
+    const uint8_t* m = (const uint8_t*)&message.payload64[0];
 
     // Store an arrival time for this message. This value ends up being calculated later.
     quint64 time = 0;
-    
+
     // The SYSTEM_TIME message is special, in that it's handled here for synchronizing the QGC time with the remote time.
     if (message.msgid == MAVLINK_MSG_ID_SYSTEM_TIME)
     {
@@ -89,31 +88,86 @@ void MAVLinkDecoder::receiveMessage(LinkInterface* link,mavlink_message_t messag
         onboardTimeOffset[message.sysid] = (timebase.time_unix_usec+500)/1000 - timebase.time_boot_ms;
         onboardToGCSUnixTimeOffsetAndDelay[message.sysid] = static_cast<qint64>(QGC::groundTimeMilliseconds() - (timebase.time_unix_usec+500)/1000);
     }
-    else
+    else if (descriptor.timeSource == TimeSourceBootMs)
     {
-
-        // See if first value is a time value and if it is, use that as the arrival time for this data.
-        uint8_t fieldid = 0;
-        uint8_t* m = (uint8_t*)&((mavlink_message_t*)(receivedMessages+msgid))->payload64[0];
-
-        if (QString(msgInfo->fields[fieldid].name) == QString("time_boot_ms") && msgInfo->fields[fieldid].type == MAVLINK_TYPE_UINT32_T)
-        {
-            time = *((quint32*)(m+msgInfo->fields[fieldid].wire_offset));
-        }
-        else if (QString(msgInfo->fields[fieldid].name).contains("usec") && msgInfo->fields[fieldid].type == MAVLINK_TYPE_UINT64_T)
-        {
-            time = *((quint64*)(m+msgInfo->fields[fieldid].wire_offset));
-            time = (time+500)/1000; // Scale to milliseconds, round up/down correctly
-        }
+        // First value is a time value, use that as the arrival time for this data.
+        quint32 bootMs;
+        memcpy(&bootMs, m + descriptor.timeOffset, sizeof(bootMs));
+        time = bootMs;
+    }
+    else if (descriptor.timeSource == TimeSourceUsec)
+    {
+        quint64 usec;
+        memcpy(&usec, m + descriptor.timeOffset, sizeof(usec));
+        time = (usec+500)/1000; // Scale to milliseconds, round up/down correctly
     }
 
     // Align UAS time to global time
     time = getUnixTimeFromMs(message.sysid, time);
 
+    // Multi component detection
+    if (componentID[message.msgid] == -1)
+    {
+        componentID[message.msgid] = message.compid;
+    }
+    else if (componentID[message.msgid] != message.compid)
+    {
+        // Got this message already
+        componentMulti[message.msgid] = true;
+    }
+    bool multiComponent = componentMulti[message.msgid];
+
+    if (descriptor.filtered) {
+        return;
+    }
+
+    // The debug and named value messages carry their own names, which are interned on first sight
+    char    name[11];
+    int     nameLength = -1;
+
+    if (message.msgid == MAVLINK_MSG_ID_DEBUG_VECT)
+    {
+        mavlink_debug_vect_t debug;
+        mavlink_msg_debug_vect_decode(&message, &debug);
+        nameLength = qstrnlen(debug.name, 10);
+        memcpy(name, debug.name, nameLength);
+        time = getUnixTimeFromMs(message.sysid, (debug.time_usec+500)/1000); // Scale to milliseconds, round up/down correctly
+    }
+    else if (message.msgid == MAVLINK_MSG_ID_DEBUG)
+    {
+        mavlink_debug_t debug;
+        mavlink_msg_debug_decode(&message, &debug);
+        nameLength = qsnprintf(name, sizeof(name), "debug.%d", debug.ind);
+        time = getUnixTimeFromMs(message.sysid, debug.time_boot_ms);
+    }
+    else if (message.msgid == MAVLINK_MSG_ID_NAMED_VALUE_FLOAT)
+    {
+        mavlink_named_value_float_t debug;
+        mavlink_msg_named_value_float_decode(&message, &debug);
+        nameLength = qstrnlen(debug.name, 10);
+        memcpy(name, debug.name, nameLength);
+        time = getUnixTimeFromMs(message.sysid, debug.time_boot_ms);
+    }
+    else if (message.msgid == MAVLINK_MSG_ID_NAMED_VALUE_INT)
+    {
+        mavlink_named_value_int_t debug;
+        mavlink_msg_named_value_int_decode(&message, &debug);
+        nameLength = qstrnlen(debug.name, 10);
+        memcpy(name, debug.name, nameLength);
+        time = getUnixTimeFromMs(message.sysid, debug.time_boot_ms);
+    }
+
     // Send out all field values for this message
-    for (unsigned int i = 0; i < msgInfo->num_fields; ++i)
+    for (int i = 0; i < descriptor.fields.count(); ++i)
     {
-        emitFieldValue(&message, i, time);
+        const FieldDescriptor_t& field = descriptor.fields[i];
+        int fieldId = field.fieldId;
+
+        if (nameLength >= 0 && field.arrayLength == 0) {
+            // Only debug vectors keep the field name as part of the value name
+            fieldId = _namedFieldId(name, nameLength, message.msgid == MAVLINK_MSG_ID_DEBUG_VECT ? field.name : NULL, field);
+        }
+        emitFieldValue(&message, descriptor, field, fieldId, multiComponent, time);
     }
 
     // Send out combined math expressions
@@ -198,310 +252,268 @@ quint64 MAVLinkDecoder::getUnixTimeFromMs(int systemID, quint64 time)
     return ret;
 }
 
-void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64 time)
+QString MAVLinkDecoder::fieldName(int fieldId) const
 {
-    bool multiComponentSourceDetected = false;
-    const mavlink_message_info_t* msgInfo = mavlink_get_message_info(msg);
+    QMutexLocker locker(&_fieldNamesMutex);
+    return fieldId >= 0 && fieldId < _fieldNames.count() ? _fieldNames[fieldId] : QString();
+}
 
-    // Store component ID
-    if (componentID[msg->msgid] == -1)
-    {
-        componentID[msg->msgid] = msg->compid;
-    }
-    else
-    {
-        // Got this message already
-        if (componentID[msg->msgid] != msg->compid)
-        {
-            componentMulti[msg->msgid] = true;
-        }
-    }
+QString MAVLinkDecoder::fieldUnit(int fieldId) const
+{
+    QMutexLocker locker(&_fieldNamesMutex);
+    return fieldId >= 0 && fieldId < _fieldUnits.count() ? _fieldUnits[fieldId] : QString();
+}
 
-    if (componentMulti[msg->msgid] == true) multiComponentSourceDetected = true;
+/// Reads a field value of type T from the unaligned payload, returning it as the variant type V
+template<typename T, typename V>
+static QVariant _readVariant(const uint8_t* data)
+{
+    T value;
+    memcpy(&value, data, sizeof(value));
+    return QVariant(static_cast<V>(value));
+}
 
-    // Add field tree widget item
-    uint8_t msgid = msg->msgid;
-    if (messageFilter.contains(msgid)) return;
-    QString fieldName(msgInfo->fields[fieldid].name);
-    QString fieldType;
-    uint8_t* m = (uint8_t*)&((mavlink_message_t*)(receivedMessages+msgid))->payload64[0];
-    QString name("%1.%2");
-    QString unit("");
+/// Reads a field value of type T from the unaligned payload as a double
+template<typename T>
+static double _readNumeric(const uint8_t* data)
+{
+    T value;
+    memcpy(&value, data, sizeof(value));
+    return static_cast<double>(value);
+}
 
-    // Debug vector messages
-    if (msgid == MAVLINK_MSG_ID_DEBUG_VECT)
-    {
-        mavlink_debug_vect_t debug;
-        mavlink_msg_debug_vect_decode(msg, &debug);
-        char buf[11];
-        strncpy(buf, debug.name, 10);
-        buf[10] = '\0';
-        name = QString("%1.%2").arg(buf).arg(fieldName);
-        time = getUnixTimeFromMs(msg->sysid, (debug.time_usec+500)/1000); // Scale to milliseconds, round up/down correctly
-    }
-    else if (msgid == MAVLINK_MSG_ID_DEBUG)
-    {
-        mavlink_debug_t debug;
-        mavlink_msg_debug_decode(msg, &debug);
-        name = name.arg(QString("debug")).arg(debug.ind);
-        time = getUnixTimeFromMs(msg->sysid, debug.time_boot_ms);
-    }
-    else if (msgid == MAVLINK_MSG_ID_NAMED_VALUE_FLOAT)
-    {
-        mavlink_named_value_float_t debug;
-        mavlink_msg_named_value_float_decode(msg, &debug);
-        char buf[11];
-        strncpy(buf, debug.name, 10);
-        buf[10] = '\0';
-        name = QString(buf);
-        time = getUnixTimeFromMs(msg->sysid, debug.time_boot_ms);
-    }
-    else if (msgid == MAVLINK_MSG_ID_NAMED_VALUE_INT)
-    {
-        mavlink_named_value_int_t debug;
-        mavlink_msg_named_value_int_decode(msg, &debug);
-        char buf[11];
-        strncpy(buf, debug.name, 10);
-        buf[10] = '\0';
-        name = QString(buf);
-        time = getUnixTimeFromMs(msg->sysid, debug.time_boot_ms);
-    }
-    else if (msgid == MAVLINK_MSG_ID_RC_CHANNELS_RAW)
-    {
-        // XXX this is really ugly, but we do not know a better way to do this
-        mavlink_rc_channels_raw_t raw;
-        mavlink_msg_rc_channels_raw_decode(msg, &raw);
-        name = name.arg(msgInfo->name).arg(fieldName);
-        name.prepend(QString("port%1_").arg(raw.port));
-    }
-    else if (msgid == MAVLINK_MSG_ID_RC_CHANNELS_SCALED)
-    {
-        // XXX this is really ugly, but we do not know a better way to do this
-        mavlink_rc_channels_scaled_t scaled;
-        mavlink_msg_rc_channels_scaled_decode(msg, &scaled);
-        name = name.arg(msgInfo->name).arg(fieldName);
-        name.prepend(QString("port%1_").arg(scaled.port));
-    }
-    else if (msgid == MAVLINK_MSG_ID_SERVO_OUTPUT_RAW)
-    {
-        // XXX this is really ugly, but we do not know a better way to do this
-        mavlink_servo_output_raw_t servo;
-        mavlink_msg_servo_output_raw_decode(msg, &servo);
-        name = name.arg(msgInfo->name).arg(fieldName);
-        name.prepend(QString("port%1_").arg(servo.port));
-    }
-    else
-    {
-        name = name.arg(msgInfo->name).arg(fieldName);
+const MAVLinkDecoder::MessageDescriptor_t& MAVLinkDecoder::_messageDescriptor(const mavlink_message_t* msg)
+{
+    // These messages are split into one set of values per port
+    int port = -1;
+    switch (msg->msgid) {
+    case MAVLINK_MSG_ID_RC_CHANNELS_RAW:
+        port = mavlink_msg_rc_channels_raw_get_port(msg);
+        break;
+    case MAVLINK_MSG_ID_RC_CHANNELS_SCALED:
+        port = mavlink_msg_rc_channels_scaled_get_port(msg);
+        break;
+    case MAVLINK_MSG_ID_SERVO_OUTPUT_RAW:
+        port = mavlink_msg_servo_output_raw_get_port(msg);
+        break;
     }
 
-    if (multiComponentSourceDetected)
-    {
-        name = name.prepend(QString("C%1:").arg(msg->compid));
+    quint32 key = (msg->msgid << 9) | (port + 1);
+    QHash<quint32, MessageDescriptor_t>::const_iterator iter = _messageDescriptors.constFind(key);
+    if (iter != _messageDescriptors.constEnd()) {
+        return iter.value();
     }
+    return _buildMessageDescriptor(msg, mavlink_get_message_info(msg), port);
+}
 
-    name = name.prepend(QString("M%1:").arg(msg->sysid));
-
-    switch (msgInfo->fields[fieldid].type)
-    {
-    case MAVLINK_TYPE_CHAR:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            char* str = (char*)(m+msgInfo->fields[fieldid].wire_offset);
-            // Enforce null termination
-            str[msgInfo->fields[fieldid].array_length-1] = '\0';
-            QString string(name + ": " + str);
-            if (!textMessageFilter.contains(msgid)) emit textMessageReceived(msg->sysid, msg->compid, MAV_SEVERITY_INFO, string);
-        }
-        else
-        {
-            // Single char
-            char b = *((char*)(m+msgInfo->fields[fieldid].wire_offset));
-            unit = QString("char[%1]").arg(msgInfo->fields[fieldid].array_length);
-            emit valueChanged(msg->sysid, name, unit, b, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT8_T:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            uint8_t* nums = m+msgInfo->fields[fieldid].wire_offset;
-            fieldType = QString("uint8_t[%1]").arg(msgInfo->fields[fieldid].array_length);
-            for (unsigned int j = 0; j < msgInfo->fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            uint8_t u = *(m+msgInfo->fields[fieldid].wire_offset);
-            fieldType = "uint8_t";
-            emit valueChanged(msg->sysid, name, fieldType, u, time);
-        }
-        break;
-    case MAVLINK_TYPE_INT8_T:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            int8_t* nums = (int8_t*)(m+msgInfo->fields[fieldid].wire_offset);
-            fieldType = QString("int8_t[%1]").arg(msgInfo->fields[fieldid].array_length);
-            for (unsigned int j = 0; j < msgInfo->fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            int8_t n = *((int8_t*)(m+msgInfo->fields[fieldid].wire_offset));
-            fieldType = "int8_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT16_T:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            uint16_t* nums = (uint16_t*)(m+msgInfo->fields[fieldid].wire_offset);
-            fieldType = QString("uint16_t[%1]").arg(msgInfo->fields[fieldid].array_length);
-            for (unsigned int j = 0; j < msgInfo->fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            uint16_t n = *((uint16_t*)(m+msgInfo->fields[fieldid].wire_offset));
-            fieldType = "uint16_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_INT16_T:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            int16_t* nums = (int16_t*)(m+msgInfo->fields[fieldid].wire_offset);
-            fieldType = QString("int16_t[%1]").arg(msgInfo->fields[fieldid].array_length);
-            for (unsigned int j = 0; j < msgInfo->fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            int16_t n = *((int16_t*)(m+msgInfo->fields[fieldid].wire_offset));
-            fieldType = "int16_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT32_T:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            uint32_t* nums = (uint32_t*)(m+msgInfo->fields[fieldid].wire_offset);
-            fieldType = QString("uint32_t[%1]").arg(msgInfo->fields[fieldid].array_length);
-            for (unsigned int j = 0; j < msgInfo->fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            uint32_t n = *((uint32_t*)(m+msgInfo->fields[fieldid].wire_offset));
-            fieldType = "uint32_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_INT32_T:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            int32_t* nums = (int32_t*)(m+msgInfo->fields[fieldid].wire_offset);
-            fieldType = QString("int32_t[%1]").arg(msgInfo->fields[fieldid].array_length);
-            for (unsigned int j = 0; j < msgInfo->fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            int32_t n = *((int32_t*)(m+msgInfo->fields[fieldid].wire_offset));
-            fieldType = "int32_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_FLOAT:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            float* nums = (float*)(m+msgInfo->fields[fieldid].wire_offset);
-            fieldType = QString("float[%1]").arg(msgInfo->fields[fieldid].array_length);
-            for (unsigned int j = 0; j < msgInfo->fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, (float)(nums[j]), time);
-            }
-        }
-        else
-        {
-            // Single value
-            float f = *((float*)(m+msgInfo->fields[fieldid].wire_offset));
-            fieldType = "float";
-            emit valueChanged(msg->sysid, name, fieldType, f, time);
+const MAVLinkDecoder::MessageDescriptor_t& MAVLinkDecoder::_buildMessageDescriptor(const mavlink_message_t* msg, const mavlink_message_info_t* msgInfo, int port)
+{
+    MessageDescriptor_t descriptor;
+
+    descriptor.timeSource = TimeSourceNone;
+    descriptor.timeOffset = 0;
+    descriptor.filtered = messageFilter.contains(msg->msgid);
+    descriptor.textFiltered = textMessageFilter.contains(msg->msgid);
+
+    // See if first value is a time value and if it is, use that as the arrival time for this data.
+    if (msgInfo->num_fields > 0) {
+        const mavlink_field_info_t& first = msgInfo->fields[0];
+        if (strcmp(first.name, "time_boot_ms") == 0 && first.type == MAVLINK_TYPE_UINT32_T) {
+            descriptor.timeSource = TimeSourceBootMs;
+            descriptor.timeOffset = first.wire_offset;
+        } else if (strstr(first.name, "usec") && first.type == MAVLINK_TYPE_UINT64_T) {
+            descriptor.timeSource = TimeSourceUsec;
+            descriptor.timeOffset = first.wire_offset;
         }
-        break;
-    case MAVLINK_TYPE_DOUBLE:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            double* nums = (double*)(m+msgInfo->fields[fieldid].wire_offset);
-            fieldType = QString("double[%1]").arg(msgInfo->fields[fieldid].array_length);
-            for (unsigned int j = 0; j < msgInfo->fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
+    }
+
+    for (unsigned int i = 0; i < msgInfo->num_fields; i++) {
+        const mavlink_field_info_t& fieldInfo = msgInfo->fields[i];
+        FieldDescriptor_t field;
+
+        field.name = fieldInfo.name;
+        field.offset = fieldInfo.wire_offset;
+        field.type = fieldInfo.type;
+        field.arrayLength = fieldInfo.array_length;
+
+        const char* typeName;
+        switch (fieldInfo.type) {
+        case MAVLINK_TYPE_CHAR:
+            typeName = "char";
+            field.elementSize = sizeof(char);
+            field.variantReader = _readVariant<char, int>;
+            field.numericReader = _readNumeric<char>;
+            break;
+        case MAVLINK_TYPE_UINT8_T:
+            typeName = "uint8_t";
+            field.elementSize = sizeof(uint8_t);
+            field.variantReader = _readVariant<uint8_t, int>;
+            field.numericReader = _readNumeric<uint8_t>;
+            break;
+        case MAVLINK_TYPE_INT8_T:
+            typeName = "int8_t";
+            field.elementSize = sizeof(int8_t);
+            field.variantReader = _readVariant<int8_t, int>;
+            field.numericReader = _readNumeric<int8_t>;
+            break;
+        case MAVLINK_TYPE_UINT16_T:
+            typeName = "uint16_t";
+            field.elementSize = sizeof(uint16_t);
+            field.variantReader = _readVariant<uint16_t, int>;
+            field.numericReader = _readNumeric<uint16_t>;
+            break;
+        case MAVLINK_TYPE_INT16_T:
+            typeName = "int16_t";
+            field.elementSize = sizeof(int16_t);
+            field.variantReader = _readVariant<int16_t, int>;
+            field.numericReader = _readNumeric<int16_t>;
+            break;
+        case MAVLINK_TYPE_UINT32_T:
+            typeName = "uint32_t";
+            field.elementSize = sizeof(uint32_t);
+            field.variantReader = _readVariant<uint32_t, uint>;
+            field.numericReader = _readNumeric<uint32_t>;
+            break;
+        case MAVLINK_TYPE_INT32_T:
+            typeName = "int32_t";
+            field.elementSize = sizeof(int32_t);
+            field.variantReader = _readVariant<int32_t, int>;
+            field.numericReader = _readNumeric<int32_t>;
+            break;
+        case MAVLINK_TYPE_FLOAT:
+            typeName = "float";
+            field.elementSize = sizeof(float);
+            field.variantReader = _readVariant<float, float>;
+            field.numericReader = _readNumeric<float>;
+            break;
+        case MAVLINK_TYPE_DOUBLE:
+            typeName = "double";
+            field.elementSize = sizeof(double);
+            field.variantReader = _readVariant<double, double>;
+            field.numericReader = _readNumeric<double>;
+            break;
+        case MAVLINK_TYPE_UINT64_T:
+            typeName = "uint64_t";
+            field.elementSize = sizeof(uint64_t);
+            field.variantReader = _readVariant<uint64_t, quint64>;
+            field.numericReader = _readNumeric<uint64_t>;
+            break;
+        case MAVLINK_TYPE_INT64_T:
+            typeName = "int64_t";
+            field.elementSize = sizeof(int64_t);
+            field.variantReader = _readVariant<int64_t, qint64>;
+            field.numericReader = _readNumeric<int64_t>;
+            break;
+        default:
+            qDebug() << "WARNING: UNKNOWN MAVLINK TYPE";
+            continue;
         }
-        else
-        {
-            // Single value
-            double f = *((double*)(m+msgInfo->fields[fieldid].wire_offset));
-            fieldType = "double";
-            emit valueChanged(msg->sysid, name, fieldType, f, time);
+
+        QString name = QString("%1.%2").arg(msgInfo->name).arg(fieldInfo.name);
+        if (port != -1) {
+            name.prepend(QString("port%1_").arg(port));
         }
-        break;
-    case MAVLINK_TYPE_UINT64_T:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            uint64_t* nums = (uint64_t*)(m+msgInfo->fields[fieldid].wire_offset);
-            fieldType = QString("uint64_t[%1]").arg(msgInfo->fields[fieldid].array_length);
-            for (unsigned int j = 0; j < msgInfo->fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, (quint64) nums[j], time);
+
+        if (field.arrayLength == 0) {
+            field.fieldId = _internField(name, typeName);
+        } else if (field.type == MAVLINK_TYPE_CHAR) {
+            // Strings are sent out as text, so they only need a single name
+            field.fieldId = _internField(name, QString("char[%1]").arg(field.arrayLength));
+        } else {
+            // Array elements are given consecutive ids
+            QString unit = QString("%1[%2]").arg(typeName).arg(field.arrayLength);
+            field.fieldId = _internField(QString("%1.%2").arg(name).arg(0), unit);
+            for (unsigned int j = 1; j < field.arrayLength; j++) {
+                _internField(QString("%1.%2").arg(name).arg(j), unit);
             }
         }
-        else
-        {
-            // Single value
-            uint64_t n = *((uint64_t*)(m+msgInfo->fields[fieldid].wire_offset));
-            fieldType = "uint64_t";
-            emit valueChanged(msg->sysid, name, fieldType, (quint64) n, time);
+
+        descriptor.fields.append(field);
+    }
+
+    quint32 key = (msg->msgid << 9) | (port + 1);
+    return _messageDescriptors.insert(key, descriptor).value();
+}
+
+int MAVLinkDecoder::_internField(const QString& name, const QString& unit)
+{
+    QMutexLocker locker(&_fieldNamesMutex);
+    _fieldNames.append(name);
+    _fieldUnits.append(unit);
+    return _fieldNames.count() - 1;
+}
+
+/// Returns the field id for a value which is named by the message contents. The lookup is done
+/// against the raw name bytes so it does not allocate once the name has been seen.
+///     @param name Value name from the message, not null terminated
+///     @param fieldName Field name to append to the value name, NULL for none
+///     @param field Field the value comes from
+int MAVLinkDecoder::_namedFieldId(const char* name, int nameLength, const char* fieldName, const FieldDescriptor_t& field)
+{
+    char    key[64];
+    int     nameKeyLength = qMin(nameLength, 10);
+
+    memcpy(key, name, nameKeyLength);
+    if (fieldName) {
+        nameKeyLength += qsnprintf(key + nameKeyLength, 48, ".%s", fieldName);
+        nameKeyLength = qMin(nameKeyLength, 58);
+    }
+
+    // Values from different fields can share a name, the field they come from keeps them apart
+    int keyLength = nameKeyLength + sizeof(field.fieldId);
+    memcpy(key + nameKeyLength, &field.fieldId, sizeof(field.fieldId));
+
+    QHash<QByteArray, int>::const_iterator iter = _namedFieldIds.constFind(QByteArray::fromRawData(key, keyLength));
+    if (iter != _namedFieldIds.constEnd()) {
+        return iter.value();
+    }
+
+    int fieldId = _internField(QString::fromLatin1(key, nameKeyLength), _fieldUnits[field.fieldId]);
+    _namedFieldIds[QByteArray(key, keyLength)] = fieldId;
+    return fieldId;
+}
+
+/// Returns the fully qualified "M<sysid>:[C<compid>:]name" value name, cached per system/component/field
+const QString& MAVLinkDecoder::_qualifiedName(int sysid, int compid, bool multiComponent, int fieldId)
+{
+    quint64 key = ((quint64)fieldId << 17) | ((quint64)(multiComponent ? compid + 1 : 0) << 8) | (quint64)sysid;
+
+    QHash<quint64, QString>::iterator iter = _qualifiedNames.find(key);
+    if (iter == _qualifiedNames.end()) {
+        QString name = _fieldNames[fieldId];
+        if (multiComponent) {
+            name.prepend(QString("C%1:").arg(compid));
         }
-        break;
-    case MAVLINK_TYPE_INT64_T:
-        if (msgInfo->fields[fieldid].array_length > 0)
-        {
-            int64_t* nums = (int64_t*)(m+msgInfo->fields[fieldid].wire_offset);
-            fieldType = QString("int64_t[%1]").arg(msgInfo->fields[fieldid].array_length);
-            for (unsigned int j = 0; j < msgInfo->fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, (qint64) nums[j], time);
-            }
+        name.prepend(QString("M%1:").arg(sysid));
+        iter = _qualifiedNames.insert(key, name);
+    }
+    return iter.value();
+}
+
+void MAVLinkDecoder::emitFieldValue(const mavlink_message_t* msg, const MessageDescriptor_t& descriptor, const FieldDescriptor_t& field, int fieldId, bool multiComponent, quint64 time)
+{
+    const uint8_t* m = (const uint8_t*)&msg->payload64[0] + field.offset;
+
+    if (field.type == MAVLINK_TYPE_CHAR && field.arrayLength > 0) {
+        if (!descriptor.textFiltered) {
+            const char* str = (const char*)m;
+            QString string(_qualifiedName(msg->sysid, msg->compid, multiComponent, fieldId) + ": " + QString::fromLatin1(str, qstrnlen(str, field.arrayLength)));
+            emit textMessageReceived(msg->sysid, msg->compid, MAV_SEVERITY_INFO, string);
         }
-        else
-        {
-            // Single value
-            int64_t n = *((int64_t*)(m+msgInfo->fields[fieldid].wire_offset));
-            fieldType = "int64_t";
-            emit valueChanged(msg->sysid, name, fieldType, (qint64) n, time);
+        return;
+    }
+
+    // The named values are only built while someone still listens for them
+    static const QMetaMethod valueChangedSignal = QMetaMethod::fromSignal(&MAVLinkDecoder::valueChanged);
+    bool emitNamed = isSignalConnected(valueChangedSignal);
+
+    // Field names and units are only appended to by this thread, so reading them here needs no lock
+    int count = field.arrayLength > 0 ? field.arrayLength : 1;
+    for (int j = 0; j < count; j++) {
+        const uint8_t* data = m + (j * field.elementSize);
+        emit fieldValueChanged(msg->sysid, msg->compid, fieldId + j, field.numericReader(data), time);
+        if (emitNamed) {
+            emit valueChanged(msg->sysid, _qualifiedName(msg->sysid, msg->compid, multiComponent, fieldId + j), _fieldUnits[fieldId + j], field.variantReader(data), time);
         }
-        break;
-    default:
-        qDebug() << "WARNING: UNKNOWN MAVLINK TYPE";
     }
 }
@@ -2,6 +2,9 @@
 #define MAVLINKDECODER_H
 
 #include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
 #include "MAVLinkProtocol.h"
 
 class MAVLinkDecoder : public QThread
@@ -12,22 +15,71 @@ public:
 
     void run();
 
+    /// Returns the "msgname.field[.index]" name for a field id emitted through fieldValueChanged.
+    /// Safe to call from any thread.
+    QString fieldName(int fieldId) const;
+
+    /// Returns the type string (e.g. "float", "uint16_t[8]") for a field id emitted through fieldValueChanged.
+    /// Safe to call from any thread.
+    QString fieldUnit(int fieldId) const;
+
 signals:
     void textMessageReceived(int uasid, int componentid, int severity, const QString& text);
+    /// Allocates a name and variant per field, only emitted while connected. Plots use fieldValueChanged.
     void valueChanged(const int uasId, const QString& name, const QString& unit, const QVariant& value, const quint64 msec);
 
+    /// Numeric fast path for plotting consumers. Field ids are interned once per message/field/array element
+    /// and never change for the lifetime of the decoder, use fieldName/fieldUnit to resolve them. Emitted
+    /// from the decoder thread, connect with Qt::DirectConnection to avoid any allocation per frame.
+    void fieldValueChanged(int uasId, int componentId, int fieldId, double value, quint64 msec);
+
 public slots:
     /** @brief Receive one message from the protocol and decode it */
     void receiveMessage(LinkInterface* link,mavlink_message_t message);
 protected:
+    typedef QVariant (*VariantReader)(const uint8_t* data);
+    typedef double   (*NumericReader)(const uint8_t* data);
+
+    /// Precomputed description of a single message field
+    typedef struct {
+        const char*     name;           ///< Field name from the MAVLink message info
+        int             fieldId;        ///< Interned id, array elements use fieldId + index
+        uint16_t        offset;         ///< Offset into the payload
+        uint8_t         type;           ///< MAVLINK_TYPE_*
+        uint8_t         arrayLength;    ///< 0 for scalar fields
+        uint8_t         elementSize;    ///< Size of a single element in bytes
+        VariantReader   variantReader;
+        NumericReader   numericReader;
+    } FieldDescriptor_t;
+
+    typedef enum {
+        TimeSourceNone,
+        TimeSourceBootMs,
+        TimeSourceUsec
+    } TimeSource_t;
+
+    /// Precomputed description of a message, built once per msgid (and per port for the port prefixed messages)
+    typedef struct {
+        TimeSource_t                timeSource;
+        uint16_t                    timeOffset;
+        bool                        filtered;       ///< Message is not emitted at all
+        bool                        textFiltered;   ///< Char array fields are not emitted as text
+        QVector<FieldDescriptor_t>  fields;
+    } MessageDescriptor_t;
+
     /** @brief Emit the value of one message field */
-    void emitFieldValue(mavlink_message_t* msg, int fieldid, quint64 time);
+    void emitFieldValue(const mavlink_message_t* msg, const MessageDescriptor_t& descriptor, const FieldDescriptor_t& field, int fieldId, bool multiComponent, quint64 time);
     /** @brief Shift a timestamp in Unix time if necessary */
     quint64 getUnixTimeFromMs(int systemID, quint64 time);
 
+    const MessageDescriptor_t& _messageDescriptor(const mavlink_message_t* msg);
+    const MessageDescriptor_t& _buildMessageDescriptor(const mavlink_message_t* msg, const mavlink_message_info_t* msgInfo, int port);
+    int _namedFieldId(const char* name, int nameLength, const char* fieldName, const FieldDescriptor_t& field);
+    int _internField(const QString& name, const QString& unit);
+    const QString& _qualifiedName(int sysid, int compid, bool multiComponent, int fieldId);
+
     static const size_t cMessageIds = 256;
 
-    mavlink_message_t receivedMessages[cMessageIds];        ///< Available / known messages
     QMap<uint16_t, bool> messageFilter;                     ///< Message/field names not to emit
     QMap<uint16_t, bool> textMessageFilter;                 ///< Message/field names not to emit in text mode
     int componentID[cMessageIds];                           ///< Multi component detection
@@ -35,6 +87,13 @@ protected:
     quint64 onboardTimeOffset[cMessageIds];                 ///< Offset of onboard time from Unix epoch (of the receiving GCS)
     qint64 onboardToGCSUnixTimeOffsetAndDelay[cMessageIds]; ///< Offset of onboard time and GCS Unix time
     quint64 firstOnboardTime[cMessageIds];                  ///< First seen onboard time
+
+    QHash<quint32, MessageDescriptor_t> _messageDescriptors;    ///< Key: msgid << 9 | (port + 1)
+    QHash<QByteArray, int>              _namedFieldIds;         ///< Debug/named value name to field id
+    QHash<quint64, QString>             _qualifiedNames;        ///< Key: sysid, compid, field id. Value: "M1:C2:name"
+    mutable QMutex                      _fieldNamesMutex;
+    QVector<QString>                    _fieldNames;            ///< Indexed by field id
+    QVector<QString>                    _fieldUnits;            ///< Indexed by field id
 };
 
 #endif // MAVLINKDECODER_H
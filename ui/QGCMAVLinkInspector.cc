@@ -9,8 +9,7 @@
 #include <QList>
 #include <QDebug>
 
-const float QGCMAVLinkInspector::updateHzLowpass = 0.2f;
-const unsigned int QGCMAVLinkInspector::updateInterval = 1000U;
+const unsigned int QGCMAVLinkInspector::updateInterval = 500U;
 
 QGCMAVLinkInspector::QGCMAVLinkInspector(const QString& title, QAction* action, MAVLinkProtocol* protocol, QWidget *parent) :
     QGCDockWidget(title, action, parent),
@@ -42,9 +41,9 @@ QGCMAVLinkInspector::QGCMAVLinkInspector(const QString& title, QAction* action,
 
     // Connect external connections
     connect(qgcApp()->toolbox()->multiVehicleManager(), &MultiVehicleManager::vehicleAdded, this, &QGCMAVLinkInspector::_vehicleAdded);
-    connect(protocol, &MAVLinkProtocol::messageReceived, this, &QGCMAVLinkInspector::receiveMessage);
 
-    // Attach the UI's refresh rate to a timer.
+    // Messages are collected by the protocol, the view only samples the statistics from the timer
+    // so an open inspector costs nothing per message.
     connect(&updateTimer, &QTimer::timeout, this, &QGCMAVLinkInspector::refreshView);
     updateTimer.start(updateInterval);
     
@@ -107,13 +106,12 @@ void QGCMAVLinkInspector::addComponent(int uas, int component, const QString& na
  */
 void QGCMAVLinkInspector::clearView()
 {
-    QMap<int, mavlink_message_t* >::iterator ite;
-    for(ite=uasMessageStorage.begin(); ite!=uasMessageStorage.end();++ite)
-    {
-        delete ite.value();
-        ite.value() = NULL;
+    // Remember the current counts so only messages which arrive after the clear show up again
+    clearedMessageCounts.clear();
+    foreach (const MAVLinkMessageStats::MessageStats_t& stats, _protocol->messageStats()->snapshot()) {
+        quint64 key = ((quint64)stats.sysid << 32) | ((quint64)stats.compid << 24) | stats.msgid;
+        clearedMessageCounts[key] = stats.count;
     }
-    uasMessageStorage.clear();
 
     QMap<int, QMap<int, QTreeWidgetItem*>* >::iterator iteMsg;
     for (iteMsg=uasMsgTreeItems.begin(); iteMsg!=uasMsgTreeItems.end();++iteMsg)
@@ -126,6 +124,7 @@ void QGCMAVLinkInspector::clearView()
         {
             delete msgTreeItems->take(*listKeys);
         }
+        delete msgTreeItems;
     }
     uasMsgTreeItems.clear();
 
@@ -136,131 +135,83 @@ void QGCMAVLinkInspector::clearView()
         iteTree.value() = NULL;
     }
     uasTreeWidgetItems.clear();
-    
-    QMap<int, QMap<int, float>* >::iterator iteHz;
-    for (iteHz=uasMessageHz.begin(); iteHz!=uasMessageHz.end();++iteHz)
-    {
-
-        iteHz.value()->clear();
-        delete iteHz.value();
-        iteHz.value() = NULL;
-    }
-    uasMessageHz.clear();
-
-    QMap<int, QMap<int, unsigned int>* >::iterator iteCount;
-    for(iteCount=uasMessageCount.begin(); iteCount!=uasMessageCount.end();++iteCount)
-    {
-        iteCount.value()->clear();
-        delete iteCount.value();
-        iteCount.value() = NULL;
-    }
-    uasMessageCount.clear();
-
-    QMap<int, QMap<int, quint64>* >::iterator iteLast;
-    for(iteLast=uasLastMessageUpdate.begin(); iteLast!=uasLastMessageUpdate.end();++iteLast)
-    {
-        iteLast.value()->clear();
-        delete iteLast.value();
-        iteLast.value() = NULL;
-    }
-    uasLastMessageUpdate.clear();
-
-    onboardMessageInterval.clear();
 
     ui->treeWidget->clear();
 }
 
 void QGCMAVLinkInspector::refreshView()
 {
-    QMap<int, mavlink_message_t* >::const_iterator ite;
-
-    for(ite=uasMessageStorage.constBegin(); ite!=uasMessageStorage.constEnd();++ite)
-    {
-        mavlink_message_t* msg = ite.value();
-        const mavlink_message_info_t* msgInfo = mavlink_get_message_info(msg);
+    QList<MAVLinkMessageStats::MessageStats_t> statsList = _protocol->messageStats()->snapshot(selectedSystemID, selectedComponentID);
 
-        // Ignore NULL values
-        if (msg->msgid == 0xFF) continue;
+    // Messages with the same id from multiple components of a system are shown as a single entry,
+    // with the summed rate and the most recently received contents.
+    QMap<int, QMap<int, int> > latestStats;     ///< sysid -> msgid -> index into statsList
+    QMap<int, QMap<int, float> > summedHz;      ///< sysid -> msgid -> rate
 
-        // Update the message frenquency
+    for (int i=0; i<statsList.count(); i++) {
+        const MAVLinkMessageStats::MessageStats_t& stats = statsList[i];
 
-        // Get the previous frequency for low-pass filtering
-        float msgHz = 0.0f;
-        QMap<int, QMap<int, float>* >::const_iterator iteHz = uasMessageHz.find(msg->sysid);
-        QMap<int, float>* uasMsgHz = iteHz.value();
-
-        while((iteHz != uasMessageHz.end()) && (iteHz.key() == msg->sysid))
-        {
-            if(iteHz.value()->contains(msg->msgid))
-            {
-                uasMsgHz = iteHz.value();
-                msgHz = iteHz.value()->value(msg->msgid);
-                break;
-            }
-            ++iteHz;
+        quint64 key = ((quint64)stats.sysid << 32) | ((quint64)stats.compid << 24) | stats.msgid;
+        if (clearedMessageCounts.value(key, 0) == stats.count) {
+            // Nothing new since the view was cleared
+            continue;
         }
 
-        // Get the number of message received
-        float msgCount = 0;
-        QMap<int, QMap<int, unsigned int> * >::const_iterator iter = uasMessageCount.find(msg->sysid);
-        QMap<int, unsigned int>* uasMsgCount = iter.value();
-
-        while((iter != uasMessageCount.end()) && (iter.key()==msg->sysid))
-        {
-            if(iter.value()->contains(msg->msgid))
-            {
-                msgCount = (float) iter.value()->value(msg->msgid);
-                uasMsgCount = iter.value();
-                break;
-            }
-            ++iter;
+        summedHz[stats.sysid][stats.msgid] += stats.rateHz;
+        QMap<int, int>& latest = latestStats[stats.sysid];
+        if (!latest.contains(stats.msgid) || statsList[latest[stats.msgid]].ageMsecs > stats.ageMsecs) {
+            latest[stats.msgid] = i;
         }
+    }
 
-        // Compute the new low-pass filtered frequency and update the message count
-        msgHz = (1.0f-updateHzLowpass)* msgHz + updateHzLowpass*msgCount/((float)updateInterval/1000.0f);
-        uasMsgHz->insert(msg->msgid,msgHz);
-        uasMsgCount->insert(msg->msgid,(unsigned int) 0);
-
-        // Update the tree view
-        QString messageName("%1 (%2 Hz, #%3)");
-        messageName = messageName.arg(msgInfo->name).arg(msgHz, 3, 'f', 1).arg(msg->msgid);
-
-        addUAStoTree(msg->sysid);
+    foreach (int sysid, latestStats.keys()) {
+        addUAStoTree(sysid);
 
         // Look for the tree for the UAS sysid
-        QMap<int, QTreeWidgetItem*>* msgTreeItems = uasMsgTreeItems.value(msg->sysid);
+        QMap<int, QTreeWidgetItem*>* msgTreeItems = uasMsgTreeItems.value(sysid);
         if (!msgTreeItems)
         {
             // The UAS tree has not been created yet, no update
-            return;
+            continue;
         }
 
-        // Add the message with msgid to the tree if not done yet
-        if(!msgTreeItems->contains(msg->msgid))
-        {
-            QStringList fields;
-            fields << messageName;
-            QTreeWidgetItem* widget = new QTreeWidgetItem();
-            for (unsigned int i = 0; i < msgInfo->num_fields; ++i)
+        const QMap<int, int>& latest = latestStats[sysid];
+        foreach (int msgid, latest.keys()) {
+            const mavlink_message_t* msg = &statsList[latest[msgid]].lastMessage;
+            const mavlink_message_info_t* msgInfo = mavlink_get_message_info(msg);
+            if (!msgInfo) {
+                continue;
+            }
+
+            // Update the tree view
+            QString messageName("%1 (%2 Hz, #%3)");
+            messageName = messageName.arg(msgInfo->name).arg(summedHz[sysid][msgid], 3, 'f', 1).arg(msgid);
+
+            // Add the message with msgid to the tree if not done yet
+            if(!msgTreeItems->contains(msgid))
             {
-                QTreeWidgetItem* field = new QTreeWidgetItem();
-                widget->addChild(field);
+                QTreeWidgetItem* widget = new QTreeWidgetItem();
+                for (unsigned int i = 0; i < msgInfo->num_fields; ++i)
+                {
+                    QTreeWidgetItem* field = new QTreeWidgetItem();
+                    widget->addChild(field);
+                }
+                msgTreeItems->insert(msgid,widget);
+                QList<int> groupKeys = msgTreeItems->uniqueKeys();
+                int insertIndex = groupKeys.indexOf(msgid);
+                uasTreeWidgetItems.value(sysid)->insertChild(insertIndex,widget);
             }
-            msgTreeItems->insert(msg->msgid,widget);
-            QList<int> groupKeys = msgTreeItems->uniqueKeys();
-            int insertIndex = groupKeys.indexOf(msg->msgid);
-            uasTreeWidgetItems.value(msg->sysid)->insertChild(insertIndex,widget);
-        }
 
-        // Update the message
-        QTreeWidgetItem* message = msgTreeItems->value(msg->msgid);
-        if(message)
-        {
-            message->setFirstColumnSpanned(true);
-            message->setData(0, Qt::DisplayRole, QVariant(messageName));
-            for (unsigned int i = 0; i < msgInfo->num_fields; ++i)
+            // Update the message
+            QTreeWidgetItem* message = msgTreeItems->value(msgid);
+            if(message)
             {
-                updateField(msg, msgInfo, i, message->child(i));
+                message->setFirstColumnSpanned(true);
+                message->setData(0, Qt::DisplayRole, QVariant(messageName));
+                for (unsigned int i = 0; i < msgInfo->num_fields; ++i)
+                {
+                    updateField(msg, msgInfo, i, message->child(i));
+                }
             }
         }
     }
@@ -286,170 +237,26 @@ void QGCMAVLinkInspector::addUAStoTree(int sysId)
     }
 }
 
-void QGCMAVLinkInspector::receiveMessage(LinkInterface* link,mavlink_message_t message)
-{
-    Q_UNUSED(link);
-
-    quint64 receiveTime;
-    
-    if (selectedSystemID != 0 && selectedSystemID != message.sysid) return;
-    if (selectedComponentID != 0 && selectedComponentID != message.compid) return;
-
-    // Create dynamically an array to store the messages for each UAS
-    if (!uasMessageStorage.contains(message.sysid))
-    {
-        mavlink_message_t* msg = new mavlink_message_t;
-        *msg = message;
-        uasMessageStorage.insertMulti(message.sysid,msg);
-    }
-
-    bool msgFound = false;
-    QMap<int, mavlink_message_t* >::const_iterator iteMsg = uasMessageStorage.find(message.sysid);
-    mavlink_message_t* uasMessage = iteMsg.value();
-    while((iteMsg != uasMessageStorage.end()) && (iteMsg.key() == message.sysid))
-    {
-        if (iteMsg.value()->msgid == message.msgid)
-        {
-            msgFound = true;
-            uasMessage = iteMsg.value();
-            break;
-        }
-        ++iteMsg;
-    }
-    if (!msgFound)
-    {
-        mavlink_message_t* msgIdMessage = new mavlink_message_t;
-        *msgIdMessage = message;
-        uasMessageStorage.insertMulti(message.sysid,msgIdMessage);
-    }
-    else
-    {
-        *uasMessage = message;
-    }
-
-    // Looking if this message has already been received once
-    msgFound = false;
-    QMap<int, QMap<int, quint64>* >::const_iterator ite = uasLastMessageUpdate.find(message.sysid);
-    QMap<int, quint64>* lastMsgUpdate = ite.value();
-    while((ite != uasLastMessageUpdate.end()) && (ite.key() == message.sysid))
-    {   
-        if(ite.value()->contains(message.msgid))
-        {
-            msgFound = true;
-
-            // Point to the found message
-            lastMsgUpdate = ite.value();
-            break;
-        }
-        ++ite;
-    }
-
-    receiveTime = QGC::groundTimeMilliseconds();
-
-    // If the message doesn't exist, create a map for the frequency, message count and time of reception
-    if(!msgFound)
-    {
-        // Create a map for the message frequency
-        QMap<int, float>* messageHz = new QMap<int,float>;
-        messageHz->insert(message.msgid,0.0f);
-        uasMessageHz.insertMulti(message.sysid,messageHz);
-
-        // Create a map for the message count
-        QMap<int, unsigned int>* messagesCount = new QMap<int, unsigned int>;
-        messagesCount->insert(message.msgid,0);
-        uasMessageCount.insertMulti(message.sysid,messagesCount);
-
-        // Create a map for the time of reception of the message
-        QMap<int, quint64>* lastMessage = new QMap<int, quint64>;
-        lastMessage->insert(message.msgid,receiveTime);
-        uasLastMessageUpdate.insertMulti(message.sysid,lastMessage);
-
-        // Point to the created message
-        lastMsgUpdate = lastMessage;
-    }
-    else
-    {
-        // The message has been found/created
-        if ((lastMsgUpdate->contains(message.msgid))&&(uasMessageCount.contains(message.sysid)))
-        {
-            // Looking for and updating the message count
-            unsigned int count = 0;
-            QMap<int, QMap<int, unsigned int>* >::const_iterator iter = uasMessageCount.find(message.sysid);
-            QMap<int, unsigned int> * uasMsgCount = iter.value();
-            while((iter != uasMessageCount.end()) && (iter.key() == message.sysid))
-            {
-                if(iter.value()->contains(message.msgid))
-                {
-                    uasMsgCount = iter.value();
-                    count = uasMsgCount->value(message.msgid,0);
-                    uasMsgCount->insert(message.msgid,count+1);
-                    break;
-                }
-                ++iter;
-            }
-        }
-        lastMsgUpdate->insert(message.msgid,receiveTime);
-    }
-
-    if (selectedSystemID == 0 || selectedComponentID == 0)
-    {
-        return;
-    }
-
-    switch (message.msgid)
-    {
-        case MAVLINK_MSG_ID_DATA_STREAM:
-            {
-                mavlink_data_stream_t stream;
-                mavlink_msg_data_stream_decode(&message, &stream);
-                onboardMessageInterval.insert(stream.stream_id, stream.message_rate);
-            }
-            break;
-
-    }
-}
-
 QGCMAVLinkInspector::~QGCMAVLinkInspector()
 {
     clearView();
     delete ui;
 }
 
-void QGCMAVLinkInspector::updateField(mavlink_message_t* msg, const mavlink_message_info_t* msgInfo, int fieldid, QTreeWidgetItem* item)
+void QGCMAVLinkInspector::updateField(const mavlink_message_t* msg, const mavlink_message_info_t* msgInfo, int fieldid, QTreeWidgetItem* item)
 {
     // Add field tree widget item
     item->setData(0, Qt::DisplayRole, QVariant(msgInfo->fields[fieldid].name));
-    
-    bool msgFound = false;
-    QMap<int, mavlink_message_t* >::const_iterator iteMsg = uasMessageStorage.find(msg->sysid);
-    mavlink_message_t* uasMessage = iteMsg.value();
-    while((iteMsg != uasMessageStorage.end()) && (iteMsg.key() == msg->sysid))
-    {
-        if (iteMsg.value()->msgid == msg->msgid)
-        {
-            msgFound = true;
-            uasMessage = iteMsg.value();
-            break;
-        }
-        ++iteMsg;
-    }
 
-    if (!msgFound)
-    {
-        return;
-    }
-
-    uint8_t* m = (uint8_t*)&uasMessage->payload64[0];
+    uint8_t* m = (uint8_t*)&msg->payload64[0];
 
     switch (msgInfo->fields[fieldid].type)
     {
     case MAVLINK_TYPE_CHAR:
         if (msgInfo->fields[fieldid].array_length > 0)
         {
-            char* str = (char*)(m+msgInfo->fields[fieldid].wire_offset);
-            // Enforce null termination
-            str[msgInfo->fields[fieldid].array_length-1] = '\0';
-            QString string(str);
+            const char* str = (const char*)(m+msgInfo->fields[fieldid].wire_offset);
+            QString string = QString::fromLatin1(str, qstrnlen(str, msgInfo->fields[fieldid].array_length));
             item->setData(2, Qt::DisplayRole, "char");
             item->setData(1, Qt::DisplayRole, string);
         }
@@ -11,6 +11,8 @@ Linecharts::Linecharts(const QString& title, QAction* action, MAVLinkDecoder* de
 {
     init();
 
+    connect(_mavlinkDecoder, &MAVLinkDecoder::fieldValueChanged, this, &Linecharts::_fieldValueChanged);
+
     this->setVisible(false);
 }
 
@@ -22,10 +24,39 @@ QWidget* Linecharts::_newVehicleWidget(Vehicle* vehicle, QWidget* parent)
     connect(vehicle->uas(), &UAS::valueChanged, widget, &LinechartWidget::appendData);
 
     // Connect decoder
-    connect(_mavlinkDecoder, &MAVLinkDecoder::valueChanged, widget, &LinechartWidget::appendData);
+    connect(this, &Linecharts::valueChanged, widget, &LinechartWidget::appendData);
 
     // Select system
     widget->setActive(true);
 
     return widget;
 }
+
+/// Curve names are only built the first time a field is seen from a system/component
+void Linecharts::_fieldValueChanged(int uasId, int componentId, int fieldId, double value, quint64 msec)
+{
+    // Multi component detection, the component is only part of the name once several send the field
+    QHash<int, int>::iterator component = _fieldComponents.find(fieldId);
+    if (component == _fieldComponents.end()) {
+        _fieldComponents.insert(fieldId, componentId);
+    } else if (component.value() != -1 && component.value() != componentId) {
+        component.value() = -1;
+        _fieldCurves.clear();
+    }
+
+    quint64 key = ((quint64)fieldId << 16) | ((quint64)componentId << 8) | (quint64)uasId;
+    QHash<quint64, FieldCurve_t>::iterator iter = _fieldCurves.find(key);
+    if (iter == _fieldCurves.end()) {
+        FieldCurve_t curve;
+        curve.name = _mavlinkDecoder->fieldName(fieldId);
+        if (_fieldComponents.value(fieldId) == -1) {
+            curve.name.prepend(QString("C%1:").arg(componentId));
+        }
+        curve.name.prepend(QString("M%1:").arg(uasId));
+        curve.unit = _mavlinkDecoder->fieldUnit(fieldId);
+        curve.isDouble = curve.unit.startsWith("float") || curve.unit.startsWith("double");
+        iter = _fieldCurves.insert(key, curve);
+    }
+
+    emit valueChanged(uasId, iter->name, iter->unit, iter->isDouble ? QVariant(value) : QVariant((qlonglong)value), msec);
+}
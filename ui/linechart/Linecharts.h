@@ -20,13 +20,26 @@ signals:
     /** @brief This signal is emitted once a logfile has been finished writing */
     void logfileWritten(QString fileName);
     void visibilityChanged(bool visible);
+    /** @brief Decoder values with their curve names resolved, fed to every vehicle widget */
+    void valueChanged(const int uasId, const QString& name, const QString& unit, const QVariant& value, const quint64 msec);
 
 protected:
     // Override from MultiVehicleDockWidget
     virtual QWidget* _newVehicleWidget(Vehicle* vehicle, QWidget* parent);
 
+private slots:
+    void _fieldValueChanged(int uasId, int componentId, int fieldId, double value, quint64 msec);
+
 private:
+    typedef struct {
+        QString name;       ///< "M<sysid>:[C<compid>:]msgname.field"
+        QString unit;
+        bool    isDouble;
+    } FieldCurve_t;
+
     MAVLinkDecoder* _mavlinkDecoder;
+    QHash<quint64, FieldCurve_t>    _fieldCurves;       ///< Key: field id, component id, system id
+    QHash<int, int>                 _fieldComponents;   ///< First component seen for a field id, -1 once several were seen
 };
 
 #endif // LINECHARTS_H